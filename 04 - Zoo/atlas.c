@@ -0,0 +1,462 @@
+/**
+ * @file
+ *
+ * Das Modul packt Texturen als Kacheln auf wenige grosse Atlas-Seiten, so
+ * dass beim Zeichnen kaum noch zwischen Texturen gewechselt werden muss.
+ *
+ * Kacheln werden regalweise (Shelf-Packing) auf die Seiten verteilt: eine
+ * Kachel kommt in das niedrigste Regal, in das sie noch passt, sonst wird
+ * oben auf der Seite ein neues Regal eroeffnet, sonst eine neue Seite.
+ *
+ * Jede Kachel ist von einem Rand der Breite ATLAS_GUTTER umgeben, der auf
+ * jeder Stufe neu aus den Randpixeln der Stufe gebildet wird. Lage und
+ * Ausmasse aller Kacheln sind Vielfache von 2^(ATLAS_LEVELS - 1), so dass
+ * jede Kachel bis zur letzten Stufe auf ganzen Texeln liegt und dort noch
+ * einen Rand von einem Texel hat.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "atlas.h"
+#include "cgimage.h"
+#include "mipmap.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Kantenlaenge einer Seite, sofern GL sie erlaubt */
+#define ATLAS_PAGE_SIZE (1024)
+
+/** Maximale Anzahl der Seiten */
+#define ATLAS_PAGES (4)
+
+/** Maximale Anzahl der Regale pro Seite */
+#define ATLAS_SHELVES (32)
+
+/** Raster fuer Lage und Ausmasse der Kacheln */
+#define ATLAS_UNIT (1 << (ATLAS_LEVELS - 1))
+
+/** Breite des Randes um jede Kachel auf Stufe 0 */
+#define ATLAS_GUTTER (ATLAS_UNIT)
+
+/** Kleinste Kachel samt Rand */
+#define ATLAS_MIN_TILE (4 * ATLAS_GUTTER)
+
+/** Internes Format der Seiten, alle Texturen des Zoos sind RGB */
+#define ATLAS_FORMAT (GL_RGB)
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Regal: ein Streifen der Seite, der von links nach rechts gefuellt wird */
+typedef struct {
+  GLint y       /* Obere Kante           */
+      , height  /* Hoehe                 */
+      , used    /* Belegte Breite        */
+      ;
+} AtlasShelf;
+
+/** Atlas-Seite */
+typedef struct {
+  GLuint id;                        /* Textur                 */
+  GLint top;                        /* Hoehe aller Regale     */
+  int shelves;                      /* Anzahl der Regale      */
+  AtlasShelf shelf[ATLAS_SHELVES];  /* Regale von oben nach unten */
+} AtlasPage;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * -------------------------------------------------------------------------- */
+
+/** Minimum und Maximum von a und b */
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+static AtlasPage pages[ATLAS_PAGES]; /* Seiten                       */
+static int pageCount = 0;            /* Anzahl der angelegten Seiten */
+static GLint pageSize = 0;           /* Kantenlaenge aller Seiten    */
+
+static GLuint boundPage = 0;               /* Gebundene Seite, 0 wenn unbekannt */
+static const AtlasTile * boundTile = NULL; /* Kachel der Texturmatrix           */
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Gibt die zu x naechstgelegene Zweierpotenz zurueck, wie sie auch
+ * mipmapBuild2D fuer einzelne Texturen waehlt.
+ *
+ * @param[in] x Zahl > 0.
+ *
+ * @return Zweierpotenz.
+ */
+static int nearestPowerOfTwo(int x)
+{
+  int p = 1;
+
+  while (2 * p <= x)
+    p <<= 1;
+
+  return (x - p > 2 * p - x)
+       ? 2 * p
+       : p
+       ;
+}
+
+/**
+ * Bestimmt einmalig die Kantenlaenge der Seiten, hoechstens ATLAS_PAGE_SIZE.
+ */
+static void initPageSize(void)
+{
+  GLint maxSize;
+
+  if (pageSize == 0)
+  {
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    pageSize = MIN(ATLAS_PAGE_SIZE, maxSize);
+  }
+}
+
+/**
+ * Bindet die Seite page, falls sie nicht schon gebunden ist.
+ *
+ * @param[in] page Textur der Seite.
+ */
+static void bindPage(GLuint page)
+{
+  if (page != boundPage)
+  {
+    glBindTexture(GL_TEXTURE_2D, page);
+    boundPage = page;
+  }
+}
+
+/**
+ * Legt eine neue, leere Seite samt aller Stufen an.
+ *
+ * @return Zeiger auf die Seite oder NULL, wenn alle Seiten belegt sind.
+ */
+static AtlasPage * newPage(void)
+{
+  AtlasPage * page;
+
+  int level;
+
+  if (pageCount == ATLAS_PAGES)
+    return NULL;
+
+  page = &pages[pageCount++];
+
+  page->top     = 0;
+  page->shelves = 0;
+
+  glGenTextures(1, &page->id);
+  bindPage(page->id);
+
+  for (level = 0; level < ATLAS_LEVELS; ++level)
+    glTexImage2D( GL_TEXTURE_2D
+                , level
+                , ATLAS_FORMAT
+                , pageSize >> level
+                , pageSize >> level
+                , 0
+                , ATLAS_FORMAT
+                , GL_UNSIGNED_BYTE
+                , NULL);
+
+  /* Nur so viele Stufen, wie die Raender tragen */
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_LEVELS - 1);
+
+  /* Trilinear zwischen den Stufen, auf der letzten liegt der Rand noch bei
+   * einem Texel, so dass auch dort keine Nachbarkachel durchscheint */
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Atlas page %i (%ix%i) created.\n", pageCount, pageSize, pageSize);
+  #endif
+
+  return page;
+}
+
+/**
+ * Sucht auf allen Seiten das niedrigste Regal, in das eine Kachel der
+ * Groesse width x height noch passt.
+ *
+ * @param[in]  width  Breite der Kachel.
+ * @param[in]  height Hoehe der Kachel.
+ * @param[out] page   Seite des Regals.
+ *
+ * @return Zeiger auf das Regal oder NULL.
+ */
+static AtlasShelf * findShelf(GLsizei width, GLsizei height, AtlasPage ** page)
+{
+  AtlasShelf * best = NULL;
+
+  int p
+    , s
+    ;
+
+  for (p = 0; p < pageCount; ++p)
+    for (s = 0; s < pages[p].shelves; ++s)
+    {
+      AtlasShelf * shelf = &pages[p].shelf[s];
+
+      if (shelf->height >= height
+       && pageSize - shelf->used >= width
+       && (best == NULL || shelf->height < best->height))
+      {
+        best  = shelf;
+        *page = &pages[p];
+      }
+    }
+
+  return best;
+}
+
+/**
+ * Eroeffnet auf der ersten Seite mit genuegend Platz ein neues Regal der
+ * Hoehe height, notfalls auf einer neuen Seite.
+ *
+ * @param[in]  height Hoehe des Regals.
+ * @param[out] page   Seite des Regals.
+ *
+ * @return Zeiger auf das Regal oder NULL.
+ */
+static AtlasShelf * newShelf(GLsizei height, AtlasPage ** page)
+{
+  AtlasShelf * shelf;
+
+  int p;
+
+  *page = NULL;
+
+  for (p = 0; p < pageCount && *page == NULL; ++p)
+    if (pageSize - pages[p].top >= height && pages[p].shelves < ATLAS_SHELVES)
+      *page = &pages[p];
+
+  if (*page == NULL && (*page = newPage()) == NULL)
+    return NULL;
+
+  shelf = &(*page)->shelf[(*page)->shelves++];
+
+  shelf->y      = (*page)->top;
+  shelf->height = height;
+  shelf->used   = 0;
+
+  (*page)->top += height;
+
+  return shelf;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Bestimmt die Ausmasse der Kachel samt Rand fuer ein Bild der Groesse
+ * width x height: wie bei mipmapBuild2D die naechste Zweierpotenz, das Bild
+ * wird dann auf das Innere ohne Rand skaliert.
+ *
+ * @param[in]  width      Breite des Bildes.
+ * @param[in]  height     Hoehe des Bildes.
+ * @param[out] tileWidth  Breite der Kachel.
+ * @param[out] tileHeight Hoehe der Kachel.
+ */
+extern void atlasTileSize(int width, int height, GLsizei * tileWidth, GLsizei * tileHeight)
+{
+  initPageSize();
+
+  *tileWidth  = MIN(MAX(nearestPowerOfTwo(MAX(width,  1)), ATLAS_MIN_TILE), pageSize);
+  *tileHeight = MIN(MAX(nearestPowerOfTwo(MAX(height, 1)), ATLAS_MIN_TILE), pageSize);
+}
+
+/**
+ * Bestimmt die Ausmasse des Inneren der Kachel tile ohne Rand, also die
+ * Groesse, die die erste Stufe eines Bildes fuer atlasUploadLevels hat.
+ *
+ * @param[in]  tile   Kachel.
+ * @param[out] width  Breite des Inneren.
+ * @param[out] height Hoehe des Inneren.
+ */
+extern void atlasTileInterior(const AtlasTile * tile, GLsizei * width, GLsizei * height)
+{
+  *width  = tile->width  - 2 * ATLAS_GUTTER;
+  *height = tile->height - 2 * ATLAS_GUTTER;
+}
+
+/**
+ * Reserviert einen Platz fuer eine Kachel der Groesse width x height (samt
+ * Rand, siehe atlasTileSize). Passt sie auf keine Seite, wird eine neue
+ * angelegt. Die Seite der Kachel ist danach gebunden.
+ *
+ * @param[in]  width  Breite der Kachel.
+ * @param[in]  height Hoehe der Kachel.
+ * @param[out] tile   Platzierte Kachel.
+ *
+ * @return TRUE  wenn ein Platz gefunden wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasPlace(GLsizei width, GLsizei height, AtlasTile * tile)
+{
+  AtlasPage * page = NULL;
+
+  AtlasShelf * shelf;
+
+  initPageSize();
+
+  /* Nur Kacheln im Raster, die auch auf der letzten Stufe einen Rand haben */
+  if (width < ATLAS_MIN_TILE || height < ATLAS_MIN_TILE
+   || width > pageSize || height > pageSize
+   || width % ATLAS_UNIT != 0 || height % ATLAS_UNIT != 0)
+    return FALSE;
+
+  shelf = findShelf(width, height, &page);
+
+  if (shelf == NULL)
+    shelf = newShelf(height, &page);
+
+  if (shelf == NULL)
+    return FALSE;
+
+  tile->page   = page->id;
+  tile->x      = shelf->used;
+  tile->y      = shelf->y;
+  tile->width  = width;
+  tile->height = height;
+
+  shelf->used += width;
+
+  bindPage(page->id);
+
+  return TRUE;
+}
+
+/**
+ * Erzeugt alle Stufen des Bildes image und laedt sie in die Kachel tile.
+ * Die Seite der Kachel bleibt danach gebunden.
+ *
+ * @param[in] tile   Platzierte Kachel.
+ * @param[in] image  Bild.
+ * @param[in] format Pixelformat des Bildes (GL_LUMINANCE, GL_RGB, ...).
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind.
+ * @param[out] levels Wenn nicht NULL: die hochgeladenen Stufen samt Rand,
+ *                   dicht gepackt (siehe mipmapBuildTile), mit free
+ *                   freizugeben.
+ *
+ * @return TRUE  wenn die Kachel hochgeladen wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasUpload(const AtlasTile * tile, const CGImage * image, GLenum format, Boolean srgb, unsigned char ** levels)
+{
+  if (tile->page == 0)
+    return FALSE;
+
+  bindPage(tile->page);
+
+  return mipmapBuildTile( image
+                        , format
+                        , srgb
+                        , tile->x
+                        , tile->y
+                        , tile->width
+                        , tile->height
+                        , ATLAS_GUTTER
+                        , ATLAS_LEVELS
+                        , levels) != 0;
+}
+
+/**
+ * Laedt die fertig berechneten Stufen levels in die Kachel tile.
+ *
+ * @param[in] tile   Platzierte Kachel.
+ * @param[in] levels ATLAS_LEVELS Bilder, jedes halb so gross wie das
+ *                   vorige, das erste so gross wie das Innere der Kachel.
+ * @param[in] format Pixelformat der Bilder.
+ *
+ * @return TRUE  wenn die Kachel hochgeladen wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasUploadLevels(const AtlasTile * tile, const CGImage * const * levels, GLenum format)
+{
+  if (tile->page == 0)
+    return FALSE;
+
+  bindPage(tile->page);
+
+  return mipmapUploadTile( levels
+                         , format
+                         , tile->x
+                         , tile->y
+                         , tile->width
+                         , tile->height
+                         , ATLAS_GUTTER
+                         , ATLAS_LEVELS) != 0;
+}
+
+/**
+ * Bindet die Seite der Kachel tile, falls sie nicht schon gebunden ist, und
+ * bildet Texturkoordinaten aus [0, 1] auf das Innere der Kachel ab.
+ * Der Matrixmodus ist danach GL_MODELVIEW.
+ *
+ * @param[in] tile Kachel.
+ */
+extern void atlasBind(const AtlasTile * tile)
+{
+  bindPage(tile->page);
+
+  if (tile != boundTile)
+  {
+    glMatrixMode(GL_TEXTURE);
+    glLoadIdentity();
+    glTranslatef( (GLfloat) (tile->x + ATLAS_GUTTER) / pageSize
+                , (GLfloat) (tile->y + ATLAS_GUTTER) / pageSize
+                , 0.0f);
+    glScalef( (GLfloat) (tile->width  - 2 * ATLAS_GUTTER) / pageSize
+            , (GLfloat) (tile->height - 2 * ATLAS_GUTTER) / pageSize
+            , 1.0f);
+    glMatrixMode(GL_MODELVIEW);
+
+    boundTile = tile;
+  }
+}
+
+/**
+ * Vergisst, welche Seite gebunden ist. Gibt es nur eine Seite, so ist es
+ * immer diese, da alle Texturen ueber den Atlas gebunden werden.
+ */
+extern void atlasInvalidate(void)
+{
+  boundPage = pageCount == 1
+            ? pages[0].id
+            : 0
+            ;
+  boundTile = NULL;
+}
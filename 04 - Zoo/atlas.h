@@ -0,0 +1,117 @@
+#ifndef __ATLAS_H__
+#define __ATLAS_H__
+/**
+ * @file
+ *
+ * Das Modul packt Texturen als Kacheln auf wenige grosse Atlas-Seiten, so
+ * dass beim Zeichnen kaum noch zwischen Texturen gewechselt werden muss.
+ * Jede Kachel hat einen Rand, der auf jeder Mipmap-Stufe die Randpixel der
+ * Kachel wiederholt. Texturkoordinaten aus [0, 1] werden beim Binden ueber
+ * die Texturmatrix auf das Innere der Kachel abgebildet.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+#include <GL/gl.h>
+
+#include "cgimage.h"
+#include "types.h"
+
+/** Kachel auf einer Atlas-Seite */
+typedef struct {
+  GLuint page;    /* Textur der Seite, 0 solange nicht platziert */
+  GLint x         /* Lage und Ausmasse samt Rand auf Stufe 0     */
+      , y
+      , width
+      , height
+      ;
+} AtlasTile;
+
+/**
+ * Anzahl der Mipmap-Stufen jeder Atlas-Seite.
+ */
+#define ATLAS_LEVELS (4)
+
+/**
+ * Bestimmt die Ausmasse der Kachel samt Rand fuer ein Bild der Groesse
+ * width x height.
+ *
+ * @param[in]  width      Breite des Bildes.
+ * @param[in]  height     Hoehe des Bildes.
+ * @param[out] tileWidth  Breite der Kachel.
+ * @param[out] tileHeight Hoehe der Kachel.
+ */
+extern void atlasTileSize(int width, int height, GLsizei * tileWidth, GLsizei * tileHeight);
+
+/**
+ * Bestimmt die Ausmasse des Inneren der Kachel tile ohne Rand, also die
+ * Groesse, die die erste Stufe eines Bildes fuer atlasUploadLevels hat.
+ *
+ * @param[in]  tile   Kachel.
+ * @param[out] width  Breite des Inneren.
+ * @param[out] height Hoehe des Inneren.
+ */
+extern void atlasTileInterior(const AtlasTile * tile, GLsizei * width, GLsizei * height);
+
+/**
+ * Reserviert einen Platz fuer eine Kachel der Groesse width x height (samt
+ * Rand, siehe atlasTileSize). Passt sie auf keine Seite, wird eine neue
+ * angelegt. Die Seite der Kachel ist danach gebunden.
+ *
+ * @param[in]  width  Breite der Kachel.
+ * @param[in]  height Hoehe der Kachel.
+ * @param[out] tile   Platzierte Kachel.
+ *
+ * @return TRUE  wenn ein Platz gefunden wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasPlace(GLsizei width, GLsizei height, AtlasTile * tile);
+
+/**
+ * Erzeugt alle Stufen des Bildes image und laedt sie in die Kachel tile.
+ * Die Seite der Kachel bleibt danach gebunden.
+ *
+ * @param[in] tile   Platzierte Kachel.
+ * @param[in] image  Bild.
+ * @param[in] format Pixelformat des Bildes (GL_LUMINANCE, GL_RGB, ...).
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind.
+ * @param[out] levels Wenn nicht NULL: die hochgeladenen Stufen samt Rand,
+ *                   dicht gepackt (siehe mipmapBuildTile), mit free
+ *                   freizugeben.
+ *
+ * @return TRUE  wenn die Kachel hochgeladen wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasUpload(const AtlasTile * tile, const CGImage * image, GLenum format, Boolean srgb, unsigned char ** levels);
+
+/**
+ * Laedt fertig berechnete Stufen in die Kachel tile, ohne zu filtern.
+ * Die Seite der Kachel bleibt danach gebunden.
+ *
+ * @param[in] tile   Platzierte Kachel.
+ * @param[in] levels ATLAS_LEVELS Bilder, jedes halb so gross wie das
+ *                   vorige, das erste so gross wie das Innere der Kachel.
+ * @param[in] format Pixelformat der Bilder.
+ *
+ * @return TRUE  wenn die Kachel hochgeladen wurde
+ *         FALSE sonst.
+ */
+extern Boolean atlasUploadLevels(const AtlasTile * tile, const CGImage * const * levels, GLenum format);
+
+/**
+ * Bindet die Seite der Kachel tile, falls sie nicht schon gebunden ist, und
+ * bildet Texturkoordinaten aus [0, 1] auf das Innere der Kachel ab.
+ * Der Matrixmodus ist danach GL_MODELVIEW.
+ *
+ * @param[in] tile Kachel.
+ */
+extern void atlasBind(const AtlasTile * tile);
+
+/**
+ * Vergisst, welche Seite gebunden ist. Muss aufgerufen werden, wenn der
+ * GL-Zustand nicht mehr dem zuletzt gebundenen entspricht, etwa zu Beginn
+ * einer Displayliste oder nach deren Aufruf.
+ */
+extern void atlasInvalidate(void);
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file
+ *
+ * Huellquader der Objekte des Levels.
+ *
+ * Die Ausmasse jeder Zeichenfunktion im Objektkoordinatensystem stehen in
+ * einer Tabelle, sie ergeben sich aus den Skalierungen in drawing.c. Der
+ * Quader in Weltkoordinaten umschliesst den um r gedrehten und um t
+ * verschobenen lokalen Quader.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "bounds.h"
+#include "level.h"
+#include "logic.h"
+#include "types.h"
+#include "vector.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+#define PI (3.1415926535897932384626433832795029)
+#define DEGTORAD(x) ((x)*(PI)/(180))
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Ausmasse der Zeichenfunktionen im Objektkoordinatensystem, samt Beinen,
+ * Kopf und Schwanz. Gitter und Glas teilen sich Kaefig und Decke, der
+ * Quader umschliesst beide.
+ */
+static const BoundsBox bounds[DF_DUMMY] =
+  { {{-5.0,    0.0,   -5.0  }, {5.0,   0.0,   5.0  }} /* Ground        */
+  , {{-1.0,   -0.1,   -0.6  }, {1.0,   0.1,   0.6  }} /* Socket        */
+  , {{-1.01,  -0.005, -0.01 }, {1.01,  1.005, 0.01 }} /* Fence         */
+  , {{-1.0,   -0.025, -1.0  }, {1.0,   0.025, 1.0  }} /* Fence Ceiling */
+  , {{-0.99,  -0.1,   -0.39 }, {0.99,  0.1,   0.39 }} /* Pool          */
+  , {{-0.99,   0.0,   -0.39 }, {0.99,  0.0,   0.39 }} /* Water         */
+  , {{-0.1,   -0.175, -0.18 }, {0.1,   0.18,  0.2  }} /* Pig           */
+  , {{-0.1,   -0.2,   -0.15 }, {0.1,   0.1,   0.15 }} /* Giraffe       */
+  , {{-0.064,  0.0,   -0.08 }, {0.064, 0.4,   0.08 }} /* Giraffe Head  */
+  , {{-0.1,   -0.06,  -0.03 }, {0.1,   0.06,  0.03 }} /* Fish          */
+  , {{-1.0,   -1.0,   -1.0  }, {1.0,   1.0,   1.0  }} /* Sun           */
+  , {{-0.25,  -0.25,  -0.25 }, {0.25,  0.25,  0.25 }} /* Giraffe Cube  */
+  };
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet die lokale Matrix des Objekts i aus Translation t und Drehung
+ * um r. Die Drehung entspricht glRotate(i->a, i->r).
+ *
+ * @param[in]  i     Objekt.
+ * @param[out] local Lokale Matrix, spaltenweise.
+ */
+static void localOfItem(const LevelItem * i, double local[16])
+{
+  double axis[3]
+       , len = vectorLength(i->r)
+       , co  = cos(DEGTORAD(i->a))
+       , si  = sin(DEGTORAD(i->a))
+       ;
+
+  int j
+    , k
+    ;
+
+  /* Ohne Drehachse keine Drehung */
+  if (len < DBL_EPSILON)
+  {
+    co  = 1.0;
+    si  = 0.0;
+    len = 1.0;
+  }
+
+  axis[0] = i->r.x / len;
+  axis[1] = i->r.y / len;
+  axis[2] = i->r.z / len;
+
+  /* Rotationsmatrix wie bei glRotate, spaltenweise */
+  for (k = 0; k < 3; ++k)
+    for (j = 0; j < 3; ++j)
+      local[k * 4 + j] = axis[j] * axis[k] * (1.0 - co) + (j == k ? co : 0.0);
+
+  local[4] -= axis[2] * si;
+  local[8] += axis[1] * si;
+  local[1] += axis[2] * si;
+  local[9] -= axis[0] * si;
+  local[2] -= axis[1] * si;
+  local[6] += axis[0] * si;
+
+  local[3]  = 0.0;
+  local[7]  = 0.0;
+  local[11] = 0.0;
+
+  local[12] = i->t.x;
+  local[13] = i->t.y;
+  local[14] = i->t.z;
+  local[15] = 1.0;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet die Weltmatrix des Objekts i. Haengt i an einem anderen Objekt,
+ * wird dessen Weltmatrix vorangestellt.
+ *
+ * @param[in]  i     Objekt.
+ * @param[out] world Weltmatrix, spaltenweise.
+ */
+extern void boundsWorldOfItem(const LevelItem * i, double world[16])
+{
+  const LevelItem * parent = logicGetParentItem(i);
+
+  double p[16]
+       , local[16]
+       ;
+
+  int j
+    , k
+    , l
+    ;
+
+  localOfItem(i, world);
+
+  if (parent == NULL)
+    return;
+
+  boundsWorldOfItem(parent, p);
+
+  for (j = 0; j < 16; ++j)
+    local[j] = world[j];
+
+  /* world = p * local */
+  for (k = 0; k < 4; ++k)
+    for (j = 0; j < 4; ++j)
+    {
+      world[k * 4 + j] = 0.0;
+
+      for (l = 0; l < 4; ++l)
+        world[k * 4 + j] += p[l * 4 + j] * local[k * 4 + l];
+    }
+}
+
+/**
+ * Berechnet den Huellquader des Objekts i in Weltkoordinaten.
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Huellquader von i.
+ */
+extern BoundsBox boundsOfItem(const LevelItem * i)
+{
+  double world[16];
+
+  boundsWorldOfItem(i, world);
+
+  return boundsOfItemAt(i, world);
+}
+
+/**
+ * Berechnet den Huellquader des Objekts i, transformiert mit der affinen
+ * Weltmatrix world. Der lokale Quader wird ueber die Betraege der
+ * Matrixeintraege umschlossen.
+ *
+ * @param[in] i     Objekt.
+ * @param[in] world Weltmatrix, spaltenweise.
+ *
+ * @return Huellquader von i.
+ */
+extern BoundsBox boundsOfItemAt(const LevelItem * i, const double world[16])
+{
+  const BoundsBox * b = bounds + i->f;
+
+  BoundsBox box;
+
+  double c[3]
+       , e[3]
+       ;
+
+  int j
+    , k
+    ;
+
+  /* Mittelpunkt und halbe Ausdehnung des lokalen Quaders */
+  for (j = 0; j < 3; ++j)
+  {
+    c[j] = (b->min[j] + b->max[j]) * 0.5;
+    e[j] = (b->max[j] - b->min[j]) * 0.5;
+  }
+
+  for (j = 0; j < 3; ++j)
+  {
+    double center = world[12 + j]
+         , extent = 0.0
+         ;
+
+    for (k = 0; k < 3; ++k)
+    {
+      center += world[k * 4 + j] * c[k];
+      extent += fabs(world[k * 4 + j]) * e[k];
+    }
+
+    box.min[j] = center - extent;
+    box.max[j] = center + extent;
+  }
+
+  return box;
+}
+
+/**
+ * Berechnet den Quader, der a und b umschliesst.
+ *
+ * @param[in] a Erster Quader.
+ * @param[in] b Zweiter Quader.
+ *
+ * @return Vereinigung von a und b.
+ */
+extern BoundsBox boundsUnion(BoundsBox a, BoundsBox b)
+{
+  int j;
+
+  for (j = 0; j < 3; ++j)
+  {
+    if (b.min[j] < a.min[j])
+      a.min[j] = b.min[j];
+    if (b.max[j] > a.max[j])
+      a.max[j] = b.max[j];
+  }
+
+  return a;
+}
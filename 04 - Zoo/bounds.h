@@ -0,0 +1,65 @@
+#ifndef __BOUNDS_H__
+#define __BOUNDS_H__
+/**
+ * @file
+ *
+ * Huellquader der Objekte des Levels, wie sie das Picking und das Culling
+ * verwenden.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "level.h"
+
+/** Achsenparalleler Quader */
+typedef struct {
+  double min[3]
+       , max[3]
+       ;
+} BoundsBox;
+
+/**
+ * Berechnet die Weltmatrix des Objekts i aus seiner Translation t und seiner
+ * Drehung um r, wie sie auch beim Zeichnen verwendet wird. Haengt i an einem
+ * anderen Objekt (siehe logicGetParentItem), sind t und r relativ zu diesem.
+ *
+ * @param[in]  i     Objekt.
+ * @param[out] world Affine Weltmatrix, spaltenweise wie bei OpenGL.
+ */
+extern void boundsWorldOfItem(const LevelItem * i, double world[16]);
+
+/**
+ * Berechnet den Huellquader des Objekts i in Weltkoordinaten aus den
+ * Ausmassen seiner Zeichenfunktion, seiner Translation t und seiner Drehung
+ * um r.
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Huellquader von i.
+ */
+extern BoundsBox boundsOfItem(const LevelItem * i);
+
+/**
+ * Berechnet den Huellquader des Objekts i in Weltkoordinaten aus den
+ * Ausmassen seiner Zeichenfunktion und einer schon bekannten Weltmatrix,
+ * etwa der aus dem Szenengraphen.
+ *
+ * @param[in] i     Objekt.
+ * @param[in] world Affine Weltmatrix, spaltenweise wie bei OpenGL.
+ *
+ * @return Huellquader von i.
+ */
+extern BoundsBox boundsOfItemAt(const LevelItem * i, const double world[16]);
+
+/**
+ * Berechnet den Quader, der a und b umschliesst.
+ *
+ * @param[in] a Erster Quader.
+ * @param[in] b Zweiter Quader.
+ *
+ * @return Vereinigung von a und b.
+ */
+extern BoundsBox boundsUnion(BoundsBox a, BoundsBox b);
+
+#endif
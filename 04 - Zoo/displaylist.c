@@ -20,6 +20,8 @@
  * Eigene Header einbinden
  * -------------------------------------------------------------------------- */
 #include "displaylist.h"
+#include "atlas.h"
+#include "drawing.h"
 #include "logic.h"
 #include "types.h"
 
@@ -48,6 +50,9 @@ extern void displaylistInit(void)
 
 /**
  * Befüllt die Displaylisten mit den aktuellen Objekten.
+ * Den führenden Zustand einer Zeichenfunktion setzt der Aufrufer der Liste
+ * (siehe drawingSetState). Er wird vor dem Kompilieren gesetzt, so dass der
+ * Atlas ihn als gebunden kennt und nur Abweichungen in die Liste kommen.
  */
 extern void displaylistSet(void)
 {
@@ -55,7 +60,9 @@ extern void displaylistSet(void)
   {
     DrawFunctionType t;
     
-    /* Erste */
+    /* Erste. Sonst ist unbekannt, welche Textur beim Aufruf gebunden ist. */
+    atlasInvalidate();
+    drawingSetState(logicGetDrawFunction((DrawFunctionType) 0));
     glNewList(displayLists[(DrawFunctionType) 0], GL_COMPILE);
       logicGetDrawFunction((DrawFunctionType) 0)();
     glEndList();
@@ -64,10 +71,15 @@ extern void displaylistSet(void)
     for (t = (DrawFunctionType) 1; t < DF_DUMMY; ++t)
     {
       displayLists[t] = displayLists[t-1] + 1;
+      atlasInvalidate();
+      drawingSetState(logicGetDrawFunction(t));
       glNewList(displayLists[t], GL_COMPILE);
         logicGetDrawFunction(t)();
       glEndList();
     }
+    
+    /* Beim Kompilieren wurde nichts gebunden */
+    atlasInvalidate();
   }
   
   #ifdef DEBUG
@@ -83,4 +95,7 @@ extern void displaylistSet(void)
 extern void displaylistCall(DrawFunctionType d)
 {
   glCallList(d + 1);
+  
+  /* Die Liste endet im führenden Zustand, den der Atlas aber nicht kennt */
+  atlasInvalidate();
 }
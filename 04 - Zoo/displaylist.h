@@ -21,7 +21,8 @@ extern void displaylistInit(void);
 extern void displaylistSet(void);
 
 /**
- * Ruft die Displayliste für den Zeichenfunktionstyp d auf.
+ * Ruft die Displayliste für den Zeichenfunktionstyp d auf. Der führende
+ * Zustand der Zeichenfunktion muss gesetzt sein (siehe drawingSetState).
  *
  * @param[in] d Zeichenfunktionstyp.
  */
@@ -21,21 +21,56 @@
 /* ----------------------------------------------------------------------------
  * Eigene Header einbinden
  * -------------------------------------------------------------------------- */
+#include "drawing.h"
 #include "vector.h"
 #include "types.h"
 #include "displaylist.h"
 #include "material.h"
 #include "texture.h"
 #include "level.h"
+#include "mesh.h"
 
 /* ----------------------------------------------------------------------------
  * Macros
  * -------------------------------------------------------------------------- */
 
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Material und Textur, nach denen eine Zeichenfunktion sortiert wird */
+typedef struct {
+  DrawFunction f;
+  Material m;
+  TextureName t;
+} DrawState;
+
 /* ----------------------------------------------------------------------------
  * Globale Daten
  * -------------------------------------------------------------------------- */
 
+/*
+ * Führender Zustand der Zeichenfunktionen. Den setzt der Aufrufer, die
+ * Funktionen setzen nur Abweichungen selbst und stellen danach den führenden
+ * Zustand wieder her.
+ */
+static const DrawState drawStates[] =
+  { { drawGround,       MAT_GRASS,   TEXTURE_GRASS   }
+  , { drawSocket,       MAT_STONE,   TEXTURE_SOCKET  }
+  , { drawFence,        MAT_FENCE,   TEXTURE_METAL   }
+  , { drawFenceCeiling, MAT_STONE,   TEXTURE_STONE   }
+  , { drawGlass,        MAT_GLASS,   TEXTURE_EMPTY   }
+  , { drawGlassCeiling, MAT_GLASS,   TEXTURE_EMPTY   }
+  , { drawPool,         MAT_STONE,   TEXTURE_STONE   }
+  , { drawWater,        MAT_WATER,   TEXTURE_WATER   }
+  , { drawPig,          MAT_PIG,     TEXTURE_PAPER   }
+  , { drawGiraffe,      MAT_GIRAFFE, TEXTURE_GIRAFFE }
+  , { drawGiraffeHead,  MAT_GIRAFFE, TEXTURE_GIRAFFE }
+  , { drawFish,         MAT_FISH,    TEXTURE_FISH    }
+  , { drawSun,          MAT_SUN,     TEXTURE_SUN     }
+  , { drawGiraffeCube,  MAT_GIRAFFE, TEXTURE_GIRAFFE }
+  };
+
 /* Unterteilungsfeinheit */
 static int drawSubdivides = 20;
 
@@ -56,44 +91,14 @@ static Boolean normals = FALSE;
  */
 static void drawSquare(unsigned subdivides, TextureName t)
 {
-  unsigned x, y;
-  
-  /* Textur aufkleben */
+  /* Textur aufkleben, jede Figur bindet ihre eigene, ein Zurücksetzen danach
+   * ist nicht nötig */
   bindTexture(t);
   
   if (normals)
-  {
-    glDisable(GL_LIGHTING);
-      glBegin(GL_LINES);
-        glColor3f(1.0, 0.0, 0.0);
-        
-        glVertex3f(0.5, 0.5, 0.0);
-        glVertex3f(0.5, 0.5, 1.0);
-      glEnd();
-    glEnable(GL_LIGHTING);
-  }
-  
-  for (y = 0; y <= subdivides; ++y)
-  {
-    glBegin(GL_QUAD_STRIP);
-      glNormal3f(0.0, 0.0, 1.0);
-      for (x = 0; x <= subdivides + 1; ++x)
-      {
-        glTexCoord2f(x / (subdivides + 1.0), y / (subdivides + 1.0));
-        glVertex3f( - 0.5 + x / (subdivides + 1.0)
-                  , 0.5 - y / (subdivides + 1.0)
-                  , 0.0);
-
-        glTexCoord2f(x / (subdivides + 1.0), (y + 1) / (subdivides + 1.0));
-        glVertex3f(- 0.5 + x / (subdivides + 1.0)
-                  ,  0.5 - (y + 1) / (subdivides + 1.0)
-                  ,  0.0);
-      }
-    glEnd();
-  }
+    meshDrawNormals(MESH_SQUARE);
   
-  /* Danach leere Textur verwenden */
-  bindTexture(TEXTURE_EMPTY);
+  meshDraw(MESH_SQUARE, subdivides);
 }
 
 /**
@@ -104,46 +109,12 @@ static void drawSquare(unsigned subdivides, TextureName t)
  */
 static void drawCube(unsigned subdivides, TextureName t)
 {
-  /* Vorne */
-  glPushMatrix();
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Rechts */
-  glPushMatrix();
-    glRotatef(90, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Hinten */
-  glPushMatrix();
-    glRotatef(180, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Links */
-  glPushMatrix();
-    glRotatef(270, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Oben */
-  glPushMatrix();
-    glRotatef(- 90, 1.0, 0.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Unten */
-  glPushMatrix();
-    glRotatef(90, 1.0, 0.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
+  bindTexture(t);
+  
+  if (normals)
+    meshDrawNormals(MESH_CUBE);
+  
+  meshDraw(MESH_CUBE, subdivides);
 }
 
 /**
@@ -154,68 +125,12 @@ static void drawCube(unsigned subdivides, TextureName t)
  */
 static void drawCubeInvertedOpen(unsigned subdivides, TextureName t)
 {
-  /* Vorne */
-  glPushMatrix();
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-  
-  glPushMatrix();
-    glTranslatef(0.0, 0.0, 0.5);
-    glRotatef(180, 0.0, 1.0, 0.0);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Rechts */
-  glPushMatrix();
-    glRotatef(90, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-  
-  glPushMatrix();
-    glRotatef(270, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, - 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Hinten */
-  glPushMatrix();
-    glRotatef(180, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-  
-  glPushMatrix();
-    glTranslatef(0.0, 0.0, - 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Links */
-  glPushMatrix();
-    glRotatef(270, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
+  bindTexture(t);
   
-  glPushMatrix();
-    glRotatef(90, 0.0, 1.0, 0.0);
-    glTranslatef(0.0, 0.0, - 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
-
-  /* Unten */
-  glPushMatrix();
-    glRotatef(90, 1.0, 0.0, 0.0);
-    glTranslatef(0.0, 0.0, 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
+  if (normals)
+    meshDrawNormals(MESH_CUBE_INVERTED_OPEN);
   
-  glPushMatrix();
-    glRotatef(270, 1.0, 0.0, 0.0);
-    glTranslatef(0.0, 0.0, - 0.5);
-    drawSquare(subdivides, t);
-  glPopMatrix();
+  meshDraw(MESH_CUBE_INVERTED_OPEN, subdivides);
 }
 
 /**
@@ -257,8 +172,6 @@ static void drawCylinder(unsigned subdivides, double proportion, TextureName t)
   glPopMatrix();
   
   gluDeleteQuadric(q);
-  
-  bindTexture(TEXTURE_EMPTY);
 }
 
 /**
@@ -322,6 +235,53 @@ extern void drawingSetSubdivides(int i)
   displaylistSet();
 }
 
+/**
+ * Bestimmt Material und Textur, nach denen die mit f gezeichneten Objekte
+ * sortiert werden.
+ *
+ * @param[in]  f Zeichenfunktion.
+ * @param[out] m Material.
+ * @param[out] t Textur.
+ *
+ * @return TRUE  wenn f bekannt ist
+ *         FALSE sonst.
+ */
+extern Boolean drawingGetState(DrawFunction f, Material * m, TextureName * t)
+{
+  unsigned i;
+  
+  for (i = 0; i < sizeof(drawStates) / sizeof(drawStates[0]); ++i)
+  {
+    if (drawStates[i].f == f)
+    {
+      *m = drawStates[i].m;
+      *t = drawStates[i].t;
+      
+      return TRUE;
+    }
+  }
+  
+  return FALSE;
+}
+
+/**
+ * Setzt den führenden Zustand der Zeichenfunktion f, Material und Textur.
+ * Für unbekannte Funktionen passiert nichts.
+ *
+ * @param[in] f Zeichenfunktion.
+ */
+extern void drawingSetState(DrawFunction f)
+{
+  Material m;
+  TextureName t;
+  
+  if (drawingGetState(f, &m, &t))
+  {
+    materialSet(m);
+    bindTexture(t);
+  }
+}
+
 /* ----------------------------------------------------------------------------
  * Cage
  * -------------------------------------------------------------------------- */
@@ -334,7 +294,6 @@ extern void drawFence(void)
   #define step (0.2)
   double d = 0.0;
   
-  materialSet(MAT_FENCE);
   for (d = - 1.0; d <= 1.0; d += step)
   {
     glPushMatrix();
@@ -361,8 +320,6 @@ extern void drawFence(void)
  */
 extern void drawFenceCeiling(void)
 {
-  materialSet(MAT_STONE);
-  
   glPushMatrix();
     glScalef(2.0, 0.05, 2.0);
     drawCube(drawSubdivides, TEXTURE_STONE);
@@ -374,6 +331,7 @@ extern void drawFenceCeiling(void)
  */
 extern void drawGlass(void)
 {
+  /* Rahmen, danach wieder das führende Glas */
   materialSet(MAT_FENCE);
   glPushMatrix();
     glScalef(2.0, 0.01, 0.01);
@@ -405,8 +363,6 @@ extern void drawGlass(void)
  */
 extern void drawGlassCeiling(void)
 {
-  materialSet(MAT_GLASS);
-  
   glPushMatrix();
     glScalef(2.0, 0.01, 2.0);
     drawCube(drawSubdivides, TEXTURE_EMPTY);
@@ -418,7 +374,6 @@ extern void drawGlassCeiling(void)
  */
 extern void drawPool(void)
 {
-  materialSet(MAT_STONE);
   glPushMatrix();
     glScalef(1.98, 0.2, 0.78);
     drawCubeInvertedOpen(drawSubdivides, TEXTURE_STONE);
@@ -430,7 +385,6 @@ extern void drawPool(void)
  */
 extern void drawWater(void)
 {
-  materialSet(MAT_WATER);
   glPushMatrix();
     glScalef(1.98, 1.0, 0.78);
     glRotatef(270, 1.0, 0.0, 0.0);
@@ -499,8 +453,6 @@ static void drawPigHead(void)
 extern void drawPig(void)
 {
   glPushName(NAME_PIG_BODY);
-    materialSet(MAT_PIG);
-    
     /* Körper */
     glPushMatrix();
       glScalef(0.1, 0.1, 0.15);
@@ -561,7 +513,6 @@ extern void drawPig(void)
  */
 extern void drawGiraffeHead(void)
 {
-  materialSet(MAT_GIRAFFE);
   glPushMatrix();
     glScalef(0.08, 0.08, 0.08);
     
@@ -603,6 +554,9 @@ extern void drawGiraffeHead(void)
       drawSphere(drawSubdivides, TEXTURE_EMPTY);
     glPopMatrix();
   glPopMatrix();
+  
+  /* Führende Textur wiederherstellen */
+  bindTexture(TEXTURE_GIRAFFE);
 }
 
 /**
@@ -611,8 +565,6 @@ extern void drawGiraffeHead(void)
 extern void drawGiraffe(void)
 {
   glPushName(NAME_GIRAFFE_BODY);
-    materialSet(MAT_GIRAFFE);
-    
     /* Körper */
     glPushMatrix();
       glScalef(0.1, 0.1, 0.15);
@@ -656,8 +608,6 @@ extern void drawGiraffe(void)
  */
 extern void drawFish(void)
 {
-  materialSet(MAT_FISH);
-  
   glPushName(NAME_FISH_BODY);
     glPushMatrix();
       glScalef(0.1, 0.06, 0.03);
@@ -676,6 +626,9 @@ extern void drawFish(void)
       glPopMatrix();
     glPopMatrix();
   glPopName();
+  
+  /* Führende Textur wiederherstellen */
+  bindTexture(TEXTURE_FISH);
 }
 
 /* ----------------------------------------------------------------------------
@@ -687,15 +640,11 @@ extern void drawFish(void)
  */
 extern void drawGround(void)
 {
-  materialSet(MAT_GRASS);
-  
   glPushMatrix();
     glScalef(10.0, 1.0, 10.0);
     glRotatef(270, 1.0, 0.0, 0.0);
     drawSquare(drawSubdivides, TEXTURE_GRASS);
   glPopMatrix();
-  
-  bindTexture(TEXTURE_EMPTY);
 }
 
 /**
@@ -703,8 +652,6 @@ extern void drawGround(void)
  */
 extern void drawSocket(void)
 {
-  materialSet(MAT_STONE);
-  
   glPushMatrix();
     glScalef(2.0, 0.2, 1.2);
     drawCube(drawSubdivides, TEXTURE_SOCKET);
@@ -716,8 +663,6 @@ extern void drawSocket(void)
  */
 extern void drawSun(void)
 {
-  materialSet(MAT_SUN);
-  
   drawSphere(drawSubdivides, TEXTURE_SUN);
 }
 
@@ -726,8 +671,6 @@ extern void drawSun(void)
  */
 extern void drawGiraffeCube(void)
 {
-  materialSet(MAT_GIRAFFE);
-  
   glDisable(GL_LIGHTING);
   
   glPushMatrix();
@@ -9,6 +9,10 @@
  * @author Julius Beckmann
  */
 
+#include "types.h"
+#include "material.h"
+#include "texture.h"
+
 /**
  * Schaltete zwischen "Normalen anzeigen" und "Normalen nicht anzeigen".
  */
@@ -22,6 +26,29 @@ extern void drawingSetNormals(void);
  */
 extern void drawingSetSubdivides(int i);
 
+/**
+ * Bestimmt Material und Textur, nach denen die mit f gezeichneten Objekte
+ * sortiert werden. Setzt f mehrere, ist es das führende, bei Objekten mit
+ * durchscheinenden Teilen also das durchscheinende. Mit ihm beginnt und
+ * endet f, gesetzt wird es vom Aufrufer (siehe drawingSetState).
+ *
+ * @param[in]  f Zeichenfunktion.
+ * @param[out] m Material.
+ * @param[out] t Textur.
+ *
+ * @return TRUE  wenn f bekannt ist
+ *         FALSE sonst, m und t bleiben dann unveraendert.
+ */
+extern Boolean drawingGetState(DrawFunction f, Material * m, TextureName * t);
+
+/**
+ * Setzt den führenden Zustand der Zeichenfunktion f, Material und Textur.
+ * Muss vor jedem Aufruf von f bzw. ihrer Displayliste gesetzt sein.
+ *
+ * @param[in] f Zeichenfunktion.
+ */
+extern void drawingSetState(DrawFunction f);
+
 /* ----------------------------------------------------------------------------
  * Zeichenfunktionen
  * -------------------------------------------------------------------------- */
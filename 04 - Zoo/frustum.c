@@ -0,0 +1,115 @@
+/**
+ * @file
+ *
+ * Sichtvolumen-Culling.
+ *
+ * Ist M = P * MV die Matrix von Objekt- in Clipkoordinaten und sind m0 bis
+ * m3 ihre Zeilen, so liegt ein Punkt genau dann im Sichtvolumen, wenn fuer
+ * i = 0, 1, 2 gilt: -w <= m_i * p <= w mit w = m3 * p. Die sechs Ebenen sind
+ * also m3 + m_i und m3 - m_i (nach Gribb und Hartmann). Sie werden nicht
+ * normiert, fuer den Vorzeichentest ist das unnoetig.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <math.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "frustum.h"
+#include "bounds.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Bestimmt das Sichtvolumen aus der aktuellen Projektions- und
+ * Modelviewmatrix.
+ *
+ * @param[out] f Sichtvolumen.
+ */
+extern void frustumFromGL(Frustum * f)
+{
+  GLdouble p[16]  /* Projektion, spaltenweise */
+         , mv[16] /* Modelview, spaltenweise  */
+         , m[16]  /* p * mv, spaltenweise     */
+         ;
+
+  int r
+    , c
+    , k
+    , i
+    ;
+
+  glGetDoublev(GL_PROJECTION_MATRIX, p);
+  glGetDoublev(GL_MODELVIEW_MATRIX, mv);
+
+  for (c = 0; c < 4; ++c)
+    for (r = 0; r < 4; ++r)
+    {
+      m[c * 4 + r] = 0.0;
+
+      for (k = 0; k < 4; ++k)
+        m[c * 4 + r] += p[k * 4 + r] * mv[c * 4 + k];
+    }
+
+  /* Ebene 2i: m3 + m_i (links, unten, nah), 2i+1: m3 - m_i (rechts, oben, fern) */
+  for (i = 0; i < 3; ++i)
+    for (c = 0; c < 4; ++c)
+    {
+      f->plane[2 * i    ][c] = m[c * 4 + 3] + m[c * 4 + i];
+      f->plane[2 * i + 1][c] = m[c * 4 + 3] - m[c * 4 + i];
+    }
+}
+
+/**
+ * Prueft, ob der Quader b zumindest teilweise im Sichtvolumen f liegen kann.
+ * Fuer jede Ebene wird der Abstand des Mittelpunkts mit der Projektion der
+ * halben Ausdehnung auf die Normale verglichen.
+ *
+ * @param[in] f Sichtvolumen.
+ * @param[in] b Quader.
+ *
+ * @return TRUE  wenn b nicht vollstaendig ausserhalb einer Ebene liegt
+ *         FALSE sonst.
+ */
+extern Boolean frustumTestBox(const Frustum * f, const BoundsBox * b)
+{
+  double c[3]
+       , e[3]
+       ;
+
+  int i
+    , j
+    ;
+
+  for (j = 0; j < 3; ++j)
+  {
+    c[j] = (b->min[j] + b->max[j]) * 0.5;
+    e[j] = (b->max[j] - b->min[j]) * 0.5;
+  }
+
+  for (i = 0; i < 6; ++i)
+  {
+    const double * n = f->plane[i];
+
+    double d = n[0] * c[0] + n[1] * c[1] + n[2] * c[2] + n[3]
+         , r = fabs(n[0]) * e[0] + fabs(n[1]) * e[1] + fabs(n[2]) * e[2]
+         ;
+
+    if (d + r < 0.0)
+      return FALSE;
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,44 @@
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+/**
+ * @file
+ *
+ * Sichtvolumen-Culling. Die sechs Ebenen des Sichtvolumens werden aus dem
+ * Produkt von Projektions- und Modelviewmatrix gewonnen, Huellquader
+ * dagegen getestet.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "bounds.h"
+#include "types.h"
+
+/** Sichtvolumen: sechs Ebenen a x + b y + c z + d >= 0 fuer innen */
+typedef struct {
+  double plane[6][4];
+} Frustum;
+
+/**
+ * Bestimmt das Sichtvolumen aus der aktuellen Projektions- und
+ * Modelviewmatrix. Die Ebenen liegen dann im Koordinatensystem, in dem
+ * die Modelviewmatrix gilt, bei reiner Kamera also in Weltkoordinaten.
+ *
+ * @param[out] f Sichtvolumen.
+ */
+extern void frustumFromGL(Frustum * f);
+
+/**
+ * Prueft, ob der Quader b zumindest teilweise im Sichtvolumen f liegen
+ * kann. Quader nahe einer Ecke des Sichtvolumens koennen faelschlich als
+ * sichtbar gelten, nie aber sichtbare als unsichtbar.
+ *
+ * @param[in] f Sichtvolumen.
+ * @param[in] b Quader.
+ *
+ * @return TRUE  wenn b nicht vollstaendig ausserhalb einer Ebene liegt
+ *         FALSE sonst.
+ */
+extern Boolean frustumTestBox(const Frustum * f, const BoundsBox * b);
+
+#endif
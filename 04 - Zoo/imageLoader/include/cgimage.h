@@ -50,11 +50,19 @@
 #define CG_IMAGE_COLOR           3
 #define CG_IMAGE_COLOR_ALPHA     4
 
+/**
+ * Constant: CG_IMAGE_ALIGNMENT
+ * Alignment in byte of the pixel buffers allocated by CGImage_init and
+ * of their row stride, large enough for any vector load.
+ */
+#define CG_IMAGE_ALIGNMENT 64
+
 typedef struct CGImage {
 
     /**
      * Field: data
-     * Pixel data, tightly packed in row major layout.
+     * Pixel data in row major layout, the first pixel of row y is
+     * located at data + y * stride.
      */
     unsigned char* data;
 
@@ -75,8 +83,77 @@ typedef struct CGImage {
      * Number of color channels.
      */
     unsigned int bpp;
+
+    /**
+     * Field: stride
+     * Distance in byte between the first pixels of two consecutive rows,
+     * at least width * bpp. Images allocated by CGImage_init start at a
+     * CG_IMAGE_ALIGNMENT boundary and pad their rows to a multiple of it.
+     */
+    unsigned int stride;
+
+    /**
+     * Field: memory
+     * Allocated pixel buffer, NULL for views which reference the pixels of
+     * another image.
+     */
+    void* memory;
 } CGImage;
 
+/**
+ * Macro: CGImage_row
+ * Address of the first pixel of row y.
+ */
+#define CGImage_row(self, y) ((self)->data + (size_t)(y) * (self)->stride)
+
+/**
+ * Macro: CGImage_pixel
+ * Address of the pixel at (x, y).
+ */
+#define CGImage_pixel(self, x, y) (CGImage_row(self, y) + (x) * (self)->bpp)
+
+/**
+ * Class: CGImageReader
+ * Callbacks for decoding an image row by row without keeping the
+ * whole bitmap in memory. Every callback returns zero to continue
+ * decoding, any other value aborts it.
+ */
+typedef struct CGImageReader {
+
+    /**
+     * Field: header
+     * Called once before the first row with the dimension and number of
+     * color channels of the image. May be NULL.
+     */
+    int (*header)(
+        void* user,
+        unsigned int width,
+        unsigned int height,
+        unsigned int bpp
+    );
+
+    /**
+     * Field: rows
+     * Called with a band of count decoded rows, tightly packed. first is
+     * the index of the first row in the band, counted from the top of the
+     * image. Bands are passed in file order, which is bottom up for
+     * bottom-up formats (BMP, most TGA), and the row buffer is only valid
+     * during the call.
+     */
+    int (*rows)(
+        void* user,
+        unsigned int first,
+        unsigned int count,
+        const unsigned char* data
+    );
+
+    /**
+     * Field: user
+     * Passed unmodified to the callbacks.
+     */
+    void* user;
+} CGImageReader;
+
 /**
  * Constructor: CGImage_create
  * Allocate and initialize an image with the given resolution and
@@ -110,21 +187,133 @@ void CGImage_init(
     unsigned int bpp
 );
 
+/**
+ * Constructor: CGImage_view
+ * Create an image that references a region of another image without
+ * copying it. The region is clipped to parent, writes to the view change
+ * parent. The view must be freed before parent; freeing it leaves the
+ * pixels untouched.
+ *
+ * Parameters:
+ *   parent - image containing the region
+ *   x      - left border of the region
+ *   y      - upper border of the region
+ *   w      - width of the region
+ *   h      - height of the region
+ *
+ * Returns:
+ *   new view, which may be empty if the region lies outside of parent
+ */
+CGImage* CGImage_view(
+    const CGImage* parent,
+    int x, int y,
+    unsigned int w, unsigned int h
+);
+
+/**
+ * Constructor: CGImage_initView
+ * Constructor for views, see <CGImage_view>. Views initialized this way
+ * own no resources and need not be destroyed.
+ */
+void CGImage_initView(
+    CGImage* self,
+    const CGImage* parent,
+    int x, int y,
+    unsigned int w, unsigned int h
+);
+
+/**
+ * Destructor: CGImage_done
+ * Free the pixel buffer of an image initialized with CGImage_init.
+ */
+void CGImage_done(CGImage* self);
+
+/**
+ * Function: CGImage_isPacked
+ * Check whether the rows of the image follow each other without padding,
+ * so the pixels form one contiguous block of width * height * bpp bytes.
+ */
+int CGImage_isPacked(const CGImage* self);
+
+/**
+ * Function: CGImage_unpackLayout
+ * Describe the row layout the way OpenGL pixel transfers expect it:
+ * passing row_length as GL_UNPACK_ROW_LENGTH (or GL_PACK_ROW_LENGTH)
+ * and alignment as GL_UNPACK_ALIGNMENT transfers the pixels in place.
+ *
+ * Parameters:
+ *   row_length - receives the row length in pixel
+ *   alignment  - receives the row alignment (1, 2, 4 or 8)
+ *
+ * Returns:
+ *   non-zero if the stride can be expressed that way, zero otherwise
+ *   (odd strides of views into unaligned images); copy the image in
+ *   that case.
+ */
+int CGImage_unpackLayout(
+    const CGImage* self,
+    int* row_length,
+    int* alignment
+);
+
 /**
  * Function: CGImage_mirrorX
- * Mirror the image horizontally.
+ * Mirror the image horizontally, in place.
  */
 void CGImage_mirrorX(CGImage* self);
 
 /**
  * Function: CGImage_mirrorY
- * Mirror the image vertically.
+ * Mirror the image vertically, in place.
  */
 void CGImage_mirrorY(CGImage* self);
 
+/**
+ * Function: CGImage_transpose
+ * Create a copy of the image with rows and columns exchanged.
+ *
+ * Returns:
+ *   transposed image
+ */
+CGImage* CGImage_transpose(const CGImage* self);
+
+/**
+ * Function: CGImage_rotate
+ * Create a copy of the image rotated counter-clockwise, as seen with
+ * the first row at the top.
+ *
+ * Parameters:
+ *   angle - rotation angle in degrees, a multiple of 90
+ *
+ * Returns:
+ *   rotated image or NULL if angle is not supported
+ */
+CGImage* CGImage_rotate(const CGImage* self, int angle);
+
+/**
+ * Function: CGImage_swapRB
+ * Exchange the first and third channel of a RGB or RGBA image in place,
+ * converting between RGB(A) and BGR(A). Other images are left untouched.
+ */
+void CGImage_swapRB(CGImage* self);
+
+/**
+ * Function: CGImage_convert
+ * Create a copy of the image with a different number of channels.
+ * RGB images get an opaque alpha channel, RGBA images lose theirs.
+ *
+ * Parameters:
+ *   bpp - number of channels of the new image (3 or 4)
+ *
+ * Returns:
+ *   converted image or NULL if the conversion is not supported
+ */
+CGImage* CGImage_convert(const CGImage* self, unsigned int bpp);
+
 /**
  * Function: CGImage_copy
- * Copy part of the image.
+ * Copy part of the image. Source and target may be views of the same
+ * image, but the regions must not overlap.
  *
  * Parameters:
  *   x     - left border of the image region to copy
@@ -172,9 +361,45 @@ CGImage* CGImage_load(const char* filename);
  */
 CGImage* CGImage_loadStream(const char* filename, FILE* stream);
 
+/**
+ * Function: CGImage_read
+ * Decode an image stored in any of the supported image formats and
+ * pass it row by row to reader. Only a few rows are held in memory at
+ * any time.
+ *
+ * Parameters:
+ *   filename - name of the image file to decode
+ *   reader   - callbacks receiving the decoded image
+ *
+ * Returns:
+ *   zero on success, non-zero if the image could not be decoded or a
+ *   callback aborted decoding
+ */
+int CGImage_read(const char* filename, const CGImageReader* reader);
+
+/**
+ * Function: CGImage_readStream
+ * Decode an image stored in any of the supported image formats and
+ * pass it row by row to reader.
+ *
+ * Parameters:
+ *   filename - name of the image file to decode (only for error reporting)
+ *   stream   - bitmap data stream
+ *   reader   - callbacks receiving the decoded image
+ *
+ * Returns:
+ *   zero on success, non-zero if the image could not be decoded or a
+ *   callback aborted decoding
+ */
+int CGImage_readStream(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+);
+
 /**
  * Destructor: CGImage_free
- * Free all allocated resources.
+ * Free all allocated resources. Views free only themselves.
  */
 void CGImage_free(CGImage* self);
 
@@ -4,6 +4,7 @@
 #include <cgimage/endian.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -33,17 +34,23 @@ typedef struct {
 
 #define ERROR(msg) \
     CGError_reportFormat( \
-        __FILE__, "CGImage_loadBMP", __LINE__, \
+        __FILE__, "CGImage_readBMP", __LINE__, \
         "%s: %s", filename, (msg) \
     )
 #define FERROR(msg) ERROR(ferror(stream) ? strerror(errno) : (msg))
 
-CGImage* CGImage_loadBMP(const char* filename, FILE* stream) {
-    CGImage* image = NULL;
+int CGImage_readBMP(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
+    unsigned char* row = NULL;
+    int result = -1;
+
     BMPFileHeader file_header;
     BMPInfoHeader info_header;
     
-    unsigned int i;
+    unsigned int row_size, padding, x, y;
     
     /* read header */
     if (
@@ -55,13 +62,13 @@ CGImage* CGImage_loadBMP(const char* filename, FILE* stream) {
         ) != 5
     ) {
         FERROR("Premature end of file");
-        goto loadBMP_error;   
+        goto readBMP_error;   
     }
     
     /* check file type */
     if (file_header.type != 0x4d42) {
         ERROR("Invalid file format");
-        goto loadBMP_error;
+        goto readBMP_error;
     }
 
     if (
@@ -71,7 +78,7 @@ CGImage* CGImage_loadBMP(const char* filename, FILE* stream) {
         ) != 11
     ) {
         FERROR("Premature end of file");
-        goto loadBMP_error;   
+        goto readBMP_error;   
     }
 
     /* only uncompressed true color bitmaps for now */
@@ -81,34 +88,56 @@ CGImage* CGImage_loadBMP(const char* filename, FILE* stream) {
         || info_header.compression != 0
     ) {
         ERROR("Unsupported image format");
-        goto loadBMP_error;
+        goto readBMP_error;
+    }
+
+    /* negative heights (top down bitmaps) are not supported either */
+    if ((info_header.width == 0) || (info_header.height == 0)
+        || (info_header.width > (UINT_MAX - 4) / 3)
+        || (info_header.height > INT_MAX)
+    ) {
+        ERROR("Invalid image size");
+        goto readBMP_error;
     }
 
-    image = CGImage_create(info_header.width, info_header.height, 3);
+    /* rows are padded to a multiple of 4 bytes */
+    row_size = info_header.width * 3;
+    padding  = (4 - row_size % 4) % 4;
 
-    for (i = 0; i < info_header.width * info_header.height; ++i) {
-        unsigned char buffer[3];
+    if (!(row = malloc(row_size + padding + 1))) {
+        ERROR(strerror(ENOMEM));
+        goto readBMP_error;
+    }
+
+    if (reader->header && reader->header(
+            reader->user, info_header.width, info_header.height, 3
+        ) != 0
+    )
+        goto readBMP_error;
 
-        if (fread(buffer, sizeof(buffer), 1, stream) != 1) {
+    /* rows are stored bottom up */
+    for (y = info_header.height; y-- > 0; ) {
+        if (fread(row, 1, row_size + padding, stream) != row_size + padding) {
             FERROR("Premature end of file");
-            goto loadBMP_error;
+            goto readBMP_error;
         }
 
-        image->data[i * 3 + 0] = buffer[2];
-        image->data[i * 3 + 1] = buffer[1];
-        image->data[i * 3 + 2] = buffer[0];
+        for (x = 0; x < row_size; x += 3) {
+            unsigned char tmp = row[x];
+
+            row[x]     = row[x + 2];
+            row[x + 2] = tmp;
+        }
+
+        if (reader->rows(reader->user, y, 1, row) != 0)
+            goto readBMP_error;
     }
 
-    CGImage_mirrorY(image);
-    
-    goto loadBMP_end;
-    
-    loadBMP_error:
-        CGImage_free(image);
-        image = NULL;
-    
-    loadBMP_end:
-        return image;
+    result = 0;
+
+    readBMP_error:
+        free(row);
+        return result;
 }
 
 #undef FERROR
@@ -0,0 +1,435 @@
+#include <cgimage.h>
+
+#include <cgimage/error.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include <config.h>
+
+/* edge length in pixel of the tiles used for rotation and transposition */
+#define BLOCK_SIZE 32
+
+/* size of the stack buffer used to swap rows */
+#define SWAP_SIZE 1024
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* copy one pixel of bpp bytes */
+static void CGImage_copyPixel(
+    unsigned char* dst,
+    const unsigned char* src,
+    unsigned int bpp
+) {
+    switch (bpp) {
+        case 4:
+            dst[3] = src[3];
+            /* fall through */
+        case 3:
+            dst[2] = src[2];
+            /* fall through */
+        case 2:
+            dst[1] = src[1];
+            /* fall through */
+        case 1:
+            dst[0] = src[0];
+            break;
+
+        default:
+            memcpy(dst, src, bpp);
+            break;
+    }
+}
+
+static void CGImage_swapBytes(
+    unsigned char* a,
+    unsigned char* b,
+    unsigned int size
+) {
+    unsigned char tmp[SWAP_SIZE];
+
+    while (size > 0) {
+        unsigned int count = MIN(size, SWAP_SIZE);
+
+        memcpy(tmp, a, count);
+        memcpy(a, b, count);
+        memcpy(b, tmp, count);
+
+        a    += count;
+        b    += count;
+        size -= count;
+    }
+}
+
+#ifdef __SSE2__
+/* reverse the order of the 16 / bpp pixels in a vector */
+static __m128i CGImage_reverseVector(__m128i v, unsigned int bpp) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+
+    if (bpp <= 2) {
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    }
+
+    if (bpp == 1)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+    return v;
+}
+#endif
+
+/* reverse the order of the pixels in a row */
+static void CGImage_reverseRow(
+    unsigned char* row,
+    unsigned int width,
+    unsigned int bpp
+) {
+    unsigned char* left  = row;
+    unsigned char* right = row + width * bpp;
+
+#ifdef __SSE2__
+    /* swap whole vectors from both ends */
+    if ((bpp == 1) || (bpp == 2) || (bpp == 4)) {
+        while (right - left >= 32) {
+            __m128i l = _mm_loadu_si128((__m128i*)left);
+            __m128i r = _mm_loadu_si128((__m128i*)(right - 16));
+
+            _mm_storeu_si128((__m128i*)left, CGImage_reverseVector(r, bpp));
+            _mm_storeu_si128((__m128i*)(right - 16), CGImage_reverseVector(l, bpp));
+
+            left  += 16;
+            right -= 16;
+        }
+    }
+#endif
+
+    /* swap the remaining pixels one by one */
+    right -= bpp;
+
+    switch (bpp) {
+        case 1:
+            for (; left < right; ++left, --right) {
+                unsigned char tmp = *left;
+
+                *left  = *right;
+                *right = tmp;
+            }
+            break;
+
+        case 3:
+            for (; left < right; left += 3, right -= 3) {
+                unsigned char t0 = left[0], t1 = left[1], t2 = left[2];
+
+                left[0]  = right[0];
+                left[1]  = right[1];
+                left[2]  = right[2];
+                right[0] = t0;
+                right[1] = t1;
+                right[2] = t2;
+            }
+            break;
+
+        default:
+            for (; left < right; left += bpp, right -= bpp)
+                CGImage_swapBytes(left, right, bpp);
+            break;
+    }
+}
+
+/*
+ * Fill dst with pixels read from base, stepping step_x bytes for every
+ * column and step_y bytes for every row of dst. Works in square tiles
+ * so that both source and destination stay in cache.
+ */
+static void CGImage_remap(
+    CGImage* dst,
+    const unsigned char* base,
+    long step_x,
+    long step_y
+) {
+    unsigned int bx, by, x, y, bpp = dst->bpp;
+
+    for (by = 0; by < dst->height; by += BLOCK_SIZE) {
+        unsigned int ey = MIN(by + BLOCK_SIZE, dst->height);
+
+        for (bx = 0; bx < dst->width; bx += BLOCK_SIZE) {
+            unsigned int ex = MIN(bx + BLOCK_SIZE, dst->width);
+
+            for (y = by; y < ey; ++y) {
+                unsigned char* out = CGImage_pixel(dst, bx, y);
+                const unsigned char* in = base + bx * step_x + y * step_y;
+
+                for (x = bx; x < ex; ++x) {
+                    CGImage_copyPixel(out, in, bpp);
+
+                    out += bpp;
+                    in  += step_x;
+                }
+            }
+        }
+    }
+}
+
+void CGImage_copy(
+    CGImage* self,
+    int x, int y,
+    unsigned int w, unsigned int h,
+    CGImage* dst,
+    int dst_x, int dst_y
+) {
+    long sx = x, sy = y, dx = dst_x, dy = dst_y, cw = w, ch = h;
+    unsigned int r, c, bpp;
+
+    /* clip on source image */
+    if (sx < 0) {
+        cw += sx;
+        dx -= sx;
+        sx  = 0;
+    }
+
+    if (sy < 0) {
+        ch += sy;
+        dy -= sy;
+        sy  = 0;
+    }
+
+    if (sx + cw > (long)self->width)
+        cw = (long)self->width - sx;
+
+    if (sy + ch > (long)self->height)
+        ch = (long)self->height - sy;
+
+    /* clip on destination image */
+    if (dx < 0) {
+        cw += dx;
+        sx -= dx;
+        dx  = 0;
+    }
+
+    if (dy < 0) {
+        ch += dy;
+        sy -= dy;
+        dy  = 0;
+    }
+
+    if (dx + cw > (long)dst->width)
+        cw = (long)dst->width - dx;
+
+    if (dy + ch > (long)dst->height)
+        ch = (long)dst->height - dy;
+
+    if ((cw <= 0) || (ch <= 0))
+        return;
+
+    /* copy that data */
+    bpp = self->bpp < dst->bpp ? self->bpp : dst->bpp;
+
+    for (r = 0; r < ch; ++r) {
+        unsigned char* out = CGImage_pixel(dst, dx, dy + r);
+        const unsigned char* in = CGImage_pixel(self, sx, sy + r);
+
+        /* same layout: copy whole rows */
+        if (self->bpp == dst->bpp) {
+            memcpy(out, in, cw * bpp);
+            continue;
+        }
+
+        for (c = 0; c < cw; ++c) {
+            CGImage_copyPixel(out, in, bpp);
+
+            out += dst->bpp;
+            in  += self->bpp;
+        }
+    }
+}
+
+void CGImage_mirrorX(CGImage* self) {
+    unsigned int y;
+
+    for (y = 0; y < self->height; ++y)
+        CGImage_reverseRow(CGImage_row(self, y), self->width, self->bpp);
+}
+
+void CGImage_mirrorY(CGImage* self) {
+    unsigned int row_size, y;
+
+    row_size = self->width * self->bpp;
+
+    for (y = 0; y < self->height / 2; ++y)
+        CGImage_swapBytes(
+            CGImage_row(self, y),
+            CGImage_row(self, self->height - y - 1),
+            row_size
+        );
+}
+
+CGImage* CGImage_transpose(const CGImage* self) {
+    CGImage* dst = CGImage_create(self->height, self->width, self->bpp);
+
+    /* dst(x, y) = src(y, x) */
+    if (dst)
+        CGImage_remap(
+            dst, self->data,
+            (long)self->stride, (long)self->bpp
+        );
+
+    return dst;
+}
+
+CGImage* CGImage_rotate(const CGImage* self, int angle) {
+    CGImage* dst = NULL;
+    unsigned int row_size = self->width * self->bpp, y;
+
+    angle %= 360;
+    if (angle < 0)
+        angle += 360;
+
+    switch (angle) {
+        case 0:
+            dst = CGImage_create(self->width, self->height, self->bpp);
+            if (dst)
+                for (y = 0; y < self->height; ++y)
+                    memcpy(CGImage_row(dst, y), CGImage_row(self, y), row_size);
+            break;
+
+        case 90:
+            /* dst(x, y) = src(width - 1 - y, x) */
+            dst = CGImage_create(self->height, self->width, self->bpp);
+            if (dst)
+                CGImage_remap(
+                    dst, CGImage_pixel(self, self->width - 1, 0),
+                    (long)self->stride, -(long)self->bpp
+                );
+            break;
+
+        case 180:
+            dst = CGImage_create(self->width, self->height, self->bpp);
+            if (dst) {
+                for (y = 0; y < self->height; ++y) {
+                    unsigned char* row = CGImage_row(dst, y);
+
+                    memcpy(row, CGImage_row(self, self->height - y - 1), row_size);
+                    CGImage_reverseRow(row, self->width, self->bpp);
+                }
+            }
+            break;
+
+        case 270:
+            /* dst(x, y) = src(y, height - 1 - x) */
+            dst = CGImage_create(self->height, self->width, self->bpp);
+            if (dst)
+                CGImage_remap(
+                    dst, CGImage_row(self, self->height - 1),
+                    -(long)self->stride, (long)self->bpp
+                );
+            break;
+
+        default:
+            CGError_reportFormat(
+                __FILE__, "CGImage_rotate", __LINE__,
+                "unsupported angle %d", angle
+            );
+            break;
+    }
+
+    return dst;
+}
+
+/* swap the first and third channel of count pixels */
+static void CGImage_swapRBRow(
+    unsigned char* ptr,
+    unsigned int count,
+    unsigned int bpp
+) {
+    unsigned char* end = ptr + count * bpp;
+
+#ifdef __SSE2__
+    /* swap bytes 0 and 2 of every 32 bit pixel */
+    if (bpp == 4) {
+        const __m128i mask_rb = _mm_set1_epi32(0x00FF00FF);
+
+        for (; end - ptr >= 16; ptr += 16) {
+            __m128i v  = _mm_loadu_si128((__m128i*)ptr);
+            __m128i rb = _mm_and_si128(v, mask_rb);
+            __m128i ga = _mm_andnot_si128(mask_rb, v);
+
+            rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            _mm_storeu_si128((__m128i*)ptr, _mm_or_si128(ga, _mm_and_si128(rb, mask_rb)));
+        }
+    }
+#endif
+
+    for (; ptr < end; ptr += bpp) {
+        unsigned char tmp = ptr[0];
+
+        ptr[0] = ptr[2];
+        ptr[2] = tmp;
+    }
+}
+
+void CGImage_swapRB(CGImage* self) {
+    unsigned int y;
+
+    if ((self->bpp != 3) && (self->bpp != 4))
+        return;
+
+    /* packed images in one go */
+    if (CGImage_isPacked(self)) {
+        CGImage_swapRBRow(self->data, self->width * self->height, self->bpp);
+        return;
+    }
+
+    for (y = 0; y < self->height; ++y)
+        CGImage_swapRBRow(CGImage_row(self, y), self->width, self->bpp);
+}
+
+CGImage* CGImage_convert(const CGImage* self, unsigned int bpp) {
+    CGImage* dst;
+    unsigned int x, y;
+
+    if ((self->bpp != bpp)
+        && !((self->bpp == 3) && (bpp == 4))
+        && !((self->bpp == 4) && (bpp == 3))
+    ) {
+        CGError_reportFormat(
+            __FILE__, "CGImage_convert", __LINE__,
+            "unsupported conversion from %u to %u channels", self->bpp, bpp
+        );
+        return NULL;
+    }
+
+    if (!(dst = CGImage_create(self->width, self->height, bpp)))
+        return NULL;
+
+    for (y = 0; y < self->height; ++y) {
+        const unsigned char* in = CGImage_row(self, y);
+        unsigned char* out = CGImage_row(dst, y);
+
+        if (self->bpp == bpp) {
+            memcpy(out, in, self->width * bpp);
+
+        /* RGB -> RGBA, opaque */
+        } else if (bpp == 4) {
+            for (x = 0; x < self->width; ++x, in += 3, out += 4) {
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+                out[3] = 255;
+            }
+
+        /* RGBA -> RGB, alpha dropped */
+        } else {
+            for (x = 0; x < self->width; ++x, in += 4, out += 3) {
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+            }
+        }
+    }
+
+    return dst;
+}
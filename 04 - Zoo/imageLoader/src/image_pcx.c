@@ -31,17 +31,22 @@ typedef struct {
 
 #define ERROR(msg) \
     CGError_reportFormat( \
-        __FILE__, "CGImage_loadPCX", __LINE__, \
+        __FILE__, "CGImage_readPCX", __LINE__, \
         "%s: %s", filename, (msg) \
     )
 #define FERROR(msg) ERROR(ferror(stream) ? strerror(errno) : (msg))
 
-CGImage* CGImage_loadPCX(const char* filename, FILE* stream) {
+int CGImage_readPCX(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
     unsigned char* palette = NULL;
-    CGImage* image = NULL;
+    unsigned char* row = NULL;
+    int result = -1;
     
     PCXHeader header;
-    unsigned int count, w, h, i;
+    unsigned int count, width, height, bpp, x, y, i;
     int buffer;
     
     /* read header */
@@ -55,13 +60,13 @@ CGImage* CGImage_loadPCX(const char* filename, FILE* stream) {
         ) != 118)
     {
         FERROR("Premature end of file");
-        goto loadPCX_error;
+        goto readPCX_error;
     }
     
     /* check magic & version */
     if ((header.manufacturer != PCX_MAGIC) || (header.version != 5) || (header.bpp != 8)) {
         ERROR("Invalid/Unsupported file format");
-        goto loadPCX_error;
+        goto readPCX_error;
     }
     
     /* read color palette */
@@ -70,81 +75,107 @@ CGImage* CGImage_loadPCX(const char* filename, FILE* stream) {
         if (fgetc(stream) == 12) {
             if (!(palette = malloc(256 * 3))) {
                 ERROR(strerror(ENOMEM));
-                goto loadPCX_error;
+                goto readPCX_error;
             }
             if (fread(palette, 1, 256 * 3, stream) != 256 * 3) {
                 FERROR("Premature end of file");
-                goto loadPCX_error;
+                goto readPCX_error;
             }
         }
     }
     
-    w = header.dimension[2] - header.dimension[0] + 1;
-    h = header.dimension[3] - header.dimension[1] + 1;
+    if ((header.dimension[2] < header.dimension[0])
+        || (header.dimension[3] < header.dimension[1])
+        || (header.planes == 0) || (header.planes > 4)
+    ) {
+        ERROR("Invalid image size");
+        goto readPCX_error;
+    }
+
+    width  = header.dimension[2] - header.dimension[0] + 1;
+    height = header.dimension[3] - header.dimension[1] + 1;
+    bpp    = palette ? 3 : header.planes;
     
-    image = CGImage_create(w, h, palette ? 3 : header.planes);
-    if (!image || !image->data) {
+    if (!(row = malloc(width * bpp + 1))) {
         ERROR(strerror(ENOMEM));
-        goto loadPCX_error;
+        goto readPCX_error;
     }
+
+    if (reader->header && reader->header(reader->user, width, height, bpp) != 0)
+        goto readPCX_error;
         
     /* read and convert image data */
     fseek(stream, sizeof(PCXHeader), SEEK_SET);
     
     /* 256 color palette image */
     if ((header.planes == 1) && palette) {
-        i = 0;
-        while(i < w * h * 3) {
+        x = y = 0;
+        while (y < height) {
             count = 1;
             if ((buffer = fgetc(stream)) == EOF) {
                 FERROR("Premature end of file");
-                goto loadPCX_error;
+                goto readPCX_error;
             }
             
             if ((buffer & 192) == 192) {
                 count = buffer & ~192;
-                buffer = fgetc(stream);
+                if ((buffer = fgetc(stream)) == EOF) {
+                    FERROR("Premature end of file");
+                    goto readPCX_error;
+                }
             }
-            while (count-- > 0) {
-                image->data[i++] = palette[buffer * 3 + 0];
-                image->data[i++] = palette[buffer * 3 + 1];
-                image->data[i++] = palette[buffer * 3 + 2];
+            while ((count-- > 0) && (y < height)) {
+                row[x * 3 + 0] = palette[buffer * 3 + 0];
+                row[x * 3 + 1] = palette[buffer * 3 + 1];
+                row[x * 3 + 2] = palette[buffer * 3 + 2];
+
+                /* runs may continue on the next row */
+                if (++x == width) {
+                    if (reader->rows(reader->user, y, 1, row) != 0)
+                        goto readPCX_error;
+
+                    x = 0;
+                    ++y;
+                }
             }
         }
         
     /* 8bit color planes */
     } else {
-        for (h = 0; h < image->height; ++h) {       /* lines */
+        for (y = 0; y < height; ++y) {              /* lines */
             for (i = 0; i < header.planes; ++i) {   /* planes */
-                w = 0;
-                while (w < image->width) {          /* pixel color plane */
+                x = 0;
+                while (x < width) {                 /* pixel color plane */
                     count = 1;
                     if ((buffer = fgetc(stream)) == EOF) {
                         FERROR("Premature end of file");
-                        goto loadPCX_error;
+                        goto readPCX_error;
                     }
 
                     if ((buffer & 192) == 192) {
                         count = buffer & ~192;
-                        buffer = fgetc(stream);
+                        if ((buffer = fgetc(stream)) == EOF) {
+                            FERROR("Premature end of file");
+                            goto readPCX_error;
+                        }
                     }
-                    while (count-- > 0) {
-                        image->data[(h * image->width + w++) * header.planes + i] = buffer;
+                    while ((count-- > 0) && (x < width)) {
+                        row[x++ * header.planes + i] = buffer;
                     }
                 }
             }
+
+            if (reader->rows(reader->user, y, 1, row) != 0)
+                goto readPCX_error;
         }
     }
     
-    goto loadPCX_end;
+    result = 0;
     
-    loadPCX_error:
-        CGImage_free(image);
-        image = NULL;
-        
-    loadPCX_end:
+    readPCX_error:
+        free(row);
         free(palette);
-        return image;
+        return result;
 }
 
 #undef FERROR
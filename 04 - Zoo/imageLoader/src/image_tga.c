@@ -17,6 +17,17 @@ typedef struct {
     uint8 image_spec[10];
 } TGAHeader;
 
+typedef struct {
+    const CGImageReader* reader;
+    unsigned char* row;
+    unsigned int width;
+    unsigned int height;
+    unsigned int bpp;
+    unsigned int x;
+    unsigned int y;
+    int top_down;
+} TGARowState;
+
 static void putpixel(unsigned char* pixel, unsigned char* buffer, int buffersize) {
     if (buffersize == 4) {
         pixel[0] = buffer[2];
@@ -27,47 +38,81 @@ static void putpixel(unsigned char* pixel, unsigned char* buffer, int buffersize
         pixel[0] = buffer[2];
         pixel[1] = buffer[1];
         pixel[2] = buffer[0];
-    } else {
+    } else if (buffersize == 2) {
         pixel[0] = (buffer[1] & 0x7C) >> 2;
         pixel[1] = (buffer[1] & 0x03) | (buffer[0] & 0xE0) >> 5;
         pixel[2] = buffer[0] & 0x1F;
+    } else {
+        pixel[0] = buffer[0];
+    }
+}
+
+/* append a pixel to the current row and pass full rows to the reader */
+static int nextpixel(TGARowState* state, const unsigned char* color) {
+    memcpy(state->row + state->x * state->bpp, color, state->bpp);
+
+    if (++state->x == state->width) {
+        unsigned int y = state->top_down
+            ? state->y
+            : state->height - state->y - 1;
+
+        state->x = 0;
+        ++state->y;
+
+        return state->reader->rows(state->reader->user, y, 1, state->row);
     }
+
+    return 0;
 }
 
 #define ERROR(msg) \
     CGError_reportFormat( \
-        __FILE__, "CGImage_loadTGA", __LINE__, \
+        __FILE__, "CGImage_readTGA", __LINE__, \
         "%s: %s", filename, (msg) \
     )
 #define FERROR(msg) ERROR(ferror(stream) ? strerror(errno) : (msg))
 
-CGImage* CGImage_loadTGA(const char* filename, FILE* stream) {
+int CGImage_readTGA(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
     unsigned char* palette = NULL;
-    CGImage* image = NULL;
+    int result = -1;
 
     TGAHeader header;
-    unsigned char buffer[4];
-    unsigned int cmap_len, pixel_size;
+    TGARowState state;
+    unsigned char buffer[4], color[4];
+    unsigned int cmap_len = 0, pixel_size;
     unsigned int width, height, bpp;
     unsigned int pixel;
 
+    state.row = NULL;
+
     /* read header */
     if (fread(&header, 18, 1, stream) != 1) {
         FERROR("Premature end of file");
-        goto loadTGA_error;
+        goto readTGA_error;
     }
 
-    if ((header.image_type & ~0xB) || ((header.image_type && 0x3) == 0x3)) {
+    if ((header.image_type & ~0xB) || ((header.image_type & 0x3) == 0x0)) {
         ERROR("Usupported image format");
-        goto loadTGA_error;
+        goto readTGA_error;
     }
 
-    if ((header.image_type & 0x1) && (!header.palette_type)) {
+    if (((header.image_type & 0x3) == 0x1) && (!header.palette_type)) {
         ERROR("Color-mapped image without color map");
-        goto loadTGA_error;
+        goto readTGA_error;
     }
 
-    bpp = pixel_size = (header.image_spec[8] + 7) / 8;
+    pixel_size = (header.image_spec[8] + 7) / 8;
+    if ((pixel_size == 0) || (pixel_size > 4)) {
+        ERROR("Usupported image format");
+        goto readTGA_error;
+    }
+
+    /* 16 bit pixels are expanded to three channels */
+    bpp = pixel_size == 2 ? 3 : pixel_size;
 
     /* skip image id */
     fseek(stream, header.id_length, SEEK_CUR);
@@ -81,15 +126,20 @@ CGImage* CGImage_loadTGA(const char* filename, FILE* stream) {
         cmap_size = cmap_entry == 4 ? 4 : 3;
 
         if ((header.image_type & 0x3) == 0x1) {
+            if ((cmap_entry < 2) || (cmap_entry > 4)) {
+                ERROR("Usupported color map format");
+                goto readTGA_error;
+            }
+
             if (!(palette = malloc(cmap_len * cmap_size))) {
                 ERROR(strerror(ENOMEM));
-                goto loadTGA_error;
+                goto readTGA_error;
             }
 
             for (pixel = 0; pixel < cmap_len; ++pixel) {
                 if (fread(buffer, 1, cmap_entry, stream) != cmap_entry) {
                     FERROR("Premature end of file");
-                    goto loadTGA_error;
+                    goto readTGA_error;
                 }
 
                 putpixel(palette + pixel * cmap_size, buffer, cmap_entry);
@@ -103,31 +153,53 @@ CGImage* CGImage_loadTGA(const char* filename, FILE* stream) {
     
     width = (header.image_spec[5] << 8) + header.image_spec[4];
     height = (header.image_spec[7] << 8) + header.image_spec[6];
-    if (!(image = CGImage_create(width, height, bpp)) || !image->data) {
+
+    if ((width == 0) || (height == 0)) {
+        ERROR("Invalid image size");
+        goto readTGA_error;
+    }
+
+    state.reader   = reader;
+    state.width    = width;
+    state.height   = height;
+    state.bpp      = bpp;
+    state.x        = 0;
+    state.y        = 0;
+    state.top_down = header.image_spec[9] & 0x20;
+
+    if (!(state.row = malloc(width * bpp + 1))) {
         ERROR(strerror(ENOMEM));
-        goto loadTGA_error;
+        goto readTGA_error;
     }
 
+    if (reader->header && reader->header(reader->user, width, height, bpp) != 0)
+        goto readTGA_error;
+
     pixel = 0;
     /* load pixel data */
-    /* RLE encoded */
-    if (header.image_type & 0x8) {
-        while (pixel < width * height) {
-            unsigned int count;
-        
+    while (pixel < width * height) {
+        unsigned int count = 1;
+        int repeat = 0, fetch = 1;
+
+        /* RLE encoded */
+        if (header.image_type & 0x8) {
             if (fread(buffer, 1, 1, stream) != 1) {
                 FERROR("Premature end of file");
-                goto loadTGA_error;
+                goto readTGA_error;
             }
             
-            count = (buffer[0] & 0x7F) + 1;
+            count  = (buffer[0] & 0x7F) + 1;
+            repeat = buffer[0] & 0x80;
+        }
+
+        while (count--) {
+            /* RLE packets repeat a single pixel */
+            if (fetch) {
+                fetch = !repeat;
 
-            /* RLE packet */
-            if (buffer[0] & 0x80) {
-                unsigned char color[4];
                 if (fread(buffer, 1, pixel_size, stream) != pixel_size) {
                     FERROR("Premature end of file");
-                    goto loadTGA_error;
+                    goto readTGA_error;
                 }
 
                 if (palette) {
@@ -137,83 +209,29 @@ CGImage* CGImage_loadTGA(const char* filename, FILE* stream) {
                         idx += buffer[i] << (8 * i);
                     }
 
+                    if (idx >= cmap_len) {
+                        ERROR("Invalid color index");
+                        goto readTGA_error;
+                    }
+
                     memcpy(color, palette + idx * bpp, bpp);
 
                 } else {
                     putpixel(color, buffer, pixel_size);
                 }
-                
-                while (count--) {
-                    memcpy(image->data + pixel * bpp, color, bpp);
-                    ++pixel;
-                }
-                
-            /* RAW packet */
-            } else {
-                while (count--) {
-                    if (fread(buffer, 1, pixel_size, stream) != pixel_size) {
-                        FERROR("Premature end of file");
-                        goto loadTGA_error;
-                    }
-
-                    if (palette) {
-                        unsigned int idx, i;
-
-                        for (i = 0, idx = 0; i < pixel_size; ++i) {
-                            idx += buffer[i] << (8 * i);
-                        }
-
-                        memcpy(
-                            image->data + pixel * bpp,
-                            palette + idx * bpp,
-                            bpp
-                        );
-
-                    } else {
-                        putpixel(
-                            image->data + pixel * bpp,
-                            buffer,
-                            pixel_size
-                        );
-                    }
-                    ++pixel;
-                }
-            }
-        }
-        
-    /* uncompressed */
-    } else {
-        while (pixel < width * height) {
-            if (fread(buffer, 1, pixel_size, stream) != pixel_size) {
-                FERROR("Premature end of file");
-                goto loadTGA_error;
-            }
-            
-            if (palette) {
-                unsigned int idx, i;
-                
-                for (i = 0, idx = 0; i < pixel_size; ++i) {
-                    idx += buffer[i] << (8 * i);
-                }
-                
-                memcpy(image->data + pixel++ * bpp, palette + idx * bpp, bpp);
-            } else {
-                putpixel(image->data + pixel++ * bpp, buffer, pixel_size);
             }
+
+            if (pixel++ < width * height && nextpixel(&state, color) != 0)
+                goto readTGA_error;
         }
     }
-    
-    if (!(header.image_spec[9] & 0x20)) CGImage_mirrorY(image);
 
-    goto loadTGA_end;
-    
-    loadTGA_error:
-        CGImage_free(image);
-        image = NULL;
-        
-    loadTGA_end:
+    result = 0;
+
+    readTGA_error:
+        free(state.row);
         free(palette);
-        return image;
+        return result;
 }
 
 #undef FERROR
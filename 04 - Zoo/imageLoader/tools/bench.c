@@ -0,0 +1,302 @@
+/*
+ * Decode benchmark for the image loader.
+ *
+ * Generates a corpus of every supported format, bit depth and encoding,
+ * then decodes each file in a child process and prints one tab
+ * separated line per file:
+ *
+ *   format variant width height bpp file_bytes iterations seconds
+ *   decode_mb_s input_mb_s allocs peak_heap peak_rss_kb status
+ *
+ * decode_mb_s counts decoded pixel bytes, input_mb_s file bytes.
+ * allocs and peak_heap cover a single decode and are counted by
+ * wrapping malloc & Co. at link time (see Makefile), so allocations made
+ * inside shared libraries such as zlib are not included. status is ok,
+ * mismatch (decoded pixels differ from the reference), error or crash.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <cgimage.h>
+
+#include <cgimage/error.h>
+
+#include "corpus.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* allocation statistics, maintained by the malloc wrappers below */
+static unsigned long bench_allocs;
+static unsigned long bench_heap;
+static unsigned long bench_peak;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+
+static void Bench_track(void* ptr) {
+    if (ptr) {
+        ++bench_allocs;
+        bench_heap += malloc_usable_size(ptr);
+
+        if (bench_heap > bench_peak)
+            bench_peak = bench_heap;
+    }
+}
+
+static void Bench_untrack(void* ptr) {
+    unsigned long size = ptr ? malloc_usable_size(ptr) : 0;
+
+    bench_heap = bench_heap > size ? bench_heap - size : 0;
+}
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+
+    Bench_track(ptr);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+
+    Bench_track(ptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    Bench_untrack(ptr);
+
+    ptr = __real_realloc(ptr, size);
+
+    Bench_track(ptr);
+    return ptr;
+}
+
+void __wrap_free(void* ptr) {
+    Bench_untrack(ptr);
+    __real_free(ptr);
+}
+
+static void Bench_ignoreError(const CGError* error) {
+    (void)error;
+}
+
+static double Bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned char* Bench_readFile(const char* path, unsigned long* size) {
+    unsigned char* data = NULL;
+    struct stat st;
+    FILE* file;
+
+    if (!(file = fopen(path, "rb")))
+        return NULL;
+
+    if ((fstat(fileno(file), &st) == 0) && (data = malloc(st.st_size + 1))) {
+        *size = st.st_size;
+
+        if (fread(data, 1, *size, file) != *size) {
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+    return data;
+}
+
+static CGImage* Bench_decode(
+    const char* path,
+    unsigned char* data,
+    unsigned long size
+) {
+    CGImage* image = NULL;
+    FILE* stream = fmemopen(data, size, "rb");
+
+    if (stream) {
+        image = CGImage_loadStream(path, stream);
+        fclose(stream);
+    }
+
+    return image;
+}
+
+/* compare the image with the packed reference pixels */
+static int Bench_equal(const CGImage* image, const unsigned char* expected) {
+    unsigned int row_size = image->width * image->bpp, y;
+
+    for (y = 0; y < image->height; ++y, expected += row_size)
+        if (memcmp(CGImage_row(image, y), expected, row_size))
+            return 0;
+
+    return 1;
+}
+
+/* decode one corpus entry and print its result line, runs in a child */
+static int Bench_run(const CorpusEntry* entry, double min_time) {
+    unsigned char *data, *expected;
+    unsigned long size, expected_size, iterations, allocs, peak;
+    const char* status = "ok";
+    char name[sizeof(entry->path) + 4];
+    struct rusage usage;
+    double start, elapsed, pixels;
+    CGImage* image;
+
+    sprintf(name, "%s.raw", entry->path);
+
+    if (!(data = Bench_readFile(entry->path, &size))
+        || !(expected = Bench_readFile(name, &expected_size))) {
+        perror(entry->path);
+        return 1;
+    }
+
+    /* first decode: allocations and correctness */
+    bench_allocs = bench_heap = bench_peak = 0;
+
+    image = Bench_decode(entry->path, data, size);
+
+    allocs = bench_allocs;
+    peak   = bench_peak;
+
+    if (!image) {
+        status = "error";
+    } else if ((image->width != entry->width)
+        || (image->height != entry->height)
+        || (image->bpp != entry->bpp)
+        || (image->width * image->height * image->bpp != expected_size)
+        || !Bench_equal(image, expected)) {
+        status = "mismatch";
+    }
+
+    CGImage_free(image);
+
+    /* timed decodes, errors have been reported above */
+    CGError_registerHandler(Bench_ignoreError);
+
+    iterations = 0;
+    start = Bench_now();
+    do {
+        CGImage_free(Bench_decode(entry->path, data, size));
+        ++iterations;
+        elapsed = Bench_now() - start;
+    } while (elapsed < min_time);
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    pixels = (double)entry->width * entry->height * entry->bpp;
+
+    printf(
+        "%s\t%s\t%u\t%u\t%u\t%lu\t%lu\t%.6f\t%.2f\t%.2f\t%lu\t%lu\t%ld\t%s\n",
+        entry->format, entry->variant,
+        entry->width, entry->height, entry->bpp,
+        size, iterations, elapsed,
+        pixels * iterations / elapsed / 1e6,
+        (double)size * iterations / elapsed / 1e6,
+        allocs, peak, usage.ru_maxrss, status
+    );
+
+    free(data);
+    free(expected);
+    return strcmp(status, "ok") ? 1 : 0;
+}
+
+static void Bench_usage(const char* name) {
+    fprintf(
+        stderr,
+        "usage: %s [-d dir] [-t seconds] [-f format] [-l]\n"
+        "  -d dir      corpus directory (default: corpus)\n"
+        "  -t seconds  minimum time spent decoding each file (default: 0.25)\n"
+        "  -f format   only benchmark this format (bmp, pcx, png, ppm, tga)\n"
+        "  -l          include 1024x1024 images\n",
+        name
+    );
+}
+
+int main(int argc, char** argv) {
+    const char* dir = "corpus";
+    const char* format = NULL;
+    double min_time = 0.25;
+    int large = 0, failures = 0, count, i, opt;
+    CorpusEntry* entries;
+
+    while ((opt = getopt(argc, argv, "d:t:f:l")) != -1) {
+        switch (opt) {
+            case 'd': dir      = optarg;       break;
+            case 't': min_time = atof(optarg); break;
+            case 'f': format   = optarg;       break;
+            case 'l': large    = 1;            break;
+            default:
+                Bench_usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if ((mkdir(dir, 0755) != 0) && (errno != EEXIST)) {
+        perror(dir);
+        return 1;
+    }
+
+    if ((count = Corpus_generate(dir, large, &entries)) < 0) {
+        fprintf(stderr, "%s: could not generate corpus\n", argv[0]);
+        return 1;
+    }
+
+    printf(
+        "format\tvariant\twidth\theight\tbpp\tfile_bytes\titerations\tseconds\t"
+        "decode_mb_s\tinput_mb_s\tallocs\tpeak_heap\tpeak_rss_kb\tstatus\n"
+    );
+    fflush(stdout);
+
+    /* every file in its own process: isolated peak RSS, crashes are reported */
+    for (i = 0; i < count; ++i) {
+        int status;
+        pid_t pid;
+
+        if (format && strcmp(format, entries[i].format))
+            continue;
+
+        if ((pid = fork()) == 0) {
+            int result = Bench_run(entries + i, min_time);
+
+            fflush(stdout);
+            _exit(result);
+        }
+
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid)) {
+            perror("fork");
+            return 1;
+        }
+
+        if (WIFSIGNALED(status)) {
+            printf(
+                "%s\t%s\t%u\t%u\t%u\t0\t0\t0\t0\t0\t0\t0\t0\tcrash\n",
+                entries[i].format, entries[i].variant,
+                entries[i].width, entries[i].height, entries[i].bpp
+            );
+            fflush(stdout);
+            ++failures;
+
+        } else if (WEXITSTATUS(status) != 0) {
+            ++failures;
+        }
+    }
+
+    free(entries);
+    return failures ? 1 : 0;
+}
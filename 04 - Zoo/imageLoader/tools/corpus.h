@@ -0,0 +1,45 @@
+#ifndef CG_TOOLS_CORPUS_H
+#define CG_TOOLS_CORPUS_H 1
+
+/**
+ * Class: Corpus
+ * Generator for a local corpus of images in every format, bit depth and
+ * encoding the loader supports. Used by the decode benchmark and as seed
+ * input for the fuzz harness.
+ */
+
+/**
+ * Type: CorpusEntry
+ * A generated image file.
+ *
+ *   path    - file name inside the corpus directory
+ *   format  - file format (bmp, pcx, png, ppm, tga)
+ *   variant - encoding details, e.g. "rgb8-paeth" or "rle32-top"
+ *   width   - image width in pixel
+ *   height  - image height in pixel
+ *   bpp     - number of channels the loader produces
+ */
+typedef struct {
+    char path[256];
+    const char* format;
+    char variant[32];
+    unsigned int width;
+    unsigned int height;
+    unsigned int bpp;
+} CorpusEntry;
+
+/**
+ * Function: Corpus_generate
+ * Write the corpus to dir, which must exist.
+ *
+ * Parameters:
+ *   dir     - target directory
+ *   large   - also generate 1024x1024 images
+ *   entries - receives a malloced array describing the generated files
+ *
+ * Returns:
+ *   number of entries or -1 on error
+ */
+int Corpus_generate(const char* dir, int large, CorpusEntry** entries);
+
+#endif
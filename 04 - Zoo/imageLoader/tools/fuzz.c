@@ -0,0 +1,294 @@
+/*
+ * Fuzz harness for the image readers.
+ *
+ * LLVMFuzzerTestOneInput is the libFuzzer entry point; build with
+ * -DFUZZ_LIBFUZZER -fsanitize=fuzzer to use it with libFuzzer. Without
+ * that define a standalone driver is built that needs no fuzzing
+ * engine and runs offline:
+ *
+ *   fuzz file...               run each file once (AFL: fuzz @@)
+ *   fuzz -n 100000 [-s seed] file...
+ *                              additionally run that many random
+ *                              mutations of the given files
+ *
+ * The harness decodes through CGImage_readStream and aborts if a reader
+ * reports an invalid size, delivers rows out of range or succeeds
+ * without delivering every row. Images above FUZZ_MAX_PIXELS are
+ * skipped to keep the run fast.
+ *
+ * Before each mutated input is decoded it is written to fuzz-current,
+ * so the input that crashed or hung the loader is left behind. Build with
+ * sanitizers (make fuzz adds -fsanitize=address,undefined) to turn
+ * memory errors into crashes.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <cgimage.h>
+
+#include <cgimage/error.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* file name passed to the loader, no extension to fall back on */
+#define FUZZ_NAME "fuzz"
+
+/* file receiving the input currently decoded */
+#define FUZZ_CURRENT "fuzz-current"
+
+/* seconds a single input may take before it counts as a hang */
+#define FUZZ_TIMEOUT 10
+
+/* upper bound for mutated inputs */
+#define FUZZ_MAX_SIZE (1024 * 1024)
+
+/* images with more pixels are rejected before allocation */
+#define FUZZ_MAX_PIXELS (4096 * 4096)
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+    unsigned int bpp;
+    unsigned int rows;
+    unsigned char* data;
+} FuzzImage;
+
+/* loader errors are expected, keep them quiet */
+static void Fuzz_ignoreError(const CGError* error) {
+    (void)error;
+}
+
+static int Fuzz_header(
+    void* user,
+    unsigned int width,
+    unsigned int height,
+    unsigned int bpp
+) {
+    FuzzImage* image = user;
+
+    if (image->data || (width == 0) || (height == 0) || (bpp == 0) || (bpp > 4))
+        abort();
+
+    if (width > FUZZ_MAX_PIXELS / height)
+        return -1;
+
+    image->width  = width;
+    image->height = height;
+    image->bpp    = bpp;
+    image->data   = malloc((size_t)width * height * bpp);
+
+    return image->data ? 0 : -1;
+}
+
+/* check the rows are in range and copy them, so short buffers are noticed */
+static int Fuzz_rows(
+    void* user,
+    unsigned int first,
+    unsigned int count,
+    const unsigned char* data
+) {
+    FuzzImage* image = user;
+    size_t row_size = (size_t)image->width * image->bpp;
+
+    if (!image->data || (count == 0) || (first >= image->height)
+        || (count > image->height - first))
+        abort();
+
+    memcpy(image->data + first * row_size, data, count * row_size);
+    image->rows += count;
+
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size) {
+    CGImageReader reader;
+    FuzzImage image;
+    FILE* stream;
+    int result;
+
+    CGError_registerHandler(Fuzz_ignoreError);
+
+    /* fmemopen rejects empty buffers */
+    if ((size == 0) || !(stream = fmemopen((void*)data, size, "rb")))
+        return 0;
+
+    memset(&image, 0, sizeof(image));
+
+    reader.header = Fuzz_header;
+    reader.rows   = Fuzz_rows;
+    reader.user   = &image;
+
+    result = CGImage_readStream(FUZZ_NAME, stream, &reader);
+    fclose(stream);
+
+    /* a successful decode delivers every row */
+    if ((result == 0) && (!image.data || (image.rows < image.height)))
+        abort();
+
+    free(image.data);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+static unsigned long fuzz_seed = 1;
+
+static unsigned long Fuzz_random(void) {
+    fuzz_seed = fuzz_seed * 6364136223846793005UL + 1442695040888963407UL;
+    return (fuzz_seed >> 33) & 0x7fffffffUL;
+}
+
+static unsigned char* Fuzz_readFile(const char* path, size_t* size) {
+    unsigned char* data = malloc(FUZZ_MAX_SIZE);
+    FILE* file;
+
+    if (!data || !(file = fopen(path, "rb"))) {
+        perror(path);
+        free(data);
+        return NULL;
+    }
+
+    *size = fread(data, 1, FUZZ_MAX_SIZE, file);
+    fclose(file);
+
+    return data;
+}
+
+/* apply a few random edits: bit flips, interesting bytes, cuts, copies */
+static size_t Fuzz_mutate(unsigned char* data, size_t size) {
+    static const unsigned char interesting[] = {
+        0x00, 0x01, 0x7f, 0x80, 0xc0, 0xff
+    };
+
+    unsigned int edits = 1 + Fuzz_random() % 8;
+
+    while (edits-- > 0 && size > 0) {
+        size_t pos = Fuzz_random() % size;
+
+        switch (Fuzz_random() % 6) {
+            case 0:
+                data[pos] ^= 1 << (Fuzz_random() % 8);
+                break;
+
+            case 1:
+                data[pos] = interesting[Fuzz_random() % sizeof(interesting)];
+                break;
+
+            case 2:
+                data[pos] = Fuzz_random();
+                break;
+
+            case 3:
+                /* truncate */
+                size = pos + 1;
+                break;
+
+            case 4: {
+                /* copy a block within the input */
+                size_t from = Fuzz_random() % size;
+                size_t len  = Fuzz_random() % 64;
+
+                if (len > size - from)
+                    len = size - from;
+                if (len > size - pos)
+                    len = size - pos;
+
+                memmove(data + pos, data + from, len);
+                break;
+            }
+
+            default:
+                /* insert a random byte */
+                if (size < FUZZ_MAX_SIZE) {
+                    memmove(data + pos + 1, data + pos, size - pos);
+                    data[pos] = Fuzz_random();
+                    ++size;
+                }
+                break;
+        }
+    }
+
+    return size;
+}
+
+static void Fuzz_saveCurrent(const unsigned char* data, size_t size) {
+    FILE* file = fopen(FUZZ_CURRENT, "wb");
+
+    if (file) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned long runs = 0, i;
+    unsigned char** seeds;
+    unsigned char* input;
+    size_t* sizes;
+    int count, opt, f;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n': runs      = strtoul(optarg, NULL, 10); break;
+            case 's': fuzz_seed = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "usage: %s [-n runs] [-s seed] file...\n", argv[0]);
+                return 2;
+        }
+    }
+
+    count = argc - optind;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [-n runs] [-s seed] file...\n", argv[0]);
+        return 2;
+    }
+
+    seeds = malloc(count * sizeof(*seeds));
+    sizes = malloc(count * sizeof(*sizes));
+    input = malloc(FUZZ_MAX_SIZE);
+    if (!seeds || !sizes || !input)
+        return 1;
+
+    /* run the inputs as they are */
+    for (f = 0; f < count; ++f) {
+        if (!(seeds[f] = Fuzz_readFile(argv[optind + f], &sizes[f])))
+            return 1;
+
+        LLVMFuzzerTestOneInput(seeds[f], sizes[f]);
+    }
+
+    /* run random mutations */
+    for (i = 0; i < runs; ++i) {
+        size_t size;
+
+        f = Fuzz_random() % count;
+        memcpy(input, seeds[f], sizes[f]);
+        size = Fuzz_mutate(input, sizes[f]);
+
+        Fuzz_saveCurrent(input, size);
+
+        /* hangs are killed by SIGALRM, leaving fuzz-current behind */
+        alarm(FUZZ_TIMEOUT);
+        LLVMFuzzerTestOneInput(input, size);
+        alarm(0);
+
+        if ((i + 1) % 10000 == 0)
+            fprintf(stderr, "%lu runs\n", i + 1);
+    }
+
+    if (runs)
+        remove(FUZZ_CURRENT);
+
+    for (f = 0; f < count; ++f)
+        free(seeds[f]);
+    free(seeds);
+    free(sizes);
+    free(input);
+
+    return 0;
+}
+
+#endif
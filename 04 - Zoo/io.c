@@ -401,6 +401,11 @@ static void cbDisplay(void)
   static double fps = 0.0;
   
   static float textColor[3] = { 1.0f, 0.0f, 0.0f };
+  
+  unsigned drawn
+         , culled
+         ;
+  
   /* Buffer zuruecksetzen */
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -413,11 +418,15 @@ static void cbDisplay(void)
   setCamera();
   
   /* Szene zeichnen */
-  sceneDraw(FALSE);
+  sceneDraw();
   
   /* Framerate ausgegeben */
   drawString(0.05, 0.05, textColor, "FPS: %.2f", fps);
   
+  /* Gezeichnete und weggelassene Objekte */
+  sceneGetItemCounts(&drawn, &culled);
+  drawString(0.05, 0.10, textColor, "Objects: %u drawn, %u culled", drawn, culled);
+  
   /* Objekt anzeigen */
   glutSwapBuffers();
   
@@ -13,6 +13,8 @@
 #include <assert.h>
 #include <float.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -32,8 +34,9 @@
 /**
  * Ordnungsrelation.
  * Vergleicht die Items i und j.
- * Dabei gilt i > j wenn die z-Ebene von i kleiner ist als die von j
- *       oder       wenn die Entfernung von der Kamera von i größer ist als die von j.
+ * Dabei gilt i > j wenn die z-Ebene von i kleiner ist als die von j.
+ * Die Reihenfolge innerhalb einer Ebene und nach der Entfernung zur Kamera
+ * bestimmt erst die Render-Warteschlange beim Zeichnen.
  *
  * @param[in] i Item 1.
  * @param[in] j Item 2.
@@ -43,52 +46,129 @@
  */
 static Boolean grEl(LevelItem * i, LevelItem * j)
 {
-  return (i->z < j->z)
-      || (i->z == j->z && i->size - j->size > DBL_EPSILON)
-      ;
+  return i->z < j->z;
 }
 
 /**
  * Invariante.
- * Die Invariante hält, wenn l nur ein Element hat oder wenn gilt, dass für alle
- * i das i-te Element kleiner ist als das (i+1)-te.
+ * Die Invariante hält, wenn l höchstens ein Element hat oder wenn gilt, dass
+ * für alle i das i-te Element nicht größer ist als das (i+1)-te.
  *
  * @param[in] l Level.
- * @param[in] i Index des "ersten" Elements.
  *
  * @return true  wenn die Invariante hält
  *         false sonst.
  */
-static Boolean levelInv(Level l, unsigned i)
+static Boolean levelInv(Level l)
 {
-  return (i == l.last - 1)
-      || (!grEl(l.items[i], l.items[i+1])
-          && levelInv(l, i+1)
-         );
+  unsigned i;
+  
+  for (i = 1; i < l.last; ++i)
+    if (grEl(l.items[i-1], l.items[i]))
+      return FALSE;
+  
+  return TRUE;
 }
 
 /**
- * Ordnet den Elementen des Levels Größen zu.
- * Ein Element ist größer, je größer die Entfernung zum Augpunkt ist.
+ * Sorgt dafür, dass l Platz für mindestens count Elemente hat. Der Platz
+ * wird mindestens verdoppelt, damit das Einfügen im Mittel billig bleibt.
  *
- * @param[in] l   Level.
- * @param[in] eve Augpunkt.
- * @param[in] n   Blickrichtung.
+ * @param[in,out] l     Level.
+ * @param[in]     count Benötigte Anzahl an Elementen.
  *
- * @return Level, wobei den Elementen Größen zugeordnet wurden.
+ * @return true  wenn genug Platz vorhanden ist
+ *         false wenn kein Speicher mehr angefordert werden konnte.
  */
-static Level calcSizes(Level l, Vector3d eye, Vector3d n)
+static Boolean reserve(Level * l, unsigned count)
 {
-  unsigned i = 0;
+  unsigned capacity = l->capacity;
   
-  /* Nur mit normierten Vektoren arbeiten */
-  n = vectorNorm(n);
+  LevelItem ** items;
   
-  /* Jedem Objekt eine Größe zuordnen -> Hesse'sche Normalform */
-  for (i = 0; i < l.last; ++i)
-    l.items[i]->size = vectorMult(vectorSub(l.items[i]->p, eye), n);
+  if (count <= capacity)
+    return TRUE;
   
-  return l;
+  capacity = capacity < LEVEL_CAPACITY ? LEVEL_CAPACITY : 2 * capacity;
+  
+  if (capacity < count)
+    capacity = count;
+  
+  items = realloc(l->items, capacity * sizeof(LevelItem *));
+  
+  if (items == NULL)
+  {
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Level : Could not grow to %u items.\n", capacity);
+    #endif
+    
+    return FALSE;
+  }
+  
+  l->items    = items;
+  l->capacity = capacity;
+  
+  return TRUE;
+}
+
+/**
+ * Stabiles Sortieren durch Einfügen. Nur, wenn für mergeSort kein
+ * Zwischenspeicher zu bekommen ist.
+ *
+ * @param[in,out] items Zu sortierende Elemente.
+ * @param[in]     count Anzahl der Elemente.
+ */
+static void insertionSort(LevelItem ** items, unsigned count)
+{
+  unsigned i = 0
+         , j = 0
+         ;
+  
+  LevelItem * tmp;
+  
+  for (i = 1; i < count; ++i)
+  {
+    tmp = items[i];
+    
+    for (j = i; j > 0 && grEl(items[j-1], tmp); --j)
+      items[j] = items[j-1];
+    
+    items[j] = tmp;
+  }
+}
+
+/**
+ * Stabiles Sortieren durch Mischen (Merge-Sort).
+ *
+ * @param[in,out] items Zu sortierende Elemente.
+ * @param[in]     tmp   Zwischenspeicher für count Elemente.
+ * @param[in]     count Anzahl der Elemente.
+ */
+static void mergeSort(LevelItem ** items, LevelItem ** tmp, unsigned count)
+{
+  unsigned half = count / 2
+         , i    = 0
+         , j    = half
+         , k    = 0
+         ;
+  
+  if (count < 2)
+    return;
+  
+  mergeSort(items,        tmp, half);
+  mergeSort(items + half, tmp, count - half);
+  
+  /* Bei Gleichheit gewinnt die linke Hälfte -> stabil */
+  while (i < half && j < count)
+    tmp[k++] = grEl(items[i], items[j]) ? items[j++] : items[i++];
+  
+  while (i < half)
+    tmp[k++] = items[i++];
+  
+  while (j < count)
+    tmp[k++] = items[j++];
+  
+  memcpy(items, tmp, count * sizeof(LevelItem *));
 }
 
 /* ----------------------------------------------------------------------------
@@ -106,39 +186,52 @@ extern Level levelInit()
 {
   Level l;
   
-  l.last = 0;
-  l.zMax = 0;
+  l.items    = NULL;
+  l.last     = 0;
+  l.capacity = 0;
+  l.zMax     = 0;
   
   return l;
 }
 
 /**
- * Fügt das Item i in den Level l ein.
+ * Fügt die count Items aus items in den Level l ein und sortiert ihn danach
+ * ein einziges Mal.
  *
- * @param[in] l   Level.
- * @param[in] i   Einzufügendes Objekt.
- * @param[in] eye Augpunkt.
- * @param[in] n   Blickrichtung.
+ * @param[in] l     Level.
+ * @param[in] items Einzufügende Objekte.
+ * @param[in] count Anzahl der Objekte.
+ * @param[in] eye   Augpunkt.
+ * @param[in] n     Blickrichtung.
  *
- * @return Level, in den i eingefügt wurde.
+ * @return Level, in den die Objekte eingefügt wurden.
  */
-extern Level levelInsert(Level l, LevelItem * i, Vector3d eye, Vector3d n)
+extern Level levelInsertAll(Level l, LevelItem ** items, unsigned count, Vector3d eye, Vector3d n)
 {
-  /* Es muss noch Platz sein im Level */
-  assert(l.last <= LEVEL_ITEMCOUNT);
+  LevelItem ** tmp;
   
-  /* Nur mit normierten Vektoren arbeiten */
-  n = vectorNorm(n);
+  if (count == 0 || !reserve(&l, l.last + count))
+    return l;
   
-  /* Einfügen von i */
-  l.items[l.last++] = i;
+  memcpy(l.items + l.last, items, count * sizeof(LevelItem *));
+  l.last += count;
   
-  /* z-Ebenen */
-  if (i->z > l.zMax)
-    l.zMax = i->z;
+  l = levelCalcSizes(l, eye, n);
   
-  /* Sortieren */
-  levelSort(l, eye, n);
+  tmp = malloc(l.last * sizeof(LevelItem *));
+  
+  /* Ohne Zwischenspeicher bleibt das langsamere Sortieren durch Einfügen */
+  if (tmp == NULL)
+    insertionSort(l.items, l.last);
+  else
+  {
+    mergeSort(l.items, tmp, l.last);
+    free(tmp);
+  }
+  
+  l.zMax = l.items[0]->z;
+  
+  assert(levelInv(l));
   
   return l;
 }
@@ -190,44 +283,26 @@ extern LevelItem * levelItemAt(Level l, unsigned i)
 }
 
 /**
- * Sortiert den Level l.
+ * Ordnet den Elementen des Levels l ihre Entfernung zum Augpunkt entlang der
+ * Blickrichtung zu. Die Reihenfolge des Levels hängt nur an den z-Ebenen und
+ * bleibt daher erhalten, nach der Entfernung sortiert die Render-Warteschlange.
  *
  * @param[in] l   Level.
  * @param[in] eye Augpunkt.
  * @param[in] n   Blickrichtung.
  *
- * @return sortierter Level.
+ * @return Level mit aktuellen Entfernungen.
  */
-extern Level levelSort(Level l, Vector3d eye, Vector3d n)
+extern Level levelCalcSizes(Level l, Vector3d eye, Vector3d n)
 {
-  Boolean sorted = FALSE;
-  
   unsigned i = 0;
   
-  LevelItem * tmp;
-  
-  /* Den Items Gewichte zuordnen */
-  l = calcSizes(l, eye, n);
-  
-  /* Dumb-Sort */
-  while (!sorted)
-  {
-    sorted = TRUE;
-    
-    for (i = 0; i < l.last - 1; ++i)
-      if (grEl(l.items[i], l.items[i+1]))
-      /*if (l.items[i].size > l.items[i+1].size)*/
-      {
-        sorted = FALSE;
-        
-        tmp          = l.items[i];
-        l.items[i]   = l.items[i+1];
-        l.items[i+1] = tmp;
-      }
-  }
+  /* Nur mit normierten Vektoren arbeiten */
+  n = vectorNorm(n);
   
-  /* Der Level muss sortiert sein */
-  assert(levelInv(l, 0));
+  /* Jedem Objekt eine Größe zuordnen -> Hesse'sche Normalform */
+  for (i = 0; i < l.last; ++i)
+    l.items[i]->size = vectorMult(vectorSub(l.items[i]->p, eye), n);
   
   return l;
 }
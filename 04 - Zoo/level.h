@@ -12,8 +12,8 @@
 
 #include "vector.h"
 
-/** Anzahl an Objekten, die ein Level enthalten kann. */
-#define LEVEL_ITEMCOUNT (15)
+/** Anzahl an Objekten, für die ein Level beim ersten Einfügen Platz schafft. */
+#define LEVEL_CAPACITY (16)
 
 /** Picking Namen */
 typedef enum {
@@ -57,12 +57,18 @@ typedef struct {
   unsigned z;          /* z-Ebene */
 } LevelItem;
 
-/** Ein Level. */
+/**
+ * Ein Level.
+ * Die Elemente liegen nach z-Ebene sortiert in einem wachsenden Feld, die
+ * höchste Ebene vorn. Kopien eines Levels teilen sich das Feld, gültig ist
+ * nur die zuletzt zurückgegebene.
+ */
 typedef struct {
-  LevelItem * items[LEVEL_ITEMCOUNT]; /* Zeiger auf Elemente */
+  LevelItem ** items; /* Zeiger auf Elemente, sortiert */
   
-  unsigned last /* Index des letzten Elementes */
-         , zMax /* maximale z-Ebene            */
+  unsigned last     /* Anzahl der Elemente         */
+         , capacity /* Platz im Feld items         */
+         , zMax     /* maximale z-Ebene            */
          ;
 } Level;
 
@@ -74,16 +80,18 @@ typedef struct {
 extern Level levelInit();
 
 /**
- * Fügt das Item i in den Level l ein.
+ * Fügt die count Items aus items in den Level l ein und sortiert ihn danach
+ * ein einziges Mal.
  *
- * @param[in] l   Level.
- * @param[in] i   Einzufügendes Objekt.
- * @param[in] eye Augpunkt.
- * @param[in] n   Blickrichtung.
+ * @param[in] l     Level.
+ * @param[in] items Einzufügende Objekte.
+ * @param[in] count Anzahl der Objekte.
+ * @param[in] eye   Augpunkt.
+ * @param[in] n     Blickrichtung.
  *
- * @return Level, in den i eingefügt wurde.
+ * @return Level, in den die Objekte eingefügt wurden.
  */
-extern Level levelInsert(Level l, LevelItem * i, Vector3d eye, Vector3d n);
+extern Level levelInsertAll(Level l, LevelItem ** items, unsigned count, Vector3d eye, Vector3d n);
 
 /**
  * Erzeugt ein LevelItem und gibt es zurück.
@@ -111,15 +119,16 @@ extern LevelItem levelItemMake(Vector3d p, Vector3d r, Vector3d t, DrawFunctionT
 extern LevelItem * levelItemAt(Level l, unsigned i);
 
 /**
- * Sortiert den Level l.
+ * Ordnet den Elementen des Levels l ihre Entfernung zum Augpunkt entlang der
+ * Blickrichtung zu. Die Reihenfolge des Levels bleibt erhalten.
  *
  * @param[in] l   Level.
  * @param[in] eye Augpunkt.
  * @param[in] n   Blickrichtung.
  *
- * @return sortierter Level.
+ * @return Level mit aktuellen Entfernungen.
  */
-extern Level levelSort(Level l, Vector3d eye, Vector3d n);
+extern Level levelCalcSizes(Level l, Vector3d eye, Vector3d n);
 
 /**
  * Gibt die String-Repräsentation des PickinName n zurück.
@@ -13,6 +13,7 @@
  * -------------------------------------------------------------------------- */
 #include <math.h>
 #include <assert.h>
+#include <stddef.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -27,6 +28,7 @@
 #include "vector.h"
 #include "level.h"
 #include "texture.h"
+#include "raycast.h"
 
 /* ----------------------------------------------------------------------------
  * Typen
@@ -319,7 +321,8 @@ static void animateGiraffe(Animation * giraffe, double interval)
     double newAngle = *giraffe->animProperty + interval * LOGIC_ANIM_ANGLE_PS;
     
     /* Wenn der Kopf kollidiert, dann die Animation umkehren */
-    if (collisionGiraffeHead(itemGiraffeHead.t, itemPig.t, newAngle))
+    if (collisionGiraffeHead( vectorAdd(itemGiraffe.t, itemGiraffeHead.t)
+                            , itemPig.t, newAngle))
     {
       giraffe->stop = TRUE;
     }
@@ -343,6 +346,9 @@ static void animateGiraffe(Animation * giraffe, double interval)
       *giraffe->animProperty = giraffe->animMin;
     }
   }
+  
+  /* Huellquader fuers Picking nachfuehren */
+  raycastUpdate(&itemGiraffeHead);
 }
 
 /**
@@ -369,6 +375,9 @@ static void animatePig(Animation * pig, double interval)
   {
     *pig->animProperty += interval * LOGIC_ANIM_ANGLE_PS;
   }
+  
+  /* Huellquader fuers Picking nachfuehren */
+  raycastUpdate(&itemPig);
 }
 
 /**
@@ -414,6 +423,9 @@ static void animateFish(Animation * fish, double interval)
     }
   }
   
+  /* Huellquader fuers Picking nachfuehren */
+  raycastUpdate(&itemFish);
+  
   #undef ANIMATION_RADIUS
 }
 
@@ -440,6 +452,25 @@ static void calcAnimation(double interval)
  */
 static void initItems(void)
 {
+  /* Alle Gegenstände, werden gemeinsam eingefügt */
+  LevelItem * items[] =
+    { &itemGround
+    , &itemSocket
+    , &itemCeiling
+    , &itemFenceFront
+    , &itemFenceBack
+    , &itemFenceLeft
+    , &itemFenceRight
+    , &itemPool
+    , &itemWater
+    , &itemPig
+    , &itemGiraffe
+    , &itemGiraffeHead
+    , &itemFish
+    , &itemSun
+    , &itemGiraffeCube
+    };
+  
   #ifdef DEBUG
   fprintf(stderr, "DEBUG :: Init : Initializing Level.\n");
   #endif
@@ -545,9 +576,10 @@ static void initItems(void)
                              , 1                          /* z */
                              );
   
+  /* Translation relativ zur Giraffe (logicGetParentItem) */
   itemGiraffeHead = levelItemMake( vectorMake(-0.5, 0.4, 0.1) /* p */
                                  , vectorMake(1.0, 0.0, 0.0)  /* r */
-                                 , vectorMake(-0.5, 0.4, 0.1) /* t */
+                                 , vectorMake(0.0, 0.0, 0.1)  /* t */
                                  , DF_GIRAFFE_HEAD            /* f */
                                  , 0                          /* a */
                                  , NAME_GIRAFFE_HEAD          /* n */
@@ -585,21 +617,10 @@ static void initItems(void)
   fprintf(stderr, "DEBUG :: Init : Inserting Items.\n");
   #endif
   
-  l = levelInsert(l, &itemGround,      eye, n);
-  l = levelInsert(l, &itemSocket,      eye, n);
-  l = levelInsert(l, &itemCeiling,     eye, n);
-  l = levelInsert(l, &itemFenceFront,  eye, n);
-  l = levelInsert(l, &itemFenceBack,   eye, n);
-  l = levelInsert(l, &itemFenceLeft,   eye, n);
-  l = levelInsert(l, &itemFenceRight,  eye, n);
-  l = levelInsert(l, &itemPool,        eye, n);
-  l = levelInsert(l, &itemWater,       eye, n);
-  l = levelInsert(l, &itemPig,         eye, n);
-  l = levelInsert(l, &itemGiraffe,     eye, n);
-  l = levelInsert(l, &itemGiraffeHead, eye, n);
-  l = levelInsert(l, &itemFish,        eye, n);
-  l = levelInsert(l, &itemSun,         eye, n);
-  l = levelInsert(l, &itemGiraffeCube, eye, n);
+  l = levelInsertAll(l, items, sizeof(items) / sizeof(items[0]), eye, n);
+  
+  /* Huellquader fuers Picking */
+  raycastBuild(l);
 }
 
 /* ----------------------------------------------------------------------------
@@ -660,8 +681,8 @@ extern void logicCalcScene(double interval)
   /* Blickrichtung normieren */
   n = vectorNorm(vectorSub(center, eye));
   
-  /* Level anhand des Augpunktes und der Blickrichtung sortieren */
-  l = levelSort(l, eye, n);
+  /* Entfernungen für die Render-Warteschlange, die danach sortiert */
+  l = levelCalcSizes(l, eye, n);
 }
 
 /**
@@ -815,6 +836,21 @@ extern Boolean logicIsPickable(PickingName n)
       ;
 }
 
+/**
+ * Gibt das Objekt zurück, an dem i hängt. Der Giraffenkopf hängt an der
+ * Giraffe und bewegt sich mit ihr.
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Übergeordnetes Objekt, NULL wenn i frei steht.
+ */
+extern const LevelItem * logicGetParentItem(const LevelItem * i)
+{
+  return i == &itemGiraffeHead
+       ? &itemGiraffe
+       : NULL;
+}
+
 /**
  * Wählt ein auswählbares Objekt aus oder lässt es los.
  *
@@ -883,13 +919,11 @@ extern void logicMove(Vector3d v)
         if (inCage(move, sizeGiraffe)
         &&  distanceGiraffePig(move, itemPig.t, sizeGiraffe, sizePig))
         {
-          /* Giraffe und Giraffenkopf bewegen */
-          itemGiraffe.t     = move;
-          itemGiraffeHead.t = vectorAdd( itemGiraffeHead.t
-                                       , vectorRotateY( vectorScale(v, 0.01, 0.01, 0.01)
-                                                      , camRotation
-                                                      )
-                                       );
+          /* Giraffe bewegen, der Kopf hängt an ihr und wird mitgeführt */
+          itemGiraffe.t = move;
+          
+          raycastUpdate(&itemGiraffe);
+          raycastUpdate(&itemGiraffeHead);
         }
       }
       /* Schwein bewegen */
@@ -904,6 +938,7 @@ extern void logicMove(Vector3d v)
         {
           /* Schwein bewegen */
           itemPig.t = move;
+          raycastUpdate(&itemPig);
         }
       }
       /* Fisch bewegen */
@@ -914,6 +949,7 @@ extern void logicMove(Vector3d v)
         {
           /* Fisch bewegen */
           itemFish.t = move;
+          raycastUpdate(&itemFish);
         }
       }
     }
@@ -152,6 +152,17 @@ extern void logicSetToCorner(Corner c);
 
 extern Boolean logicIsPickable(PickingName n);
 
+/**
+ * Gibt das Objekt zurück, an dem i hängt. Verschiebungen des übergeordneten
+ * Objekts gelten auch für i. Übergeordnete Objekte werden nur verschoben,
+ * nicht gedreht.
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Übergeordnetes Objekt, NULL wenn i frei steht.
+ */
+extern const LevelItem * logicGetParentItem(const LevelItem * i);
+
 /**
  * Wählt ein auswählbares Objekt aus oder lässt es los.
  *
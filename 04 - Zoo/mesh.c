@@ -0,0 +1,421 @@
+/**
+ * @file
+ *
+ * Das Modul zerlegt die unterteilten Grundformen einmalig in Dreiecke und
+ * haelt sie in einem Zwischenspeicher.
+ *
+ * Jede Form besteht aus Seiten, die alle aus demselben unterteilten Quadrat
+ * hervorgehen: das Quadrat wird entlang z verschoben und dann gedreht, so
+ * wie es die Zeichenfunktionen frueher pro Seite mit glTranslate und
+ * glRotate getan haben. Die Eckpunkte liegen verschraenkt als Textur-
+ * koordinate, Normale und Position (GL_T2F_N3F_V3F) in einem Feld, die
+ * Dreiecke als Indizes in einem zweiten.
+ *
+ * Der Zwischenspeicher ist nach (Form, Unterteilung) geschluesselt. Wird die
+ * Unterteilung geaendert, entstehen neue Eintraege, die alten bleiben, bis
+ * sie als am laengsten unbenutzte verdraengt werden.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#define GL_GLEXT_PROTOTYPES
+
+#include <GL/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "mesh.h"
+#include "types.h"
+#include "vector.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Anzahl der Eintraege im Zwischenspeicher */
+#define MESH_CACHE_SIZE (8)
+
+/** Maximale Anzahl der Seiten einer Form */
+#define MESH_MAX_FACES (10)
+
+/** Floats pro Eckpunkt: Texturkoordinate, Normale, Position */
+#define MESH_STRIDE (8)
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Lage einer Seite: erst um dz entlang z verschieben, dann um a drehen */
+typedef struct {
+  double a;      /* Drehwinkel im Gradmass      */
+  char axis;     /* Drehachse, 'x' oder 'y'     */
+  double dz;     /* Verschiebung entlang z      */
+} MeshFace;
+
+/** Eintrag im Zwischenspeicher */
+typedef struct {
+  MeshType type;          /* Form                                   */
+  unsigned subdivides;    /* Unterteilung                           */
+  unsigned long used;     /* Zeitpunkt der letzten Benutzung, 0 = frei */
+  GLsizei count;          /* Anzahl der Indizes                     */
+  GLuint vbo              /* Puffer fuer Eckpunkte, 0 ohne VBO      */
+       , ibo              /* Puffer fuer Indizes                    */
+       ;
+  GLfloat * vertices;     /* Eckpunkte, nur ohne VBO                */
+  GLuint * indices;       /* Indizes, nur ohne VBO                  */
+} MeshEntry;
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* Seiten der Formen, wie sie frueher in drawing.c gesetzt wurden */
+static const MeshFace faces[MESH_DUMMY][MESH_MAX_FACES] =
+  { /* Quadrat */
+    { {   0.0, 'y',   0.0 }
+    }
+    /* Wuerfel: vorne, rechts, hinten, links, oben, unten */
+  , { {   0.0, 'y',   0.5 }
+    , {  90.0, 'y',   0.5 }
+    , { 180.0, 'y',   0.5 }
+    , { 270.0, 'y',   0.5 }
+    , { -90.0, 'x',   0.5 }
+    , {  90.0, 'x',   0.5 }
+    }
+    /* Offener Wuerfel, jede Seite von aussen und von innen, ohne oben */
+  , { {   0.0, 'y',   0.5 }
+    , { 180.0, 'y', - 0.5 }
+    , {  90.0, 'y',   0.5 }
+    , { 270.0, 'y', - 0.5 }
+    , { 180.0, 'y',   0.5 }
+    , {   0.0, 'y', - 0.5 }
+    , { 270.0, 'y',   0.5 }
+    , {  90.0, 'y', - 0.5 }
+    , {  90.0, 'x',   0.5 }
+    , { 270.0, 'x', - 0.5 }
+    }
+  };
+
+/* Anzahl der Seiten der Formen */
+static const unsigned faceCount[MESH_DUMMY] = {1, 6, 10};
+
+/* Zwischenspeicher */
+static MeshEntry cache[MESH_CACHE_SIZE];
+
+/* Zaehler fuer die Benutzung der Eintraege */
+static unsigned long stamp = 0;
+
+/* -1 unbekannt, 0 keine VBOs, 1 VBOs vorhanden */
+static int hasVBO = -1;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Prueft, ob GL Vertex Buffer Objects anbietet (ab Version 1.5).
+ *
+ * @return TRUE  wenn VBOs benutzt werden koennen
+ *         FALSE sonst.
+ */
+static Boolean checkVBO(void)
+{
+  if (hasVBO < 0)
+  {
+    const char * version = (const char *) glGetString(GL_VERSION);
+
+    int major = 0
+      , minor = 0
+      ;
+
+    if (version)
+      sscanf(version, "%d.%d", &major, &minor);
+
+    hasVBO = major > 1 || (major == 1 && minor >= 5);
+
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Mesh : %s.\n", hasVBO ? "Using VBOs" : "Using client arrays");
+    #endif
+  }
+
+  return hasVBO;
+}
+
+/**
+ * Dreht den Vektor v wie die Seite f.
+ *
+ * @param[in] f Seite.
+ * @param[in] v Vektor.
+ *
+ * @return gedrehter Vektor.
+ */
+static Vector3d rotate(const MeshFace * f, Vector3d v)
+{
+  return f->axis == 'x'
+       ? vectorRotateX(v, f->a)
+       : vectorRotateY(v, f->a);
+}
+
+/**
+ * Zerlegt die Form type mit der Unterteilung subdivides in Dreiecke.
+ * Die Eckpunkte werden wie im frueheren GL_QUAD_STRIP zeilenweise von oben
+ * nach unten erzeugt, die Dreiecke behalten dessen Umlaufsinn.
+ *
+ * @param[in]  type       Form.
+ * @param[in]  subdivides Feinheit der Form.
+ * @param[out] vertices   Neu angelegte Eckpunkte.
+ * @param[out] indices    Neu angelegte Indizes.
+ *
+ * @return Anzahl der Indizes, 0 wenn kein Speicher angefordert werden konnte.
+ */
+static GLsizei tessellate(MeshType type, unsigned subdivides, GLfloat ** vertices, GLuint ** indices)
+{
+  unsigned side  = subdivides + 2
+         , quads = subdivides + 1
+         , f
+         , x
+         , y
+         ;
+
+  GLfloat * v;
+  GLuint * i;
+
+  *vertices = malloc(faceCount[type] * side * side * MESH_STRIDE * sizeof(GLfloat));
+  *indices  = malloc(faceCount[type] * quads * quads * 6 * sizeof(GLuint));
+
+  if (*vertices == NULL || *indices == NULL)
+  {
+    free(*vertices);
+    free(*indices);
+
+    return 0;
+  }
+
+  v = *vertices;
+  i = *indices;
+
+  for (f = 0; f < faceCount[type]; ++f)
+  {
+    const MeshFace * face = faces[type] + f;
+
+    GLuint base = f * side * side;
+
+    Vector3d n = rotate(face, vectorMake(0.0, 0.0, 1.0));
+
+    /* Eckpunkte */
+    for (y = 0; y < side; ++y)
+      for (x = 0; x < side; ++x)
+      {
+        Vector3d p = rotate(face, vectorMake( - 0.5 + x / (double) quads
+                                            ,   0.5 - y / (double) quads
+                                            , face->dz
+                                            ));
+
+        *v++ = x / (GLfloat) quads;
+        *v++ = y / (GLfloat) quads;
+        *v++ = n.x;
+        *v++ = n.y;
+        *v++ = n.z;
+        *v++ = p.x;
+        *v++ = p.y;
+        *v++ = p.z;
+      }
+
+    /* Zwei Dreiecke pro Feld, gegen den Uhrzeigersinn */
+    for (y = 0; y < quads; ++y)
+      for (x = 0; x < quads; ++x)
+      {
+        GLuint a = base + y * side + x
+             , b = a + side
+             ;
+
+        *i++ = a;
+        *i++ = b;
+        *i++ = b + 1;
+
+        *i++ = a;
+        *i++ = b + 1;
+        *i++ = a + 1;
+      }
+  }
+
+  return (GLsizei) (i - *indices);
+}
+
+/**
+ * Gibt den Eintrag e frei.
+ *
+ * @param[in,out] e Eintrag.
+ */
+static void release(MeshEntry * e)
+{
+  if (e->vbo)
+  {
+    glDeleteBuffers(1, &e->vbo);
+    glDeleteBuffers(1, &e->ibo);
+  }
+
+  free(e->vertices);
+  free(e->indices);
+
+  e->vbo      = 0;
+  e->ibo      = 0;
+  e->vertices = NULL;
+  e->indices  = NULL;
+  e->used     = 0;
+}
+
+/**
+ * Sucht die Form type mit der Unterteilung subdivides im Zwischenspeicher
+ * und legt sie an, falls sie fehlt.
+ *
+ * @param[in] type       Form.
+ * @param[in] subdivides Feinheit der Form.
+ *
+ * @return Eintrag, NULL wenn die Form nicht angelegt werden konnte.
+ */
+static MeshEntry * lookup(MeshType type, unsigned subdivides)
+{
+  MeshEntry * e = cache;
+
+  unsigned k;
+
+  for (k = 0; k < MESH_CACHE_SIZE; ++k)
+  {
+    if (cache[k].used && cache[k].type == type && cache[k].subdivides == subdivides)
+    {
+      cache[k].used = ++stamp;
+      return cache + k;
+    }
+
+    /* Freie oder am laengsten unbenutzte Stelle merken */
+    if (cache[k].used < e->used)
+      e = cache + k;
+  }
+
+  if (e->used)
+    release(e);
+
+  e->count = tessellate(type, subdivides, &e->vertices, &e->indices);
+
+  if (e->count == 0)
+  {
+    e->vertices = NULL;
+    e->indices  = NULL;
+
+    return NULL;
+  }
+
+  e->type       = type;
+  e->subdivides = subdivides;
+  e->used       = ++stamp;
+
+  /* In Puffer kopieren, die Felder werden dann nicht mehr gebraucht */
+  if (checkVBO())
+  {
+    glGenBuffers(1, &e->vbo);
+    glGenBuffers(1, &e->ibo);
+
+    glBindBuffer(GL_ARRAY_BUFFER, e->vbo);
+    glBufferData(GL_ARRAY_BUFFER
+                , faceCount[type] * (subdivides + 2) * (subdivides + 2) * MESH_STRIDE * sizeof(GLfloat)
+                , e->vertices
+                , GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, e->count * sizeof(GLuint), e->indices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    free(e->vertices);
+    free(e->indices);
+    e->vertices = NULL;
+    e->indices  = NULL;
+  }
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Mesh : Tessellated type %i, %u subdivides.\n", type, subdivides);
+  #endif
+
+  return e;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Zeichnet die Form type mit der Unterteilung subdivides.
+ *
+ * @param[in] type       Form.
+ * @param[in] subdivides Feinheit der Form.
+ */
+extern void meshDraw(MeshType type, unsigned subdivides)
+{
+  MeshEntry * e = lookup(type, subdivides);
+
+  if (e == NULL)
+    return;
+
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  if (e->vbo)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, e->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, e->ibo);
+
+    glInterleavedArrays(GL_T2F_N3F_V3F, 0, NULL);
+    glDrawElements(GL_TRIANGLES, e->count, GL_UNSIGNED_INT, NULL);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  else
+  {
+    glInterleavedArrays(GL_T2F_N3F_V3F, 0, e->vertices);
+    glDrawElements(GL_TRIANGLES, e->count, GL_UNSIGNED_INT, e->indices);
+  }
+
+  glPopClientAttrib();
+}
+
+/**
+ * Zeichnet fuer jede Seite der Form type eine Linie in Richtung ihrer
+ * Normalen.
+ *
+ * @param[in] type Form.
+ */
+extern void meshDrawNormals(MeshType type)
+{
+  unsigned f;
+
+  glDisable(GL_LIGHTING);
+    glBegin(GL_LINES);
+      glColor3f(1.0, 0.0, 0.0);
+
+      for (f = 0; f < faceCount[type]; ++f)
+      {
+        const MeshFace * face = faces[type] + f;
+
+        Vector3d from = rotate(face, vectorMake(0.5, 0.5, face->dz))
+               , to   = rotate(face, vectorMake(0.5, 0.5, face->dz + 1.0))
+               ;
+
+        glVertex3d(from.x, from.y, from.z);
+        glVertex3d(to.x,   to.y,   to.z);
+      }
+    glEnd();
+  glEnable(GL_LIGHTING);
+}
@@ -0,0 +1,43 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+/**
+ * @file
+ *
+ * Das Modul zerlegt die unterteilten Grundformen einmalig in Dreiecke und
+ * haelt sie in einem Zwischenspeicher, der nach Form und Unterteilung
+ * geschluesselt ist. Gezeichnet wird jede Form mit einem einzigen
+ * glDrawElements, aus einem Vertex Buffer Object, falls GL es anbietet,
+ * sonst aus Client-Arrays.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/** Zwischengespeicherte Grundformen */
+typedef enum {
+  MESH_SQUARE              /* Quadrat im Ursprung in der x-y-Ebene  */
+, MESH_CUBE                /* Einheitswuerfel aus sechs Quadraten   */
+, MESH_CUBE_INVERTED_OPEN  /* Innen und aussen, ohne Oberseite      */
+, MESH_DUMMY
+} MeshType;
+
+/**
+ * Zeichnet die Form type mit der Unterteilung subdivides. Ist sie noch
+ * nicht im Zwischenspeicher, wird sie erzeugt und dabei, falls noetig, die
+ * am laengsten nicht benutzte Form verdraengt.
+ * Die Textur muss vorher gebunden sein.
+ *
+ * @param[in] type       Form.
+ * @param[in] subdivides Feinheit der Form.
+ */
+extern void meshDraw(MeshType type, unsigned subdivides);
+
+/**
+ * Zeichnet fuer jede Seite der Form type eine Linie in Richtung ihrer
+ * Normalen, wie sie zur Kontrolle der Normalen angezeigt wird.
+ *
+ * @param[in] type Form.
+ */
+extern void meshDrawNormals(MeshType type);
+
+#endif
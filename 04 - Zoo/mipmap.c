@@ -0,0 +1,1099 @@
+/**
+ * @file
+ *
+ * Das Modul erzeugt Mipmap-Ketten auf der CPU und laedt sie Stufe fuer Stufe
+ * mit glTexImage2D hoch. Es ersetzt gluBuild2DMipmaps.
+ *
+ * Bilder, deren Ausmasse keine Zweierpotenzen sind, werden zunaechst mit
+ * einem flaechengewichteten Filter in Festkomma auf die naechste
+ * Zweierpotenz skaliert. Jede weitere Stufe entsteht aus der vorherigen durch
+ * einen 2x2-Boxfilter, dessen vertikale Summe (falls vorhanden) mit SSE2
+ * gebildet wird. Die Zeilen einer Stufe werden auf mehrere Threads verteilt.
+ *
+ * Die erste Stufe wird direkt aus dem CGImage gelesen und ueber
+ * GL_UNPACK_ROW_LENGTH samt Zeilenabstand hochgeladen, ohne sie vorher dicht
+ * zu packen.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* sysconf */
+#define _POSIX_C_SOURCE 200112L
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "mipmap.h"
+#include "cgimage.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Teilauftrag fuer einen Thread */
+typedef struct {
+  MipmapRowFunction f;
+  const void * data;
+  int y0
+    , y1
+    ;
+} RowJob;
+
+/** Filterkoeffizienten fuer das Skalieren in einer Richtung */
+typedef struct {
+  int taps;              /* Koeffizienten pro Zielpixel              */
+  int * first;           /* Erstes Quellpixel je Zielpixel           */
+  unsigned int * weight; /* Gewichte je Zielpixel, Summe MIPMAP_ONE */
+} Taps;
+
+/** Auftrag: eine Stufe per 2x2-Boxfilter verkleinern */
+typedef struct {
+  const unsigned char * src;
+  unsigned char * dst;
+  int sw      /* Ausmasse der Quelle  */
+    , sh
+    , sstride /* Zeilenabstand der Quelle in Bytes */
+    , dw      /* Breite des Ziels     */
+    , bpp     /* Bytes pro Pixel      */
+    , alpha   /* Index des Alphakanals, -1 wenn keiner */
+    ;
+  Boolean srgb;
+} Downsample;
+
+/** Auftrag: ein Bild flaechengewichtet skalieren */
+typedef struct {
+  const unsigned char * src;
+  unsigned short * tmp;  /* Horizontal skaliert, 8 Bit Nachkomma */
+  unsigned int * acc;    /* Eine Zielzeile Summen je Teilauftrag */
+  unsigned char * dst;
+  int sw                 /* Breite der Quelle */
+    , sstride            /* Zeilenabstand der Quelle in Bytes */
+    , dw                 /* Ausmasse des Ziels */
+    , dh
+    , bpp
+    ;
+  Taps x
+     , y
+     ;
+} Resample;
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Maximale Anzahl der Threads pro Stufe */
+#define MIPMAP_THREADS (4)
+
+/** Stufen mit weniger Zeilen werden nicht aufgeteilt */
+#define MIPMAP_PARALLEL_ROWS (64)
+
+/** Aufloesung der Tabelle fuer linear -> sRGB */
+#define MIPMAP_SRGB_BITS (12)
+
+/** 1.0 in der Festkommadarstellung der Filtergewichte */
+#define MIPMAP_ONE (65536U)
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * -------------------------------------------------------------------------- */
+
+/** Minimum und Maximum von a und b */
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* sRGB -> linear (16 Bit) und linear (MIPMAP_SRGB_BITS Bit) -> sRGB */
+static unsigned short srgbToLinear[256];
+static unsigned char  linearToSrgb[1 << MIPMAP_SRGB_BITS];
+
+static Boolean srgbTables = FALSE;
+
+/* Anzahl der Threads pro Stufe, 0 solange nicht bestimmt */
+static int threads = 0;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet die Umrechnungstabellen zwischen sRGB und linearem Farbraum.
+ */
+static void initSrgbTables(void)
+{
+  int i;
+
+  double c;
+
+  for (i = 0; i < 256; ++i)
+  {
+    c = i / 255.0;
+    c = c <= 0.04045
+      ? c / 12.92
+      : pow((c + 0.055) / 1.055, 2.4)
+      ;
+    srgbToLinear[i] = (unsigned short) (c * 65535.0 + 0.5);
+  }
+
+  for (i = 0; i < (1 << MIPMAP_SRGB_BITS); ++i)
+  {
+    c = (i + 0.5) / (1 << MIPMAP_SRGB_BITS);
+    c = c <= 0.0031308
+      ? c * 12.92
+      : 1.055 * pow(c, 1.0 / 2.4) - 0.055
+      ;
+    linearToSrgb[i] = (unsigned char) (c * 255.0 + 0.5);
+  }
+
+  srgbTables = TRUE;
+}
+
+/**
+ * Bestimmt einmalig die Anzahl der Threads pro Stufe, nicht mehr als
+ * Prozessoren vorhanden sind.
+ */
+static void initThreads(void)
+{
+  if (threads == 0)
+  {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    threads = cpus < 1
+            ? 1
+            : (int) MIN(cpus, MIPMAP_THREADS)
+            ;
+  }
+}
+
+/**
+ * Gibt die Anzahl der Bytes pro Pixel fuer format zurueck.
+ *
+ * @param[in] format Pixelformat.
+ *
+ * @return Bytes pro Pixel, 0 fuer unbekannte Formate.
+ */
+static int formatBpp(GLenum format)
+{
+  switch (format)
+  {
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Gibt die zu x naechstgelegene Zweierpotenz zurueck.
+ * So waehlt auch GLU die Groesse skalierter Texturen.
+ *
+ * @param[in] x Zahl > 0.
+ *
+ * @return Zweierpotenz.
+ */
+static int nearestPowerOfTwo(int x)
+{
+  int p = 1;
+
+  while (2 * p <= x)
+    p <<= 1;
+
+  return (x - p > 2 * p - x)
+       ? 2 * p
+       : p
+       ;
+}
+
+/**
+ * Fuehrt einen Teilauftrag aus (Einstieg fuer pthread_create).
+ *
+ * @param[in] arg Zeiger auf einen RowJob.
+ *
+ * @return NULL.
+ */
+static void * runRowJob(void * arg)
+{
+  RowJob * job = arg;
+
+  job->f(job->data, job->y0, job->y1);
+
+  return NULL;
+}
+
+/**
+ * Bestimmt, in wie viele Teilauftraege parallelRows rows Zeilen aufteilt.
+ *
+ * @param[in] rows Anzahl der Zeilen.
+ *
+ * @return Anzahl der Teilauftraege, hoechstens MIPMAP_THREADS.
+ */
+static int rowJobs(int rows)
+{
+  return rows < MIPMAP_PARALLEL_ROWS
+       ? 1
+       : threads
+       ;
+}
+
+/**
+ * Bestimmt den Teilauftrag von parallelRows, der mit Zeile y0 beginnt.
+ * Damit koennen Zeilenfunktionen vorab angelegten Speicher je Teilauftrag
+ * nutzen.
+ *
+ * @param[in] y0   Erste Zeile des Teilauftrags.
+ * @param[in] rows Anzahl aller Zeilen.
+ *
+ * @return Index des Teilauftrags.
+ */
+static int rowJob(int y0, int rows)
+{
+  int i = 0
+    , n = rowJobs(rows)
+    ;
+
+  while (i < n - 1 && rows * (i + 1) / n <= y0)
+    ++i;
+
+  return i;
+}
+
+/**
+ * Fuehrt f fuer die Zeilen [0, rows) aus. Bei genuegend Zeilen werden diese
+ * auf mehrere Threads verteilt, der letzte Teil laeuft im aufrufenden Thread.
+ *
+ * @param[in] f    Zeilenfunktion.
+ * @param[in] data Daten des Auftrags.
+ * @param[in] rows Anzahl der Zeilen.
+ */
+static void parallelRows(MipmapRowFunction f, const void * data, int rows)
+{
+  RowJob job[MIPMAP_THREADS];
+
+  pthread_t thread[MIPMAP_THREADS];
+
+  Boolean started[MIPMAP_THREADS];
+
+  int i
+    , n = rowJobs(rows)
+    ;
+
+  for (i = 0; i < n; ++i)
+  {
+    job[i].f    = f;
+    job[i].data = data;
+    job[i].y0   = rows * i / n;
+    job[i].y1   = rows * (i + 1) / n;
+
+    /* Was nicht gestartet werden kann, laeuft hier */
+    started[i] = i < n - 1
+              && pthread_create(&thread[i], NULL, runRowJob, &job[i]) == 0;
+  }
+
+  for (i = 0; i < n; ++i)
+    if (!started[i])
+      runRowJob(&job[i]);
+
+  for (i = 0; i < n; ++i)
+    if (started[i])
+      pthread_join(thread[i], NULL);
+}
+
+/**
+ * Summiert die Zeilen a und b der Laenge n komponentenweise nach sum.
+ *
+ * @param[in]  a   Erste Zeile.
+ * @param[in]  b   Zweite Zeile.
+ * @param[out] sum Summe.
+ * @param[in]  n   Anzahl der Bytes.
+ */
+static void addRows(const unsigned char * a, const unsigned char * b, unsigned short * sum, int n)
+{
+  int i = 0;
+
+  #ifdef __SSE2__
+  __m128i zero = _mm_setzero_si128()
+        , va
+        , vb
+        ;
+
+  for (; i + 16 <= n; i += 16)
+  {
+    va = _mm_loadu_si128((const __m128i *) (a + i));
+    vb = _mm_loadu_si128((const __m128i *) (b + i));
+
+    _mm_storeu_si128( (__m128i *) (sum + i)
+                    , _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+    _mm_storeu_si128( (__m128i *) (sum + i + 8)
+                    , _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+  }
+  #endif
+
+  for (; i < n; ++i)
+    sum[i] = (unsigned short) (a[i] + b[i]);
+}
+
+/**
+ * Berechnet die Zeilen [y0, y1) einer per 2x2-Boxfilter verkleinerten Stufe.
+ *
+ * @param[in] data Zeiger auf einen Downsample-Auftrag.
+ * @param[in] y0   Erste Zeile.
+ * @param[in] y1   Hinter der letzten Zeile.
+ */
+static void downsampleRows(const void * data, int y0, int y1)
+{
+  const Downsample * d = data;
+
+  int x
+    , y
+    , ch
+    , x0
+    , x1
+    ;
+
+  unsigned long s;
+
+  const unsigned char * r0
+                      , * r1
+                      ;
+
+  unsigned char * out;
+
+  unsigned short * sum = d->srgb
+                       ? NULL
+                       : malloc(d->sw * d->bpp * sizeof(unsigned short))
+                       ;
+
+  for (y = y0; y < y1; ++y)
+  {
+    /* Beteiligte Zeilen der Quelle, bei Hoehe 1 zweimal dieselbe */
+    r0  = d->src + (2 * y)                    * d->sstride;
+    r1  = d->src + MIN(2 * y + 1, d->sh - 1) * d->sstride;
+    out = d->dst + y * d->dw * d->bpp;
+
+    if (sum != NULL)
+    {
+      /* Vertikal summieren ... */
+      addRows(r0, r1, sum, d->sw * d->bpp);
+
+      /* ... und horizontal benachbarte Pixel dazunehmen */
+      for (x = 0; x < d->dw; ++x)
+      {
+        x0 = (2 * x) * d->bpp;
+        x1 = MIN(2 * x + 1, d->sw - 1) * d->bpp;
+
+        for (ch = 0; ch < d->bpp; ++ch)
+          out[x * d->bpp + ch] = (unsigned char) ((sum[x0 + ch] + sum[x1 + ch] + 2) >> 2);
+      }
+    }
+    else
+    {
+      /* Pixelweise, Farbkanaele ggf. linear mitteln, Alpha immer direkt */
+      for (x = 0; x < d->dw; ++x)
+      {
+        x0 = (2 * x) * d->bpp;
+        x1 = MIN(2 * x + 1, d->sw - 1) * d->bpp;
+
+        for (ch = 0; ch < d->bpp; ++ch)
+          if (!d->srgb || ch == d->alpha)
+            out[x * d->bpp + ch] = (unsigned char) ((r0[x0 + ch] + r0[x1 + ch] + r1[x0 + ch] + r1[x1 + ch] + 2) >> 2);
+          else
+          {
+            s = (unsigned long) srgbToLinear[r0[x0 + ch]] + srgbToLinear[r0[x1 + ch]]
+              + srgbToLinear[r1[x0 + ch]] + srgbToLinear[r1[x1 + ch]];
+            out[x * d->bpp + ch] = linearToSrgb[(s >> 2) >> (16 - MIPMAP_SRGB_BITS)];
+          }
+      }
+    }
+  }
+
+  free(sum);
+}
+
+/**
+ * Berechnet die Filterkoeffizienten fuer das flaechengewichtete Skalieren
+ * von n auf m Pixel. Jedes Zielpixel mittelt die von ihm ueberdeckten
+ * Quellpixel, gewichtet mit der ueberdeckten Flaeche. Die Fenster werden so
+ * gelegt, dass sie nie ueber den Rand der Quelle hinausragen.
+ *
+ * @param[out] t Koeffizienten.
+ * @param[in]  n Anzahl der Quellpixel.
+ * @param[in]  m Anzahl der Zielpixel.
+ *
+ * @return TRUE  wenn der Speicher angelegt werden konnte
+ *         FALSE sonst.
+ */
+static Boolean makeTaps(Taps * t, int n, int m)
+{
+  double scale = (double) n / m
+       , a
+       , b
+       ;
+
+  int i
+    , j
+    ;
+
+  unsigned int w
+             , sum
+             , * weight
+             ;
+
+  t->taps   = MIN((int) ceil(scale) + 1, n);
+  t->first  = malloc(m * sizeof(int));
+  t->weight = calloc(m * t->taps, sizeof(unsigned int));
+
+  if (t->first == NULL || t->weight == NULL)
+    return FALSE;
+
+  for (i = 0; i < m; ++i)
+  {
+    a = i * scale;
+    b = (i + 1) * scale;
+
+    t->first[i] = MIN((int) a, n - t->taps);
+    weight      = t->weight + i * t->taps - t->first[i];
+    sum         = 0;
+
+    for (j = (int) a; j < n && j < b; ++j)
+    {
+      w = (unsigned int) ((MIN(b, j + 1) - MAX(a, j)) / scale * MIPMAP_ONE + 0.5);
+      w = MIN(w, MIPMAP_ONE - sum);
+
+      weight[j] = w;
+      sum += w;
+    }
+
+    /* Rundungsfehler dem ersten ueberdeckten Pixel zuschlagen */
+    weight[(int) a] += MIPMAP_ONE - sum;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Skaliert die Quellzeilen [y0, y1) horizontal auf die Zielbreite.
+ *
+ * @param[in] data Zeiger auf einen Resample-Auftrag.
+ * @param[in] y0   Erste Zeile.
+ * @param[in] y1   Hinter der letzten Zeile.
+ */
+static void resampleRowsX(const void * data, int y0, int y1)
+{
+  const Resample * r = data;
+
+  int x
+    , y
+    , k
+    , ch
+    , bpp  = r->bpp
+    , taps = r->x.taps
+    ;
+
+  unsigned int acc;
+
+  const unsigned int * w;
+
+  const unsigned char * in;
+
+  unsigned short * out;
+
+  for (y = y0; y < y1; ++y)
+  {
+    out = r->tmp + y * r->dw * bpp;
+
+    for (x = 0; x < r->dw; ++x)
+    {
+      in = r->src + y * r->sstride + r->x.first[x] * bpp;
+      w  = r->x.weight + x * taps;
+
+      for (ch = 0; ch < bpp; ++ch)
+      {
+        acc = 0;
+
+        for (k = 0; k < taps; ++k)
+          acc += w[k] * in[k * bpp + ch];
+
+        /* 8 Nachkommabits behalten */
+        *out++ = (unsigned short) ((acc + 128) >> 8);
+      }
+    }
+  }
+}
+
+/**
+ * Skaliert die Zielzeilen [y0, y1) vertikal aus den horizontal skalierten
+ * Quellzeilen. Summiert wird in der Zeile von r->acc, die zum Teilauftrag
+ * gehoert.
+ *
+ * @param[in] data Zeiger auf einen Resample-Auftrag.
+ * @param[in] y0   Erste Zeile.
+ * @param[in] y1   Hinter der letzten Zeile.
+ */
+static void resampleRowsY(const void * data, int y0, int y1)
+{
+  const Resample * r = data;
+
+  int i
+    , y
+    , k
+    , n = r->dw * r->bpp
+    ;
+
+  unsigned int w
+             , * acc = r->acc + rowJob(y0, r->dh) * n
+             ;
+
+  const unsigned short * in;
+
+  unsigned char * out;
+
+  for (y = y0; y < y1; ++y)
+  {
+    out = r->dst + y * n;
+
+    for (i = 0; i < n; ++i)
+      acc[i] = 0;
+
+    /* Zeilenweise gewichtet aufsummieren */
+    for (k = 0; k < r->y.taps; ++k)
+    {
+      w  = r->y.weight[y * r->y.taps + k];
+      in = r->tmp + (r->y.first[y] + k) * n;
+
+      if (w != 0)
+        for (i = 0; i < n; ++i)
+          acc[i] += w * in[i];
+    }
+
+    for (i = 0; i < n; ++i)
+      out[i] = (unsigned char) ((acc[i] + (1U << 23)) >> 24);
+  }
+}
+
+/**
+ * Skaliert das Bild src (sw x sh) flaechengewichtet auf dst (dw x dh).
+ *
+ * @param[in]  src Quelle.
+ * @param[in]  sstride Zeilenabstand der Quelle in Bytes.
+ * @param[in]  sw  Breite der Quelle.
+ * @param[in]  sh  Hoehe der Quelle.
+ * @param[out] dst Ziel.
+ * @param[in]  dw  Breite des Ziels.
+ * @param[in]  dh  Hoehe des Ziels.
+ * @param[in]  bpp Bytes pro Pixel.
+ *
+ * @return TRUE  wenn skaliert wurde
+ *         FALSE wenn kein Speicher vorhanden war.
+ */
+static Boolean resample(const unsigned char * src, int sstride, int sw, int sh, unsigned char * dst, int dw, int dh, int bpp)
+{
+  Resample r;
+
+  Boolean success;
+
+  r.src      = src;
+  r.dst      = dst;
+  r.sw       = sw;
+  r.sstride  = sstride;
+  r.dw       = dw;
+  r.dh       = dh;
+  r.bpp      = bpp;
+  r.tmp      = malloc(dw * sh * bpp * sizeof(unsigned short));
+  r.acc      = malloc(rowJobs(dh) * dw * bpp * sizeof(unsigned int));
+  r.x.first  = r.y.first  = NULL;
+  r.x.weight = r.y.weight = NULL;
+
+  success = r.tmp != NULL
+         && r.acc != NULL
+         && makeTaps(&r.x, sw, dw)
+         && makeTaps(&r.y, sh, dh)
+         ;
+
+  if (success)
+  {
+    parallelRows(resampleRowsX, &r, sh);
+    parallelRows(resampleRowsY, &r, dh);
+  }
+
+  free(r.tmp);
+  free(r.acc);
+  free(r.x.first);
+  free(r.x.weight);
+  free(r.y.first);
+  free(r.y.weight);
+
+  return success;
+}
+
+/**
+ * Kopiert die Stufe src (w x h Pixel) nach dst und umgibt sie dabei mit einem
+ * Rand von g Pixeln, der die Randpixel der Stufe wiederholt. dst ist danach
+ * (w + 2g) x (h + 2g) Pixel gross und dicht gepackt.
+ *
+ * @param[in]  src     Stufe.
+ * @param[in]  sstride Zeilenabstand der Stufe in Bytes.
+ * @param[in]  w       Breite der Stufe.
+ * @param[in]  h       Hoehe der Stufe.
+ * @param[in]  g       Breite des Randes.
+ * @param[out] dst     Stufe mit Rand.
+ * @param[in]  bpp     Bytes pro Pixel.
+ */
+static void extrudeLevel(const unsigned char * src, int sstride, int w, int h, int g, unsigned char * dst, int bpp)
+{
+  int x
+    , y
+    , stride = (w + 2 * g) * bpp
+    ;
+
+  const unsigned char * row;
+
+  for (y = 0; y < h + 2 * g; ++y, dst += stride)
+  {
+    /* Zeilen oberhalb und unterhalb wiederholen die erste bzw. letzte */
+    row = src + MIN(MAX(y - g, 0), h - 1) * sstride;
+
+    for (x = 0; x < g; ++x)
+    {
+      memcpy(dst + x * bpp, row, bpp);
+      memcpy(dst + (g + w + x) * bpp, row + (w - 1) * bpp, bpp);
+    }
+
+    memcpy(dst + g * bpp, row, w * bpp);
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Erzeugt alle Mipmap-Stufen des Bildes image mit einem 2x2-Boxfilter und
+ * laedt sie in die gerade gebundene GL_TEXTURE_2D hoch.
+ * Bilder, deren Ausmasse keine Zweierpotenzen sind, werden vorher wie bei
+ * gluBuild2DMipmaps skaliert.
+ *
+ * @param[in] image  Bild, auch eine Ansicht (CGImage_view) eines groesseren.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu image->bpp.
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind und
+ *                   linear gemittelt werden sollen.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapBuild2D(const CGImage * image, GLenum format, Boolean srgb)
+{
+  int bpp       = formatBpp(format)
+    , width     = (int) image->width
+    , height    = (int) image->height
+    , level     = 0
+    , rowLength = 0
+    , alignment = 1
+    , y
+    , w
+    , h
+    ;
+
+  GLint maxSize;
+
+  Downsample d;
+
+  unsigned char * scaled = NULL
+              , * buf[2]
+              ;
+
+  if (bpp == 0 || bpp != (int) image->bpp || width < 1 || height < 1)
+    return 0;
+
+  initThreads();
+
+  /* Zielgroesse wie bei GLU, begrenzt auf die Maximalgroesse */
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+  w = MIN(nearestPowerOfTwo(width),  maxSize);
+  h = MIN(nearestPowerOfTwo(height), maxSize);
+
+  /* Zwei Puffer im Wechsel: Stufe 1, 3, 5, ... und Stufe 2, 4, 6, ... */
+  buf[0] = malloc(MAX(w / 2, 1) * MAX(h / 2, 1) * bpp);
+  buf[1] = malloc(MAX(w / 4, 1) * MAX(h / 4, 1) * bpp);
+
+  d.src     = image->data;
+  d.sstride = (int) image->stride;
+  d.bpp     = bpp;
+  d.srgb    = srgb;
+  d.alpha   = (format == GL_RGBA || format == GL_LUMINANCE_ALPHA)
+            ? bpp - 1
+            : -1
+            ;
+
+  /* Keine Zweierpotenz -> vorher skalieren */
+  if (w != width || h != height)
+  {
+    scaled = malloc(w * h * bpp);
+
+    d.src = scaled != NULL && resample(image->data, image->stride, width, height, scaled, w, h, bpp)
+          ? scaled
+          : NULL
+          ;
+    d.sstride = w * bpp;
+  }
+  /* Zeilenabstand fuer GL nicht darstellbar -> dicht gepackt kopieren */
+  else if (!CGImage_unpackLayout(image, &rowLength, &alignment))
+  {
+    scaled = malloc(w * h * bpp);
+
+    if (scaled != NULL)
+      for (y = 0; y < h; ++y)
+        memcpy(scaled + y * w * bpp, CGImage_row(image, y), w * bpp);
+
+    d.src     = scaled;
+    d.sstride = w * bpp;
+  }
+
+  if (d.src == NULL || buf[0] == NULL || buf[1] == NULL)
+  {
+    free(buf[0]);
+    free(buf[1]);
+    free(scaled);
+    return 0;
+  }
+
+  if (srgb && !srgbTables)
+    initSrgbTables();
+
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+
+  /* Erste Stufe direkt aus image */
+  if (d.src == image->data)
+  {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+  }
+  else
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  glTexImage2D(GL_TEXTURE_2D, level, bpp, w, h, 0, format, GL_UNSIGNED_BYTE, d.src);
+
+  /* Alle weiteren dicht gepackt */
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  /* Jede Stufe aus der vorherigen */
+  while (w > 1 || h > 1)
+  {
+    d.sw  = w;
+    d.sh  = h;
+    d.dst = buf[level % 2];
+
+    w    = MAX(w / 2, 1);
+    h    = MAX(h / 2, 1);
+    d.dw = w;
+
+    parallelRows(downsampleRows, &d, h);
+
+    glTexImage2D(GL_TEXTURE_2D, ++level, bpp, w, h, 0, format, GL_UNSIGNED_BYTE, d.dst);
+
+    d.src     = d.dst;
+    d.sstride = w * bpp;
+  }
+
+  glPopClientAttrib();
+
+  free(buf[0]);
+  free(buf[1]);
+  free(scaled);
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Built %i mipmap levels.\n", level + 1);
+  #endif
+
+  return 1;
+}
+
+/**
+ * Erzeugt die Stufen 0 bis levels - 1 des Bildes image als Kachel eines
+ * Texturatlas und laedt sie per glTexSubImage2D in die gerade gebundene
+ * GL_TEXTURE_2D hoch, deren Stufen bereits angelegt sein muessen.
+ * Die Kachel belegt auf Stufe 0 das Rechteck x, y, width, height. Das Bild
+ * wird auf das Innere ohne den Rand gutter skaliert. Auf jeder Stufe wird
+ * der (halbierte) Rand neu aus den Randpixeln der Stufe gebildet, so dass
+ * beim Filtern nichts von benachbarten Kacheln einfliesst.
+ *
+ * @param[in] image  Bild, auch eine Ansicht (CGImage_view) eines groesseren.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu image->bpp.
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind und
+ *                   linear gemittelt werden sollen.
+ * @param[in] x      Linke Kante der Kachel auf Stufe 0.
+ * @param[in] y      Obere Kante der Kachel auf Stufe 0.
+ * @param[in] width  Breite der Kachel samt Rand auf Stufe 0.
+ * @param[in] height Hoehe der Kachel samt Rand auf Stufe 0.
+ * @param[in] gutter Breite des Randes auf Stufe 0.
+ * @param[in] levels Anzahl der Stufen. x, y, width, height und gutter
+ *                   muessen Vielfache von 2^(levels - 1) sein.
+ * @param[out] out   Wenn nicht NULL: alle Stufen samt Rand, dicht gepackt.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapBuildTile(const CGImage * image, GLenum format, Boolean srgb, int x, int y, int width, int height, int gutter, int levels, unsigned char ** out)
+{
+  int bpp   = formatBpp(format)
+    , unit  = 1 << (levels - 1)
+    , w     = width  - 2 * gutter
+    , h     = height - 2 * gutter
+    , level = 0
+    , size  = 0
+    , i
+    ;
+
+  unsigned char * copy = NULL;
+
+  Downsample d;
+
+  unsigned char * scaled = NULL
+              , * border = NULL
+              , * buf[2]
+              ;
+
+  if (bpp == 0 || bpp != (int) image->bpp || image->width < 1 || image->height < 1
+   || levels < 1 || w < unit || h < unit
+   || (x | y | width | height | gutter) % unit != 0)
+    return 0;
+
+  initThreads();
+
+  buf[0] = malloc(MAX(w / 2, 1) * MAX(h / 2, 1) * bpp);
+  buf[1] = malloc(MAX(w / 4, 1) * MAX(h / 4, 1) * bpp);
+  border = malloc(width * height * bpp);
+
+  d.src     = image->data;
+  d.sstride = (int) image->stride;
+  d.bpp     = bpp;
+  d.srgb    = srgb;
+  d.alpha   = (format == GL_RGBA || format == GL_LUMINANCE_ALPHA)
+            ? bpp - 1
+            : -1
+            ;
+
+  /* Auf das Innere der Kachel skalieren */
+  if (w != (int) image->width || h != (int) image->height)
+  {
+    scaled = malloc(w * h * bpp);
+
+    d.src = scaled != NULL && resample(image->data, image->stride, image->width, image->height, scaled, w, h, bpp)
+          ? scaled
+          : NULL
+          ;
+    d.sstride = w * bpp;
+  }
+
+  /* Platz fuer die Kopie aller Stufen */
+  if (out != NULL)
+  {
+    for (i = 0; i < levels; ++i)
+      size += (width >> i) * (height >> i) * bpp;
+
+    *out = copy = malloc(size);
+  }
+
+  if (d.src == NULL || buf[0] == NULL || buf[1] == NULL || border == NULL
+   || (out != NULL && copy == NULL))
+  {
+    free(buf[0]);
+    free(buf[1]);
+    free(border);
+    free(scaled);
+
+    if (out != NULL)
+    {
+      free(copy);
+      *out = NULL;
+    }
+
+    return 0;
+  }
+
+  if (srgb && !srgbTables)
+    initSrgbTables();
+
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for (;;)
+  {
+    extrudeLevel(d.src, d.sstride, w, h, gutter, border, bpp);
+
+    if (copy != NULL)
+    {
+      size = (w + 2 * gutter) * (h + 2 * gutter) * bpp;
+      memcpy(copy, border, size);
+      copy += size;
+    }
+
+    glTexSubImage2D( GL_TEXTURE_2D
+                   , level
+                   , x
+                   , y
+                   , w + 2 * gutter
+                   , h + 2 * gutter
+                   , format
+                   , GL_UNSIGNED_BYTE
+                   , border);
+
+    if (++level == levels)
+      break;
+
+    /* Naechste Stufe aus dem Inneren der vorherigen */
+    d.sw  = w;
+    d.sh  = h;
+    d.dst = buf[(level - 1) % 2];
+
+    w    /= 2;
+    h    /= 2;
+    d.dw  = w;
+
+    parallelRows(downsampleRows, &d, h);
+
+    d.src     = d.dst;
+    d.sstride = w * bpp;
+
+    x      /= 2;
+    y      /= 2;
+    gutter /= 2;
+  }
+
+  glPopClientAttrib();
+
+  free(buf[0]);
+  free(buf[1]);
+  free(border);
+  free(scaled);
+
+  return 1;
+}
+
+/**
+ * Laedt fertig berechnete Stufen in eine Kachel der gerade gebundenen
+ * GL_TEXTURE_2D hoch, ohne selbst zu filtern. Der Rand wird wie bei
+ * mipmapBuildTile auf jeder Stufe aus deren Randpixeln gebildet.
+ *
+ * @param[in] images Stufen, images[i] hat die Ausmasse des Inneren der
+ *                   Kachel geteilt durch 2^i.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu den Bildern.
+ * @param[in] x      Linke Kante der Kachel auf Stufe 0.
+ * @param[in] y      Obere Kante der Kachel auf Stufe 0.
+ * @param[in] width  Breite der Kachel samt Rand auf Stufe 0.
+ * @param[in] height Hoehe der Kachel samt Rand auf Stufe 0.
+ * @param[in] gutter Breite des Randes auf Stufe 0.
+ * @param[in] levels Anzahl der Stufen, wie bei mipmapBuildTile.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapUploadTile(const CGImage * const * images, GLenum format, int x, int y, int width, int height, int gutter, int levels)
+{
+  int bpp   = formatBpp(format)
+    , unit  = 1 << (levels - 1)
+    , w     = width  - 2 * gutter
+    , h     = height - 2 * gutter
+    , level
+    ;
+
+  unsigned char * border;
+
+  if (bpp == 0 || levels < 1 || w < unit || h < unit
+   || (x | y | width | height | gutter) % unit != 0)
+    return 0;
+
+  for (level = 0; level < levels; ++level)
+    if (images[level]->bpp != (unsigned) bpp
+     || images[level]->width  != (unsigned) (w >> level)
+     || images[level]->height != (unsigned) (h >> level))
+      return 0;
+
+  border = malloc(width * height * bpp);
+
+  if (border == NULL)
+    return 0;
+
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for (level = 0; level < levels; ++level)
+  {
+    extrudeLevel( images[level]->data
+                , (int) images[level]->stride
+                , w >> level
+                , h >> level
+                , gutter >> level
+                , border
+                , bpp);
+
+    glTexSubImage2D( GL_TEXTURE_2D
+                   , level
+                   , x >> level
+                   , y >> level
+                   , (w >> level) + 2 * (gutter >> level)
+                   , (h >> level) + 2 * (gutter >> level)
+                   , format
+                   , GL_UNSIGNED_BYTE
+                   , border);
+  }
+
+  glPopClientAttrib();
+
+  free(border);
+
+  return 1;
+}
+
+/**
+ * Fuehrt f fuer die Zeilen [0, rows) aus, bei genuegend Zeilen verteilt auf
+ * dieselben Threads, mit denen auch die Stufen berechnet werden.
+ *
+ * @param[in] f    Zeilenfunktion.
+ * @param[in] data Daten des Auftrags.
+ * @param[in] rows Anzahl der Zeilen.
+ */
+extern void mipmapParallelRows(MipmapRowFunction f, const void * data, int rows)
+{
+  initThreads();
+
+  parallelRows(f, data, rows);
+}
@@ -3,6 +3,22 @@
  *
  * Verarbeitet Picking-Ereignisse.
  *
+ * Zum Picken wird der Strahl durch den Mauszeiger aus Projektions- und
+ * Kameramatrix zurueckgerechnet und auf der CPU mit den pickbaren Objekten
+ * geschnitten (siehe raycast.h). Die Tiere werden dabei mit ihrer genauen
+ * Form aus Kugeln, Quadern und Zylindern geschnitten (siehe shape.h), alle
+ * uebrigen Objekte mit ihrem Huellquader. Die Formen sind glatt, gezeichnet
+ * werden Facetten, an den Silhouetten kann der Treffer also um Bruchteile
+ * eines Pixels vom Bild abweichen.
+ *
+ * Farbkennung (PICKING_COLOR_ID, abschaltbar, standardmaessig aus): Die
+ * Objekte werden ohne Licht und
+ * Texturen in den nicht sichtbaren Hinterpuffer gezeichnet, beschraenkt per
+ * Scissor auf die wenigen Pixel unter dem Mauszeiger. Jedes Objekt leuchtet
+ * dabei (GL_EMISSION) in einer eigenen Farbe, aus der beim Zuruecklesen der
+ * Name berechnet wird. Gezeichnet werden nur die Kandidaten, deren Quader
+ * der Strahl trifft, trifft er keinen, wird nichts gezeichnet.
+ *
  * @author Christopher Blöcker
  * @author Julius Beckmann
  */
@@ -12,6 +28,7 @@
  * -------------------------------------------------------------------------- */
 #include <assert.h>
 #include <GL/glut.h>
+#include <stdlib.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -25,6 +42,31 @@
 #include "vector.h"
 #include "logic.h"
 #include "level.h"
+#include "raycast.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Kantenlaenge des Bereichs unter dem Mauszeiger in Pixeln, ungerade */
+#define PICKING_SIZE (5)
+
+/**
+ * Bits eines Namens pro Farbkanal, nur die obersten des Kanals werden belegt.
+ * Drei Kanaele reichen so fuer 64 Namen.
+ */
+#define PICKING_BITS (2)
+
+/** Hoechstens so viele Kandidaten, wie sich Namen kodieren lassen */
+#define PICKING_CANDIDATES (1 << (3 * PICKING_BITS))
+
+/**
+ * TRUE:  Die Kandidaten per Farbkennung an der gezeichneten Geometrie
+ *        entscheiden. Pixelgenau, kostet aber einen Zeichendurchgang und
+ *        glReadPixels pro Klick; dient zum Gegenpruefen des Strahltests.
+ * FALSE: Die naechste getroffene Form entscheidet, ganz ohne Zeichnen.
+ */
+#define PICKING_COLOR_ID (FALSE)
 
 /* ----------------------------------------------------------------------------
  * Funktionen
@@ -33,137 +75,254 @@
  * -------------------------------------------------------------------------- */
 
 /**
- * Verarbeitung der Picking-Ergebnisse.
- * Findet den Treffer, der dem Betrachter am naechsten liegt und gibt die
- * Namen dieses Treffers aus.
- * @param numHits Anzahl der getroffenen Objekte (In).
- * @param buffer Buffer, in dem die Treffer gespeichert sind (In).
+ * Berechnet den Wert eines Farbkanals fuer die Bits b eines Namens. Die Bits
+ * liegen in den obersten Bits des Kanals, die unteren werden auf die Mitte
+ * gesetzt, so dass auch Farbpuffer mit weniger als 8 Bit pro Kanal den
+ * Namen unverfaelscht speichern.
+ *
+ * @param[in] b Bits des Namens.
+ *
+ * @return Kanalwert zwischen 0 und 1.
  */
-static void processHits(int numHits, unsigned buffer[], PickingAction a)
+static GLfloat encodeChannel(unsigned b)
 {
-  /* Anzahl der Namen des Treffers, der am naechsten zum Betrachter ist */
-  int numOfClosestNames;
-  /* Anzahl der Namen des Treffers, der am naechsten zum Betrachter ist */
-  unsigned * ptrClosestNames;
+  return ((b << (8 - PICKING_BITS)) | (1 << (7 - PICKING_BITS))) / 255.0f;
+}
 
-  /* Laufvariable - Nummer des akt. verarbeiteten Treffers */
-  int i;
-  /* Laufvariable - Zeiger auf den Beginn des Hit-Records */
-  unsigned * ptr = (unsigned *) buffer;
+/**
+ * Berechnet den Namen aus einem gelesenen Pixel.
+ *
+ * @param[in] rgb Pixel.
+ *
+ * @return Name, NAME_UNPICKABLE fuer den Hintergrund.
+ */
+static PickingName decodeColor(const GLubyte rgb[3])
+{
+  return (PickingName) ( (rgb[0] >> (8 - PICKING_BITS))
+                       | (rgb[1] >> (8 - PICKING_BITS)) << PICKING_BITS
+                       | (rgb[2] >> (8 - PICKING_BITS)) << (2 * PICKING_BITS)
+                       );
+}
 
-  /* DepthBuffer - Wert */
-  unsigned minZ = 0xffffffff;
+/**
+ * Setzt die Farbe, in der das Objekt n beim Picken gezeichnet wird.
+ *
+ * @param[in] n Name des Objekts.
+ */
+static void setName(PickingName n)
+{
+  GLfloat color[4];
+
+  color[0] = encodeChannel( n                        & ((1 << PICKING_BITS) - 1));
+  color[1] = encodeChannel((n >> PICKING_BITS)       & ((1 << PICKING_BITS) - 1));
+  color[2] = encodeChannel((n >> (2 * PICKING_BITS)) & ((1 << PICKING_BITS) - 1));
+  color[3] = 1.0f;
+
+  glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, color);
+}
+
+/**
+ * Zeichnet die Kandidaten items in der Farbe ihres Namens um das Pixel
+ * (x, y) und liest den Namen zurueck, der dem Pixel am naechsten liegt.
+ *
+ * @param[in] x          x-Koordinate im Fenster, von unten gezaehlt.
+ * @param[in] y          y-Koordinate im Fenster, von unten gezaehlt.
+ * @param[in] modelview  Kameramatrix.
+ * @param[in] projection Projektionsmatrix.
+ * @param[in] items      Kandidaten.
+ * @param[in] count      Anzahl der Kandidaten.
+ *
+ * @return Name des getroffenen Objekts, NAME_UNPICKABLE wenn keins.
+ */
+static PickingName pickColor(int x, int y, const GLdouble modelview[16], const GLdouble projection[16], const LevelItem ** items, int count)
+{
+  /* Schwarz: kein Umgebungslicht */
+  GLfloat black[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+  /* Gelesene Pixel */
+  GLubyte pixels[PICKING_SIZE * PICKING_SIZE][3];
+
+  PickingName n = NAME_UNPICKABLE;
 
-  if (numHits > 0)
+  int i
+    , d
+    , best = PICKING_SIZE * PICKING_SIZE
+    , r    = PICKING_SIZE / 2
+    ;
+
+  /* Zustand sichern, der fuers Picken umgestellt wird */
+  glPushAttrib( GL_ENABLE_BIT
+              | GL_LIGHTING_BIT
+              | GL_COLOR_BUFFER_BIT
+              | GL_SCISSOR_BIT
+              | GL_PIXEL_MODE_BIT
+              | GL_CURRENT_BIT);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+
+  /* Nur die Pixel unter dem Mauszeiger */
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(x - r, y - r, PICKING_SIZE, PICKING_SIZE);
+
+  /* Farbe = Emission: Licht an, aber keine Lichtquelle und kein Umgebungslicht */
+  glEnable(GL_LIGHTING);
+  glDisable(GL_LIGHT0);
+  glLightModelfv(GL_LIGHT_MODEL_AMBIENT, black);
+  glShadeModel(GL_FLAT);
+
+  /* Nichts darf die Farben verfaelschen */
+  glDisable(GL_TEXTURE_2D);
+  glDisable(GL_BLEND);
+  glDisable(GL_DITHER);
+  glDisable(GL_FOG);
+
+  glDrawBuffer(GL_BACK);
+  glReadBuffer(GL_BACK);
+
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glMatrixMode (GL_PROJECTION);
+  glPushMatrix ();
+  glLoadMatrixd (projection);
+
+  glMatrixMode (GL_MODELVIEW);
+  glPushMatrix ();
+  glLoadMatrixd (modelview);
+
+  /* Nur die Kandidaten, die Tiefe entscheidet zwischen ihnen */
+  for (i = 0; i < count; ++i)
   {
-    /* Alle Treffer verarbeiten */
-    for (i = 0; i < numHits; ++i)
+    setName(items[i]->n);
+    sceneDrawItem(items[i]);
+  }
+
+  glPopMatrix ();
+  glMatrixMode (GL_PROJECTION);
+  glPopMatrix ();
+  glMatrixMode (GL_MODELVIEW);
+
+  /* Pixel zuruecklesen */
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(x - r, y - r, PICKING_SIZE, PICKING_SIZE, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+  glPopClientAttrib();
+  glPopAttrib();
+
+  /* Getroffenes Pixel, das dem Mauszeiger am naechsten liegt */
+  for (i = 0; i < PICKING_SIZE * PICKING_SIZE; ++i)
+  {
+    d = abs(i % PICKING_SIZE - r) + abs(i / PICKING_SIZE - r);
+
+    if (d < best && decodeColor(pixels[i]) != NAME_UNPICKABLE)
     {
-      /* Ist der Treffer naeher dran, als der bisher naechste? */
-      if (*(ptr + 1) < minZ)
+      n    = decodeColor(pixels[i]);
+      best = d;
+    }
+  }
+
+  return n;
+}
+
+/**
+ * Verarbeitung des Picking-Ergebnisses.
+ * Fuehrt die Aktion a fuer das getroffene Objekt n aus.
+ *
+ * @param[in] n Name des getroffenen Objekts.
+ * @param[in] a Auszufuehrende Aktion.
+ */
+static void processName(PickingName n, PickingAction a)
+{
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: ");
+  
+  switch (a)
+  {
+    case ACTION_SELECT:
+      fprintf(stderr, "Selecting ");
+      break;
+    case ACTION_RELEASE:
+      fprintf(stderr, "Releasing ");
+      /* CANNOT happen! */
+      assert(0);
+      break;
+    case ACTION_ANIMATE:
+      fprintf(stderr, "Animating ");
+      break;
+    default:
+      fprintf(stderr, "PICKING ERROR!\n");
+      /* CANNOT happen! */
+      assert(0);
+      break;
+  }
+  #endif
+  
+  switch (n)
+  {
+    case NAME_GIRAFFE:
+    case NAME_GIRAFFE_HEAD:
+    case NAME_GIRAFFE_BODY:
+      #ifdef DEBUG
+      fprintf(stderr, "Giraffe.\n");
+      #endif
+      
+      switch (a)
       {
-        /* Anzahl der Namen merken */
-        numOfClosestNames = *ptr;
-        /* Zeiger auf den ersten Namen merken */
-        ptrClosestNames = ptr + 3;
-        /* als neuen minimalen Tiefenwert merken */
-        minZ = *(ptr + 1);
+        case ACTION_SELECT:
+          logicSelect(NAME_GIRAFFE, TRUE);
+          break;
+        case ACTION_RELEASE:
+          /* CANNOT happen! */
+          assert(0);
+          break;
+        case ACTION_ANIMATE:
+          logicAnimate(ANIMATION_GIRAFFE);
+          break;
       }
-      /* zum Beginn des naechsten Hit-Records springen */
-      /* Schrittweite: Anzahl-Feld + minZ-Feld + maxZ-Feld + Namen-Felder */
-      ptr += 3 + numOfClosestNames;
-    }
-    
-    #ifdef DEBUG
-    fprintf(stderr, "DEBUG :: ");
-    
-    switch (a)
-    {
-      case ACTION_SELECT:
-        fprintf(stderr, "Selecting ");
-        break;
-      case ACTION_RELEASE:
-        fprintf(stderr, "Releasing ");
-        /* CANNOT happen! */
-        assert(0);
-        break;
-      case ACTION_ANIMATE:
-        fprintf(stderr, "Animating ");
-        break;
-      default:
-        fprintf(stderr, "PICKING ERROR!\n");
-        /* CANNOT happen! */
-        assert(0);
-        break;
-    }
-    #endif
-    
-    switch (*ptrClosestNames)
-    {
-      case NAME_GIRAFFE:
-      case NAME_GIRAFFE_HEAD:
-      case NAME_GIRAFFE_BODY:
-        #ifdef DEBUG
-        fprintf(stderr, "Giraffe.\n");
-        #endif
-        
-        switch (a)
-        {
-          case ACTION_SELECT:
-            logicSelect(NAME_GIRAFFE, TRUE);
-            break;
-          case ACTION_RELEASE:
-            /* CANNOT happen! */
-            assert(0);
-            break;
-          case ACTION_ANIMATE:
-            logicAnimate(ANIMATION_GIRAFFE);
-            break;
-        }
-        break;
-      case NAME_PIG:
-      case NAME_PIG_HEAD:
-      case NAME_PIG_BODY:
-        #ifdef DEBUG
-        fprintf(stderr, "Pig.\n");
-        #endif
-        
-        switch (a)
-        {
-          case ACTION_SELECT:
-            logicSelect(NAME_PIG, TRUE);
-            break;
-          case ACTION_RELEASE:
-            /* CANNOT happen! */
-            assert(0);
-            break;
-          case ACTION_ANIMATE:
-            logicAnimate(ANIMATION_PIG);
-            break;
-        }
-        break;
-      case NAME_FISH:
-      case NAME_FISH_HEAD:
-      case NAME_FISH_BODY:
-        #ifdef DEBUG
-        fprintf(stderr, "Fish.\n");
-        #endif
-        
-        switch (a)
-        {
-          case ACTION_SELECT:
-            logicSelect(NAME_FISH, TRUE);
-            break;
-          case ACTION_RELEASE:
-            /* CANNOT happen! */
-            assert(0);
-            break;
-          case ACTION_ANIMATE:
-            logicAnimate(ANIMATION_FISH);
-            break;
-        }
-        break;
-    }
+      break;
+    case NAME_PIG:
+    case NAME_PIG_HEAD:
+    case NAME_PIG_BODY:
+      #ifdef DEBUG
+      fprintf(stderr, "Pig.\n");
+      #endif
+      
+      switch (a)
+      {
+        case ACTION_SELECT:
+          logicSelect(NAME_PIG, TRUE);
+          break;
+        case ACTION_RELEASE:
+          /* CANNOT happen! */
+          assert(0);
+          break;
+        case ACTION_ANIMATE:
+          logicAnimate(ANIMATION_PIG);
+          break;
+      }
+      break;
+    case NAME_FISH:
+    case NAME_FISH_HEAD:
+    case NAME_FISH_BODY:
+      #ifdef DEBUG
+      fprintf(stderr, "Fish.\n");
+      #endif
+      
+      switch (a)
+      {
+        case ACTION_SELECT:
+          logicSelect(NAME_FISH, TRUE);
+          break;
+        case ACTION_RELEASE:
+          /* CANNOT happen! */
+          assert(0);
+          break;
+        case ACTION_ANIMATE:
+          logicAnimate(ANIMATION_FISH);
+          break;
+      }
+      break;
+    default:
+      break;
   }
 }
 
@@ -182,58 +341,71 @@ static void processHits(int numHits, unsigned buffer[], PickingAction a)
  */
 extern void pick(int x, int y, PickingAction a)
 {
-  /** Groesse des Buffers fuer Picking Ergebnisse */
-  #define SELECTBUFSIZE 512
+  GLdouble modelview[16]
+         , projection[16]
+         , nearX, nearY, nearZ
+         , farX,  farY,  farZ
+         ;
 
-  /* Viewport (Darstellungsbereich des Fensters) */
   GLint viewport[4];
 
-  /* Puffer fuer Picking-Ergebnis */
-  GLuint buffer[SELECTBUFSIZE];
+  /* Kandidaten aus der Hierarchie */
+  const LevelItem * items[PICKING_CANDIDATES];
 
-  /* Anzahl der getroffenen Namen beim Picking */
-  GLint numHits;
+  int count;
 
-  /* aktuellen Viewport ermitteln */
-  glGetIntegerv (GL_VIEWPORT, viewport);
+  Vector3d origin
+         , dir
+         ;
 
-  /* Puffer festlegen, Name-Stack leeren und Rendermode wechseln */
-  glSelectBuffer (SELECTBUFSIZE, buffer);
-  glInitNames ();
-  glRenderMode (GL_SELECT);
+  /* Getroffener Name */
+  PickingName n = NAME_UNPICKABLE;
 
-  /* Nachfolgende Operationen beeinflussen Projektionsmatrix */
+  /* Matrizen wie beim Zeichnen aufsetzen und auslesen */
   glMatrixMode (GL_PROJECTION);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
+  glPushMatrix ();
   glLoadIdentity ();
 
-  gluPickMatrix (x, glutGet (GLUT_WINDOW_HEIGHT) - y, 5, 5, viewport);
-
   setProjection ((double) glutGet (GLUT_WINDOW_WIDTH) /
                  (double) glutGet (GLUT_WINDOW_HEIGHT));
 
-  /* Nachfolgende Operationen beeinflussen Modelviewmatrix */
+  glGetDoublev (GL_PROJECTION_MATRIX, projection);
+  glPopMatrix ();
+
   glMatrixMode (GL_MODELVIEW);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
+  glPushMatrix ();
   glLoadIdentity ();
 
   setCamera ();
 
-  /* Zeichnen */
-  sceneDraw (TRUE);
+  glGetDoublev (GL_MODELVIEW_MATRIX, modelview);
+  glPopMatrix ();
 
-  /* Zeichnen beenden und auswerten */
-  glFlush ();
+  glGetIntegerv (GL_VIEWPORT, viewport);
 
-  /* Nachfolgende Operationen beeinflussen Projektionsmatrix */
-  glMatrixMode (GL_PROJECTION);
-  /* Matrix zuruecksetzen - Einheitsmatrix laden */
-  glLoadIdentity ();
+  /*
+   * Strahl durch die Mitte des Pixels unter dem Mauszeiger von der nahen zur
+   * fernen Clipping-Ebene, dort tastet auch die Rasterisierung ab
+   */
+  y = viewport[3] - 1 - y;
 
-  setProjection ((double) glutGet (GLUT_WINDOW_WIDTH) /
-                 (double) glutGet (GLUT_WINDOW_HEIGHT));
-  
-  numHits = glRenderMode (GL_RENDER);
-  
-  processHits (numHits, buffer, a);
+  if (gluUnProject(x + 0.5, y + 0.5, 0.0, modelview, projection, viewport, &nearX, &nearY, &nearZ)
+  &&  gluUnProject(x + 0.5, y + 0.5, 1.0, modelview, projection, viewport, &farX,  &farY,  &farZ))
+  {
+    origin = vectorMake(nearX, nearY, nearZ);
+    dir    = vectorMake(farX - nearX, farY - nearY, farZ - nearZ);
+
+    if (PICKING_COLOR_ID)
+    {
+      count = raycastCandidates(origin, dir, items, PICKING_CANDIDATES);
+
+      if (count > 0)
+        n = pickColor(x, y, modelview, projection, items, count);
+    }
+    else
+      n = raycastPick(origin, dir);
+  }
+
+  if (n != NAME_UNPICKABLE)
+    processName(n, a);
 }
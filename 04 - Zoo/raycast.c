@@ -0,0 +1,552 @@
+/**
+ * @file
+ *
+ * Picking per Strahlschnitt auf der CPU.
+ *
+ * Jedes pickbare Objekt bekommt einen Huellquader (siehe bounds.c). Die
+ * Quader bilden die Blaetter eines Binaerbaums, dessen innere Knoten jeweils
+ * beide Kinder umschliessen.
+ * Aufgebaut wird der Baum einmal, indem die Blaetter rekursiv entlang der
+ * laengsten Achse am Median geteilt werden. Bewegt sich ein Objekt, wird nur
+ * sein Blatt neu berechnet und der Pfad zur Wurzel angepasst.
+ *
+ * Trifft der Strahl den Quader eines Blattes, wird er in das
+ * Objektkoordinatensystem gebracht und mit der genauen Form des Objekts
+ * geschnitten (siehe shape.h). Der Quader umschliesst die Form, sein
+ * Eintrittspunkt liegt also nie hinter dem Treffer auf der Form.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "raycast.h"
+#include "bounds.h"
+#include "level.h"
+#include "logic.h"
+#include "shape.h"
+#include "types.h"
+#include "vector.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Groesse des Stapels beim Durchlaufen. Die Teilung am Median haelt den Baum
+ * balanciert, 64 Ebenen reichen fuer jede denkbare Anzahl an Objekten.
+ */
+#define RAYCAST_STACK (64)
+
+/** Kein Knoten */
+#define RAYCAST_NONE (-1)
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Knoten der Hierarchie */
+typedef struct {
+  BoundsBox box;            /* Huellquader                          */
+  int left                  /* Linkes Kind, RAYCAST_NONE bei Blatt  */
+    , right                 /* Rechtes Kind                         */
+    , parent                /* Elternknoten, RAYCAST_NONE an Wurzel */
+    ;
+  const LevelItem * item;   /* Objekt, nur bei Blaettern            */
+} RaycastNode;
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* Knoten, die ersten leafCount sind die Blaetter */
+static RaycastNode * nodes = NULL;
+
+static int nodeCount = 0            /* Belegte Knoten  */
+         , leafCount = 0            /* Anzahl Blaetter */
+         , root      = RAYCAST_NONE /* Wurzel          */
+         ;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet den Mittelpunkt des Quaders b entlang der Achse axis.
+ *
+ * @param[in] b    Quader.
+ * @param[in] axis Achse (0 = x, 1 = y, 2 = z).
+ *
+ * @return Mittelpunkt entlang axis.
+ */
+static double boxCenter(const BoundsBox * b, int axis)
+{
+  return (b->min[axis] + b->max[axis]) * 0.5;
+}
+
+/**
+ * Baut rekursiv einen Teilbaum ueber die Blaetter leaves[0..count-1] auf.
+ * Die Blaetter werden nach ihrem Mittelpunkt entlang der laengsten Achse
+ * sortiert und am Median geteilt.
+ *
+ * @param[in,out] leaves Indizes der Blaetter, werden umsortiert.
+ * @param[in]     count  Anzahl der Blaetter, mindestens 1.
+ *
+ * @return Index der Wurzel des Teilbaums.
+ */
+static int buildNode(int * leaves, int count)
+{
+  BoundsBox box = nodes[leaves[0]].box;
+
+  double size = -1.0;
+
+  int axis = 0
+    , node
+    , i
+    , j
+    ;
+
+  assert(count > 0);
+
+  if (count == 1)
+    return leaves[0];
+
+  for (i = 1; i < count; ++i)
+    box = boundsUnion(box, nodes[leaves[i]].box);
+
+  for (j = 0; j < 3; ++j)
+    if (box.max[j] - box.min[j] > size)
+    {
+      size = box.max[j] - box.min[j];
+      axis = j;
+    }
+
+  /* Insertion-Sort, es sind nur wenige Blaetter */
+  for (i = 1; i < count; ++i)
+  {
+    int leaf = leaves[i];
+
+    for (j = i; j > 0 && boxCenter(&nodes[leaves[j - 1]].box, axis)
+                       > boxCenter(&nodes[leaf].box, axis); --j)
+      leaves[j] = leaves[j - 1];
+
+    leaves[j] = leaf;
+  }
+
+  node = nodeCount++;
+
+  nodes[node].box    = box;
+  nodes[node].item   = (void *) 0;
+  nodes[node].parent = RAYCAST_NONE;
+  nodes[node].left   = buildNode(leaves, count / 2);
+  nodes[node].right  = buildNode(leaves + count / 2, count - count / 2);
+
+  nodes[nodes[node].left].parent  = node;
+  nodes[nodes[node].right].parent = node;
+
+  return node;
+}
+
+/**
+ * Schneidet den Strahl mit dem Quader b (Slab-Test).
+ *
+ * @param[in]  b      Quader.
+ * @param[in]  origin Startpunkt des Strahls.
+ * @param[in]  dir    Richtung des Strahls.
+ * @param[in]  tMax   Schnitte hinter tMax zaehlen nicht.
+ * @param[out] tHit   Eintrittsparameter, 0 wenn origin in b liegt.
+ *
+ * @return TRUE  wenn der Strahl b zwischen 0 und tMax trifft
+ *         FALSE sonst.
+ */
+static Boolean hitBox(const BoundsBox * b, const double origin[3], const double dir[3], double tMax, double * tHit)
+{
+  double tMin = 0.0;
+
+  int j;
+
+  for (j = 0; j < 3; ++j)
+  {
+    /* Parallel zur Ebene: origin muss zwischen den Ebenen liegen */
+    if (fabs(dir[j]) < DBL_EPSILON)
+    {
+      if (origin[j] < b->min[j] || origin[j] > b->max[j])
+        return FALSE;
+    }
+    else
+    {
+      double t1 = (b->min[j] - origin[j]) / dir[j]
+           , t2 = (b->max[j] - origin[j]) / dir[j]
+           ;
+
+      if (t1 > t2)
+      {
+        double tmp = t1;
+        t1 = t2;
+        t2 = tmp;
+      }
+
+      if (t1 > tMin)
+        tMin = t1;
+      if (t2 < tMax)
+        tMax = t2;
+
+      if (tMin > tMax)
+        return FALSE;
+    }
+  }
+
+  *tHit = tMin;
+
+  return TRUE;
+}
+
+/**
+ * Schneidet den Strahl mit der genauen Form des Objekts item. Der Strahl
+ * wird dazu mit der Inversen der Weltmatrix in Objektkoordinaten gebracht,
+ * t bleibt dabei erhalten. Objekte ohne hinterlegte Form zaehlen mit ihrem
+ * Huellquader.
+ *
+ * @param[in]  item   Objekt.
+ * @param[in]  origin Startpunkt des Strahls.
+ * @param[in]  dir    Richtung des Strahls.
+ * @param[in]  tMax   Schnitte hinter tMax zaehlen nicht.
+ * @param[out] tHit   Parameter des Schnitts.
+ *
+ * @return TRUE  wenn der Strahl die Form zwischen 0 und tMax trifft
+ *         FALSE sonst.
+ */
+static Boolean hitItem(const LevelItem * item, const double origin[3], const double dir[3], double tMax, double * tHit)
+{
+  double m[16]
+       , inv[9]
+       , p[3]
+       , o[3]
+       , d[3]
+       , det
+       , t
+       ;
+
+  int j
+    , k
+    ;
+
+  if (!shapeKnown(item->f))
+  {
+    BoundsBox box = boundsOfItem(item);
+
+    return hitBox(&box, origin, dir, tMax, tHit);
+  }
+
+  boundsWorldOfItem(item, m);
+
+  /* Inverse des linearen Teils ueber die Adjunkte, spaltenweise */
+  inv[0] = m[5] * m[10] - m[9] * m[6];
+  inv[1] = m[9] * m[2]  - m[1] * m[10];
+  inv[2] = m[1] * m[6]  - m[5] * m[2];
+  inv[3] = m[8] * m[6]  - m[4] * m[10];
+  inv[4] = m[0] * m[10] - m[8] * m[2];
+  inv[5] = m[4] * m[2]  - m[0] * m[6];
+  inv[6] = m[4] * m[9]  - m[8] * m[5];
+  inv[7] = m[8] * m[1]  - m[0] * m[9];
+  inv[8] = m[0] * m[5]  - m[4] * m[1];
+
+  det = m[0] * inv[0] + m[4] * inv[1] + m[8] * inv[2];
+
+  if (fabs(det) < DBL_EPSILON)
+    return FALSE;
+
+  for (j = 0; j < 3; ++j)
+    p[j] = origin[j] - m[12 + j];
+
+  for (j = 0; j < 3; ++j)
+  {
+    o[j] = 0.0;
+    d[j] = 0.0;
+
+    for (k = 0; k < 3; ++k)
+    {
+      o[j] += inv[k * 3 + j] * p[k]   / det;
+      d[j] += inv[k * 3 + j] * dir[k] / det;
+    }
+  }
+
+  if (!shapeIntersect(item->f, o, d, &t) || t > tMax)
+    return FALSE;
+
+  *tHit = t;
+
+  return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Baut die Hierarchie ueber alle pickbaren Objekte des Levels l neu auf.
+ *
+ * @param[in] l Level.
+ */
+extern void raycastBuild(Level l)
+{
+  int * leaves;
+
+  unsigned i;
+
+  nodeCount = 0;
+  leafCount = 0;
+  root      = RAYCAST_NONE;
+
+  free(nodes);
+
+  /* n Blaetter brauchen hoechstens 2n - 1 Knoten */
+  nodes  = malloc((2 * l.last + 1) * sizeof(RaycastNode));
+  leaves = malloc((l.last + 1) * sizeof(int));
+
+  if (nodes == NULL || leaves == NULL)
+  {
+    free(leaves);
+    free(nodes);
+    nodes = NULL;
+
+    return;
+  }
+
+  /* Ein Blatt pro pickbarem Objekt */
+  for (i = 0; i < l.last; ++i)
+  {
+    LevelItem * item = levelItemAt(l, i);
+
+    if (logicIsPickable(item->n))
+    {
+      nodes[nodeCount].box    = boundsOfItem(item);
+      nodes[nodeCount].left   = RAYCAST_NONE;
+      nodes[nodeCount].right  = RAYCAST_NONE;
+      nodes[nodeCount].parent = RAYCAST_NONE;
+      nodes[nodeCount].item   = item;
+
+      leaves[nodeCount] = nodeCount;
+      ++nodeCount;
+    }
+  }
+
+  leafCount = nodeCount;
+
+  root = leafCount > 0
+       ? buildNode(leaves, leafCount)
+       : RAYCAST_NONE;
+
+  free(leaves);
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Raycast : %d leaves, %d nodes.\n", leafCount, nodeCount);
+  #endif
+}
+
+/**
+ * Passt den Huellquader des Objekts i und aller darueber liegenden Knoten an.
+ *
+ * @param[in] i Bewegtes Objekt.
+ */
+extern void raycastUpdate(const LevelItem * i)
+{
+  int node;
+
+  for (node = 0; node < leafCount && nodes[node].item != i; ++node)
+    ;
+
+  if (node == leafCount)
+    return;
+
+  nodes[node].box = boundsOfItem(i);
+
+  /* Pfad zur Wurzel anpassen */
+  for (node = nodes[node].parent; node != RAYCAST_NONE; node = nodes[node].parent)
+    nodes[node].box = boundsUnion( nodes[nodes[node].left].box
+                              , nodes[nodes[node].right].box
+                              );
+}
+
+/**
+ * Schneidet den Strahl origin + t * dir mit den Objekten der Hierarchie.
+ * Kinder werden von vorn nach hinten besucht, Teilbaeume hinter dem
+ * naechsten Treffer werden uebersprungen.
+ *
+ * @param[in] origin Startpunkt des Strahls.
+ * @param[in] dir    Richtung des Strahls.
+ *
+ * @return Name des naechstgelegenen getroffenen Objekts,
+ *         NAME_UNPICKABLE wenn nichts getroffen wurde.
+ */
+extern PickingName raycastPick(Vector3d origin, Vector3d dir)
+{
+  PickingName n = NAME_UNPICKABLE;
+
+  double o[3]
+       , d[3]
+       , best = DBL_MAX
+       , t
+       ;
+
+  int stack[RAYCAST_STACK]
+    , top = 0
+    ;
+
+  if (root == RAYCAST_NONE)
+    return n;
+
+  o[0] = origin.x;
+  o[1] = origin.y;
+  o[2] = origin.z;
+
+  d[0] = dir.x;
+  d[1] = dir.y;
+  d[2] = dir.z;
+
+  if (hitBox(&nodes[root].box, o, d, best, &t))
+    stack[top++] = root;
+
+  while (top > 0)
+  {
+    RaycastNode * node = nodes + stack[--top];
+
+    double tLeft
+         , tRight
+         ;
+
+    Boolean hitLeft
+          , hitRight
+          ;
+
+    /* Blatt: Form naeher als der bisher naechste Treffer */
+    if (node->item)
+    {
+      if (hitBox(&node->box, o, d, best, &t)
+       && hitItem(node->item, o, d, best, &t))
+      {
+        best = t;
+        n    = node->item->n;
+      }
+      continue;
+    }
+
+    assert(top + 2 <= RAYCAST_STACK);
+
+    hitLeft  = hitBox(&nodes[node->left].box,  o, d, best, &tLeft);
+    hitRight = hitBox(&nodes[node->right].box, o, d, best, &tRight);
+
+    /* Das naehere Kind zuletzt auf den Stapel, damit es zuerst dran ist */
+    if (hitLeft && hitRight && tLeft < tRight)
+    {
+      stack[top++] = node->right;
+      stack[top++] = node->left;
+    }
+    else
+    {
+      if (hitLeft)
+        stack[top++] = node->left;
+      if (hitRight)
+        stack[top++] = node->right;
+    }
+  }
+
+  return n;
+}
+
+/**
+ * Sammelt alle Objekte, deren Huellquader der Strahl origin + t * dir
+ * trifft, sortiert nach dem Eintrittspunkt von vorn nach hinten.
+ *
+ * @param[in]  origin Startpunkt des Strahls.
+ * @param[in]  dir    Richtung des Strahls.
+ * @param[out] items  Getroffene Objekte.
+ * @param[in]  max    Platz in items.
+ *
+ * @return Anzahl der Objekte in items.
+ */
+extern int raycastCandidates(Vector3d origin, Vector3d dir, const LevelItem ** items, int max)
+{
+  double o[3]
+       , d[3]
+       , dist[RAYCAST_STACK]
+       , t
+       ;
+
+  int stack[RAYCAST_STACK]
+    , top   = 0
+    , count = 0
+    , j
+    ;
+
+  if (root == RAYCAST_NONE)
+    return 0;
+
+  if (max > RAYCAST_STACK)
+    max = RAYCAST_STACK;
+
+  o[0] = origin.x;
+  o[1] = origin.y;
+  o[2] = origin.z;
+
+  d[0] = dir.x;
+  d[1] = dir.y;
+  d[2] = dir.z;
+
+  if (hitBox(&nodes[root].box, o, d, DBL_MAX, &t))
+    stack[top++] = root;
+
+  while (top > 0)
+  {
+    RaycastNode * node = nodes + stack[--top];
+
+    if (!node->item)
+    {
+      assert(top + 2 <= RAYCAST_STACK);
+
+      if (hitBox(&nodes[node->left].box, o, d, DBL_MAX, &t))
+        stack[top++] = node->left;
+      if (hitBox(&nodes[node->right].box, o, d, DBL_MAX, &t))
+        stack[top++] = node->right;
+
+      continue;
+    }
+
+    if (!hitBox(&node->box, o, d, DBL_MAX, &t))
+      continue;
+
+    /* Einsortieren, bei vollem Feld faellt das hinterste heraus */
+    for (j = count < max ? count++ : max; j > 0 && dist[j - 1] > t; --j)
+      if (j < max)
+      {
+        items[j] = items[j - 1];
+        dist[j]  = dist[j - 1];
+      }
+
+    if (j < max)
+    {
+      items[j] = node->item;
+      dist[j]  = t;
+    }
+  }
+
+  return count;
+}
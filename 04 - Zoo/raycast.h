@@ -0,0 +1,65 @@
+#ifndef __RAYCAST_H__
+#define __RAYCAST_H__
+/**
+ * @file
+ *
+ * Picking per Strahlschnitt auf der CPU. Die pickbaren Objekte des Levels
+ * werden durch achsenparallele Quader (AABB) umschlossen, die in einer
+ * Hierarchie von Huellquadern (BVH) liegen. Ein Strahl wird gegen diese
+ * Hierarchie geschnitten, ohne dass dafuer gezeichnet werden muss.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "level.h"
+#include "vector.h"
+
+/**
+ * Baut die Hierarchie ueber alle pickbaren Objekte des Levels l neu auf.
+ * Die Objekte werden ueber ihre Adresse wiedererkannt, sie muessen also
+ * solange gueltig bleiben, wie die Hierarchie benutzt wird.
+ *
+ * @param[in] l Level.
+ */
+extern void raycastBuild(Level l);
+
+/**
+ * Passt den Huellquader des Objekts i an dessen aktuelle Lage an und
+ * vergroessert bzw. verkleinert alle darueber liegenden Knoten entsprechend.
+ * Objekte, die nicht in der Hierarchie liegen, werden ignoriert.
+ *
+ * @param[in] i Bewegtes Objekt.
+ */
+extern void raycastUpdate(const LevelItem * i);
+
+/**
+ * Schneidet den Strahl origin + t * dir (t >= 0) mit den Objekten der
+ * Hierarchie. Getroffene Quader werden an der genauen Form des Objekts
+ * nachgeprueft, sofern eine hinterlegt ist (siehe shape.h). Benoetigt
+ * keinen GL-Kontext.
+ *
+ * @param[in] origin Startpunkt des Strahls.
+ * @param[in] dir    Richtung des Strahls, muss nicht normiert sein.
+ *
+ * @return Name des naechstgelegenen getroffenen Objekts,
+ *         NAME_UNPICKABLE wenn nichts getroffen wurde.
+ */
+extern PickingName raycastPick(Vector3d origin, Vector3d dir);
+
+/**
+ * Sammelt alle Objekte, deren Huellquader der Strahl origin + t * dir
+ * (t >= 0) trifft, sortiert von vorn nach hinten. Die Quader sind groeber
+ * als die Objekte, die Treffer sind also nur Kandidaten, die noch an der
+ * echten Geometrie geprueft werden muessen (siehe pick).
+ *
+ * @param[in]  origin Startpunkt des Strahls.
+ * @param[in]  dir    Richtung des Strahls, muss nicht normiert sein.
+ * @param[out] items  Getroffene Objekte, das naechste zuerst.
+ * @param[in]  max    Platz in items, hoechstens 64 werden benutzt.
+ *
+ * @return Anzahl der Objekte in items.
+ */
+extern int raycastCandidates(Vector3d origin, Vector3d dir, const LevelItem ** items, int max);
+
+#endif
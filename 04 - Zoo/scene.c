@@ -15,6 +15,7 @@
  * -------------------------------------------------------------------------- */
 #include <GL/gl.h>
 #include <GL/glut.h>
+#include <stdlib.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -30,14 +31,36 @@
 #include "vector.h"
 #include "displaylist.h"
 #include "picking.h"
+#include "drawing.h"
+#include "material.h"
+#include "texture.h"
+#include "renderQueue.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "sceneGraph.h"
 
 /* ----------------------------------------------------------------------------
  * Typen
  * -------------------------------------------------------------------------- */
 
+/** Eintrag der Tabelle von Objekt zu Knoten */
+typedef struct {
+  const LevelItem * item; /* Objekt, NULL für einen freien Platz */
+  int node;               /* Knoten im Szenengraphen            */
+} ItemNode;
+
 /* ----------------------------------------------------------------------------
  * Konstanten
  * -------------------------------------------------------------------------- */
+
+/** Ferne Clipping-Ebene, zugleich größte Tiefe in der Warteschlange */
+#define SCENE_FAR (30.0)
+
+/** Mindestgenauigkeit einer z-Ebene im z-Buffer in Bit */
+#define SCENE_LAYER_BITS (16)
+
+/** Anfängliche Größe der Tabelle von Objekt zu Knoten, Zweierpotenz */
+#define SCENE_ITEM_NODES (32)
  
 /* ----------------------------------------------------------------------------
  * Globale Daten
@@ -62,37 +85,230 @@ static Boolean useDisplayLists = TRUE  /*   DisplayListen benutzen ? */
              #endif
              ;
 
+/* Zeichenaufträge eines Bildes */
+static RenderQueue queue;
+
+/* Weltmatrizen der Objekte */
+static SceneGraph graph;
+
+/* Knoten je Objekt, offen adressiert über die Adresse des Objekts. Die
+ * Reihenfolge im Level ändert sich beim Sortieren, die Adressen nicht. */
+static ItemNode * itemNodes = NULL;
+
+static unsigned itemNodeSize  = 0 /* Plätze in itemNodes */
+              , itemNodeCount = 0 /* Belegte Plätze      */
+              ;
+
+/* Kameramatrix des aktuellen Bildes */
+static double view[16];
+
+static unsigned drawnItems  = 0 /* Im letzten Bild gezeichnete Objekte  */
+              , culledItems = 0 /* Im letzten Bild weggelassene Objekte */
+              ;
+
 /* ----------------------------------------------------------------------------
  * Funktionen
  * ----------------------------------------------------------------------------
  * Static
  * -------------------------------------------------------------------------- */
 
+/**
+ * Bindet die Textur t für die Warteschlange.
+ *
+ * @param[in] t Textur.
+ */
+static void setTexture(int t)
+{
+  bindTexture((TextureName) t);
+}
+
+/**
+ * Setzt das Material m für die Warteschlange.
+ *
+ * @param[in] m Material.
+ */
+static void setMaterial(int m)
+{
+  materialSet((Material) m);
+}
+
 /**
  * Ruft die Zeichenfunktion bzw. Displayliste zum Zeichnen der durch f gegebenen
- * Zeichenfunktion auf.
+ * Zeichenfunktion auf. Ihren führenden Zustand hat die Warteschlange gesetzt.
  *
- * @param[in] i Zeiger auf zu zeichnendes LevelItem.
+ * @param[in] data Zeiger auf zu zeichnendes LevelItem.
  */
-static void drawMyType(LevelItem * i)
+static void drawMyType(const void * data)
 {
+  const SceneNode * n = data;
+  const LevelItem * i = n->data;
+  
   #ifdef DEBUG
   if (zInfo)
     fprintf(stderr, "DEBUG :: Drawing %s\n", levelPickingNameToString(i->n));
   #endif
   
-  glPushName(i->n);
+  /* Zwischengespeicherte Weltmatrix statt Translate und Rotate */
+  sceneGraphLoad(&graph, n - graph.nodes, view);
   
-  glPushMatrix();
-    glTranslatef(i->t.x, i->t.y, i->t.z);
-    glRotatef(i->a, i->r.x, i->r.y, i->r.z);
+  useDisplayLists
+    ? displaylistCall(i->f)
+    : logicGetDrawFunction(i->f)();
+}
+
+/**
+ * Berechnet den Platz des Objekts i in einer Tabelle der Größe size.
+ *
+ * @param[in] i    Objekt.
+ * @param[in] size Größe der Tabelle, Zweierpotenz.
+ *
+ * @return Erster Platz, an dem gesucht wird.
+ */
+static unsigned long hashItem(const LevelItem * i, unsigned size)
+{
+  return (((unsigned long) i >> 4) * 2654435761UL) & (size - 1);
+}
+
+/**
+ * Sucht den Knoten des Objekts i.
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Knoten, -1 wenn i noch keinen hat.
+ */
+static int findNode(const LevelItem * i)
+{
+  unsigned long h;
+  
+  if (itemNodeSize == 0)
+    return -1;
+  
+  for (h = hashItem(i, itemNodeSize); itemNodes[h].item != NULL; h = (h + 1) & (itemNodeSize - 1))
+    if (itemNodes[h].item == i)
+      return itemNodes[h].node;
+  
+  return -1;
+}
+
+/**
+ * Trägt den Knoten node des Objekts i in die Tabelle ein. Ist sie danach
+ * mehr als halb voll, wird sie zuerst verdoppelt.
+ *
+ * @param[in] i    Objekt.
+ * @param[in] node Knoten.
+ *
+ * @return TRUE  wenn der Eintrag angelegt wurde,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+static Boolean insertNode(const LevelItem * i, int node)
+{
+  unsigned long h;
+  
+  unsigned k;
+  
+  if (2 * (itemNodeCount + 1) > itemNodeSize)
+  {
+    unsigned size = itemNodeSize < SCENE_ITEM_NODES
+                  ? SCENE_ITEM_NODES
+                  : 2 * itemNodeSize
+                  ;
     
-    useDisplayLists
-      ? displaylistCall(i->f)
-      : logicGetDrawFunction(i->f)();
-  glPopMatrix();
+    ItemNode * nodes = malloc(size * sizeof(ItemNode));
+    
+    if (nodes == NULL)
+      return FALSE;
+    
+    for (k = 0; k < size; ++k)
+      nodes[k].item = NULL;
+    
+    /* Bisherige Einträge umziehen */
+    for (k = 0; k < itemNodeSize; ++k)
+      if (itemNodes[k].item != NULL)
+      {
+        for (h = hashItem(itemNodes[k].item, size); nodes[h].item != NULL; h = (h + 1) & (size - 1))
+          ;
+        
+        nodes[h] = itemNodes[k];
+      }
+    
+    free(itemNodes);
+    
+    itemNodes    = nodes;
+    itemNodeSize = size;
+  }
+  
+  for (h = hashItem(i, itemNodeSize); itemNodes[h].item != NULL; h = (h + 1) & (itemNodeSize - 1))
+    ;
+  
+  itemNodes[h].item = i;
+  itemNodes[h].node = node;
   
-  glPopName();
+  ++itemNodeCount;
+  
+  return TRUE;
+}
+
+/**
+ * Gibt den Knoten des Objekts i zurück und legt ihn beim ersten Mal an,
+ * unter dem Knoten des übergeordneten Objekts (logicGetParentItem).
+ *
+ * @param[in] i Objekt.
+ *
+ * @return Knoten, -1 wenn kein Speicher mehr frei ist.
+ */
+static int nodeOfItem(const LevelItem * i)
+{
+  const LevelItem * parent = logicGetParentItem(i);
+  
+  int node       = findNode(i)
+    , parentNode = SCENEGRAPH_ROOT
+    ;
+  
+  if (node >= 0)
+    return node;
+  
+  /* Eltern liegen im Graphen vor ihren Kindern */
+  if (parent != NULL && (parentNode = nodeOfItem(parent)) < 0)
+    return -1;
+  
+  node = sceneGraphAdd(&graph, parentNode, i);
+  
+  if (node >= 0 && !insertNode(i, node))
+    return -1;
+  
+  return node;
+}
+
+/**
+ * Überträgt die Transformationen der Objekte von l in den Szenengraphen und
+ * berechnet die geänderten Weltmatrizen neu. Die Transformation eines Objekts
+ * mit übergeordnetem Objekt ist bereits relativ zu diesem, bewegt sich das
+ * übergeordnete, wird es über den Graphen mitgeführt.
+ *
+ * @param[in] l Level.
+ */
+static void syncGraph(Level l)
+{
+  static const Vector3d one = { 1.0, 1.0, 1.0 };
+  
+  unsigned i;
+  
+  int node;
+  
+  const LevelItem * item;
+  
+  for (i = 0; i < l.last; ++i)
+  {
+    item = levelItemAt(l, i);
+    node = nodeOfItem(item);
+    
+    if (node < 0)
+      continue;
+    
+    sceneGraphSetLocal(&graph, node, item->t, item->r, item->a, one);
+  }
+  
+  sceneGraphUpdate(&graph);
 }
 
 /**
@@ -133,10 +349,10 @@ static void setLights(void)
 extern void setProjection(double aspect)
 {
   /* perspektivische Projektion */
-  gluPerspective( 70.0   /* Oeffnungswinkel      */
-                , aspect /* Seitenverhaeltnis    */
-                , 0.1    /* nahe Clipping-Ebene  */
-                , 30.0   /* ferne Clipping-Ebene */
+  gluPerspective( 70.0      /* Oeffnungswinkel      */
+                , aspect    /* Seitenverhaeltnis    */
+                , 0.1       /* nahe Clipping-Ebene  */
+                , SCENE_FAR /* ferne Clipping-Ebene */
                 );
 }
 
@@ -158,76 +374,122 @@ extern void setCamera(void)
 }
 
 /**
- * Zeichnet die Szene
+ * Zeichnet die Szene. Objekte, deren Hüllquader ganz außerhalb des
+ * Sichtvolumens liegen, werden weggelassen. Eine Displayliste wird dabei
+ * nur als Ganzes geprüft, nicht Teil für Teil.
  */
-extern void sceneDraw(Boolean names)
+extern void sceneDraw(void)
 {
-  int i = 0;
-  
-  unsigned z = 0;
+  unsigned i;
   
   Level l = logicGetLevel();
   LevelItem * item;
   
+  Material m;
+  TextureName t;
+  
+  Frustum frustum;
+  BoundsBox box;
+  
+  unsigned drawn  = 0
+         , culled = 0
+         ;
+  
+  int node;
+  
+  /* Sichtvolumen der aktuellen Kamera */
+  frustumFromGL(&frustum);
+  
+  /* Kamera merken, die Objekte laden ihre Matrix selbst */
+  glGetDoublev(GL_MODELVIEW_MATRIX, view);
+  
+  /* Nur geänderte Weltmatrizen neu berechnen */
+  syncGraph(l);
+  
   setLights();
   
   /* Blenden */
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   
-  i = l.last - 1;
-  
-  /* Back -> Front */
-  while (z < l.zMax && i >= 0)
+  for (i = 0; i < l.last; ++i)
   {
     item = levelItemAt(l, i);
+    node = findNode(item);
     
-    /* z-BUffer bei neuer z-Ebene löschen */
-    if (z != item->z)
-    {
-      #ifdef DEBUG
-      if (zInfo)
-        fprintf(stderr, "DEBUG :: Clearing Z-Buffer.\n");
-      #endif
-      
-      glClear(GL_DEPTH_BUFFER_BIT);
-      
-      ++z;
-    }
+    if (node < 0)
+      continue;
+    
+    /* Objekte außerhalb des Sichtvolumens weglassen */
+    box = boundsOfItemAt(item, sceneGraphWorld(&graph, node));
     
-    if (names)
+    if (!frustumTestBox(&frustum, &box))
     {
-      /* Zeichnen fürs Picking, nur die Elemente zeichnen, die pickable sind */
-      if (logicIsPickable(item->n))
-        drawMyType(item);
+      ++culled;
+      continue;
     }
-    else
-      drawMyType(item);
     
-    --i;
-  }
-  
-  /* letzte z-Ebene */
-  while (i >= 0)
-  {
-    item = levelItemAt(l, i);
+    ++drawn;
     
-    if (names)
-    {
-      if (logicIsPickable(item->n))
-        drawMyType(item);
-    }
+    /* Führendes Material und Textur setzt die Warteschlange nur bei einem
+     * Wechsel, die Displaylisten enthalten nur Abweichungen davon */
+    if (drawingGetState(logicGetDrawFunction(item->f), &m, &t))
+      renderQueuePush(&queue, item->z, materialIsTranslucent(m), t, m, item->size, drawMyType, &graph.nodes[node]);
     else
-      drawMyType(item);
-    
-    --i;
+      renderQueuePush(&queue, item->z, FALSE, 0, 0, item->size, drawMyType, &graph.nodes[node]);
   }
   
+  /* Ebene für Ebene, undurchsichtig von vorn nach hinten, dann
+   * durchscheinend von hinten nach vorn */
+  renderQueueSubmit(&queue);
+  
+  /* Kamera wiederherstellen */
+  glLoadMatrixd(view);
+  
+  drawnItems  = drawn;
+  culledItems = culled;
+  
   #ifdef DEBUG
   if (zInfo)
-    fprintf(stderr, "\n");
+    fprintf(stderr, "DEBUG :: %u drawn, %u culled.\n\n", drawn, culled);
   #endif
 }
 
+/**
+ * Zeichnet nur das Objekt i mit seiner Weltmatrix (inklusive übergeordneter
+ * Objekte) relativ zur aktuellen Modelview-Matrix, ohne Licht und Sortierung.
+ *
+ * @param[in] i Objekt.
+ */
+extern void sceneDrawItem(const LevelItem * i)
+{
+  GLdouble world[16];
+  
+  boundsWorldOfItem(i, world);
+  
+  glPushMatrix();
+    glMultMatrixd(world);
+    
+    drawingSetState(logicGetDrawFunction(i->f));
+    
+    useDisplayLists
+      ? displaylistCall(i->f)
+      : logicGetDrawFunction(i->f)();
+  glPopMatrix();
+}
+
+/**
+ * Gibt zurück, wie viele Objekte im letzten Bild gezeichnet und wie viele
+ * als außerhalb des Sichtvolumens weggelassen wurden.
+ *
+ * @param[out] drawn  Gezeichnete Objekte.
+ * @param[out] culled Weggelassene Objekte.
+ */
+extern void sceneGetItemCounts(unsigned * drawn, unsigned * culled)
+{
+  *drawn  = drawnItems;
+  *culled = culledItems;
+}
+
 /**
  * Initialisierung der Szene.
  */
@@ -259,6 +521,15 @@ extern int sceneInit(void)
   /* Texturierung */
   glEnable(GL_TEXTURE_2D);
   
+  renderQueueInit(&queue, SCENE_FAR, setTexture, setMaterial);
+  
+  /* z-Ebenen über glDepthRange trennen, nur ein Löschen des z-Buffers */
+  renderQueueSetLayering(&queue, RENDERQUEUE_LAYERS_DEPTHRANGE, SCENE_LAYER_BITS);
+  
+  /* Szenengraph mit Wurzel */
+  if (!sceneGraphInit(&graph))
+    return 0;
+  
   return 1;
 }
 
@@ -11,6 +11,7 @@
  */
 
 #include "types.h"
+#include "level.h"
 
 /**
  * Setzen der Projektionsmatrix.
@@ -27,9 +28,29 @@ extern void setProjection(double aspect);
  */
 extern void setCamera(void);
 /**
- * Zeichnet die Szene.
+ * Zeichnet die Szene. Objekte, deren Hüllquader ganz außerhalb des
+ * Sichtvolumens liegen, werden weggelassen. Eine Displayliste wird dabei
+ * nur als Ganzes geprüft, nicht Teil für Teil.
  */
-extern void sceneDraw(Boolean names);
+extern void sceneDraw(void);
+
+/**
+ * Zeichnet nur das Objekt i mit seiner Weltmatrix (inklusive übergeordneter
+ * Objekte) relativ zur aktuellen Modelview-Matrix. Licht, Material und Reihenfolge bleiben dem
+ * Aufrufer überlassen, etwa dem Picking.
+ *
+ * @param[in] i Objekt.
+ */
+extern void sceneDrawItem(const LevelItem * i);
+
+/**
+ * Gibt zurück, wie viele Objekte im letzten Bild gezeichnet und wie viele
+ * als außerhalb des Sichtvolumens weggelassen wurden.
+ *
+ * @param[out] drawn  Gezeichnete Objekte.
+ * @param[out] culled Weggelassene Objekte.
+ */
+extern void sceneGetItemCounts(unsigned * drawn, unsigned * culled);
 
 /**
  * Initialisierung der Szene.
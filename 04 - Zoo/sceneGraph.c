@@ -0,0 +1,354 @@
+/**
+ * @file
+ *
+ * Szenengraph mit zwischengespeicherten Weltmatrizen.
+ *
+ * Die Knoten liegen in einem wachsenden Feld, Eltern immer vor ihren
+ * Kindern. Ein Update laeuft deshalb einmal von vorn nach hinten: Ein
+ * Knoten wird neu berechnet, wenn er selbst geaendert ist oder sein
+ * Elternknoten in diesem Durchlauf neu berechnet wurde.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "sceneGraph.h"
+#include "types.h"
+#include "vector.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+#define PI (3.1415926535897932384626433832795029)
+#define DEGTORAD(x) ((x)*(PI)/(180))
+
+/** Anfaengliche Anzahl der Knoten */
+#define SCENEGRAPH_CAPACITY (32)
+
+/** Einheitsmatrix */
+static const double identity[16] =
+  { 1.0, 0.0, 0.0, 0.0
+  , 0.0, 1.0, 0.0, 0.0
+  , 0.0, 0.0, 1.0, 0.0
+  , 0.0, 0.0, 0.0, 1.0
+  };
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet res = a * b fuer spaltenweise 4x4-Matrizen. res darf weder a
+ * noch b sein.
+ *
+ * @param[out] res Produkt.
+ * @param[in]  a   Linker Faktor.
+ * @param[in]  b   Rechter Faktor.
+ */
+static void multiply(double res[16], const double a[16], const double b[16])
+{
+  int col
+    , row
+    ;
+
+  for (col = 0; col < 4; ++col)
+    for (row = 0; row < 4; ++row)
+      res[col * 4 + row] = a[row]      * b[col * 4]
+                         + a[4 + row]  * b[col * 4 + 1]
+                         + a[8 + row]  * b[col * 4 + 2]
+                         + a[12 + row] * b[col * 4 + 3];
+}
+
+/**
+ * Berechnet die lokale Matrix Translate(t) * Rotate(a, r) * Scale(s) des
+ * Knotens n, die Drehung wie bei glRotate.
+ *
+ * @param[in]  n     Knoten.
+ * @param[out] local Lokale Matrix, spaltenweise.
+ */
+static void localMatrix(const SceneNode * n, double local[16])
+{
+  double axis[3]
+       , len = vectorLength(n->r)
+       , co  = cos(DEGTORAD(n->a))
+       , si  = sin(DEGTORAD(n->a))
+       , s[3]
+       ;
+
+  int j
+    , k
+    ;
+
+  /* Ohne Drehachse keine Drehung */
+  if (len < DBL_EPSILON)
+  {
+    co  = 1.0;
+    si  = 0.0;
+    len = 1.0;
+  }
+
+  axis[0] = n->r.x / len;
+  axis[1] = n->r.y / len;
+  axis[2] = n->r.z / len;
+
+  s[0] = n->s.x;
+  s[1] = n->s.y;
+  s[2] = n->s.z;
+
+  /* Rotationsmatrix, Spalte k mit s[k] skaliert */
+  for (k = 0; k < 3; ++k)
+  {
+    for (j = 0; j < 3; ++j)
+      local[k * 4 + j] = axis[j] * axis[k] * (1.0 - co) + (j == k ? co : 0.0);
+
+    local[k * 4 + 3] = 0.0;
+  }
+
+  local[4]  -= axis[2] * si;
+  local[8]  += axis[1] * si;
+  local[1]  += axis[2] * si;
+  local[9]  -= axis[0] * si;
+  local[2]  -= axis[1] * si;
+  local[6]  += axis[0] * si;
+
+  for (k = 0; k < 3; ++k)
+    for (j = 0; j < 3; ++j)
+      local[k * 4 + j] *= s[k];
+
+  local[12] = n->t.x;
+  local[13] = n->t.y;
+  local[14] = n->t.z;
+  local[15] = 1.0;
+}
+
+/**
+ * Prueft, ob sich u und v unterscheiden.
+ *
+ * @param[in] u Erster Vektor.
+ * @param[in] v Zweiter Vektor.
+ *
+ * @return TRUE  wenn sich eine Komponente unterscheidet,
+ *         FALSE sonst.
+ */
+static Boolean vectorDiffers(Vector3d u, Vector3d v)
+{
+  return u.x != v.x || u.y != v.y || u.z != v.z;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Initialisiert den Graphen g mit der Wurzel.
+ *
+ * @param[out] g Szenengraph.
+ *
+ * @return TRUE  wenn die Wurzel angelegt werden konnte,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+extern Boolean sceneGraphInit(SceneGraph * g)
+{
+  g->nodes    = NULL;
+  g->count    = 0;
+  g->capacity = 0;
+
+  return sceneGraphAdd(g, -1, NULL) == SCENEGRAPH_ROOT;
+}
+
+/**
+ * Gibt den Speicher des Graphen g frei.
+ *
+ * @param[in] g Szenengraph.
+ */
+extern void sceneGraphFree(SceneGraph * g)
+{
+  free(g->nodes);
+
+  g->nodes    = NULL;
+  g->count    = 0;
+  g->capacity = 0;
+}
+
+/**
+ * Haengt einen neuen Knoten ohne Transformation an den Knoten parent.
+ *
+ * @param[in] g      Szenengraph.
+ * @param[in] parent Elternknoten.
+ * @param[in] data   Daten des Benutzers.
+ *
+ * @return Nummer des neuen Knotens,
+ *         -1 wenn kein Speicher mehr frei ist.
+ */
+extern int sceneGraphAdd(SceneGraph * g, int parent, const void * data)
+{
+  SceneNode * n;
+
+  if (g->count == g->capacity)
+  {
+    unsigned capacity = g->capacity < SCENEGRAPH_CAPACITY
+                      ? SCENEGRAPH_CAPACITY
+                      : 2 * g->capacity
+                      ;
+
+    SceneNode * nodes = realloc(g->nodes, capacity * sizeof(SceneNode));
+
+    if (nodes == NULL)
+    {
+      #ifdef DEBUG
+      fprintf(stderr, "DEBUG :: Scene Graph : Could not grow to %u nodes.\n", capacity);
+      #endif
+
+      return -1;
+    }
+
+    g->nodes    = nodes;
+    g->capacity = capacity;
+  }
+
+  n = &g->nodes[g->count];
+
+  n->parent  = parent;
+  n->t       = vectorMake(0.0, 0.0, 0.0);
+  n->r       = vectorMake(0.0, 0.0, 0.0);
+  n->s       = vectorMake(1.0, 1.0, 1.0);
+  n->a       = 0.0;
+  n->dirty   = TRUE;
+  n->changed = FALSE;
+  n->data    = data;
+
+  memcpy(n->world, identity, sizeof(identity));
+
+  return (int) g->count++;
+}
+
+/**
+ * Setzt die lokale Transformation des Knotens n.
+ *
+ * @param[in] g Szenengraph.
+ * @param[in] n Knoten.
+ * @param[in] t Verschiebung.
+ * @param[in] r Drehachse.
+ * @param[in] a Drehwinkel in Grad.
+ * @param[in] s Skalierung.
+ */
+extern void sceneGraphSetLocal(SceneGraph * g, int n, Vector3d t, Vector3d r, double a, Vector3d s)
+{
+  SceneNode * node = &g->nodes[n];
+
+  if (!vectorDiffers(node->t, t)
+   && !vectorDiffers(node->r, r)
+   && !vectorDiffers(node->s, s)
+   && node->a == a)
+    return;
+
+  node->t     = t;
+  node->r     = r;
+  node->s     = s;
+  node->a     = a;
+  node->dirty = TRUE;
+}
+
+/**
+ * Setzt die Daten des Benutzers am Knoten n.
+ *
+ * @param[in] g    Szenengraph.
+ * @param[in] n    Knoten.
+ * @param[in] data Daten des Benutzers.
+ */
+extern void sceneGraphSetData(SceneGraph * g, int n, const void * data)
+{
+  g->nodes[n].data = data;
+}
+
+/**
+ * Berechnet die Weltmatrizen aller geaenderten Knoten und ihrer Nachfahren
+ * neu.
+ *
+ * @param[in] g Szenengraph.
+ *
+ * @return Anzahl der neu berechneten Knoten.
+ */
+extern unsigned sceneGraphUpdate(SceneGraph * g)
+{
+  unsigned i
+         , updated = 0
+         ;
+
+  double local[16];
+
+  SceneNode * n;
+
+  for (i = 0; i < g->count; ++i)
+  {
+    n = &g->nodes[i];
+
+    n->changed = n->dirty
+              || (n->parent >= 0 && g->nodes[n->parent].changed);
+
+    if (!n->changed)
+      continue;
+
+    localMatrix(n, local);
+
+    if (n->parent < 0)
+      memcpy(n->world, local, sizeof(local));
+    else
+      multiply(n->world, g->nodes[n->parent].world, local);
+
+    n->dirty = FALSE;
+    ++updated;
+  }
+
+  return updated;
+}
+
+/**
+ * Gibt die zwischengespeicherte Weltmatrix des Knotens n zurueck.
+ *
+ * @param[in] g Szenengraph.
+ * @param[in] n Knoten.
+ *
+ * @return Weltmatrix, spaltenweise.
+ */
+extern const double * sceneGraphWorld(const SceneGraph * g, int n)
+{
+  return g->nodes[n].world;
+}
+
+/**
+ * Laedt view * Weltmatrix des Knotens n als Modelviewmatrix.
+ *
+ * @param[in] g    Szenengraph.
+ * @param[in] n    Knoten.
+ * @param[in] view Kameramatrix, spaltenweise.
+ */
+extern void sceneGraphLoad(const SceneGraph * g, int n, const double view[16])
+{
+  double modelview[16];
+
+  multiply(modelview, view, g->nodes[n].world);
+
+  glLoadMatrixd(modelview);
+}
@@ -0,0 +1,134 @@
+#ifndef __SCENEGRAPH_H__
+#define __SCENEGRAPH_H__
+/**
+ * @file
+ *
+ * Szenengraph. Jeder Knoten haelt seine lokale Transformation aus
+ * Verschiebung, Drehung und Skalierung und die daraus zwischengespeicherte
+ * Weltmatrix. Neu berechnet werden nur Knoten, deren lokale Transformation
+ * sich geaendert hat, und ihre Nachfahren. Haengt ein Knoten an einem
+ * anderen, folgt er dessen Bewegung, ohne dass seine lokale Transformation
+ * angefasst wird. Zeichnen und Culling verwenden dieselben Weltmatrizen.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "types.h"
+#include "vector.h"
+
+/** Wurzel des Graphen, immer vorhanden, mit Einheitsmatrix */
+#define SCENEGRAPH_ROOT (0)
+
+/** Knoten des Szenengraphen */
+typedef struct {
+  int parent;              /* Elternknoten, -1 fuer die Wurzel          */
+
+  Vector3d t               /* Verschiebung                              */
+         , r               /* Drehachse                                 */
+         , s               /* Skalierung                                */
+         ;
+
+  double a;                /* Drehwinkel in Grad                        */
+
+  double world[16];        /* Weltmatrix, spaltenweise wie bei OpenGL   */
+
+  Boolean dirty            /* Lokale Transformation geaendert           */
+        , changed          /* Weltmatrix beim letzten Update berechnet  */
+        ;
+
+  const void * data;       /* Daten des Benutzers                       */
+} SceneNode;
+
+/** Szenengraph, Eltern liegen im Feld immer vor ihren Kindern */
+typedef struct {
+  SceneNode * nodes;
+
+  unsigned count
+         , capacity
+         ;
+} SceneGraph;
+
+/**
+ * Initialisiert den Graphen g, der danach nur die Wurzel enthaelt.
+ *
+ * @param[out] g Szenengraph.
+ *
+ * @return TRUE  wenn die Wurzel angelegt werden konnte,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+extern Boolean sceneGraphInit(SceneGraph * g);
+
+/**
+ * Gibt den Speicher des Graphen g frei.
+ *
+ * @param[in] g Szenengraph.
+ */
+extern void sceneGraphFree(SceneGraph * g);
+
+/**
+ * Haengt einen neuen Knoten ohne Transformation an den Knoten parent.
+ *
+ * @param[in] g      Szenengraph.
+ * @param[in] parent Elternknoten, muss schon im Graphen sein.
+ * @param[in] data   Daten des Benutzers.
+ *
+ * @return Nummer des neuen Knotens,
+ *         -1 wenn kein Speicher mehr frei ist.
+ */
+extern int sceneGraphAdd(SceneGraph * g, int parent, const void * data);
+
+/**
+ * Setzt die lokale Transformation des Knotens n auf
+ * Translate(t) * Rotate(a, r) * Scale(s). Der Knoten wird nur dann als
+ * geaendert markiert, wenn sich ein Wert unterscheidet.
+ *
+ * @param[in] g Szenengraph.
+ * @param[in] n Knoten.
+ * @param[in] t Verschiebung.
+ * @param[in] r Drehachse.
+ * @param[in] a Drehwinkel in Grad.
+ * @param[in] s Skalierung.
+ */
+extern void sceneGraphSetLocal(SceneGraph * g, int n, Vector3d t, Vector3d r, double a, Vector3d s);
+
+/**
+ * Setzt die Daten des Benutzers am Knoten n.
+ *
+ * @param[in] g    Szenengraph.
+ * @param[in] n    Knoten.
+ * @param[in] data Daten des Benutzers.
+ */
+extern void sceneGraphSetData(SceneGraph * g, int n, const void * data);
+
+/**
+ * Berechnet die Weltmatrizen aller geaenderten Knoten und ihrer Nachfahren
+ * neu.
+ *
+ * @param[in] g Szenengraph.
+ *
+ * @return Anzahl der neu berechneten Knoten.
+ */
+extern unsigned sceneGraphUpdate(SceneGraph * g);
+
+/**
+ * Gibt die zwischengespeicherte Weltmatrix des Knotens n zurueck, gueltig
+ * nach sceneGraphUpdate.
+ *
+ * @param[in] g Szenengraph.
+ * @param[in] n Knoten.
+ *
+ * @return Weltmatrix, spaltenweise.
+ */
+extern const double * sceneGraphWorld(const SceneGraph * g, int n);
+
+/**
+ * Laedt view * Weltmatrix des Knotens n als Modelviewmatrix.
+ *
+ * @param[in] g    Szenengraph.
+ * @param[in] n    Knoten.
+ * @param[in] view Kameramatrix, spaltenweise.
+ */
+extern void sceneGraphLoad(const SceneGraph * g, int n, const double view[16]);
+
+#endif
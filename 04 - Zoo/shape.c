@@ -0,0 +1,359 @@
+/**
+ * @file
+ *
+ * Genaue Form der pickbaren Objekte.
+ *
+ * Die Teile jeder Figur stehen in einer Tabelle, sie ergeben sich aus den
+ * Verschiebungen, Drehungen und Skalierungen in drawing.c. Jedes Teil ist
+ * eine Einheitsfigur (Quader [-1, 1]^3, Kugel mit Radius 1 oder Zylinder
+ * entlang y von -1 bis 1 mit Radius 1 unten), die um ihre Halbachsen e
+ * skaliert, um angle Grad um x gedreht und nach c verschoben wird. Der
+ * Strahl wird in das System der Einheitsfigur gebracht und dort analytisch
+ * geschnitten, der Parameter t bleibt dabei erhalten.
+ *
+ * Gezeichnet werden Kugeln und Zylinder als Facetten (drawSubdivides), die
+ * Tabelle beschreibt die runde Figur. Am Rand einer Figur koennen Strahl und
+ * Bild darum um Bruchteile eines Pixels voneinander abweichen.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <float.h>
+#include <math.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "shape.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Art eines Teils */
+typedef enum {
+  SHAPE_BOX
+, SHAPE_SPHERE
+, SHAPE_CYLINDER
+} ShapeKind;
+
+/** Teil einer Figur */
+typedef struct {
+  DrawFunctionType f;   /* Figur, zu der das Teil gehoert            */
+  ShapeKind kind;       /* Einheitsfigur                             */
+  double c[3]           /* Mittelpunkt                               */
+       , e[3]           /* Halbachsen vor der Drehung                */
+       , angle          /* Drehung um x in Grad                      */
+       , top            /* Zylinder: Radius oben, unten ist er 1     */
+       ;
+} ShapePart;
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+#define PI (3.1415926535897932384626433832795029)
+#define DEGTORAD(x) ((x)*(PI)/(180))
+
+/** Anzahl der Teile aller Figuren */
+#define SHAPE_PARTS ((int) (sizeof(parts) / sizeof(parts[0])))
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Teile der pickbaren Figuren im Objektkoordinatensystem, in der
+ * Reihenfolge, in der drawing.c sie zeichnet.
+ */
+static const ShapePart parts[] =
+  { /* Schwein: Koerper, Beine, Kopf, Augen, Schnauze, Nasenloecher, Schwanz */
+    { DF_PIG,          SHAPE_SPHERE,   {  0.0,    0.0,    0.0    }, { 0.1,    0.1,    0.15   },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_BOX,      {  0.05,  -0.1,    0.075  }, { 0.01,   0.075,  0.015  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_BOX,      { -0.05,  -0.1,    0.075  }, { 0.01,   0.075,  0.015  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_BOX,      {  0.05,  -0.1,   -0.075  }, { 0.01,   0.075,  0.015  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_BOX,      { -0.05,  -0.1,   -0.075  }, { 0.01,   0.075,  0.015  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_SPHERE,   {  0.0,    0.1,    0.1    }, { 0.08,   0.08,   0.08   },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_SPHERE,   {  0.032,  0.14,   0.156  }, { 0.016,  0.016,  0.016  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_SPHERE,   { -0.032,  0.14,   0.156  }, { 0.016,  0.016,  0.016  },   0.0, 0.0 }
+  , { DF_PIG,          SHAPE_CYLINDER, {  0.0,    0.1,    0.172  }, { 0.016,  0.016,  0.016  },  90.0, 1.0 }
+  , { DF_PIG,          SHAPE_CYLINDER, {  0.008,  0.1,    0.1848 }, { 0.0048, 0.0048, 0.0048 },  90.0, 1.0 }
+  , { DF_PIG,          SHAPE_CYLINDER, { -0.008,  0.1,    0.1848 }, { 0.0048, 0.0048, 0.0048 },  90.0, 1.0 }
+  , { DF_PIG,          SHAPE_CYLINDER, {  0.0,    0.0,   -0.16   }, { 0.02,   0.02,   0.02   }, 270.0, 0.0 }
+
+    /* Giraffe: Koerper, Beine */
+  , { DF_GIRAFFE,      SHAPE_SPHERE,   {  0.0,    0.0,    0.0    }, { 0.1,    0.1,    0.15   },   0.0, 0.0 }
+  , { DF_GIRAFFE,      SHAPE_BOX,      {  0.05,  -0.1,    0.075  }, { 0.01,   0.1,    0.015  },   0.0, 0.0 }
+  , { DF_GIRAFFE,      SHAPE_BOX,      { -0.05,  -0.1,    0.075  }, { 0.01,   0.1,    0.015  },   0.0, 0.0 }
+  , { DF_GIRAFFE,      SHAPE_BOX,      {  0.05,  -0.1,   -0.075  }, { 0.01,   0.1,    0.015  },   0.0, 0.0 }
+  , { DF_GIRAFFE,      SHAPE_BOX,      { -0.05,  -0.1,   -0.075  }, { 0.01,   0.1,    0.015  },   0.0, 0.0 }
+
+    /* Giraffenkopf: Hals, Kopf, Augen, Nase */
+  , { DF_GIRAFFE_HEAD, SHAPE_CYLINDER, {  0.0,    0.16,   0.0    }, { 0.016,  0.16,   0.016  },   0.0, 1.0 }
+  , { DF_GIRAFFE_HEAD, SHAPE_SPHERE,   {  0.0,    0.32,   0.0    }, { 0.064,  0.04,   0.08   },  45.0, 0.0 }
+  , { DF_GIRAFFE_HEAD, SHAPE_SPHERE,   {  0.032,  0.368,  0.008  }, { 0.016,  0.016,  0.016  },   0.0, 0.0 }
+  , { DF_GIRAFFE_HEAD, SHAPE_SPHERE,   { -0.032,  0.368,  0.008  }, { 0.016,  0.016,  0.016  },   0.0, 0.0 }
+  , { DF_GIRAFFE_HEAD, SHAPE_SPHERE,   {  0.0,    0.32,   0.056  }, { 0.016,  0.016,  0.008  },   0.0, 0.0 }
+
+    /* Fisch: Koerper, Flossen */
+  , { DF_FISH,         SHAPE_SPHERE,   {  0.0,    0.0,    0.0    }, { 0.1,    0.06,   0.03   },   0.0, 0.0 }
+  , { DF_FISH,         SHAPE_SPHERE,   {  0.06,   0.03,   0.015  }, { 0.02,   0.03,   0.015  },   0.0, 0.0 }
+  , { DF_FISH,         SHAPE_SPHERE,   {  0.06,   0.03,  -0.015  }, { 0.02,   0.03,   0.015  },   0.0, 0.0 }
+  };
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Merkt sich t als naechsten Schnitt, wenn t vor dem bisher naechsten liegt.
+ *
+ * @param[in]     t    Parameter eines Schnitts.
+ * @param[in,out] best Bisher naechster Schnitt, DBL_MAX wenn keiner.
+ */
+static void closer(double t, double * best)
+{
+  if (t >= 0.0 && t < *best)
+    *best = t;
+}
+
+/**
+ * Schneidet den Strahl mit dem Quader [-1, 1]^3 (Slab-Test).
+ *
+ * @param[in]     o    Startpunkt.
+ * @param[in]     d    Richtung.
+ * @param[in,out] best Naechster Schnitt.
+ */
+static void hitUnitBox(const double o[3], const double d[3], double * best)
+{
+  double tMin = 0.0
+       , tMax = DBL_MAX
+       , t1
+       , t2
+       , tmp
+       ;
+
+  int j;
+
+  for (j = 0; j < 3; ++j)
+  {
+    if (fabs(d[j]) < DBL_EPSILON)
+    {
+      if (o[j] < -1.0 || o[j] > 1.0)
+        return;
+    }
+    else
+    {
+      t1 = (-1.0 - o[j]) / d[j];
+      t2 = ( 1.0 - o[j]) / d[j];
+
+      if (t1 > t2)
+      {
+        tmp = t1;
+        t1  = t2;
+        t2  = tmp;
+      }
+
+      if (t1 > tMin)
+        tMin = t1;
+      if (t2 < tMax)
+        tMax = t2;
+
+      if (tMin > tMax)
+        return;
+    }
+  }
+
+  closer(tMin, best);
+}
+
+/**
+ * Schneidet den Strahl mit der Kugel mit Radius 1 um den Ursprung.
+ *
+ * @param[in]     o    Startpunkt.
+ * @param[in]     d    Richtung.
+ * @param[in,out] best Naechster Schnitt.
+ */
+static void hitUnitSphere(const double o[3], const double d[3], double * best)
+{
+  double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2]
+       , b = o[0] * d[0] + o[1] * d[1] + o[2] * d[2]
+       , c = o[0] * o[0] + o[1] * o[1] + o[2] * o[2] - 1.0
+       , disc = b * b - a * c
+       ;
+
+  if (a < DBL_EPSILON || disc < 0.0)
+    return;
+
+  disc = sqrt(disc);
+
+  /* Liegt o in der Kugel, zaehlt der Austritt */
+  closer((- b - disc) / a, best);
+  closer((- b + disc) / a, best);
+}
+
+/**
+ * Schneidet den Strahl mit dem Zylinder entlang y von -1 bis 1, dessen
+ * Radius von 1 unten linear auf top oben uebergeht, samt Deckeln.
+ *
+ * @param[in]     o    Startpunkt.
+ * @param[in]     d    Richtung.
+ * @param[in]     top  Radius oben.
+ * @param[in,out] best Naechster Schnitt.
+ */
+static void hitUnitCylinder(const double o[3], const double d[3], double top, double * best)
+{
+  /* Radius auf Hoehe y: r0 + k * y */
+  double k  = (top - 1.0) * 0.5
+       , r0 = (top + 1.0) * 0.5
+       , ro = r0 + k * o[1]
+       , a  = d[0] * d[0] + d[2] * d[2] - k * k * d[1] * d[1]
+       , b  = o[0] * d[0] + o[2] * d[2] - k * d[1] * ro
+       , c  = o[0] * o[0] + o[2] * o[2] - ro * ro
+       , disc
+       , t
+       , x
+       , y
+       , z
+       , r
+       ;
+
+  int i;
+
+  /* Mantel */
+  if (fabs(a) > DBL_EPSILON && (disc = b * b - a * c) >= 0.0)
+  {
+    disc = sqrt(disc);
+
+    for (i = -1; i <= 1; i += 2)
+    {
+      t = (- b + i * disc) / a;
+      y = o[1] + t * d[1];
+
+      if (y >= -1.0 && y <= 1.0 && r0 + k * y >= 0.0)
+        closer(t, best);
+    }
+  }
+
+  /* Deckel unten (Radius 1) und oben (Radius top) */
+  if (fabs(d[1]) > DBL_EPSILON)
+    for (i = -1; i <= 1; i += 2)
+    {
+      t = (i - o[1]) / d[1];
+      x = o[0] + t * d[0];
+      z = o[2] + t * d[2];
+      r = i < 0 ? 1.0 : top;
+
+      if (x * x + z * z <= r * r)
+        closer(t, best);
+    }
+}
+
+/**
+ * Schneidet den Strahl mit dem Teil p.
+ *
+ * @param[in]     p      Teil.
+ * @param[in]     origin Startpunkt in Objektkoordinaten.
+ * @param[in]     dir    Richtung in Objektkoordinaten.
+ * @param[in,out] best   Naechster Schnitt.
+ */
+static void hitPart(const ShapePart * p, const double origin[3], const double dir[3], double * best)
+{
+  double co = cos(DEGTORAD(p->angle))
+       , si = sin(DEGTORAD(p->angle))
+       , o[3]
+       , d[3]
+       ;
+
+  /* Verschiebung rueckgaengig machen, dann um -angle um x drehen ... */
+  o[0] = origin[0] - p->c[0];
+  o[1] =  co * (origin[1] - p->c[1]) + si * (origin[2] - p->c[2]);
+  o[2] = -si * (origin[1] - p->c[1]) + co * (origin[2] - p->c[2]);
+
+  d[0] = dir[0];
+  d[1] =  co * dir[1] + si * dir[2];
+  d[2] = -si * dir[1] + co * dir[2];
+
+  /* ... und auf die Einheitsfigur skalieren */
+  o[0] /= p->e[0];
+  o[1] /= p->e[1];
+  o[2] /= p->e[2];
+
+  d[0] /= p->e[0];
+  d[1] /= p->e[1];
+  d[2] /= p->e[2];
+
+  switch (p->kind)
+  {
+    case SHAPE_BOX:
+      hitUnitBox(o, d, best);
+      break;
+    case SHAPE_SPHERE:
+      hitUnitSphere(o, d, best);
+      break;
+    case SHAPE_CYLINDER:
+      hitUnitCylinder(o, d, p->top, best);
+      break;
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Gibt an, ob fuer die Zeichenfunktion f eine Form hinterlegt ist.
+ *
+ * @param[in] f Zeichenfunktion.
+ *
+ * @return TRUE  wenn f Teile hat,
+ *         FALSE sonst.
+ */
+extern Boolean shapeKnown(DrawFunctionType f)
+{
+  int i;
+
+  for (i = 0; i < SHAPE_PARTS; ++i)
+    if (parts[i].f == f)
+      return TRUE;
+
+  return FALSE;
+}
+
+/**
+ * Schneidet den Strahl origin + t * dir mit allen Teilen der Figur f.
+ *
+ * @param[in]  f      Zeichenfunktion.
+ * @param[in]  origin Startpunkt in Objektkoordinaten.
+ * @param[in]  dir    Richtung in Objektkoordinaten.
+ * @param[out] t      Naechster Schnitt.
+ *
+ * @return TRUE  wenn ein Teil getroffen wurde,
+ *         FALSE sonst.
+ */
+extern Boolean shapeIntersect(DrawFunctionType f, const double origin[3], const double dir[3], double * t)
+{
+  double best = DBL_MAX;
+
+  int i;
+
+  for (i = 0; i < SHAPE_PARTS; ++i)
+    if (parts[i].f == f)
+      hitPart(parts + i, origin, dir, &best);
+
+  if (best == DBL_MAX)
+    return FALSE;
+
+  *t = best;
+
+  return TRUE;
+}
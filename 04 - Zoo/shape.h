@@ -0,0 +1,42 @@
+#ifndef __SHAPE_H__
+#define __SHAPE_H__
+/**
+ * @file
+ *
+ * Genaue Form der pickbaren Objekte. Jede Zeichenfunktion eines Tieres wird
+ * durch die Kugeln, Quader und Zylinder beschrieben, aus denen drawing.c sie
+ * zusammensetzt, so dass ein Strahl ohne Zeichnen mit der Figur selbst statt
+ * mit ihrem Huellquader geschnitten werden kann.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "types.h"
+
+/**
+ * Gibt an, ob fuer die Zeichenfunktion f eine Form hinterlegt ist.
+ *
+ * @param[in] f Zeichenfunktion.
+ *
+ * @return TRUE  wenn shapeIntersect f genau schneiden kann,
+ *         FALSE sonst.
+ */
+extern Boolean shapeKnown(DrawFunctionType f);
+
+/**
+ * Schneidet den Strahl origin + t * dir (t >= 0) im Objektkoordinatensystem
+ * mit der Form der Zeichenfunktion f.
+ *
+ * @param[in]  f      Zeichenfunktion.
+ * @param[in]  origin Startpunkt des Strahls in Objektkoordinaten.
+ * @param[in]  dir    Richtung des Strahls in Objektkoordinaten, muss nicht
+ *                    normiert sein.
+ * @param[out] t      Parameter des naechsten Schnittpunkts.
+ *
+ * @return TRUE  wenn der Strahl die Form trifft,
+ *         FALSE sonst.
+ */
+extern Boolean shapeIntersect(DrawFunctionType f, const double origin[3], const double dir[3], double * t);
+
+#endif
@@ -2,7 +2,7 @@
  * @file
  * Texturen-Modul.
  * Das Modul kapselt die Textur-Funktionalitaet (insbesondere das Laden und
- * Binden) des Programms.
+ * Binden) des Programms. Alle Texturen liegen als Kacheln im Texturatlas.
  *
  * @author Christopher Blöcker
  * @author Julius Beckmann
@@ -14,6 +14,7 @@
 #include <GL/glu.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -23,10 +24,13 @@
  * Eigene Header einbinden
  * -------------------------------------------------------------------------- */
 #include "texture.h"
+#include "atlas.h"
 #include "cgimage.h"
+#include "textureLoader.h"
+#include "textureCache.h"
 #include "displaylist.h"
 #include "types.h"
-#include "vector.h"
+#include "mipmap.h"
 
 /* ----------------------------------------------------------------------------
  * Typen
@@ -34,27 +38,30 @@
 
 /* Textur */
 typedef struct {
-  unsigned id;
+  AtlasTile tile;
   char * filename;
 } Texture;
 
-/**
- * Bildinformationen : Höhe, Breite
- */
-typedef struct
-{
-  int x
-    , y
-    , w
-    , h;
-} IntRect;
+/** Auftrag: ein Bild drehen, Zeilen unabhängig voneinander */
+typedef struct {
+  const CGImage * in;
+  CGImage * out;
+  long cu       /* Schritt im Quellbild je Zielpixel, Festkomma */
+     , su
+     , offset   /* Versatz der Abtastposition, Festkomma        */
+     ;
+  Boolean bilinear;
+} RotateJob;
 
 /* ----------------------------------------------------------------------------
  * Konstanten
  * -------------------------------------------------------------------------- */
 
-/** Anzahl der Texturen. */
-#define TEXTURE_COUNT (TEXTURE_EMPTY)
+/** Anzahl der Texturen, die leere ist eine weisse Kachel. */
+#define TEXTURE_COUNT (TEXTURE_EMPTY + 1)
+
+/** Mipmaps sRGB-korrekt (im linearen Farbraum) mitteln */
+#define TEXTURE_MIPMAP_SRGB (FALSE)
 
 /** Ausmaße einer selbst berechneten Textur */
 #define TEXTURE_SIZE (256)
@@ -62,6 +69,18 @@ typedef struct
 /** BPP einer selbst berechneten Textur */
 #define TEXTURE_BPP (1)
 
+/**
+ * Gedrehte Texturen bilinear statt per Nearest Neighbor abtasten. Aus, damit
+ * die Kanten der Muster scharf bleiben wie bisher.
+ */
+#define TEXTURE_ROTATE_BILINEAR (FALSE)
+
+/** Nachkommabits der Festkommazahlen beim Drehen */
+#define FIX_SHIFT (16)
+
+/** 1 als Festkommazahl */
+#define FIX_ONE (1L << FIX_SHIFT)
+
 /** Kanalinformationen */
 #define I_MIN (  0)
 #define I_MAX (255)
@@ -70,20 +89,23 @@ typedef struct
  * Macros
  * -------------------------------------------------------------------------- */
 
-/**
- * Pixel an Koordinate x/y von d setzen (Kanal ch)
- */
-#define setPixel(d,bpp,w,x,y,ch,v) ((*((d) + ((bpp) * ((w) * (y) + (x))) + (ch))) = (unsigned char)(v))
+#define PI (3.1415926535897932384626433832795029)
+#define DEGTORAD(x) ((x)*(PI)/(180))
 
 /**
- * Gibt einen Zeiger auf den Wert zurück, der in d an Stelle x/y ist.
+ * Bringt die Festkommakoordinate u nach einem Schritt von höchstens einem
+ * Pixel zurück in [0, period). Ist die Periode eine Zweierpotenz, wird nur
+ * maskiert (mask = period - 1), sonst ist mask 0.
  */
-#define getPixel(d,bpp,w,x,y,ch) ((d) + ((bpp) * ((w) * (y) + (x))) + (ch))
+#define wrapStep(u,period,mask) (((mask) != 0) ? ((u) & (mask)) : ((u) >= (period)) ? ((u) - (period)) : ((u) < 0) ? ((u) + (period)) : (u))
 
 /**
- * Berechnet, ob eine Koordinate innerhalb der Grenzen eines Bildes liegt.
+ * Bringt eine beliebige Festkommakoordinate u in [0, period).
  */
-#define isIn(x,y,bounds) (((x) >= 0) && ((y) >= 0) && ((x) < (bounds.w)) && ((y) < (bounds.h)))
+#define wrapAny(u,period) ((((u) % (period)) + (period)) % (period))
+
+/** Maximum zweier Werte */
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
 
 /* ----------------------------------------------------------------------------
  * Globale Daten
@@ -101,31 +123,6 @@ static Texture textures[TEXTURE_COUNT]; /* Texturen */
  * Static
  * -------------------------------------------------------------------------- */
 
-/**
- * Gibt den Wert des Pixels x/y des Kanals ch in buf zurück.
- * Befindet sich x/y außerhalb des Bildes, so wird periodische Fortsetzung 
- * am Rand des Bildes angenommen. (Thorus-Faltung)
- * @param[in] buf    Speicherbereich, der die Pixelwerte eines Bildes enthält
- * @param[in] bpp    Gibt an, wieviele Bytes pro Pixel verwendet werden
- * @param[in] x      Auszulesende x-Koordinate
- * @param[in] y      Auszulesende y-Koordinate
- * @param[in] bounds Ausmaße des Bildes
- * @param[in] ch     Auszulesender Kanal
- * @return           Wert des Pixels x/y des Kanals ch von buf    wenn x/y im gültigen
- *                                                                Bereich liegt
- *                   periodische Fortsetzung des Randes           sonst
- */
-static unsigned char getPixelPeriodCont(unsigned char * buf, unsigned char bpp, int x, int y, IntRect bounds, unsigned char ch)
-{
-  while (x < 0)
-    x += bounds.w;
-  
-  while (y < 0)
-    y += bounds.h;
-  
-  return *getPixel(buf, bpp, bounds.w, x % bounds.w, y % bounds.h, ch);
-}
-
 /**
  * Initialisiert das Texturen-Array und setzt die Dateinamen der zu ladenden
  * Texturen.
@@ -134,12 +131,10 @@ static int initTextureArray(void)
 {
   int i;
   
-  unsigned texIDs[TEXTURE_COUNT];
-  glGenTextures(TEXTURE_COUNT, texIDs);
-  
   for (i = 0; i < TEXTURE_COUNT; ++i)
   {
-    textures[i].id = texIDs[i];
+    textures[i].tile.page = 0;
+    textures[i].filename  = NULL;
   }
   
   textures[TEXTURE_GRASS].filename   = "textures/grass.png";
@@ -180,192 +175,436 @@ unsigned calculateGLBitmapMode(CGImage * self)
 }
 
 /**
- * Berechnet eine Textur, welche aus schwarzen und weißen Quadraten besteht.
+ * Zählt die Stellen k aus [0, a), für die k % (2 * s) > s gilt, also die
+ * dunklen Stellen eines Musters mit Periode 2 * s.
+ *
+ * @param[in] a Obere Grenze (exklusiv).
+ * @param[in] s Halbe Periode, mindestens 1.
+ *
+ * @return Anzahl der Stellen.
+ */
+static int countDark(int a, int s)
+{
+  return (a / (2 * s)) * (s - 1) + MAX(a % (2 * s) - s - 1, 0);
+}
+
+/**
+ * Zählt die dunklen Stellen im Block [i * n, (i + 1) * n) der ersten Stufe,
+ * der in Stufe log2(n) zu der Stelle i zusammenfällt.
+ *
+ * @param[in] i Stelle in der Stufe.
+ * @param[in] n Kantenlänge des Blocks.
+ * @param[in] s Halbe Periode, mindestens 1.
+ *
+ * @return Anzahl der Stellen aus [0, n].
+ */
+static int countDarkBlock(int i, int n, int s)
+{
+  return countDark((i + 1) * n, s) - countDark(i * n, s);
+}
+
+/**
+ * Bestimmt die halbe Periode der selbst berechneten Muster für die
+ * Kantenlänge size. Gewünscht sind 2^textureSize Quadrate über die ganze
+ * Kante, wie bei TEXTURE_SIZE. Genommen wird die nächstgelegene halbe
+ * Periode s, für die 2 * s die Kantenlänge teilt, sonst liefe das Muster
+ * beim Drehen nicht nahtlos um.
+ *
+ * @param[in] size Kantenlänge der ersten Stufe.
+ *
+ * @return Halbe Periode, mindestens 1.
+ */
+static int halfPeriod(int size)
+{
+  double ideal = (double) size / (1 << textureSize);
+  
+  int s
+    , best = 1
+    ;
+  
+  for (s = 1; 2 * s <= size; ++s)
+    if (size % (2 * s) == 0 && fabs(s - ideal) <= fabs(best - ideal))
+      best = s;
+  
+  return best;
+}
+
+/**
+ * Berechnet die Stufe level einer Textur, welche aus schwarzen und weißen
+ * Quadraten besteht. Jeder Pixel ist der exakte Mittelwert des
+ * 2^level x 2^level Blocks der ersten Stufe, der aus den dunklen Anteilen
+ * seiner Spalte und Zeile geschlossen berechnet wird. Zeilen mit gleichem
+ * Anteil werden nur kopiert.
+ *
+ * @param[in] size  Kantenlänge der ersten Stufe.
+ * @param[in] level Stufe.
  *
  * @return Zeiger auf eine Textur, welche aus Quadraten besteht.
  */
-static CGImage * calcSquares(void)
+static CGImage * calcSquares(int size, int level)
 {
-  int x   /* Pixel -     */
-    , y   /* Koordinaten */
-    , ch  /* Kanal       */
-    , v   /* Pixelwert   */
-    , s = (int) (TEXTURE_SIZE / pow(2, textureSize))
+  int x   /* Pixel -                        */
+    , y   /* Koordinaten                    */
+    , cy  /* Dunkler Anteil der Zeile       */
+    , last = -1                /* Anteil der vorigen Zeile */
+    , n    = 1 << level        /* Blockgröße               */
+    , w    = size >> level     /* Kantenlänge der Stufe    */
+    , s    = halfPeriod(size)
     ;
   
+  int * cx;          /* Dunkler Anteil je Spalte */
+  unsigned char * row;
+  
   CGImage * squares;
   
   /* Initialisieren */
-  squares = CGImage_create(TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_BPP);
+  squares = CGImage_create(w, w, TEXTURE_BPP);
+  cx      = malloc(w * sizeof(int));
   
-  for (y = 0; y < TEXTURE_SIZE; ++y)
+  if (squares == NULL || cx == NULL)
   {
-    for (x = 0; x < TEXTURE_SIZE; ++x)
-    {
-      for (ch = 0; ch < TEXTURE_BPP; ++ch)
-      {
-        /* Farbe bestimmen */
-        v = ((x % (2 * s) > s) == (y % (2 * s) > s))
-          ? I_MAX
-          : I_MIN
-          ;
-        
-        /* setzen */
-        setPixel(squares->data, TEXTURE_BPP, TEXTURE_SIZE, x, y, ch, v);
-      }
-    }
+    CGImage_free(squares);
+    free(cx);
+    return NULL;
   }
   
+  for (x = 0; x < w; ++x)
+    cx[x] = countDarkBlock(x, n, s);
+  
+  for (y = 0; y < w; ++y)
+  {
+    row = CGImage_row(squares, y);
+    cy  = countDarkBlock(y, n, s);
+    
+    /* Gleiche Zeile wie zuvor */
+    if (cy == last)
+      memcpy(row, row - squares->stride, w * TEXTURE_BPP);
+    
+    /* Hell, wo Spalte und Zeile beide dunkel oder beide hell sind */
+    else
+      for (x = 0; x < w; ++x)
+        memset(row + x * TEXTURE_BPP
+             , (I_MAX * (cx[x] * cy + (n - cx[x]) * (n - cy)) + n * n / 2) / (n * n)
+             , TEXTURE_BPP);
+    
+    last = cy;
+  }
+  
+  free(cx);
+  
   return squares;
 }
 
 /**
- * Berechnet eine Textur, welche aus vertikalen schwarzen und weißen Streifen
- * besteht.
+ * Berechnet die Stufe level einer Textur, welche aus vertikalen schwarzen
+ * und weißen Streifen besteht. Jede Zeile hat einen einzigen Wert, den
+ * Mittelwert der zusammengefassten Zeilen der ersten Stufe.
+ *
+ * @param[in] size  Kantenlänge der ersten Stufe.
+ * @param[in] level Stufe.
  *
  * @return Zeiger auf eine Textur, welche aus Streifen besteht.
  */
-static CGImage * calcStripes(void)
+static CGImage * calcStripes(int size, int level)
 {
-  int x   /* Pixel -     */
-    , y   /* Koordinaten */
-    , ch  /* Kanal       */
-    , v   /* Pixelwert   */
-    , s = (int) (TEXTURE_SIZE / pow(2, textureSize))
+  int y   /* Zeile                 */
+    , n = 1 << level    /* Blockgröße            */
+    , w = size >> level /* Kantenlänge der Stufe */
+    , s = halfPeriod(size)
     ;
   
   CGImage * stripes;
   
   /* Initialisieren */
-  stripes = CGImage_create(TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_BPP);
+  stripes = CGImage_create(w, w, TEXTURE_BPP);
+  
+  if (stripes == NULL)
+    return NULL;
   
   /* Streifen */
-  for (y = 0; y < TEXTURE_SIZE; ++y)
+  for (y = 0; y < w; ++y)
+    memset( CGImage_row(stripes, y)
+          , (I_MAX * (n - countDarkBlock(y, n, s)) + n / 2) / n
+          , w * TEXTURE_BPP);
+  
+  return stripes;
+}
+
+/**
+ * Berechnet die Zeilen [y0, y1) eines gedrehten Bildes. Die Abtastposition
+ * im Quellbild wird nur am Zeilenanfang bestimmt und dann je Pixel um
+ * (cos, sin) weitergeschoben, periodisch fortgesetzt am Rand des Bildes.
+ *
+ * @param[in] data Zeiger auf einen RotateJob.
+ * @param[in] y0   Erste Zeile.
+ * @param[in] y1   Zeile hinter der letzten.
+ */
+static void rotateRows(const void * data, int y0, int y1)
+{
+  const RotateJob * job = data;
+  const CGImage   * in  = job->in;
+
+  int x   /* Pixel -                        */
+    , y   /* Koordinaten                    */
+    , ch  /* Kanal                          */
+    , i0  /* Abgetastete Spalten            */
+    , i1
+    , fx  /* Nachkommaanteile, 8 Bit        */
+    , fy
+    , w   = in->width
+    , h   = in->height
+    , bpp = in->bpp
+    ;
+
+  long pu = (long) w << FIX_SHIFT  /* Perioden */
+     , pv = (long) h << FIX_SHIFT
+     , mu = (w & (w - 1)) == 0 ? pu - 1 : 0
+     , mv = (h & (h - 1)) == 0 ? pv - 1 : 0
+     , u
+     , v
+     ;
+
+  const unsigned char * r0
+                    , * r1
+                    ;
+
+  unsigned char * dst;
+
+  for (y = y0; y < y1; ++y)
   {
-    for (x = 0; x < TEXTURE_SIZE; ++x)
+    u   = wrapAny(job->offset - job->su * y, pu);
+    v   = wrapAny(job->offset + job->cu * y, pv);
+    dst = CGImage_row(job->out, y);
+
+    for (x = 0; x < w; ++x, dst += bpp)
     {
-      for (ch = 0; ch < TEXTURE_BPP; ++ch)
+      i0 = (int) (u >> FIX_SHIFT);
+      r0 = CGImage_row(in, v >> FIX_SHIFT);
+
+      if (!job->bilinear)
+        memcpy(dst, r0 + i0 * bpp, bpp);
+
+      else
       {
-        /* Farbe bestimmen */
-        v = (y % (2 * s) <= s)
-          ? I_MAX
-          : I_MIN
-          ;
-        
-        /* setzen */
-        setPixel(stripes->data, TEXTURE_BPP, TEXTURE_SIZE, x, y, ch, v);
+        i1 = i0 + 1 < w ? i0 + 1 : 0;
+        r1 = (v >> FIX_SHIFT) + 1 < h ? r0 + in->stride : in->data;
+        fx = (int) (u & (FIX_ONE - 1)) >> (FIX_SHIFT - 8);
+        fy = (int) (v & (FIX_ONE - 1)) >> (FIX_SHIFT - 8);
+
+        i0 *= bpp;
+        i1 *= bpp;
+
+        for (ch = 0; ch < bpp; ++ch)
+          dst[ch] = (unsigned char)
+            ( ( (r0[i0 + ch] * (256 - fx) + r0[i1 + ch] * fx) * (256 - fy)
+              + (r1[i0 + ch] * (256 - fx) + r1[i1 + ch] * fx) * fy
+              + (1L << 15)) >> 16);
       }
+
+      u = wrapStep(u + job->cu, pu, mu);
+      v = wrapStep(v + job->su, pv, mv);
     }
   }
-  
-  return stripes;
 }
 
 /**
  * Berechnet eine Textur, welche aus der Drehung um angle aus in entsteht.
- * Hierbei wird Inverse-Mapping mit Nearest Neighbor und 
- * periodischer Bildfortsetzung verwendet.
+ * Hierbei wird Inverse-Mapping mit periodischer Bildfortsetzung verwendet,
+ * abgetastet wird per Nearest Neighbor oder bilinear. Die Zeilen werden auf
+ * mehrere Threads verteilt.
  *
- * @param[in] in    Zeiger auf Textur, die um angle gedreht werden soll.
- * @param[in] angle Drehwinkel.
+ * @param[in] in       Zeiger auf Textur, die um angle gedreht werden soll.
+ * @param[in] angle    Drehwinkel.
+ * @param[in] bilinear TRUE, wenn bilinear abgetastet werden soll.
  *
  * @return Zeiger auf die Textur, die durch die Drehung um angle aus in entsteht.
  */
-static CGImage * textureRotate(CGImage * in, unsigned angle)
+static CGImage * textureRotate(const CGImage * in, unsigned angle, Boolean bilinear)
 {
-  int x   /* Pixel -     */
-    , y   /* Koordinaten */
-    , ch  /* Kanal       */
-    , v   /* Pixelwert   */
-    ;
-  
-  /* Bildgrenzen */
-  IntRect bounds = {0, 0, TEXTURE_SIZE, TEXTURE_SIZE};
-  
-  Vector3d u;
-  
+  RotateJob job;
+
+  double a = DEGTORAD(360 - angle);
+
   /* Initialisieren */
-  CGImage * out = CGImage_create(TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_BPP);
-  
-  for (y = 0; y < TEXTURE_SIZE; ++y)
+  CGImage * out = CGImage_create(in->width, in->height, in->bpp);
+
+  if (out == NULL)
+    return NULL;
+
+  job.in       = in;
+  job.out      = out;
+  job.cu       = (long) floor(cos(a) * FIX_ONE + 0.5);
+  job.su       = (long) floor(sin(a) * FIX_ONE + 0.5);
+  job.bilinear = bilinear;
+
+  /* Nearest Neighbor rundet auf das nächste Pixel */
+  job.offset   = bilinear ? 0 : FIX_ONE / 2;
+
+  mipmapParallelRows(rotateRows, &job, out->height);
+
+  return out;
+}
+
+/**
+ * Platziert eine Kachel für ein Bild der Größe width x height im Atlas,
+ * falls die Textur t noch keine hat.
+ *
+ * @param[in] t      Textur.
+ * @param[in] width  Breite des Bildes.
+ * @param[in] height Höhe des Bildes.
+ *
+ * @return 1 wenn t eine Kachel hat
+ *         0 sonst.
+ */
+static int placeTexture(Texture * t, int width, int height)
+{
+  GLsizei tileWidth
+        , tileHeight
+        ;
+
+  if (t->tile.page == 0)
   {
-    for (x = 0; x < TEXTURE_SIZE; ++x)
-    {
-      for (ch = 0; ch < TEXTURE_BPP; ++ch)
-      {
-        /* Bildkoordinate im Quellbild berechnen */
-        u = vectorRotateZ(vectorMake(x, y, 0), 360 - angle);
-        
-        /* Aus dem Quellbild mittels NN und periodischer Fortsetzung auslesen */
-        v = getPixelPeriodCont(in->data, TEXTURE_BPP, (int) (u.x + 0.5), (int) (u.y + 0.5), bounds, ch);
-        
-        /* Im Zielbild setzen */
-        setPixel(out->data, TEXTURE_BPP, TEXTURE_SIZE, x, y, ch, v);
-      }
-    }
+    atlasTileSize(width, height, &tileWidth, &tileHeight);
+
+    if (!atlasPlace(tileWidth, tileHeight, &t->tile))
+      return 0;
   }
-  
-  return out;
+
+  return 1;
 }
 
 /**
- * Berechnet Texturen für die Giraffe.
+ * Lädt das Bild image in die Kachel der Textur t hoch. Hat t noch keine
+ * Kachel, wird zuerst eine passende im Atlas platziert.
+ *
+ * @param[in]  t      Textur.
+ * @param[in]  image  Bild.
+ * @param[out] levels Wenn nicht NULL: die hochgeladenen Stufen für den
+ *                    Cache, mit free freizugeben.
+ *
+ * @return 1 wenn das Hochladen erfolgreich war
+ *         0 sonst.
  */
-static void calcTextures(void)
+static int uploadTexture(Texture * t, CGImage * image, unsigned char ** levels)
+{
+  if (!placeTexture(t, image->width, image->height))
+    return 0;
+
+  return atlasUpload(&t->tile, image, calculateGLBitmapMode(image), TEXTURE_MIPMAP_SRGB, levels);
+}
+
+/**
+ * Platziert die Kachel eines Cache-Eintrags für die Textur user im Atlas.
+ * Einträge mit anderer Stufenzahl (etwa aus der Zeit vor dem Atlas) passen
+ * nicht.
+ *
+ * @param[in]  user   Zeiger auf die Textur.
+ * @param[in]  width  Breite der Kachel.
+ * @param[in]  height Höhe der Kachel.
+ * @param[in]  levels Stufen des Eintrags.
+ * @param[out] x      Linke Kante der Kachel.
+ * @param[out] y      Obere Kante der Kachel.
+ *
+ * @return TRUE  wenn die Kachel platziert wurde
+ *         FALSE sonst.
+ */
+static Boolean placeCachedTexture(void * user, GLsizei width, GLsizei height, GLint levels, GLint * x, GLint * y)
 {
-  CGImage * squares = calcSquares() /* Quadratmuster  */
-        , * stripes = calcStripes() /* Streifenmuster */
+  Texture * t = user;
+
+  if (levels != ATLAS_LEVELS || !atlasPlace(width, height, &t->tile))
+    return FALSE;
+
+  *x = t->tile.x;
+  *y = t->tile.y;
+
+  return TRUE;
+}
+
+/**
+ * Berechnet die leere Textur: eine weiße Kachel, die mit GL_MODULATE die
+ * Materialfarbe unverändert lässt.
+ *
+ * @return 1 wenn die Kachel hochgeladen wurde
+ *         0 sonst.
+ */
+static int calcEmpty(void)
+{
+  int success = 0;
+
+  CGImage * white = CGImage_create(1, 1, 1);
+
+  if (white != NULL)
+  {
+    *white->data = I_MAX;
+
+    success = uploadTexture(&textures[TEXTURE_EMPTY], white, NULL);
+
+    CGImage_free(white);
+  }
+
+  return success;
+}
+
+/**
+ * Berechnet alle Stufen des Musters pattern, dreht jede um 45 Grad und lädt
+ * sie ungefiltert in die Kachel der Textur t, die beim Neuberechnen
+ * dieselbe bleibt.
+ *
+ * @param[in] t       Textur.
+ * @param[in] pattern Erzeugt die Stufe eines Musters.
+ */
+static void calcTexture(Texture * t, CGImage * (* pattern)(int, int))
+{
+  CGImage * levels[ATLAS_LEVELS]
         , * tex
         ;
-  
+
+  GLsizei width
+        , height
+        ;
+
+  int level;
+
+  if (!placeTexture(t, TEXTURE_SIZE, TEXTURE_SIZE))
+    return;
+
+  /* Muster direkt in der Größe des Kachelinneren, nichts wird skaliert.
+   * halfPeriod passt die Periode so an, dass sie das Innere teilt */
+  atlasTileInterior(&t->tile, &width, &height);
+
+  for (level = 0; level < ATLAS_LEVELS; ++level)
+  {
+    tex           = pattern(width, level);
+    levels[level] = tex != NULL ? textureRotate(tex, 45, TEXTURE_ROTATE_BILINEAR) : NULL;
+
+    CGImage_free(tex);
+  }
+
+  for (level = 0; level < ATLAS_LEVELS && levels[level] != NULL; ++level)
+    ;
+
+  if (level == ATLAS_LEVELS)
+    atlasUploadLevels(&t->tile, (const CGImage * const *) levels, GL_LUMINANCE);
+
+  for (level = 0; level < ATLAS_LEVELS; ++level)
+    CGImage_free(levels[level]);
+}
+
+/**
+ * Berechnet Texturen für die Giraffe.
+ */
+static void calcTextures(void)
+{
   #ifdef DEBUG
   fprintf(stderr, "DEBUG :: Calculating Textures.\n");
   #endif
   
   /* Karos */
-  tex = textureRotate(squares, 45);
-  
-  glBindTexture(GL_TEXTURE_2D, textures[TEXTURE_OWN_1].id);
-  gluBuild2DMipmaps( GL_TEXTURE_2D
-                   , tex->bpp
-                   , tex->width
-                   , tex->height
-                   , calculateGLBitmapMode(tex)
-                   , GL_UNSIGNED_BYTE
-                   , tex->data);
-  
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  
-  /* Rotierte löschen */
-  CGImage_free(tex);
-  
+  calcTexture(&textures[TEXTURE_OWN_1], calcSquares);
   
   /* Streifen */
-  tex = textureRotate(stripes, 45);
-  
-  glBindTexture(GL_TEXTURE_2D, textures[TEXTURE_OWN_2].id);  
-  gluBuild2DMipmaps( GL_TEXTURE_2D
-                   , tex->bpp
-                   , tex->width
-                   , tex->height
-                   , calculateGLBitmapMode(tex)
-                   , GL_UNSIGNED_BYTE
-                   , tex->data);
-  
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  
-  /* Rotierte löschen */
-  CGImage_free(tex);
-  
-  /* Texturen löschen */
-  CGImage_free(squares);
-  CGImage_free(stripes);
+  calcTexture(&textures[TEXTURE_OWN_2], calcStripes);
 }
 
 /* ----------------------------------------------------------------------------
@@ -376,7 +615,8 @@ static void calcTextures(void)
 
 /**
  * Bindet die Textur texture, so dass sie fuer alle nachfolgende gezeichneten
- * Primitiven verwendet wird.
+ * Primitiven verwendet wird. Die Atlas-Seite wird nur gebunden, wenn sie
+ * wechselt, ansonsten wird nur die Texturmatrix auf die Kachel gesetzt.
  *
  * @param texture Bezeichner der Textur, die gebunden werden soll.
  */
@@ -384,11 +624,11 @@ extern void bindTexture(TextureName t)
 {
   /* Der Giraffe evtl. die selbst berechneten Texturen verpassen */
   if (t == TEXTURE_GIRAFFE && useTexture != 0)
-    glBindTexture(GL_TEXTURE_2D, textures[TEXTURE_OWN_1 + useTexture - 1].id);
+    atlasBind(&textures[TEXTURE_OWN_1 + useTexture - 1].tile);
   
   /* Allen anderen die normale Textur */
   else
-    glBindTexture(GL_TEXTURE_2D, textures[t].id);
+    atlasBind(&textures[t].tile);
 }
 
 /**
@@ -399,47 +639,72 @@ extern void bindTexture(TextureName t)
  */
 extern int loadTextures(void)
 {
-  int i;
-  
-  CGImage * image = NULL;
+  int i
+    , count   = 0
+    , success = 1
+    ;
+
+  char * filenames[TEXTURE_SUN + 1]; /* Nicht im Cache gefundene Texturen */
+
+  int missing[TEXTURE_SUN + 1];      /* Zugehoerige Texturindizes        */
+
+  TextureLoaderResult result;
+
+  unsigned char * levels;
 
   if (initTextureArray())
   {
-    /* Alle Texturen nacheinander laden. */
-    for (i = 0; i <= TEXTURE_SUN; ++i)
+    /* Zuerst im Cache nachsehen, ... */
+    for (i = 0; i < TEXTURE_SUN + 1; ++i)
     {
+      if (!textureCacheLoadTile(textures[i].filename, placeCachedTexture, &textures[i]))
+      {
+        filenames[count] = textures[i].filename;
+        missing[count++] = i;
+      }
+    }
+
+    /* ... den Rest parallel dekodieren ... */
+    if (count > 0 && !textureLoaderStart(filenames, count))
+      return 0;
+
+    /* ... in der Reihenfolge der Fertigstellung hochladen und cachen. */
+    while (count > 0 && textureLoaderNext(&result))
+    {
+      i = missing[result.index];
+
       #ifdef DEBUG
-      fprintf(stderr, "DEBUG :: Loading %s.\n", textures[i].filename);
+      fprintf(stderr, "DEBUG :: Loaded %s.\n", textures[i].filename);
       #endif
-      
-      image = CGImage_load(textures[i].filename);
 
-      if (image != NULL)
-      {
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        
-        gluBuild2DMipmaps( GL_TEXTURE_2D
-                         , image->bpp
-                         , image->width
-                         , image->height
-                         , calculateGLBitmapMode(image)
-                         , GL_UNSIGNED_BYTE
-                         , image->data);
-        
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        
-        CGImage_free(image);
-      }
+      levels = NULL;
+
+      /* Gecacht werden die eben hochgeladenen Stufen, ohne Zurücklesen */
+      if (result.image != NULL && uploadTexture(&textures[i], result.image, &levels))
+        textureCacheStoreTile( textures[i].filename
+                             , result.image->bpp
+                             , calculateGLBitmapMode(result.image)
+                             , textures[i].tile.width
+                             , textures[i].tile.height
+                             , ATLAS_LEVELS
+                             , levels);
       else
-        return 0;
+        success = 0;
+
+      free(levels);
+      CGImage_free(result.image);
     }
-    
-    calcTextures();
-    
-    return 1;
+
+    if (count > 0)
+      textureLoaderFinish();
+
+    if (success)
+      success = calcEmpty();
+
+    if (success)
+      calcTextures();
+
+    return success;
   }
   else
     return 0;
@@ -498,7 +763,7 @@ extern void textureSetSize(int i)
   /* toBounds */
   if (textureSize < 0)
     textureSize = 0;
-  else if (pow(2, textureSize) > TEXTURE_SIZE)
+  else if ((1 << textureSize) > TEXTURE_SIZE)
     textureSize = (int) (log(TEXTURE_SIZE) / log(2));
   
   #ifdef DEBUG
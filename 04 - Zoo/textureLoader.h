@@ -0,0 +1,51 @@
+#ifndef __TEXTURELOADER_H__
+#define __TEXTURELOADER_H__
+/**
+ * @file
+ *
+ * Das Modul dekodiert Bilddateien parallel auf mehreren Threads.
+ * Die fertigen Bilder werden ueber eine Warteschlange an den GL-Thread
+ * uebergeben, der sie dann hochladen kann.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+#include "cgimage.h"
+
+/** Ein fertig dekodiertes Bild. */
+typedef struct {
+  int index;       /* Index der Datei beim Start des Ladens  */
+  CGImage * image; /* Dekodiertes Bild, NULL bei einem Fehler */
+} TextureLoaderResult;
+
+/**
+ * Startet das Dekodieren der count Dateien filenames.
+ * Es kann immer nur ein Ladevorgang gleichzeitig laufen.
+ *
+ * @param[in] filenames Namen der zu ladenden Dateien.
+ * @param[in] count     Anzahl der Dateien.
+ *
+ * @return 1 wenn das Laden gestartet wurde
+ *         0 sonst.
+ */
+extern int textureLoaderStart(char ** filenames, int count);
+
+/**
+ * Wartet auf das naechste fertig dekodierte Bild und gibt es in result
+ * zurueck. Die Reihenfolge entspricht der Fertigstellung, nicht der Reihenfolge
+ * der Dateinamen. Das Bild gehoert danach dem Aufrufer.
+ *
+ * @param[out] result Fertiges Bild.
+ *
+ * @return 1 wenn ein Bild geliefert wurde
+ *         0 wenn alle Bilder abgeholt wurden.
+ */
+extern int textureLoaderNext(TextureLoaderResult * result);
+
+/**
+ * Beendet den Ladevorgang, wartet auf alle Threads und gibt nicht abgeholte
+ * Bilder frei.
+ */
+extern void textureLoaderFinish(void);
+
+#endif
@@ -72,9 +72,6 @@ static void drawSquare(TextureName t)
       }
     glEnd();
   }
-  
-  /* Danach leere Textur verwenden */
-  bindTexture(TEXTURE_EMPTY);
 }
 
 /**
@@ -100,8 +97,6 @@ static void drawCylinder1(double proportion, TextureName t)
     gluCylinder(q, 1.0, proportion, 2.0, subdivides + 3, subdivides + 3);
   glPopMatrix();
   
-  bindTexture(TEXTURE_EMPTY);
-  
   gluDeleteQuadric(q);
 }
 
@@ -193,7 +188,6 @@ extern void drawSphere(TextureName t)
   
   bindTexture(t);
   gluSphere(q, 1.0, subdivides + 3, subdivides + 3);
-  bindTexture(TEXTURE_EMPTY);
   
   gluDeleteQuadric(q);
 }
@@ -3,11 +3,36 @@
 #include <cgimage/error.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <config.h>
 
+/* round up to a multiple of CG_IMAGE_ALIGNMENT */
+#define ALIGN(n) \
+    (((n) + (CG_IMAGE_ALIGNMENT - 1)) & ~(size_t)(CG_IMAGE_ALIGNMENT - 1))
+
+/* allocate an aligned, zeroed pixel buffer, returns zero on failure */
+static int CGImage_allocate(
+    CGImage* self,
+    unsigned int width,
+    unsigned int height,
+    unsigned int bpp
+) {
+    self->width  = width;
+    self->height = height;
+    self->bpp    = bpp;
+    self->stride = ALIGN(width * bpp);
+
+    self->memory = calloc(1, (size_t)self->stride * height + CG_IMAGE_ALIGNMENT);
+    self->data   = self->memory
+        ? (unsigned char*)ALIGN((size_t)self->memory)
+        : NULL;
+
+    return self->memory != NULL;
+}
+
 CGImage* CGImage_create(
     unsigned int width,
     unsigned int height,
@@ -27,123 +52,151 @@ void CGImage_init(
     unsigned int height,
     unsigned int bpp
 ) {
-    self->width = width;
-    self->height = height;
-    self->bpp = bpp;
+    int allocated = CGImage_allocate(self, width, height, bpp);
+
+    cg_assert(allocated);
+    (void)allocated;
+}
+
+CGImage* CGImage_view(
+    const CGImage* parent,
+    int x, int y,
+    unsigned int w, unsigned int h
+) {
+    CGImage* self = malloc(sizeof(CGImage));
 
-    self->data = calloc(width * height, bpp);
-    cg_assert(self->data != NULL);
+    if (self)
+        CGImage_initView(self, parent, x, y, w, h);
+
+    return self;
 }
 
-void CGImage_copy(
+void CGImage_initView(
     CGImage* self,
+    const CGImage* parent,
     int x, int y,
-    unsigned int w, unsigned int h,
-    CGImage* dst,
-    int dst_x, int dst_y
+    unsigned int w, unsigned int h
 ) {
-    unsigned int r, c, b, bpp;
-
-    if (
-        (w == 0) || (h == 0)
-         || ((x >= 0) && ((unsigned int)x >= self->width))
-         || ((x < 0) && ((unsigned int)-x >= w))
-         || ((y >= 0) && ((unsigned int)y >= self->height))
-         || ((y < 0) && ((unsigned int)-y >= h))
-         || ((dst_x >= 0) && ((unsigned int)dst_x >= dst->width))
-         || ((dst_x < 0) && ((unsigned int)-dst_x >= w))
-         || ((dst_y >= 0) && ((unsigned int)dst_y >= dst->height))
-         || ((dst_y < 0) && ((unsigned int)-dst_y >= h))
-    )
-        return;
-
-    /* clip on source image */
-    if (x < 0) {
-        w     += x;
-        dst_x -= x;
-        x      = 0;
-    }
+    long x0 = x, y0 = y, x1 = (long)x + (long)w, y1 = (long)y + (long)h;
+
+    /* clip on parent */
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > (long)parent->width)  x1 = parent->width;
+    if (y1 > (long)parent->height) y1 = parent->height;
+    if (x1 < x0) x1 = x0;
+    if (y1 < y0) y1 = y0;
+
+    self->width  = x1 - x0;
+    self->height = y1 - y0;
+    self->bpp    = parent->bpp;
+    self->stride = parent->stride;
+    self->memory = NULL;
+    self->data   = CGImage_pixel(parent, x0, y0);
+}
 
-    if (y < 0) {
-        h     += y;
-        dst_y -= y;
-        y      = 0;
-    }
+void CGImage_done(CGImage* self) {
+    free(self->memory);
 
-    if ((x + w) > self->width)
-        w = self->width - x;
+    self->memory = NULL;
+    self->data   = NULL;
+}
 
-    if ((y + h) > self->height)
-        h = self->height - y;
+void CGImage_free(CGImage* self) {
+    if (self)
+        free(self->memory);
 
-    /* clip on destination image */
-    if (dst_x < 0) {
-        x     -= dst_x;
-        w     += dst_x;
-        dst_x  = 0;
-    }
+    free(self);
+}
 
-    if (dst_y < 0) {
-        y     -= dst_y;
-        w     += dst_y;
-        dst_y  = 0;
-    }
+int CGImage_isPacked(const CGImage* self) {
+    return (self->stride == self->width * self->bpp) || (self->height <= 1);
+}
 
-    if ((dst_x + w) >= dst->width)
-        w = dst->width - dst_x;
+int CGImage_unpackLayout(
+    const CGImage* self,
+    int* row_length,
+    int* alignment
+) {
+    unsigned int row_size, a;
 
-    if ((dst_y + h) >= dst->height)
-        h = dst->height - dst_y;
+    if (self->bpp == 0)
+        return 0;
 
-    /* copy that data */
-    bpp = self->bpp < dst->bpp ? self->bpp : dst->bpp;
+    *row_length = self->stride / self->bpp;
+    row_size    = *row_length * self->bpp;
 
-    for (r = 0; r < h; ++r) {
-        for (c = 0; c < w; ++c) {
-            for (b = 0; b < bpp; ++b) {
-                dst->data[((dst_y + r) * dst->width + (dst_x + c)) * dst->bpp + b] =
-                        self->data[((y + r) * self->width + (x + c)) * self->bpp + b];
-            }
+    /* GL rounds row_length * bpp up to a multiple of the alignment */
+    for (a = 8; a > 0; a /= 2) {
+        if ((row_size + a - 1) / a * a == self->stride) {
+            *alignment = a;
+            return 1;
         }
     }
+
+    return 0;
 }
 
-void CGImage_mirrorX(CGImage* self) {
-    unsigned char* tmp;
-    unsigned int x, y;
+typedef struct {
+    const char* filename;
+    CGImage* image;
+} CGImageLoadState;
 
-    tmp = malloc(self->bpp);
+static int CGImage_loadHeader(
+    void* user,
+    unsigned int width,
+    unsigned int height,
+    unsigned int bpp
+) {
+    CGImageLoadState* state = user;
 
-    for (y = 0; y < self->height; ++y) {
-        for (x = 0; x < self->width / 2; ++x) {
-            memcpy(tmp, self->data + (y * self->width + x) * self->bpp, self->bpp);
-            memcpy(self->data + (y * self->width + x) * self->bpp, self->data + (y * self->width + (self->width - x - 1)) * self->bpp, self->bpp);
-            memcpy(self->data + (y * self->width + (self->width - x - 1)) * self->bpp, tmp, self->bpp);
-        }
+    /* rows are addressed with unsigned int offsets */
+    if ((width == 0) || (height == 0) || (bpp == 0)
+        || (width > (UINT_MAX - CG_IMAGE_ALIGNMENT) / bpp)
+        || (ALIGN(width * bpp) > UINT_MAX / height)) {
+        CGError_reportFormat(
+            __FILE__, "CGImage_loadStream", __LINE__,
+            "%s: invalid image size %ux%ux%u", state->filename, width, height, bpp
+        );
+        return -1;
     }
-}
-
-void CGImage_mirrorY(CGImage* self) {
-    unsigned char* tmp;
-    unsigned int tmp_size, y;
 
-    tmp_size = self->width * self->bpp;
-    tmp = malloc(tmp_size);
+    /* not CGImage_create, which asserts the allocation succeeds */
+    if ((state->image = malloc(sizeof(CGImage)))
+        && !CGImage_allocate(state->image, width, height, bpp)) {
+        free(state->image);
+        state->image = NULL;
+    }
 
-    for (y = 0; y < self->height / 2; ++y) {
-        memcpy(tmp, self->data + y * tmp_size, tmp_size);
-        memcpy(self->data + y * tmp_size, self->data + (self->height - y - 1) * tmp_size, tmp_size);
-        memcpy(self->data + (self->height - y - 1) * tmp_size, tmp, tmp_size);
+    if (!state->image) {
+        CGError_reportFormat(
+            __FILE__, "CGImage_loadStream", __LINE__,
+            "%s: %s", state->filename, strerror(ENOMEM)
+        );
+        return -1;
     }
 
-    free(tmp);
+    return 0;
 }
 
-void CGImage_free(CGImage* self) {
-    if (self)
-        free(self->data);
+static int CGImage_loadRows(
+    void* user,
+    unsigned int first,
+    unsigned int count,
+    const unsigned char* data
+) {
+    CGImage* image = ((CGImageLoadState*)user)->image;
+    unsigned int row_size = image->width * image->bpp;
 
-    free(self);
+    if (CGImage_isPacked(image)) {
+        memcpy(CGImage_row(image, first), data, count * row_size);
+
+    } else {
+        for (; count > 0; --count, ++first, data += row_size)
+            memcpy(CGImage_row(image, first), data, row_size);
+    }
+
+    return 0;
 }
 
 CGImage* CGImage_load(const char* filename) {
@@ -165,11 +218,30 @@ CGImage* CGImage_load(const char* filename) {
     return image;
 }
 
-CGImage* CGImage_loadBMP(const char* filename, FILE* stream);
-CGImage* CGImage_loadPCX(const char* filename, FILE* stream);
-CGImage* CGImage_loadPNG(const char* filename, FILE* stream);
-CGImage* CGImage_loadPPM(const char* filename, FILE* stream);
-CGImage* CGImage_loadTGA(const char* filename, FILE* stream);
+CGImage* CGImage_loadStream(const char* filename, FILE* stream) {
+    CGImageLoadState state;
+    CGImageReader reader;
+
+    state.filename = filename;
+    state.image    = NULL;
+
+    reader.header = CGImage_loadHeader;
+    reader.rows   = CGImage_loadRows;
+    reader.user   = &state;
+
+    if (CGImage_readStream(filename, stream, &reader) != 0) {
+        CGImage_free(state.image);
+        return NULL;
+    }
+
+    return state.image;
+}
+
+int CGImage_readBMP(const char* filename, FILE* stream, const CGImageReader* reader);
+int CGImage_readPCX(const char* filename, FILE* stream, const CGImageReader* reader);
+int CGImage_readPNG(const char* filename, FILE* stream, const CGImageReader* reader);
+int CGImage_readPPM(const char* filename, FILE* stream, const CGImageReader* reader);
+int CGImage_readTGA(const char* filename, FILE* stream, const CGImageReader* reader);
 
 typedef enum {
     FORMAT_UNKNOWN,
@@ -220,7 +292,30 @@ static ImageFormat CGImage_identify(
     return FORMAT_UNKNOWN;
 }
 
-CGImage* CGImage_loadStream(const char* filename, FILE* stream) {
+int CGImage_read(const char* filename, const CGImageReader* reader) {
+    FILE* stream = NULL;
+    int result   = -1;
+
+    /* open file */
+    if (!(stream = fopen(filename, "rb"))) {
+        CGError_reportFormat(
+            __FILE__, "CGImage_read", __LINE__,
+            "%s: %s", filename, strerror(errno)
+        );
+
+    } else {
+        result = CGImage_readStream(filename, stream, reader);
+        fclose(stream);
+    }
+
+    return result;
+}
+
+int CGImage_readStream(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
     unsigned char magic[32];
     long int read_count;
 
@@ -230,37 +325,37 @@ CGImage* CGImage_loadStream(const char* filename, FILE* stream) {
 
     if (fseek(stream, -read_count, SEEK_CUR) != 0) {
         CGError_reportFormat(
-            __FILE__, "CGImage_loadStream", __LINE__,
+            __FILE__, "CGImage_readStream", __LINE__,
             "%s: %s", filename, strerror(errno)
         );
-        return NULL;
+        return -1;
     }
 
     format = CGImage_identify(filename, magic, read_count);
 
     switch (format) {
         case FORMAT_BMP:
-            return CGImage_loadBMP(filename, stream);
+            return CGImage_readBMP(filename, stream, reader);
 
         case FORMAT_PCX:
-            return CGImage_loadPCX(filename, stream);
+            return CGImage_readPCX(filename, stream, reader);
 
 #ifdef HAVE_LIBZ
         case FORMAT_PNG:
-            return CGImage_loadPNG(filename, stream);
+            return CGImage_readPNG(filename, stream, reader);
 #endif
 
         case FORMAT_PPM:
-            return CGImage_loadPPM(filename, stream);
+            return CGImage_readPPM(filename, stream, reader);
 
         case FORMAT_TGA:
-            return CGImage_loadTGA(filename, stream);
+            return CGImage_readTGA(filename, stream, reader);
 
         default:
             CGError_reportFormat(
-                __FILE__, "CGImage_loadStream", __LINE__,
+                __FILE__, "CGImage_readStream", __LINE__,
                 "%s: %s", filename, "unknown image format"
             );
-            return NULL;
+            return -1;
     }
 }
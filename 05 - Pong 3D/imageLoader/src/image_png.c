@@ -6,6 +6,7 @@
 #include <zlib.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -34,6 +35,7 @@ typedef struct {
     unsigned char* buffer_in;
     unsigned char* buffer_out;
     unsigned char* buffer_backup;
+    unsigned char* row;
 
     z_stream zlib;
     
@@ -52,14 +54,18 @@ typedef struct {
 
 #define ERROR(msg) \
     CGError_reportFormat( \
-        __FILE__, "CGImage_loadPNG", __LINE__, \
+        __FILE__, "CGImage_readPNG", __LINE__, \
         "%s: %s", filename, (msg) \
     )
 #define FERROR(msg) ERROR(ferror(stream) ? strerror(errno) : (msg))
 
-CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
-    CGImage* image = NULL;
-    
+int CGImage_readPNG(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
+    int result = -1;
+
     PNGChunkHeader chunk;
     PNGImageHeader header;
 
@@ -75,13 +81,13 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
     /* read png file magic */
     if (fread(magic, 1, 8, stream) != 8) {
         FERROR("Premature end of file");
-        goto loadPNG_error;
+        goto readPNG_error;
     }
 
     /* check file magic */
     if (strncmp(magic, PNG_MAGIC, 8)) {
         ERROR("Invalid file format");
-        goto loadPNG_error;
+        goto readPNG_error;
     }
     
     /* read png chunks */
@@ -89,25 +95,25 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
         /* read chunk header */
         if (CGEndian_readf(stream, "2D", &chunk.size) != 2) {
             FERROR("Premature end of file");
-            goto loadPNG_error;
+            goto readPNG_error;
         }
 
         /* first chunk must be IHDR */
         if ((chunk_number == 0) && (chunk.type != 0x49484452)) {
             ERROR("First chunk must be IHDR");
-            goto loadPNG_error;
+            goto readPNG_error;
         }
 
         /* IHDR */
         if (chunk.type == 0x49484452) {
             if (chunk_number != 0) {
                 ERROR("Repeated IHDR chunk found");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
 
             if (chunk.size != 13) {
                 ERROR("Invalid IHDR chunk size");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (CGEndian_readf(
@@ -117,33 +123,42 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                 ) != 7)
             {
                 FERROR("Premature end of file");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             /* check header fields */
             if (header.compression != 0) {
                 ERROR("Compression method not supported");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (header.filter != 0) {
                 ERROR("Filter method not supported");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (header.interlace != 0) {
                 ERROR("Interlace method not supported");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (header.color_type & ~0x07) {
                 ERROR("Sample type not supported");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (header.color_type & 0x01) {
                 ERROR("Palette images not supported");
-                goto loadPNG_error;
+                goto readPNG_error;
+            }
+            
+            /* greyscale allows 1 to 16 bits, all other types 8 or 16 */
+            if (!((header.bit_depth == 8) || (header.bit_depth == 16)
+                || ((header.color_type == 0) && ((header.bit_depth == 1)
+                    || (header.bit_depth == 2) || (header.bit_depth == 4))))
+            ) {
+                ERROR("Invalid bit depth");
+                goto readPNG_error;
             }
             
             /* initialize decoder */
@@ -151,7 +166,16 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                 (header.color_type & 0x02 ? 3 : 1) +
                 (header.color_type & 0x04 ? 1 : 0);
             decoder.sample_mask =
-                ~(~0 << header.bit_depth);
+                ~(~0U << header.bit_depth);
+            
+            /* scanlines are sized in bits */
+            if ((header.width == 0) || (header.height == 0)
+                || (header.width > (UINT_MAX - 8) / 64)
+                || (header.height > UINT_MAX / 2)
+            ) {
+                ERROR("Invalid image size");
+                goto readPNG_error;
+            }
             
             decoder.sample_size =
                 (header.bit_depth + 7) / 8;
@@ -160,20 +184,25 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
             decoder.scanline_size =
                 (header.bit_depth * decoder.plane_count * header.width + 7) / 8;
             
-            /* create image buffer */
-            image = CGImage_create(
-                header.width, header.height, decoder.plane_count
-            );
-            if (!image || !image->data) {
+            /* create row buffer */
+            decoder.row = malloc(header.width * decoder.plane_count);
+            if (!decoder.row) {
                 ERROR(strerror(ENOMEM));
-                goto loadPNG_error;
+                goto readPNG_error;
             }
-            
+
+            if (reader->header && reader->header(
+                    reader->user,
+                    header.width, header.height, decoder.plane_count
+                ) != 0
+            )
+                goto readPNG_error;
+
             /* initialize the zlib inflate stream */
             decoder.buffer_size    = decoder.scanline_size + 1;
             decoder.buffer_in      = malloc(decoder.buffer_size);
             decoder.buffer_out     = malloc(decoder.buffer_size);
-            decoder.buffer_backup  = malloc(decoder.buffer_size);
+            decoder.buffer_backup  = calloc(decoder.buffer_size, 1);
             
             decoder.zlib.zalloc    = (alloc_func)Z_NULL;
             decoder.zlib.zfree     = (free_func)Z_NULL;
@@ -186,7 +215,7 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
 
             if (inflateInit(&decoder.zlib) != Z_OK) {
                 ERROR(decoder.zlib.msg);
-                goto loadPNG_error;
+                goto readPNG_error;
             }
 
         /* IEND */
@@ -209,7 +238,7 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                               1, read_count, stream) != read_count
                     ) {
                         FERROR("Premature end of file");
-                        goto loadPNG_error;
+                        goto readPNG_error;
                     }
 
                     data_left             -= read_count;
@@ -220,10 +249,17 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                 if ((decoder.zlib.avail_in  > 0) &&
                     (decoder.zlib.avail_out > 0)
                 ) {
-                    if (inflate(&decoder.zlib, Z_NO_FLUSH) < 0) {
-                        ERROR(decoder.zlib.msg);
-                        goto loadPNG_error;
+                    int status = inflate(&decoder.zlib, Z_NO_FLUSH);
+
+                    /* Z_NEED_DICT included, PNG has no preset dictionaries */
+                    if ((status != Z_OK) && (status != Z_STREAM_END)) {
+                        ERROR(decoder.zlib.msg ? decoder.zlib.msg : "Invalid image data");
+                        goto readPNG_error;
                     }
+
+                    /* ignore data behind the end of the stream */
+                    if (status == Z_STREAM_END)
+                        decoder.zlib.avail_in = 0;
                 
                     memmove(
                         decoder.buffer_in,
@@ -240,20 +276,18 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                     unsigned int pixel, byte;
                     int bit_shift;
                     
-                    if (decoder.scanline >= image->height) {
+                    if (decoder.scanline >= header.height) {
                         ERROR("Too many pixels");
-                        goto loadPNG_error;
+                        goto readPNG_error;
                     }
                 
                     if (filter > 4) {
                         ERROR("Invalid scanline filter");
-                        goto loadPNG_error;
+                        goto readPNG_error;
                     }
                     
                     /* filter scanline */
-                    if ((filter == 1) ||
-                        ((filter == 3) && (decoder.scanline == 0))
-                    ) {
+                    if (filter == 1) {
                         for (byte = decoder.pixel_size + 1; byte < decoder.buffer_size; ++byte)
                             decoder.buffer_out[byte] +=
                                 decoder.buffer_out[byte - decoder.pixel_size];
@@ -262,7 +296,8 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                         for (byte = 1; byte < decoder.buffer_size; ++byte)
                             decoder.buffer_out[byte] += decoder.buffer_backup[byte];
                         
-                    } else if ((filter == 3) && (decoder.scanline != 0)) {
+                    /* the previous scanline of the first one is all zero */
+                    } else if (filter == 3) {
                         for (byte = 1; byte < 1 + decoder.pixel_size; ++byte)
                             decoder.buffer_out[byte] +=
                                 decoder.buffer_backup[byte] / 2;
@@ -318,9 +353,9 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                             sample = (sample >> bit_shift) & decoder.sample_mask;
                             
                             /* scale sample to 8 bit color bit_depth */
-                            sample = (sample * 255 + 1) / decoder.sample_mask;
+                            sample = (sample * 255 + decoder.sample_mask / 2) / decoder.sample_mask;
                                 
-                            image->data[(decoder.scanline * image->width + pixel) * image->bpp + plane] = sample;
+                            decoder.row[pixel * decoder.plane_count + plane] = sample;
 
                             bit_shift -= header.bit_depth;
                             if (bit_shift < 0) {
@@ -330,6 +365,13 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
                         }
                     }
                     
+                    /* hand scanline to the reader */
+                    if (reader->rows(
+                            reader->user, decoder.scanline, 1, decoder.row
+                        ) != 0
+                    )
+                        goto readPNG_error;
+
                     /* exchange buffers */
                     ptr                   = decoder.buffer_backup;
                     decoder.buffer_backup = decoder.buffer_out;
@@ -346,12 +388,12 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
         } else {
             if (((chunk.type >> 24) & 0x20) == 0) {
                 ERROR("Unknown critical chunk found");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
             
             if (((chunk.type >>  8) & 0x20) != 0) {
                 ERROR("Invalid chunk found (reserved bit set)");
-                goto loadPNG_error;
+                goto readPNG_error;
             }
 
             /* skip chunk */
@@ -361,7 +403,7 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
         /* skip chunk crc */
         if (CGEndian_readf(stream, "D", &chunk.crc) != 1) {
             FERROR("Premature end of file");
-            goto loadPNG_error;
+            goto readPNG_error;
         }
         
         ++chunk_number;
@@ -370,26 +412,23 @@ CGImage* CGImage_loadPNG(const char* filename, FILE* stream) {
     /* no IEND chunk found? */
     if (!done) {
         ERROR("File truncated");
-        goto loadPNG_error;
+        goto readPNG_error;
     }
     
-    if (decoder.scanline < image->height) {
+    if (decoder.scanline < header.height) {
         ERROR("Too few pixels");
-        goto loadPNG_error;
+        goto readPNG_error;
     }
 
-    goto loadPNG_end;
-
-    loadPNG_error:
-        CGImage_free(image);
-        image = NULL;
+    result = 0;
 
-    loadPNG_end:
+    readPNG_error:
         inflateEnd(&decoder.zlib);
         free(decoder.buffer_in);
         free(decoder.buffer_out);
         free(decoder.buffer_backup);
-        return image;
+        free(decoder.row);
+        return result;
 }
 
 #undef FERROR
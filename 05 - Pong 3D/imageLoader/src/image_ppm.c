@@ -3,75 +3,105 @@
 #include <cgimage/error.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #include <config.h>
 
+/* read at most this many bytes of pixel data at once */
+#define PPM_BAND_SIZE 65536
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
 #define ERROR(msg) \
     CGError_reportFormat( \
-        __FILE__, "CGImage_loadPPM", __LINE__, \
+        __FILE__, "CGImage_readPPM", __LINE__, \
         "%s: %s", filename, (msg) \
     )
 #define FERROR(msg) ERROR(ferror(stream) ? strerror(errno) : (msg))
 
-CGImage* CGImage_loadPPM(const char* filename, FILE* stream) {
-    CGImage* image = NULL;
+int CGImage_readPPM(
+    const char* filename,
+    FILE* stream,
+    const CGImageReader* reader
+) {
+    unsigned char* band = NULL;
+    int result = -1;
 
     char magic[2];
     unsigned int width, height, max;
+    unsigned int row_size, band_rows, row;
 
     /* read header */
     if (fscanf(
-            stream, "%2c%*[\n]%d%*[ ]%d%*[\n]%d%*[\n]",
+            stream, "%2c%*[\n]%u%*[ ]%u%*[\n]%u%*[\n]",
             magic, &width, &height, &max
         ) != 4
     ) {
         FERROR("Premature end of file");
-        goto loadPPM_error;
+        goto readPPM_error;
     }
 
     if (magic[0] != 'P' || magic[1] != '6') {
         ERROR("Usupported image format");
-        goto loadPPM_error;
+        goto readPPM_error;
     }
 
-    /* allocate memory */
-    if (
-        !(image = CGImage_create(width, height, 3))
-        || !image->data
-    ) {
-        ERROR(strerror(ENOMEM));
-        goto loadPPM_error;
+    /* only 8 bit samples */
+    if ((max == 0) || (max > 255)) {
+        ERROR("Usupported sample range");
+        goto readPPM_error;
     }
 
-    /* read bitmap data */
-    if (
-        fread(
-            image->data, 1, width * height * 3, stream
-        ) != width * height * 3
-    ) {
-        FERROR("Premature end of file");
-        goto loadPPM_error;
+    if ((width == 0) || (height == 0) || (width > UINT_MAX / 3)) {
+        ERROR("Invalid image size");
+        goto readPPM_error;
     }
 
-    /* rescale intensities */
-    if (max != 255) {
-        unsigned int i;
+    /* allocate band buffer */
+    row_size  = width * 3;
+    band_rows = row_size ? PPM_BAND_SIZE / row_size : 0;
+    if (band_rows == 0)
+        band_rows = 1;
+    if (band_rows > height)
+        band_rows = height;
 
-        for (i = 0; i < width * height * 3; ++i)
-            image->data[i] = (image->data[i] * 255) / max;
+    if (!(band = malloc(band_rows * row_size + 1))) {
+        ERROR(strerror(ENOMEM));
+        goto readPPM_error;
     }
 
-    goto loadPPM_end;
-    
-    loadPPM_error:
-        CGImage_free(image);
-        image = NULL;
-        
-    loadPPM_end:
-        return image;
+    if (reader->header && reader->header(reader->user, width, height, 3) != 0)
+        goto readPPM_error;
+
+    /* read bitmap data band by band */
+    for (row = 0; row < height; row += band_rows) {
+        unsigned int count = MIN(band_rows, height - row);
+
+        if (fread(band, row_size, count, stream) != count) {
+            FERROR("Premature end of file");
+            goto readPPM_error;
+        }
+
+        /* rescale intensities */
+        if (max != 255) {
+            unsigned int i;
+
+            for (i = 0; i < count * row_size; ++i)
+                band[i] = band[i] < max ? (band[i] * 255) / max : 255;
+        }
+
+        if (reader->rows(reader->user, row, count, band) != 0)
+            goto readPPM_error;
+    }
+
+    result = 0;
+
+    readPPM_error:
+        free(band);
+        return result;
 }
 
 #undef FERROR
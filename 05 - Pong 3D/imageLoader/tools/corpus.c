@@ -0,0 +1,746 @@
+#include "corpus.h"
+
+#include <zlib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* images are generated in these sizes, the last one only if large is set */
+static const unsigned int corpus_sizes[][2] = {
+    {   17,   13 },
+    {  256,  256 },
+    { 1024, 1024 }
+};
+
+/* size of the IDAT chunks written to PNG files */
+#define PNG_CHUNK_SIZE 8192
+
+/* filter id used to cycle through all PNG filters row by row */
+#define PNG_FILTER_MIXED 5
+
+static const char* png_filter_names[] = {
+    "none", "sub", "up", "average", "paeth", "mixed"
+};
+
+/*
+ * Deterministic pixel source: flat areas, gradients, checkers and noise
+ * in 16x16 tiles, so that both run length and deflate coding see
+ * realistic input. Returns a value in [0, max].
+ */
+static unsigned int Corpus_sample(
+    unsigned int x,
+    unsigned int y,
+    unsigned int c,
+    unsigned int max
+) {
+    unsigned long h;
+
+    switch (((x / 16) + (y / 16) * 7) % 4) {
+        case 0:
+            return (max * ((x + y * 3 + c * 50) & 255)) / 255;
+
+        case 1:
+            return (max * ((c * 80 + 40) & 255)) / 255;
+
+        case 2:
+            h = (x * 73856093UL) ^ (y * 19349663UL) ^ (c * 83492791UL);
+            h = (h ^ (h >> 13)) * 1274126177UL;
+            return (unsigned int)((h ^ (h >> 16)) & 0xffffffUL) % (max + 1);
+
+        default:
+            return ((x / 4 + y / 4 + c) % 2) ? max : 0;
+    }
+}
+
+static void Corpus_put16(unsigned char* p, unsigned int v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void Corpus_put32(unsigned char* p, unsigned long v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static void Corpus_put32BE(unsigned char* p, unsigned long v) {
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+static int Corpus_writeFile(
+    const char* path,
+    const unsigned char* data,
+    unsigned long size
+) {
+    FILE* file = fopen(path, "wb");
+    int ok;
+
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    ok = fwrite(data, 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok)
+        perror(path);
+
+    return ok ? 0 : -1;
+}
+
+/* growable output buffer */
+typedef struct {
+    unsigned char* data;
+    unsigned long size;
+    unsigned long capacity;
+} CorpusBuffer;
+
+static unsigned char* Corpus_append(CorpusBuffer* buffer, unsigned long size) {
+    unsigned char* ptr;
+
+    if (buffer->size + size > buffer->capacity) {
+        unsigned long capacity = buffer->capacity ? buffer->capacity : 4096;
+
+        while (capacity < buffer->size + size)
+            capacity *= 2;
+
+        if (!(ptr = realloc(buffer->data, capacity)))
+            return NULL;
+
+        buffer->data     = ptr;
+        buffer->capacity = capacity;
+    }
+
+    ptr = buffer->data + buffer->size;
+    buffer->size += size;
+
+    return ptr;
+}
+
+static int Corpus_appendBytes(
+    CorpusBuffer* buffer,
+    const void* data,
+    unsigned long size
+) {
+    unsigned char* ptr = Corpus_append(buffer, size);
+
+    if (!ptr)
+        return -1;
+
+    memcpy(ptr, data, size);
+    return 0;
+}
+
+static int Corpus_pngChunk(
+    CorpusBuffer* out,
+    const char* type,
+    const unsigned char* data,
+    unsigned long size
+) {
+    unsigned char* ptr = Corpus_append(out, size + 12);
+    unsigned long crc;
+
+    if (!ptr)
+        return -1;
+
+    Corpus_put32BE(ptr, size);
+    memcpy(ptr + 4, type, 4);
+    if (size)
+        memcpy(ptr + 8, data, size);
+
+    crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, ptr + 4, size + 4);
+    Corpus_put32BE(ptr + 8 + size, crc);
+
+    return 0;
+}
+
+static unsigned char Corpus_paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+    if ((pa <= pb) && (pa <= pc))
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+/*
+ * Write a PNG with the given color type (0 gray, 2 rgb, 4 gray+alpha,
+ * 6 rgba) and bit depth. expected receives the 8 bit pixels a correct
+ * decoder produces.
+ */
+static int Corpus_writePNG(
+    const char* path,
+    unsigned int width,
+    unsigned int height,
+    unsigned int color_type,
+    unsigned int depth,
+    unsigned int filter,
+    unsigned char* expected
+) {
+    CorpusBuffer out = { NULL, 0, 0 };
+    unsigned char ihdr[13];
+    unsigned char *raw = NULL, *prev = NULL, *filtered = NULL, *packed = NULL;
+    unsigned long line, unit, packed_size, pos;
+    unsigned int channels, max, x, y, c;
+    int result = -1;
+
+    channels = (color_type & 2 ? 3 : 1) + (color_type & 4 ? 1 : 0);
+    max      = (1u << depth) - 1;
+    line     = ((unsigned long)width * channels * depth + 7) / 8;
+    unit     = (channels * depth + 7) / 8;
+
+    raw      = calloc(line + 1, 1);
+    prev     = calloc(line + 1, 1);
+    filtered = malloc((line + 1) * height + 1);
+    packed_size = compressBound((line + 1) * height);
+    packed   = malloc(packed_size);
+
+    if (!raw || !prev || !filtered || !packed)
+        goto writePNG_end;
+
+    for (y = 0; y < height; ++y) {
+        unsigned int type = filter == PNG_FILTER_MIXED ? y % 5 : filter;
+        unsigned char* dst = filtered + y * (line + 1);
+        unsigned long bit = 0, i;
+
+        /* pack samples, most significant bit first */
+        memset(raw, 0, line);
+        for (x = 0; x < width; ++x) {
+            for (c = 0; c < channels; ++c) {
+                unsigned int s = Corpus_sample(x, y, c, depth == 16 ? 255 : max);
+
+                if (depth == 16) {
+                    expected[(y * width + x) * channels + c] = s;
+                    s *= 257;
+                    raw[bit / 8]     = s >> 8;
+                    raw[bit / 8 + 1] = s & 0xff;
+                } else {
+                    expected[(y * width + x) * channels + c] = s * 255 / max;
+                    raw[bit / 8] |= s << (8 - depth - bit % 8);
+                }
+
+                bit += depth;
+            }
+        }
+
+        /* filter scanline */
+        dst[0] = type;
+        for (i = 0; i < line; ++i) {
+            int a = i >= unit ? raw[i - unit] : 0;
+            int b = prev[i];
+            int d = i >= unit ? prev[i - unit] : 0;
+
+            switch (type) {
+                case 0: dst[i + 1] = raw[i];                          break;
+                case 1: dst[i + 1] = raw[i] - a;                      break;
+                case 2: dst[i + 1] = raw[i] - b;                      break;
+                case 3: dst[i + 1] = raw[i] - ((a + b) >> 1);         break;
+                default: dst[i + 1] = raw[i] - Corpus_paeth(a, b, d); break;
+            }
+        }
+
+        memcpy(prev, raw, line);
+    }
+
+    if (compress2(packed, &packed_size, filtered, (line + 1) * height, 6) != Z_OK)
+        goto writePNG_end;
+
+    Corpus_put32BE(ihdr, width);
+    Corpus_put32BE(ihdr + 4, height);
+    ihdr[8]  = depth;
+    ihdr[9]  = color_type;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    if (Corpus_appendBytes(&out, "\211PNG\r\n\032\n", 8)
+        || Corpus_pngChunk(&out, "IHDR", ihdr, 13)
+        || Corpus_pngChunk(&out, "tEXt", (const unsigned char*)"Comment\0corpus", 14))
+        goto writePNG_end;
+
+    /* split the data stream over several IDAT chunks */
+    for (pos = 0; pos < packed_size; pos += PNG_CHUNK_SIZE) {
+        unsigned long size = packed_size - pos;
+
+        if (size > PNG_CHUNK_SIZE)
+            size = PNG_CHUNK_SIZE;
+
+        if (Corpus_pngChunk(&out, "IDAT", packed + pos, size))
+            goto writePNG_end;
+    }
+
+    if (Corpus_pngChunk(&out, "IEND", NULL, 0))
+        goto writePNG_end;
+
+    result = Corpus_writeFile(path, out.data, out.size);
+
+    writePNG_end:
+        free(out.data);
+        free(raw);
+        free(prev);
+        free(filtered);
+        free(packed);
+        return result;
+}
+
+/*
+ * Write a TGA. bits is 8 (grayscale or palette), 24 or 32. Pixels are
+ * run length encoded if rle is set, rows are stored bottom up unless
+ * top is set.
+ */
+static int Corpus_writeTGA(
+    const char* path,
+    unsigned int width,
+    unsigned int height,
+    unsigned int bits,
+    int palette,
+    int rle,
+    int top,
+    unsigned char* expected
+) {
+    CorpusBuffer out = { NULL, 0, 0 };
+    unsigned char header[18];
+    unsigned char* pixels = NULL;
+    unsigned int size = bits / 8, bpp = palette ? 3 : size;
+    unsigned long count = (unsigned long)width * height, i;
+    unsigned int x, y, c;
+    int result = -1;
+
+    if (!(pixels = malloc(count * size + 1)))
+        goto writeTGA_end;
+
+    memset(header, 0, sizeof(header));
+    header[1] = palette ? 1 : 0;
+    header[2] = (palette ? 1 : (size == 1 ? 3 : 2)) | (rle ? 8 : 0);
+    if (palette) {
+        Corpus_put16(header + 5, 256);
+        header[7] = 24;
+    }
+    Corpus_put16(header + 12, width);
+    Corpus_put16(header + 14, height);
+    header[16] = bits;
+    header[17] = (top ? 0x20 : 0) | (size == 4 ? 8 : 0);
+
+    if (Corpus_appendBytes(&out, header, sizeof(header)))
+        goto writeTGA_end;
+
+    /* palette: BGR entries, a color ramp */
+    if (palette) {
+        unsigned char* entry = Corpus_append(&out, 256 * 3);
+
+        if (!entry)
+            goto writeTGA_end;
+
+        for (i = 0; i < 256; ++i) {
+            entry[i * 3 + 0] = (i * 7) & 0xff;
+            entry[i * 3 + 1] = 255 - i;
+            entry[i * 3 + 2] = i;
+        }
+    }
+
+    /* raw pixels in file order */
+    for (y = 0; y < height; ++y) {
+        unsigned int row = top ? y : height - y - 1;
+
+        for (x = 0; x < width; ++x) {
+            unsigned char* p = pixels + ((unsigned long)y * width + x) * size;
+            unsigned char* e = expected + ((unsigned long)row * width + x) * bpp;
+            unsigned char v[4] = { 0, 0, 0, 0 };
+
+            for (c = 0; c < size; ++c)
+                v[c] = Corpus_sample(x, row, c, 255);
+
+            if (palette) {
+                p[0] = v[0];
+                e[0] = v[0];
+                e[1] = 255 - v[0];
+                e[2] = (v[0] * 7) & 0xff;
+            } else if (size == 1) {
+                p[0] = e[0] = v[0];
+            } else {
+                /* stored as BGR(A) */
+                p[0] = v[2];
+                p[1] = v[1];
+                p[2] = v[0];
+                memcpy(e, v, size);
+                if (size == 4)
+                    p[3] = v[3];
+            }
+        }
+    }
+
+    if (!rle) {
+        if (Corpus_appendBytes(&out, pixels, count * size))
+            goto writeTGA_end;
+
+    } else {
+        /* packets of up to 128 pixels, crossing row boundaries */
+        i = 0;
+        while (i < count) {
+            unsigned long n = 1;
+
+            while ((i + n < count) && (n < 128)
+                && !memcmp(pixels + i * size, pixels + (i + n) * size, size))
+                ++n;
+
+            if (n > 1) {
+                unsigned char packet = 0x80 | (n - 1);
+
+                if (Corpus_appendBytes(&out, &packet, 1)
+                    || Corpus_appendBytes(&out, pixels + i * size, size))
+                    goto writeTGA_end;
+
+            } else {
+                unsigned char packet;
+
+                while ((i + n < count) && (n < 128)
+                    && ((i + n + 1 >= count)
+                        || memcmp(pixels + (i + n) * size, pixels + (i + n + 1) * size, size)))
+                    ++n;
+
+                packet = n - 1;
+                if (Corpus_appendBytes(&out, &packet, 1)
+                    || Corpus_appendBytes(&out, pixels + i * size, n * size))
+                    goto writeTGA_end;
+            }
+
+            i += n;
+        }
+    }
+
+    result = Corpus_writeFile(path, out.data, out.size);
+
+    writeTGA_end:
+        free(out.data);
+        free(pixels);
+        return result;
+}
+
+/* Write a binary PPM with the given maximum sample value. */
+static int Corpus_writePPM(
+    const char* path,
+    unsigned int width,
+    unsigned int height,
+    unsigned int max,
+    unsigned char* expected
+) {
+    CorpusBuffer out = { NULL, 0, 0 };
+    char header[64];
+    unsigned long i, count = (unsigned long)width * height * 3;
+    unsigned char* data;
+    int result = -1;
+
+    sprintf(header, "P6\n%u %u\n%u\n", width, height, max);
+
+    if (Corpus_appendBytes(&out, header, strlen(header))
+        || !(data = Corpus_append(&out, count)))
+        goto writePPM_end;
+
+    for (i = 0; i < count; ++i) {
+        unsigned long p = i / 3;
+
+        data[i]     = Corpus_sample(p % width, p / width, i % 3, max);
+        expected[i] = data[i] * 255 / max;
+    }
+
+    result = Corpus_writeFile(path, out.data, out.size);
+
+    writePPM_end:
+        free(out.data);
+        return result;
+}
+
+/* Write an uncompressed 24 bit BMP, rows bottom up and padded. */
+static int Corpus_writeBMP(
+    const char* path,
+    unsigned int width,
+    unsigned int height,
+    unsigned char* expected
+) {
+    CorpusBuffer out = { NULL, 0, 0 };
+    unsigned char header[54];
+    unsigned long row_size = ((unsigned long)width * 3 + 3) & ~3UL;
+    unsigned char* data;
+    unsigned int x, y, c;
+    int result = -1;
+
+    memset(header, 0, sizeof(header));
+    header[0] = 'B';
+    header[1] = 'M';
+    Corpus_put32(header + 2, 54 + row_size * height);
+    Corpus_put32(header + 10, 54);
+    Corpus_put32(header + 14, 40);
+    Corpus_put32(header + 18, width);
+    Corpus_put32(header + 22, height);
+    Corpus_put16(header + 26, 1);
+    Corpus_put16(header + 28, 24);
+    Corpus_put32(header + 34, row_size * height);
+
+    if (Corpus_appendBytes(&out, header, sizeof(header))
+        || !(data = Corpus_append(&out, row_size * height)))
+        goto writeBMP_end;
+
+    memset(data, 0, row_size * height);
+    for (y = 0; y < height; ++y) {
+        unsigned char* row = data + (height - y - 1) * row_size;
+
+        for (x = 0; x < width; ++x) {
+            for (c = 0; c < 3; ++c)
+                expected[(y * width + x) * 3 + c] = Corpus_sample(x, y, c, 255);
+
+            row[x * 3 + 0] = expected[(y * width + x) * 3 + 2];
+            row[x * 3 + 1] = expected[(y * width + x) * 3 + 1];
+            row[x * 3 + 2] = expected[(y * width + x) * 3 + 0];
+        }
+    }
+
+    result = Corpus_writeFile(path, out.data, out.size);
+
+    writeBMP_end:
+        free(out.data);
+        return result;
+}
+
+/* run length encode one PCX scanline plane */
+static int Corpus_pcxLine(CorpusBuffer* out, const unsigned char* line, unsigned int size) {
+    unsigned int i = 0;
+
+    while (i < size) {
+        unsigned char run[2];
+        unsigned int n = 1;
+
+        while ((i + n < size) && (n < 63) && (line[i + n] == line[i]))
+            ++n;
+
+        if ((n > 1) || (line[i] >= 192)) {
+            run[0] = 192 | n;
+            run[1] = line[i];
+            if (Corpus_appendBytes(out, run, 2))
+                return -1;
+        } else if (Corpus_appendBytes(out, line + i, 1)) {
+            return -1;
+        }
+
+        i += n;
+    }
+
+    return 0;
+}
+
+/* Write a version 5 PCX, either 8 bit with palette or with 3 color planes. */
+static int Corpus_writePCX(
+    const char* path,
+    unsigned int width,
+    unsigned int height,
+    int palette,
+    unsigned char* expected
+) {
+    CorpusBuffer out = { NULL, 0, 0 };
+    unsigned char header[128];
+    unsigned char* line = NULL;
+    unsigned int planes = palette ? 1 : 3, x, y, c;
+    int result = -1;
+
+    memset(header, 0, sizeof(header));
+    header[0] = 10;
+    header[1] = 5;
+    header[2] = 1;
+    header[3] = 8;
+    Corpus_put16(header + 8, width - 1);
+    Corpus_put16(header + 10, height - 1);
+    Corpus_put16(header + 12, 72);
+    Corpus_put16(header + 14, 72);
+    header[65] = planes;
+    Corpus_put16(header + 66, width);
+    Corpus_put16(header + 68, 1);
+
+    if (!(line = malloc(width + 1)) || Corpus_appendBytes(&out, header, sizeof(header)))
+        goto writePCX_end;
+
+    for (y = 0; y < height; ++y) {
+        for (c = 0; c < planes; ++c) {
+            for (x = 0; x < width; ++x) {
+                unsigned char* e = expected + (y * width + x) * 3;
+
+                line[x] = Corpus_sample(x, y, c, 255);
+
+                if (palette) {
+                    e[0] = line[x];
+                    e[1] = 255 - line[x];
+                    e[2] = (line[x] * 7) & 0xff;
+                } else {
+                    e[c] = line[x];
+                }
+            }
+
+            if (Corpus_pcxLine(&out, line, width))
+                goto writePCX_end;
+        }
+    }
+
+    /* 256 color palette at the end of the file */
+    if (palette) {
+        unsigned char* entry = Corpus_append(&out, 769);
+        unsigned int i;
+
+        if (!entry)
+            goto writePCX_end;
+
+        entry[0] = 12;
+        for (i = 0; i < 256; ++i) {
+            entry[1 + i * 3 + 0] = i;
+            entry[1 + i * 3 + 1] = 255 - i;
+            entry[1 + i * 3 + 2] = (i * 7) & 0xff;
+        }
+    }
+
+    result = Corpus_writeFile(path, out.data, out.size);
+
+    writePCX_end:
+        free(out.data);
+        free(line);
+        return result;
+}
+
+int Corpus_generate(const char* dir, int large, CorpusEntry** entries) {
+    /* png variants: color type, bit depth, filter */
+    static const unsigned int png[][3] = {
+        { 0,  1, PNG_FILTER_MIXED },
+        { 0,  2, PNG_FILTER_MIXED },
+        { 0,  4, PNG_FILTER_MIXED },
+        { 0,  8, PNG_FILTER_MIXED },
+        { 0, 16, PNG_FILTER_MIXED },
+        { 4,  8, PNG_FILTER_MIXED },
+        { 4, 16, PNG_FILTER_MIXED },
+        { 2,  8, 0 },
+        { 2,  8, 1 },
+        { 2,  8, 2 },
+        { 2,  8, 3 },
+        { 2,  8, 4 },
+        { 2,  8, PNG_FILTER_MIXED },
+        { 2, 16, PNG_FILTER_MIXED },
+        { 6,  8, PNG_FILTER_MIXED },
+        { 6, 16, PNG_FILTER_MIXED }
+    };
+
+    /* tga variants: bits, palette, rle, top down */
+    static const int tga[][4] = {
+        {  8, 0, 0, 0 },
+        {  8, 0, 1, 1 },
+        {  8, 1, 0, 0 },
+        {  8, 1, 1, 0 },
+        { 24, 0, 0, 0 },
+        { 24, 0, 0, 1 },
+        { 24, 0, 1, 0 },
+        { 24, 0, 1, 1 },
+        { 32, 0, 0, 0 },
+        { 32, 0, 1, 1 }
+    };
+
+#define PNG_VARIANTS (sizeof(png) / sizeof(*png))
+#define TGA_VARIANTS (sizeof(tga) / sizeof(*tga))
+
+    static const char* png_types[] = { "gray", "", "rgb", "", "graya", "", "rgba" };
+
+    unsigned int sizes = large ? 3 : 2, variants, s, v, count = 0;
+    CorpusEntry* list;
+
+    variants = PNG_VARIANTS + TGA_VARIANTS + 2 + 1 + 2;
+
+    if (!(list = malloc(sizes * variants * sizeof(CorpusEntry))))
+        return -1;
+
+    for (s = 0; s < sizes; ++s) {
+        unsigned int width = corpus_sizes[s][0], height = corpus_sizes[s][1];
+
+        for (v = 0; v < variants; ++v) {
+            CorpusEntry* e = list + count;
+            unsigned int k = v;
+            unsigned char* expected;
+            char name[sizeof(e->path) + 4];
+            int result;
+
+            e->width  = width;
+            e->height = height;
+
+            /* describe the entry, k is the index within its format */
+            if (k < PNG_VARIANTS) {
+                e->format = "png";
+                e->bpp    = (png[k][0] & 2 ? 3 : 1) + (png[k][0] & 4 ? 1 : 0);
+                sprintf(e->variant, "%s%u-%s", png_types[png[k][0]], png[k][1], png_filter_names[png[k][2]]);
+
+            } else if ((k -= PNG_VARIANTS) < TGA_VARIANTS) {
+                e->format = "tga";
+                e->bpp    = tga[k][1] ? 3 : tga[k][0] / 8;
+                sprintf(
+                    e->variant, "%s%s%d-%s",
+                    tga[k][2] ? "rle" : "raw",
+                    tga[k][1] ? "pal" : "",
+                    tga[k][0],
+                    tga[k][3] ? "top" : "bottom"
+                );
+
+            } else if ((k -= TGA_VARIANTS) < 2) {
+                e->format = "ppm";
+                e->bpp    = 3;
+                sprintf(e->variant, "max%d", k ? 100 : 255);
+
+            } else if ((k -= 2) < 1) {
+                e->format = "bmp";
+                e->bpp    = 3;
+                strcpy(e->variant, "rgb24");
+
+            } else {
+                k -= 1;
+                e->format = "pcx";
+                e->bpp    = 3;
+                strcpy(e->variant, k ? "planes3" : "pal8");
+            }
+
+            sprintf(e->path, "%s/%s-%s-%ux%u.%s", dir, e->format, e->variant, width, height, e->format);
+
+            if (!(expected = malloc(width * height * e->bpp))) {
+                free(list);
+                return -1;
+            }
+
+            /* write the file */
+            if (!strcmp(e->format, "png"))
+                result = Corpus_writePNG(e->path, width, height, png[k][0], png[k][1], png[k][2], expected);
+            else if (!strcmp(e->format, "tga"))
+                result = Corpus_writeTGA(e->path, width, height, tga[k][0], tga[k][1], tga[k][2], tga[k][3], expected);
+            else if (!strcmp(e->format, "ppm"))
+                result = Corpus_writePPM(e->path, width, height, k ? 100 : 255, expected);
+            else if (!strcmp(e->format, "bmp"))
+                result = Corpus_writeBMP(e->path, width, height, expected);
+            else
+                result = Corpus_writePCX(e->path, width, height, k, expected);
+
+            /* reference pixels next to the file */
+            sprintf(name, "%s.raw", e->path);
+            if (!result)
+                result = Corpus_writeFile(name, expected, width * height * e->bpp);
+
+            free(expected);
+
+            if (result) {
+                free(list);
+                return -1;
+            }
+
+            ++count;
+        }
+    }
+
+    *entries = list;
+    return count;
+}
@@ -178,6 +178,16 @@ static void handleKeyboardEvent(int key, int status, Boolean isSpecialKey, int x
         case 'N':
           logicSwitch(LOGIC_SWITCHABLE_SHADOWVOLUMES);
           break;
+        /* Schatten per z-fail statt z-pass */
+        case 'x':
+        case 'X':
+          logicSwitch(LOGIC_SWITCHABLE_ZFAIL);
+          break;
+        /* Schatten per Shadow Map statt Schattenvolumen */
+        case 'b':
+        case 'B':
+          logicSwitch(LOGIC_SWITCHABLE_SHADOWMAPS);
+          break;
         case 'u':
         case 'U':
           logicSwitch(LOGIC_SWITCHABLE_LIGHTBACKWARD);
@@ -28,28 +28,7 @@
 #include "vector.h"
 #include "object.h"
 #include "texture.h"
-
-/* ----------------------------------------------------------------------------
- * Typen
- * -------------------------------------------------------------------------- */
-
-/** Seiten eines Würfels */
-typedef enum {
-  FACE_FRONT
-, FACE_LEFT
-, FACE_BACK
-, FACE_RIGHT
-, FACE_TOP
-, FACE_BOTTOM
-, FACE_DUMMY
-} Face;
-
-/** Informationen über Würfelseiten */
-typedef enum {
-  VERTEX_MIDDLE
-, VERTEX_NORMAL
-, VERTEX_DUMMY
-} Vertex;
+#include "physics.h"
 
 /* ----------------------------------------------------------------------------
  * Konstanten
@@ -63,6 +42,7 @@ typedef enum {
 #define LOGIC_BALL_ANGLE_MAX   ( 45  )
 #define LOGIC_BALL_STEP_PS     (  1.5)
 #define LOGIC_BALL_SPEED       (  1.0)
+#define LOGIC_BALL_BOUNCES_MAX (  4  )
 
 #define LOGIC_RACKET_STEP_PS   (  2.0)
 #define LOGIC_RACKET_ANGLE_PS  (120.0)
@@ -126,6 +106,8 @@ static Boolean switchable[LOGIC_SWITCHABLE_DUMMY] =
   , FALSE /* LIGHTRIGHT    */
   , TRUE  /* SHADOWS       */
   , FALSE /* SHADOWVOLUMES */
+  , FALSE /* ZFAIL         */
+  , FALSE /* SHADOWMAPS    */
   };
 
 /* Vektoren */
@@ -149,30 +131,15 @@ static double camRotation = - 35.0 /* Aulenkung der Kamera */
             , ballSpeed   = LOGIC_BALL_SPEED
             ;
 
-static Vector3d middle[FACE_DUMMY] =
-                { {  0.0,   0.0, + 0.5} /* Front  */
-                , {- 0.5,   0.0,   0.0} /* Left   */
-                , {  0.0,   0.0, - 0.5} /* Back   */
-                , {+ 0.5,   0.0,   0.0} /* Right  */
-                , {  0.0, + 0.5,   0.0} /* Top    */
-                , {  0.0, - 0.5,   0.0} /* Bottom */
-                }
-              , normal[FACE_DUMMY] =
-                { {  0.0,   0.0, + 1.0} /* Front  */
-                , {- 1.0,   0.0,   0.0} /* Left   */
-                , {  0.0,   0.0, - 1.0} /* Back   */
-                , {+ 1.0,   0.0,   0.0} /* Right  */
-                , {  0.0, + 1.0,   0.0} /* Top    */
-                , {  0.0, - 1.0,   0.0} /* Bottom */
-                }
-              ;
-
 /* Der "Level" */
 static Objects objects[LOGIC_OBJECTS_DUMMY];
 
 /* Levelgegenstände */
 static Object object[LOGIC_OBJECT_DUMMY];
 
+/* Kollisionskörper der Levelgegenstände */
+static PhysicsBody body[LOGIC_OBJECT_DUMMY];
+
 /* ----------------------------------------------------------------------------
  * Funktionen
  * ----------------------------------------------------------------------------
@@ -276,196 +243,142 @@ static void calcRacket(double interval)
 }
 
 /**
- * Berechnet die Position des Balls.
+ * Verändert die Farbe des Balls.
  *
- * @param[in] interval Zeit seit dem letzen Aufruf.
+ * @param[in] ball Der Ball.
  */
-static void calcBall(double interval)
+static void switchBallColor(Object * ball)
+{
+  Material matBall = ball->m;
+
+  ball->m = (MAT_BALL0 + (rand() % (MAT_BALL5 - MAT_BALL0))) % MAT_BALL5;
+
+  if (ball->m == matBall)
+    ball->m += ball->m == MAT_BALL5
+             ? -1
+             : +1
+             ;
+}
+
+/**
+ * Sucht unter den Objekten, an denen der Ball abprallt, den frühesten
+ * Aufprall, wenn sich der Ball um v bewegt.
+ *
+ * @param[in]  v   Strecke des Balls.
+ * @param[out] hit Frühester Aufprall.
+ *
+ * @return getroffenes Objekt, LOGIC_OBJECT_DUMMY wenn keins getroffen wird.
+ */
+static LogicObject findCollision(Vector3d v, PhysicsHit * hit)
 {
   static Object * objectBall = &object[LOGIC_OBJECT_BALL];
   
-  double speed = interval * ballSpeed * LOGIC_BALL_STEP_PS;
+  static const LogicObject colliders[] =
+    { LOGIC_OBJECT_RACKET
+    , LOGIC_OBJECT_WALLFRONT
+    , LOGIC_OBJECT_WALLCENTER
+    , LOGIC_OBJECT_WALLLEFT
+    , LOGIC_OBJECT_WALLRIGHT
+    , LOGIC_OBJECT_CUBE0
+    , LOGIC_OBJECT_CUBE1
+    };
   
-  /* Rotation als Bewegungsrichtung missbrauchen */
-  objectBall->t = vectorAdd( objectBall->t
-                           , vectorScale(objectBall->r, speed, speed, speed)
-                           );
+  LogicObject found = LOGIC_OBJECT_DUMMY;
   
-  /* Neu erzeugen, wenn der Ball das Spielfeld verlässt */
-  if (objectBall->t.z > 1.5)
+  PhysicsHit h;
+  
+  unsigned i;
+  
+  for (i = 0; i < sizeof(colliders) / sizeof(colliders[0]); ++i)
   {
-    objectBall->t          = vectorMake(0.0, 0.0, - 0.2);
-    objectBall->r          = makeBallDirection();
-    ballSpeed              = LOGIC_BALL_SPEED;
+    /* Falls Cheat, dann Ball an der vorderen Wand statt am Schläger fangen */
+    if (colliders[i] == (switchable[LOGIC_SWITCHABLE_CHEAT] ? LOGIC_OBJECT_RACKET : LOGIC_OBJECT_WALLFRONT))
+      continue;
     
-    if (--ints[LOGIC_INT_LIFES] < 1)
+    if (physicsSweepSphere(&body[colliders[i]], objectBall->t, v, LOGIC_BALL_RADIUS, &h)
+     && (found == LOGIC_OBJECT_DUMMY || h.t < hit->t))
     {
-      objectBall->t = vectorMakeNull();
-      objectBall->r = vectorMakeNull();
-      
-      fprintf(stdout, "Punkte : %i\n", ints[LOGIC_INT_POINTS]);
-      fprintf(stderr, "\n");
-      fprintf(stdout, "Game Over!\n");
-    }
-    else
-    {
-      fprintf(stdout, "Punkte : %i\n", ints[LOGIC_INT_POINTS]);
-      fprintf(stdout, "Leben  : %i\n", ints[LOGIC_INT_LIFES]);
-      fprintf(stderr, "\n");
+      *hit  = h;
+      found = colliders[i];
     }
   }
   
-  if (ints[LOGIC_INT_LIFES] > 0)
-    objectBall->r = vectorNorm(objectBall->r);
-}
-
-/**
- * Gibt den Mittelpunkt der Fläche f eines Würfels zurück.
- *
- * @param[in] f Fläche.
- */
-static Vector3d getMiddle(Face f)
-{
-  return middle[f];
-}
-
-/**
- * Gibt die Normale der Fläche f eines Würfels zurück.
- *
- * @param[in] f Fläche.
- */
-static Vector3d getNormal(Face f)
-{
-  return normal[f];
+  return found;
 }
 
 /**
- * Reflektiert den Ball am Objeckt o.
+ * Berechnet die Position des Balls.
  *
- * @param[in] o Objekt, an dem der Ball reflektiert werden soll.
+ * @param[in] interval Zeit seit dem letzen Aufruf.
  */
-extern void reflectOn(Object * o)
+static void calcBall(double interval)
 {
   static Object * objectBall = &object[LOGIC_OBJECT_BALL];
   
-  /* Seit, an der reflektiert werden soll. */
-  Face face;
+  double speed = interval * ballSpeed * LOGIC_BALL_STEP_PS;
   
-  /* Kollision aufgetreten ? */
-  Boolean collision = FALSE;
+  int bounces = 0;
   
-  /* "Alle" Seiten auf Kollision prüfen */
-  for (face = FACE_FRONT; !collision && face <= FACE_RIGHT; ++face)
+  /* Ball bis zum jeweils nächsten Aufprall bewegen und dort abprallen lassen */
+  while (speed > 0.0 && bounces < LOGIC_BALL_BOUNCES_MAX)
   {
-    double d   /* Distanz von der Fläche */
-               /**
-                * |
-                * |
-                * |->  x
-                * |
-                * |
-                */
-         , dNN /* Distand vom Mittelpunkt der Fläche in Richtung der Flächenvektoren */
-               /**
-                * |---------|
-                * |         |
-                * |    ·  x |
-                * |         |
-                * |---------|
-                */
-         ;
-    
-    Vector3d middle         = getMiddle(face)                   /* Flächenmittelpunkt         */
-           , normal         = getNormal(face)                   /* Flächennormale             */
-           , neighborNormal = getNormal((face + 1) % FACE_TOP); /* Normale einer Nachbarseite */
-           ;
+    /* Rotation als Bewegungsrichtung missbrauchen */
+    Vector3d v = vectorScale(objectBall->r, speed, speed, speed);
     
-    /* Mittelpunkt und Normalen affinieren, also dahin schieben, wo das Object ist */
-    middle = vectorAdd(vectorRotateY(vectorScale(middle, o->s.x, o->s.y, o->s.z), o->a), o->t);
-    normal = vectorRotateY(normal, o->a);
-    neighborNormal = vectorRotateY(neighborNormal, o->a);
+    PhysicsHit hit;
     
-    /* Entfernungen berechnen */
-    d   = vectorMult(vectorSub(objectBall->t, middle), normal);
-    dNN = fabs(vectorMult(vectorSub(objectBall->t, middle), neighborNormal));
+    LogicObject o = findCollision(v, &hit);
     
-    /**
-     * Wenn der Ball sich auf die Fläche zubewegt und die Distanzen stimmen, 
-     * dann abprallen lassen
-     */
-    if (vectorMult(objectBall->r, normal) < 0.0 /* Ball in Richtung Fläche */
-     && d   > 0.0                               /* Ball vor der Fläche     */
-     && d   < LOGIC_BALL_RADIUS                 /* Ball knallt mangels Entfernung auf die Fläche */
-     && dNN + LOGIC_BALL_RADIUS < ((face == FACE_LEFT || face == FACE_RIGHT) ? o->s.z : o->s.x)) /* und fliegt nicht vorbei */
+    if (o == LOGIC_OBJECT_DUMMY)
     {
-      Vector3d invBallDir = vectorScale(objectBall->r, -1.0, -1.0, -1.0);
-      
-      double scale = 2.0 * vectorMult(normal, invBallDir);
+      objectBall->t = vectorAdd(objectBall->t, v);
+      speed         = 0.0;
+    }
+    else
+    {
+      objectBall->t = vectorAdd(objectBall->t, vectorScale(v, hit.t, hit.t, hit.t));
+      objectBall->r = physicsReflect(objectBall->r, hit.n);
+      speed        *= 1.0 - hit.t;
       
-      objectBall->r = vectorSub(vectorScale(normal, scale, scale, scale), invBallDir);
+      if (o == LOGIC_OBJECT_RACKET)
+      {
+        ballSpeed *= 1.05;
+        ++ints[LOGIC_INT_POINTS];
+      }
       
-      collision = TRUE;
+      ++bounces;
     }
   }
-}
-
-/**
- * Verändert die Farbe des Balls.
- *
- * @param[in] ball Der Ball.
- */
-static void switchBallColor(Object * ball)
-{
-  Material matBall = ball->m;
-
-  ball->m = (MAT_BALL0 + (rand() % (MAT_BALL5 - MAT_BALL0))) % MAT_BALL5;
-
-  if (ball->m == matBall)
-    ball->m += ball->m == MAT_BALL5
-             ? -1
-             : +1
-             ;
-}
-
-/**
- * Berechnet alle Kollisionen und lässt den Ball reflektieren.
- */
-static void calcCollision(void)
-{
-  static Object * objectWallCenter = &object[LOGIC_OBJECT_WALLCENTER]
-              , * objectWallLeft   = &object[LOGIC_OBJECT_WALLLEFT]
-              , * objectWallRight  = &object[LOGIC_OBJECT_WALLRIGHT]
-              , * objectWallFront  = &object[LOGIC_OBJECT_WALLFRONT]
-              , * objectRacket     = &object[LOGIC_OBJECT_RACKET]
-              , * objectCube0      = &object[LOGIC_OBJECT_CUBE0]
-              , * objectCube1      = &object[LOGIC_OBJECT_CUBE1]
-              , * objectBall       = &object[LOGIC_OBJECT_BALL]
-              ;
   
-  Vector3d ballDir = objectBall->r;
+  if (bounces > 0)
+    switchBallColor(objectBall);
   
-  /* Falls Cheat, dann Ball fangen */
-  if (switchable[LOGIC_SWITCHABLE_CHEAT])
-    reflectOn(objectWallFront);
-  else
+  /* Neu erzeugen, wenn der Ball das Spielfeld verlässt */
+  if (objectBall->t.z > 1.5)
   {
-    reflectOn(objectRacket);
+    objectBall->t          = vectorMake(0.0, 0.0, - 0.2);
+    objectBall->r          = makeBallDirection();
+    ballSpeed              = LOGIC_BALL_SPEED;
     
-    if (vectorLength(vectorSub(ballDir, objectBall->r)) > 0.0)
+    if (--ints[LOGIC_INT_LIFES] < 1)
     {
-      ballSpeed *= 1.05;
-      ++ints[LOGIC_INT_POINTS];
+      objectBall->t = vectorMakeNull();
+      objectBall->r = vectorMakeNull();
+      
+      fprintf(stdout, "Punkte : %i\n", ints[LOGIC_INT_POINTS]);
+      fprintf(stderr, "\n");
+      fprintf(stdout, "Game Over!\n");
+    }
+    else
+    {
+      fprintf(stdout, "Punkte : %i\n", ints[LOGIC_INT_POINTS]);
+      fprintf(stdout, "Leben  : %i\n", ints[LOGIC_INT_LIFES]);
+      fprintf(stderr, "\n");
     }
   }
   
-  reflectOn(objectWallCenter);
-  reflectOn(objectWallLeft);
-  reflectOn(objectWallRight);
-  reflectOn(objectCube0);
-  reflectOn(objectCube1);
-  
-  if (vectorLength(vectorSub(ballDir, objectBall->r)) > 0.0)
-    switchBallColor(objectBall);
+  if (ints[LOGIC_INT_LIFES] > 0)
+    objectBall->r = vectorNorm(objectBall->r);
 }
 
 /**
@@ -494,6 +407,8 @@ static void initObjects(void)
         , * shadowableByBall  = &objects[LOGIC_OBJECTS_SHADOWABLEBYBALL]
         ;
   
+  int i;
+  
   #ifdef DEBUG
   fprintf(stderr, "DEBUG :: Init : Initializing Objects.\n");
   #endif
@@ -614,6 +529,9 @@ static void initObjects(void)
                                  );
   }
   
+  for (i = 0; i < LOGIC_OBJECT_DUMMY; ++i)
+    physicsBodyInit(&body[i], &object[i]);
+  
   *level = *objectsInsert(level, objectBall,       *eye, *n);
   *level = *objectsInsert(level, objectWallLeft,   *eye, *n);
   *level = *objectsInsert(level, objectWallRight,  *eye, *n);
@@ -703,7 +621,6 @@ extern void logicCalcScene(double interval)
     
     calcRacket(interval);
     calcBall(interval);
-    calcCollision();
   }
     
   /* Blickrichtung normieren */
@@ -37,6 +37,8 @@ typedef enum {
 , LOGIC_SWITCHABLE_LIGHTRIGHT
 , LOGIC_SWITCHABLE_SHADOWS
 , LOGIC_SWITCHABLE_SHADOWVOLUMES
+, LOGIC_SWITCHABLE_ZFAIL
+, LOGIC_SWITCHABLE_SHADOWMAPS
 , LOGIC_SWITCHABLE_DUMMY
 } LogicSwitchable;
 
@@ -87,3 +87,16 @@ extern void materialSet(Material m)
   /* Farbe des Materials auf den Spekularen Anteil setzen */
   glColor4fv(material[m][LIGHT_SPECULAR]);
 }
+
+/**
+ * Gibt an, ob das Material m durchscheint und daher geblendet wird.
+ *
+ * @param[in] m Materialtyp.
+ *
+ * @return TRUE  wenn die diffuse Farbe von m nicht deckend ist
+ *         FALSE sonst.
+ */
+extern Boolean materialIsTranslucent(Material m)
+{
+  return material[m][LIGHT_DIFFUSE][3] < 1.0f ? TRUE : FALSE;
+}
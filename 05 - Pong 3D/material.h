@@ -9,6 +9,8 @@
  * @author Julius Beckmann
  */
 
+#include "types.h"
+
 /* Lichteigenschaften */
 typedef enum {
   LIGHT_AMBIENT
@@ -44,4 +46,14 @@ typedef float MaterialProps[MAT_DUMMY][LIGHT_DUMMY][4];
  */
 extern void materialSet(Material m);
 
+/**
+ * Gibt an, ob das Material m durchscheint und daher geblendet wird.
+ *
+ * @param[in] m Materialtyp.
+ *
+ * @return TRUE  wenn die diffuse Farbe von m nicht deckend ist
+ *         FALSE sonst.
+ */
+extern Boolean materialIsTranslucent(Material m);
+
 #endif
@@ -12,6 +12,10 @@
 
 #include <math.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 
 /* ---- Eigene Header einbinden ---- */
 
@@ -41,6 +45,38 @@
 
 /* ---- Funktionen ---- */
 
+#ifdef __SSE__
+/**
+ * Laedt die vier Spalten der Matrix m in SSE-Register.
+ * @param m Matrix.
+ * @param c Spalten von m.
+ */
+static void
+loadColumns (const GLfloat * m, __m128 c[4])
+{
+  c[0] = _mm_loadu_ps (m);
+  c[1] = _mm_loadu_ps (m + 4);
+  c[2] = _mm_loadu_ps (m + 8);
+  c[3] = _mm_loadu_ps (m + 12);
+}
+
+/**
+ * Bildet die Linearkombination der Spalten c mit den Koeffizienten v, also
+ * das Produkt der Matrix mit dem Vektor v.
+ * @param c Spalten der Matrix.
+ * @param v Vektor mit vier Komponenten.
+ * @return Produkt.
+ */
+static __m128
+combineColumns (const __m128 c[4], const GLfloat * v)
+{
+  return _mm_add_ps (_mm_add_ps (_mm_mul_ps (c[0], _mm_set1_ps (v[0])),
+                                 _mm_mul_ps (c[1], _mm_set1_ps (v[1]))),
+                     _mm_add_ps (_mm_mul_ps (c[2], _mm_set1_ps (v[2])),
+                                 _mm_mul_ps (c[3], _mm_set1_ps (v[3]))));
+}
+#endif
+
 
 /**
  * Normalisiert den Vektor v.
@@ -70,6 +106,12 @@ VectorNormalize (CGVector3f * v)
 void
 VectorMatrixMult (CGMatrix16f m, CGVector4f * v)
 {
+#ifdef __SSE__
+  __m128 c[4];
+
+  loadColumns (m, c);
+  _mm_storeu_ps (*v, combineColumns (c, *v));
+#else
   CGVector4f res = { 0.0f, 0.0f, 0.0f, 0.0f };
 
   res[0] = m[0] * (*v)[0] + m[4] * (*v)[1] + m[8] * (*v)[2] + m[12] * (*v)[3];
@@ -81,6 +123,42 @@ VectorMatrixMult (CGMatrix16f m, CGVector4f * v)
   (*v)[1] = res[1];
   (*v)[2] = res[2];
   (*v)[3] = res[3];
+#endif
+}
+
+/**
+ * Multipliziert die n Punkte points mit der Matrix m. Die Punkte haben je
+ * drei Koordinaten, die vierte wird als 1 angenommen.
+ * @param m Matrix, mit der die Punkte multipliziert werden sollen.
+ * @param points Punkte, je drei Koordinaten hintereinander.
+ * @param n Anzahl der Punkte.
+ * @param out Ergebnisse in homogenen Koordinaten.
+ *          Vorbedingung: out bietet Platz fuer n Vektoren.
+ */
+void
+TransformPoints (CGMatrix16f m, const GLfloat * points, GLsizei n,
+                 CGVector4f * out)
+{
+  GLsizei i;
+#ifdef __SSE__
+  __m128 c[4];
+
+  loadColumns (m, c);
+
+  for (i = 0; i < n; i++, points += 3)
+    _mm_storeu_ps (out[i],
+                   _mm_add_ps (_mm_add_ps (_mm_mul_ps (c[0], _mm_set1_ps (points[0])),
+                                           _mm_mul_ps (c[1], _mm_set1_ps (points[1]))),
+                               _mm_add_ps (_mm_mul_ps (c[2], _mm_set1_ps (points[2])),
+                                           c[3])));
+#else
+  int row;
+
+  for (i = 0; i < n; i++, points += 3)
+    for (row = 0; row < 4; row++)
+      out[i][row] = m[row] * points[0] + m[4 + row] * points[1] +
+                    m[8 + row] * points[2] + m[12 + row];
+#endif
 }
 
 /**
@@ -108,6 +186,19 @@ getIdentity (CGMatrix16f * m)
 void
 MatrixMatrixMult (CGMatrix16f * m1, CGMatrix16f m2)
 {
+#ifdef __SSE__
+  __m128 c[4], res[4];
+  unsigned int i = 0;
+
+  /* Erst alles rechnen, dann schreiben, m2 darf m1 sein */
+  loadColumns (*m1, c);
+
+  for (i = 0; i < 4; i++)
+    res[i] = combineColumns (c, m2 + 4 * i);
+
+  for (i = 0; i < 4; i++)
+    _mm_storeu_ps (*m1 + 4 * i, res[i]);
+#else
   CGMatrix16f res;
   unsigned int i = 0;
 
@@ -149,6 +240,7 @@ MatrixMatrixMult (CGMatrix16f * m1, CGMatrix16f m2)
 
   for (i = 0; i < 16; i++)
     (*m1)[i] = res[i];
+#endif
 }
 
 /**
@@ -271,3 +363,77 @@ void Scale (CGMatrix16f * m, CGVector3f v)
   /* Translation ausfuehren */
   MatrixMatrixMult (m, mScale);
 }
+
+/**
+ * Liefert die Inverse der Transformation, die erst um s skaliert, dann um
+ * den Winkel angle um die Achse rotAxis dreht und zuletzt um t verschiebt,
+ * also die Inverse von T * R * S. Sie wird direkt aus den Bestandteilen
+ * gebildet: die Inverse der Rotation ist ihre Transponierte, die der
+ * Skalierung und Translation sind die Kehrwerte bzw. die Negation.
+ * @param m die Inverse.
+ *          Vorbedingung: m ist ein Zeiger auf ein existierende Matrix.
+ *          Nachbedingung: m ist S^-1 * R^T * T^-1.
+ * @param t Translationsvektor.
+ * @param rotAxis Rotationsachse, der Nullvektor steht fuer keine Rotation.
+ * @param angle Rotationswinkel.
+ * @param s Skalierungsvektor, ohne 0-Komponenten.
+ */
+void
+getInverseTransform (CGMatrix16f * m, CGVector3f t, CGVector3f rotAxis,
+                     GLfloat angle, CGVector3f s)
+{
+  GLfloat c, si, omc, len;
+  GLfloat r[9]; /* Rotation, zeilenweise */
+  CGVector3f v;
+  int row, col;
+
+  len = (GLfloat) sqrt (rotAxis[0] * rotAxis[0] + rotAxis[1] * rotAxis[1] +
+                        rotAxis[2] * rotAxis[2]);
+
+  /* Ohne Achse keine Rotation */
+  if (len == 0.0f)
+    {
+      v[0] = 0.0f;
+      v[1] = 0.0f;
+      v[2] = 1.0f;
+      angle = 0.0f;
+    }
+  else
+    {
+      v[0] = rotAxis[0] / len;
+      v[1] = rotAxis[1] / len;
+      v[2] = rotAxis[2] / len;
+    }
+
+  c = (GLfloat) cos (DEG2RAD (angle));
+  si = (GLfloat) sin (DEG2RAD (angle));
+  omc = 1.0f - c;
+
+  /* Rotationsmatrix wie in Rotate */
+  r[0] = v[0] * v[0] * omc + c;
+  r[1] = v[0] * v[1] * omc - v[2] * si;
+  r[2] = v[0] * v[2] * omc + v[1] * si;
+
+  r[3] = v[1] * v[0] * omc + v[2] * si;
+  r[4] = v[1] * v[1] * omc + c;
+  r[5] = v[1] * v[2] * omc - v[0] * si;
+
+  r[6] = v[0] * v[2] * omc - v[1] * si;
+  r[7] = v[1] * v[2] * omc + v[0] * si;
+  r[8] = v[2] * v[2] * omc + c;
+
+  /* Zeile row der Inversen ist Spalte row der Rotation durch s[row] */
+  for (row = 0; row < 3; row++)
+    {
+      for (col = 0; col < 3; col++)
+        (*m)[col * 4 + row] = r[col * 3 + row] / s[row];
+
+      (*m)[12 + row] = -((*m)[row] * t[0] + (*m)[4 + row] * t[1] +
+                         (*m)[8 + row] * t[2]);
+    }
+
+  (*m)[3] = 0.0f;
+  (*m)[7] = 0.0f;
+  (*m)[11] = 0.0f;
+  (*m)[15] = 1.0f;
+}
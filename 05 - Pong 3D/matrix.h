@@ -4,7 +4,8 @@
  * @file
  * Schnittstelle des Matrix-Moduls.
  * Das Modul kapselt einige Matrixberechnungen. Die Funktionen sind an die
- * entsprechenden OpenGL-Funktionen angelehnt.
+ * entsprechenden OpenGL-Funktionen angelehnt. Wo der Compiler SSE anbietet,
+ * werden Matrixprodukte spaltenweise mit SSE berechnet.
  *
  * Bestandteil eines Beispielprogramms fuer Schatten mit OpenGL & GLUT.
  *
@@ -31,6 +32,18 @@ void VectorNormalize (CGVector3f * v);
  */
 void VectorMatrixMult (CGMatrix16f m, CGVector4f * v);
 
+/**
+ * Multipliziert die n Punkte points mit der Matrix m. Die Punkte haben je
+ * drei Koordinaten, die vierte wird als 1 angenommen.
+ * @param m Matrix, mit der die Punkte multipliziert werden sollen.
+ * @param points Punkte, je drei Koordinaten hintereinander.
+ * @param n Anzahl der Punkte.
+ * @param out Ergebnisse in homogenen Koordinaten.
+ *          Vorbedingung: out bietet Platz fuer n Vektoren.
+ */
+void TransformPoints (CGMatrix16f m, const GLfloat * points, GLsizei n,
+                      CGVector4f * out);
+
 /**
  * Liefert die Einheitsmatrix.
  * @param m die Einheitsmatrix.
@@ -82,4 +95,20 @@ void Translate (CGMatrix16f * m, CGVector3f v);
  */
 void Scale (CGMatrix16f * m, CGVector3f v);
 
+/**
+ * Liefert die Inverse der Transformation T * R * S, die erst um s skaliert,
+ * dann um den Winkel angle um die Achse rotAxis dreht und zuletzt um t
+ * verschiebt. Ersetzt die Kette aus getIdentity, Scale, Rotate und
+ * Translate mit den negierten Werten.
+ * @param m die Inverse.
+ *          Vorbedingung: m ist ein Zeiger auf ein existierende Matrix.
+ *          Nachbedingung: m ist S^-1 * R^T * T^-1.
+ * @param t Translationsvektor.
+ * @param rotAxis Rotationsachse, der Nullvektor steht fuer keine Rotation.
+ * @param angle Rotationswinkel.
+ * @param s Skalierungsvektor, ohne 0-Komponenten.
+ */
+void getInverseTransform (CGMatrix16f * m, CGVector3f t, CGVector3f rotAxis,
+                          GLfloat angle, CGVector3f s);
+
 #endif
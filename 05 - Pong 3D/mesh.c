@@ -0,0 +1,422 @@
+/**
+ * @file
+ *
+ * Das Modul laedt Dreiecksnetze aus Wavefront-OBJ-Dateien.
+ *
+ * Die Datei wird zeilenweise gelesen. Flaechen duerfen die Formen i, i/t,
+ * i//n und i/t/n haben, negative Indizes zaehlen vom zuletzt gelesenen
+ * Punkt zurueck. Texturkoordinaten und Normalen werden uebersprungen.
+ * OBJ-Dateien zaehlen die Ecken von aussen gesehen gegen den Uhrzeigersinn,
+ * die Dreiecke werden umgekehrt abgelegt, so wie initObjectFromTriangles
+ * sie erwartet.
+ *
+ * Beim Verschweissen wird jede Position auf ein Raster gerundet und unter
+ * den gerundeten Koordinaten in eine Hashtabelle mit linearem Sondieren
+ * eingetragen. Der erste Punkt einer Zelle bleibt, alle weiteren werden auf
+ * ihn umgelenkt.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "mesh.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Anfaengliche Anzahl der Punkte bzw. Dreiecke */
+#define MESH_CAPACITY (64)
+
+/** Laengste Zeile einer OBJ-Datei */
+#define MESH_LINE (1024)
+
+/** Raster beim Verschweissen nach dem Laden */
+#define MESH_WELD_EPSILON (1e-6)
+
+/** Kennzeichen eines freien Platzes in der Hashtabelle */
+#define MESH_EMPTY (0xFFFFFFFFUL)
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Initialisiert das leere Dreiecksnetz m.
+ *
+ * @param[out] m Dreiecksnetz.
+ */
+static void meshInit(Mesh * m)
+{
+  m->points           = NULL;
+  m->triangles        = NULL;
+  m->nPoints          = 0;
+  m->nTriangles       = 0;
+  m->pointCapacity    = 0;
+  m->triangleCapacity = 0;
+}
+
+/**
+ * Haengt den Punkt (x, y, z) an m an.
+ *
+ * @param[in] m Dreiecksnetz.
+ * @param[in] x x-Koordinate.
+ * @param[in] y y-Koordinate.
+ * @param[in] z z-Koordinate.
+ *
+ * @return TRUE  wenn der Punkt angehaengt wurde,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+static Boolean addPoint(Mesh * m, GLfloat x, GLfloat y, GLfloat z)
+{
+  if (m->nPoints == m->pointCapacity)
+  {
+    GLuint capacity = m->pointCapacity < MESH_CAPACITY
+                    ? MESH_CAPACITY
+                    : 2 * m->pointCapacity
+                    ;
+
+    GLfloat * points = realloc(m->points, capacity * 3 * sizeof(GLfloat));
+
+    if (points == NULL)
+      return FALSE;
+
+    m->points        = points;
+    m->pointCapacity = capacity;
+  }
+
+  m->points[3 * m->nPoints]     = x;
+  m->points[3 * m->nPoints + 1] = y;
+  m->points[3 * m->nPoints + 2] = z;
+
+  ++m->nPoints;
+
+  return TRUE;
+}
+
+/**
+ * Haengt das Dreieck (a, b, c) an m an.
+ *
+ * @param[in] m Dreiecksnetz.
+ * @param[in] a Erster Punktindex.
+ * @param[in] b Zweiter Punktindex.
+ * @param[in] c Dritter Punktindex.
+ *
+ * @return TRUE  wenn das Dreieck angehaengt wurde,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+static Boolean addTriangle(Mesh * m, GLuint a, GLuint b, GLuint c)
+{
+  if (m->nTriangles == m->triangleCapacity)
+  {
+    GLuint capacity = m->triangleCapacity < MESH_CAPACITY
+                    ? MESH_CAPACITY
+                    : 2 * m->triangleCapacity
+                    ;
+
+    GLuint * triangles = realloc(m->triangles, capacity * 3 * sizeof(GLuint));
+
+    if (triangles == NULL)
+      return FALSE;
+
+    m->triangles        = triangles;
+    m->triangleCapacity = capacity;
+  }
+
+  m->triangles[3 * m->nTriangles]     = a;
+  m->triangles[3 * m->nTriangles + 1] = b;
+  m->triangles[3 * m->nTriangles + 2] = c;
+
+  ++m->nTriangles;
+
+  return TRUE;
+}
+
+/**
+ * Liest die Flaeche aus der Zeile line und haengt sie als Faecher von
+ * Dreiecken an m an, mit umgekehrtem Umlaufsinn.
+ *
+ * @param[in] m    Dreiecksnetz.
+ * @param[in] line Zeile hinter dem "f".
+ *
+ * @return TRUE  wenn die Flaeche gelesen werden konnte,
+ *         FALSE bei ungueltigen Indizes oder wenn kein Speicher frei ist.
+ */
+static Boolean readFace(Mesh * m, char * line)
+{
+  GLuint first = 0
+       , prev  = 0
+       , index
+       ;
+
+  int corners = 0;
+
+  long i;
+
+  char * token;
+
+  for (token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n"))
+  {
+    /* Nur der Punktindex vor dem ersten '/' zaehlt */
+    i = strtol(token, NULL, 10);
+
+    if (i < 0)
+      i += (long) m->nPoints + 1;
+
+    if (i < 1 || i > (long) m->nPoints)
+      return FALSE;
+
+    index = (GLuint) (i - 1);
+
+    if (corners == 0)
+      first = index;
+    else if (corners >= 2 && !addTriangle(m, first, index, prev))
+      return FALSE;
+
+    prev = index;
+    ++corners;
+  }
+
+  return corners >= 3;
+}
+
+/**
+ * Berechnet einen Hashwert fuer die Rasterzelle (x, y, z).
+ *
+ * @param[in] x Zelle in x-Richtung.
+ * @param[in] y Zelle in y-Richtung.
+ * @param[in] z Zelle in z-Richtung.
+ *
+ * @return Hashwert.
+ */
+static unsigned long hashCell(long x, long y, long z)
+{
+  return ((unsigned long) x * 73856093UL)
+       ^ ((unsigned long) y * 19349663UL)
+       ^ ((unsigned long) z * 83492791UL);
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Laedt das Dreiecksnetz m aus der OBJ-Datei filename.
+ *
+ * @param[out] m        Dreiecksnetz.
+ * @param[in]  filename Name der Datei.
+ *
+ * @return TRUE  wenn die Datei gelesen werden konnte,
+ *         FALSE sonst.
+ */
+extern Boolean meshLoadObj(Mesh * m, const char * filename)
+{
+  char line[MESH_LINE];
+
+  float x
+      , y
+      , z
+      ;
+
+  Boolean ok = TRUE;
+
+  unsigned long lineNumber = 0;
+
+  FILE * file = fopen(filename, "r");
+
+  meshInit(m);
+
+  if (file == NULL)
+  {
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Mesh : Could not open %s.\n", filename);
+    #endif
+
+    return FALSE;
+  }
+
+  while (ok && fgets(line, sizeof(line), file) != NULL)
+  {
+    ++lineNumber;
+
+    /* Punkt */
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+      ok = sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3
+        && addPoint(m, x, y, z);
+
+    /* Flaeche */
+    else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+      ok = readFace(m, line + 2);
+
+    /* Alles andere (vt, vn, g, usemtl, Kommentare, ...) wird uebersprungen */
+  }
+
+  fclose(file);
+
+  if (!ok)
+  {
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Mesh : Error in %s, line %lu.\n", filename, lineNumber);
+    #endif
+
+    meshFree(m);
+
+    return FALSE;
+  }
+
+  /* Ohne Verschweissen bleibt das Netz, nur ohne Nachbarn an den Naehten */
+  meshWeld(m, MESH_WELD_EPSILON);
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Mesh : %s: %u points, %u triangles.\n", filename, m->nPoints, m->nTriangles);
+  #endif
+
+  return TRUE;
+}
+
+/**
+ * Verschweisst die Punkte von m, die im selben Raster der Weite epsilon
+ * liegen, und entfernt dabei entartete Dreiecke.
+ *
+ * @param[in] m       Dreiecksnetz.
+ * @param[in] epsilon Weite des Rasters.
+ *
+ * @return TRUE  wenn verschweisst wurde,
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+extern Boolean meshWeld(Mesh * m, double epsilon)
+{
+  unsigned long size = 1
+              , mask
+              , h
+              ;
+
+  GLuint * table   /* Hashtabelle, Index des ersten Punktes einer Zelle */
+       , * remap   /* Neuer Index jedes alten Punktes                   */
+       , i
+       , j
+       , count = 0
+       , kept  = 0
+       ;
+
+  long cell[3];
+
+  double scale = epsilon > 0.0 ? 1.0 / epsilon : 1.0;
+
+  /* Tabelle hoechstens halb voll */
+  while (size < 2UL * m->nPoints)
+    size <<= 1;
+
+  mask = size - 1;
+
+  table = malloc(size * sizeof(GLuint));
+  remap = malloc((m->nPoints + 1) * sizeof(GLuint));
+
+  if (table == NULL || remap == NULL)
+  {
+    free(table);
+    free(remap);
+
+    return FALSE;
+  }
+
+  for (h = 0; h < size; ++h)
+    table[h] = (GLuint) MESH_EMPTY;
+
+  for (i = 0; i < m->nPoints; ++i)
+  {
+    const GLfloat * p = &m->points[3 * i];
+
+    /* Ohne Raster zaehlen nur exakt gleiche Positionen */
+    for (j = 0; j < 3; ++j)
+      cell[j] = epsilon > 0.0 ? (long) floor(p[j] * scale + 0.5) : 0;
+
+    h = epsilon > 0.0
+      ? hashCell(cell[0], cell[1], cell[2]) & mask
+      : hashCell((long) (p[0] * 1e4), (long) (p[1] * 1e4), (long) (p[2] * 1e4)) & mask
+      ;
+
+    /* Zelle suchen, die Punkte in der Tabelle haben schon ihre neuen Indizes */
+    for (; table[h] != (GLuint) MESH_EMPTY; h = (h + 1) & mask)
+    {
+      const GLfloat * q = &m->points[3 * table[h]];
+
+      if (epsilon > 0.0
+        ? (long) floor(q[0] * scale + 0.5) == cell[0]
+       && (long) floor(q[1] * scale + 0.5) == cell[1]
+       && (long) floor(q[2] * scale + 0.5) == cell[2]
+        : q[0] == p[0] && q[1] == p[1] && q[2] == p[2])
+        break;
+    }
+
+    /* Neue Zelle: Punkt nach vorn ruecken */
+    if (table[h] == (GLuint) MESH_EMPTY)
+    {
+      memmove(&m->points[3 * count], p, 3 * sizeof(GLfloat));
+
+      table[h] = count;
+      remap[i] = count;
+
+      ++count;
+    }
+    else
+      remap[i] = table[h];
+  }
+
+  m->nPoints = count;
+
+  /* Dreiecke umlenken, entartete entfallen */
+  for (i = 0; i < m->nTriangles; ++i)
+  {
+    GLuint a = remap[m->triangles[3 * i]]
+         , b = remap[m->triangles[3 * i + 1]]
+         , c = remap[m->triangles[3 * i + 2]]
+         ;
+
+    if (a == b || b == c || c == a)
+      continue;
+
+    m->triangles[3 * kept]     = a;
+    m->triangles[3 * kept + 1] = b;
+    m->triangles[3 * kept + 2] = c;
+
+    ++kept;
+  }
+
+  m->nTriangles = kept;
+
+  free(table);
+  free(remap);
+
+  return TRUE;
+}
+
+/**
+ * Gibt den Speicher des Dreiecksnetzes m frei.
+ *
+ * @param[in] m Dreiecksnetz.
+ */
+extern void meshFree(Mesh * m)
+{
+  free(m->points);
+  free(m->triangles);
+
+  meshInit(m);
+}
@@ -0,0 +1,65 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+/**
+ * @file
+ *
+ * Das Modul laedt Dreiecksnetze aus Wavefront-OBJ-Dateien, etwa fuer
+ * schattenwerfende Objekte (initObjectFromTriangles). Gelesen werden nur
+ * Punkte (v) und Flaechen (f), Vielecke werden als Faecher in Dreiecke
+ * zerlegt. Punkte mit gleicher Position werden verschweisst, damit
+ * benachbarte Dreiecke ihre Kanten ueber gleiche Indizes teilen. Die
+ * Dreiecke liegen von aussen gesehen im Uhrzeigersinn vor, umgekehrt zur
+ * Datei.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+#include <GL/gl.h>
+
+#include "types.h"
+
+/** Dreiecksnetz */
+typedef struct {
+  GLfloat * points;      /* Punkte, je drei Koordinaten              */
+  GLuint * triangles;    /* Dreiecke, je drei Indizes, Uhrzeigersinn */
+
+  GLuint nPoints
+       , nTriangles
+       , pointCapacity   /* Platz in points, in Punkten              */
+       , triangleCapacity/* Platz in triangles, in Dreiecken         */
+       ;
+} Mesh;
+
+/**
+ * Laedt das Dreiecksnetz m aus der OBJ-Datei filename und verschweisst es
+ * mit meshWeld.
+ *
+ * @param[out] m        Dreiecksnetz.
+ * @param[in]  filename Name der Datei.
+ *
+ * @return TRUE  wenn die Datei gelesen werden konnte,
+ *         FALSE sonst, m ist dann leer.
+ */
+extern Boolean meshLoadObj(Mesh * m, const char * filename);
+
+/**
+ * Verschweisst die Punkte von m, die im selben Raster der Weite epsilon
+ * liegen, und entfernt Dreiecke, die dabei zu Kanten oder Punkten werden.
+ * Gesucht wird ueber eine Hashtabelle, der Aufwand ist linear.
+ *
+ * @param[in] m       Dreiecksnetz.
+ * @param[in] epsilon Weite des Rasters, 0 fuer exakt gleiche Positionen.
+ *
+ * @return TRUE  wenn verschweisst wurde,
+ *         FALSE wenn kein Speicher mehr frei ist, m bleibt dann unveraendert.
+ */
+extern Boolean meshWeld(Mesh * m, double epsilon);
+
+/**
+ * Gibt den Speicher des Dreiecksnetzes m frei.
+ *
+ * @param[in] m Dreiecksnetz.
+ */
+extern void meshFree(Mesh * m);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef __MIPMAP_H__
+#define __MIPMAP_H__
+/**
+ * @file
+ *
+ * Das Modul erzeugt Mipmap-Ketten auf der CPU und laedt sie Stufe fuer Stufe
+ * mit glTexImage2D hoch. Es ersetzt gluBuild2DMipmaps.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+#include <GL/gl.h>
+
+#include "cgimage.h"
+#include "types.h"
+
+/** Funktion, die die Zeilen [y0, y1) eines Auftrags berechnet */
+typedef void (* MipmapRowFunction)(const void * data, int y0, int y1);
+
+/**
+ * Erzeugt alle Mipmap-Stufen des Bildes image mit einem 2x2-Boxfilter und
+ * laedt sie in die gerade gebundene GL_TEXTURE_2D hoch.
+ * Bilder, deren Ausmasse keine Zweierpotenzen sind, werden vorher wie bei
+ * gluBuild2DMipmaps skaliert. Der Zeilenabstand von image wird beachtet, die
+ * erste Stufe wird ohne Kopie hochgeladen.
+ *
+ * @param[in] image  Bild, auch eine Ansicht (CGImage_view) eines groesseren.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu image->bpp.
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind und
+ *                   linear gemittelt werden sollen.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapBuild2D(const CGImage * image, GLenum format, Boolean srgb);
+
+/**
+ * Erzeugt die Stufen 0 bis levels - 1 des Bildes image als Kachel eines
+ * Texturatlas und laedt sie per glTexSubImage2D in die gerade gebundene
+ * GL_TEXTURE_2D hoch. Das Bild wird auf das Innere der Kachel skaliert, der
+ * Rand gutter wiederholt auf jeder Stufe deren Randpixel, so dass beim
+ * Filtern nichts von benachbarten Kacheln einfliesst.
+ *
+ * @param[in] image  Bild, auch eine Ansicht (CGImage_view) eines groesseren.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu image->bpp.
+ * @param[in] srgb   TRUE, wenn die Farbkanaele sRGB-kodiert sind und
+ *                   linear gemittelt werden sollen.
+ * @param[in] x      Linke Kante der Kachel auf Stufe 0.
+ * @param[in] y      Obere Kante der Kachel auf Stufe 0.
+ * @param[in] width  Breite der Kachel samt Rand auf Stufe 0.
+ * @param[in] height Hoehe der Kachel samt Rand auf Stufe 0.
+ * @param[in] gutter Breite des Randes auf Stufe 0.
+ * @param[in] levels Anzahl der Stufen. x, y, width, height und gutter
+ *                   muessen Vielfache von 2^(levels - 1) sein.
+ * @param[out] out   Wenn nicht NULL: neu angelegter Speicher mit allen
+ *                   hochgeladenen Stufen samt Rand, dicht gepackt
+ *                   hintereinander, etwa fuer den Textur-Cache. Der
+ *                   Aufrufer gibt ihn mit free frei.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapBuildTile(const CGImage * image, GLenum format, Boolean srgb, int x, int y, int width, int height, int gutter, int levels, unsigned char ** out);
+
+/**
+ * Laedt fertig berechnete Stufen in eine Kachel der gerade gebundenen
+ * GL_TEXTURE_2D hoch, etwa analytisch erzeugte Muster, die nicht gefiltert
+ * werden muessen. Der Rand wird wie bei mipmapBuildTile gebildet.
+ *
+ * @param[in] images Stufen, images[i] hat die Ausmasse des Inneren der
+ *                   Kachel geteilt durch 2^i.
+ * @param[in] format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB oder GL_RGBA,
+ *                   passend zu den Bildern.
+ * @param[in] x      Linke Kante der Kachel auf Stufe 0.
+ * @param[in] y      Obere Kante der Kachel auf Stufe 0.
+ * @param[in] width  Breite der Kachel samt Rand auf Stufe 0.
+ * @param[in] height Hoehe der Kachel samt Rand auf Stufe 0.
+ * @param[in] gutter Breite des Randes auf Stufe 0.
+ * @param[in] levels Anzahl der Stufen, wie bei mipmapBuildTile.
+ *
+ * @return 1 wenn alle Stufen hochgeladen wurden
+ *         0 sonst.
+ */
+extern int mipmapUploadTile(const CGImage * const * images, GLenum format, int x, int y, int width, int height, int gutter, int levels);
+
+/**
+ * Fuehrt f fuer die Zeilen [0, rows) aus, bei genuegend Zeilen verteilt auf
+ * dieselben Threads, mit denen auch die Stufen berechnet werden. f darf nur
+ * die eigenen Zeilen schreiben.
+ *
+ * @param[in] f    Zeilenfunktion.
+ * @param[in] data Daten des Auftrags, von allen Threads gelesen.
+ * @param[in] rows Anzahl der Zeilen.
+ */
+extern void mipmapParallelRows(MipmapRowFunction f, const void * data, int rows);
+
+#endif
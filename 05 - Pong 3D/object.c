@@ -18,6 +18,7 @@
 #include "types.h"
 #include "drawing.h"
 #include "logic.h"
+#include "matrix.h"
 
 /* ----------------------------------------------------------------------------
  * Funktionen
@@ -123,6 +124,8 @@ static Object objectMake(Figure f, Vector3d t, Vector3d r, Vector3d s, double a,
   
   o.z = 0;
   
+  o.inverse.valid = FALSE;
+  
   return o;
 }
 
@@ -246,6 +249,19 @@ extern Object objectMakeKegel(Vector3d t, Vector3d r, Vector3d s, double a, Text
  * @param[in] o Zu zeichnendes Objekt.
  */
 extern void objectDraw(Object * o)
+{
+  /* Material setzen */
+  materialSet(o->m);
+  
+  objectDrawShape(o);
+}
+
+/**
+ * Zeichnet die Figur des Objekts o, ohne das Material zu setzen.
+ *
+ * @param[in] o Zu zeichnendes Objekt.
+ */
+extern void objectDrawShape(const Object * o)
 {
   glPushMatrix();
     /* Affinieren */
@@ -253,14 +269,49 @@ extern void objectDraw(Object * o)
     glRotatef(o->a, o->r.x, o->r.y, o->r.z);
     glScalef(o->s.x, o->s.y, o->s.z);
     
-    /* Material setzen */
-    materialSet(o->m);
-    
     /* Zeichnen */
     o->d(o->tex);
   glPopMatrix();
 }
 
+/**
+ * Gibt die Inverse der Transformation des Objekts o zurück.
+ *
+ * @param[in] o Objekt.
+ *
+ * @return Inverse Transformation.
+ */
+extern GLfloat * objectGetInverse(Object * o)
+{
+  ObjectInverse * inv = &o->inverse;
+  
+  CGVector3f t
+           , r
+           , s
+           ;
+  
+  if (inv->valid
+   && inv->a   == o->a
+   && inv->t.x == o->t.x && inv->t.y == o->t.y && inv->t.z == o->t.z
+   && inv->r.x == o->r.x && inv->r.y == o->r.y && inv->r.z == o->r.z
+   && inv->s.x == o->s.x && inv->s.y == o->s.y && inv->s.z == o->s.z)
+    return inv->m;
+  
+  t[0] = o->t.x; t[1] = o->t.y; t[2] = o->t.z;
+  r[0] = o->r.x; r[1] = o->r.y; r[2] = o->r.z;
+  s[0] = o->s.x; s[1] = o->s.y; s[2] = o->s.z;
+  
+  getInverseTransform(&inv->m, t, r, o->a, s);
+  
+  inv->t     = o->t;
+  inv->r     = o->r;
+  inv->s     = o->s;
+  inv->a     = o->a;
+  inv->valid = TRUE;
+  
+  return inv->m;
+}
+
 /**
  * Erzeugt ein Objects und gibt es initialisiert zurück.
  *
@@ -32,6 +32,20 @@ typedef enum {
 , FIGURE_KEGEL    /* A Kegel    */
 } Figure;
 
+/** Zwischengespeicherte inverse Transformation eines Objekts */
+typedef struct {
+  Vector3d t        /* Translation, für die m gilt */
+         , r        /* Rotationsachse              */
+         , s        /* Skalierung                  */
+         ;
+  
+  double a;         /* Rotationswinkel             */
+  
+  Boolean valid;    /* m berechnet                 */
+  
+  CGMatrix16f m;    /* Inverse Transformation      */
+} ObjectInverse;
+
 /** Object */
 typedef struct {
   Figure f;  /* Type of Figure */
@@ -53,6 +67,8 @@ typedef struct {
        ;
        
   int z;
+  
+  ObjectInverse inverse; /* Nur über objectGetInverse benutzen */
 } Object;
 
 /** Objektsammlungen */
@@ -137,6 +153,25 @@ extern Object objectMakeKegel(Vector3d t, Vector3d r, Vector3d s, double a, Text
  */
 extern void objectDraw(Object * o);
 
+/**
+ * Zeichnet die Figur des Objekts o, ohne das Material zu setzen.
+ *
+ * @param[in] o Zu zeichnendes Objekt.
+ */
+extern void objectDrawShape(const Object * o);
+
+/**
+ * Gibt die Inverse der Transformation des Objekts o zurück, mit der Welt- in
+ * Objektkoordinaten umgerechnet werden. Sie wird nur neu berechnet, wenn
+ * sich Verschiebung, Rotation oder Skalierung von o geändert haben.
+ *
+ * @param[in] o Objekt.
+ *
+ * @return Inverse Transformation, spaltenweise, gültig bis zur nächsten
+ *         Änderung von o, nicht verändern.
+ */
+extern GLfloat * objectGetInverse(Object * o);
+
 /**
  * Erzeugt ein Objects und gibt es initialisiert zurück.
  *
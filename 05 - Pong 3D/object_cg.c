@@ -14,7 +14,12 @@
 /* ----------------------------------------------------------------------------
  * System Header einbinden
  * -------------------------------------------------------------------------- */
+#define GL_GLEXT_PROTOTYPES
+
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GL/glu.h>
 
 /* ----------------------------------------------------------------------------
@@ -22,6 +27,7 @@
  * -------------------------------------------------------------------------- */
 #include "object_cg.h"
 #include "vector.h"
+#include "matrix.h"
 
 /* ----------------------------------------------------------------------------
  * Konstanten
@@ -30,162 +36,375 @@
 /** Laenge der Kanten des Schattenvolumens */
 #define INFINITY (25)
 
+/** Anfaengliche Anzahl der Eckpunkte eines Schattenvolumens */
+#define SHADOW_VOLUME_CAPACITY (96)
+
+/** Kleinstes w eines projizierten Punktes, der noch vor dem Auge liegt.
+    Grosszuegig, weil in float gerechnet wird. */
+#define SHADOW_MIN_W (1e-4)
+
+/** Anzahl der Punkte, die extendShadowBounds auf einmal projiziert */
+#define SHADOW_BOUNDS_BATCH (64)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/** Bietet GL Vertex Buffer Objects an? -1 = noch nicht geprueft */
+static int hasVBO = -1;
+
+/** Bietet GL Depth Clamping an? -1 = noch nicht geprueft */
+static int hasDepthClamp = -1;
+
+/** Wie der Stencilpuffer beide Seiten in einem Durchlauf behandeln kann */
+typedef enum
+{
+  STENCIL_UNKNOWN = -1,
+  /** Gar nicht, zwei Durchlaeufe mit Culling */
+  STENCIL_TWO_PASS,
+  /** glStencilOpSeparate, ab OpenGL 2.0 */
+  STENCIL_SEPARATE,
+  /** GL_EXT_stencil_two_side zusammen mit Wrap-Operationen */
+  STENCIL_TWO_SIDE_EXT
+} StencilMode;
+
+/** Verfuegbare Art der zweiseitigen Stenciloperationen */
+static StencilMode stencilMode = STENCIL_UNKNOWN;
+
+/** Kante in der Hashtabelle von setConnectivity */
+typedef struct
+{
+  /** Kleinerer Punktindex. */
+  GLuint p1;
+
+  /** Groesserer Punktindex. */
+  GLuint p2;
+
+  /** 3 * Flaeche + Kante, die auf ihren Nachbarn wartet, oder EDGE_... */
+  GLint edge;
+} CGEdge;
+
+/** Platz in der Hashtabelle der Kanten ist frei */
+#define EDGE_EMPTY (-1)
+
+/** Kante hat ihren Nachbarn gefunden */
+#define EDGE_PAIRED (-2)
+
+/** Eckpunkte des Wuerfels */
+static const GLfloat cubePoints[8 * 3] = {
+  -0.5f, -0.5f, +0.5f,
+  +0.5f, -0.5f, +0.5f,
+  +0.5f, +0.5f, +0.5f,
+  -0.5f, +0.5f, +0.5f,
+  -0.5f, -0.5f, -0.5f,
+  +0.5f, -0.5f, -0.5f,
+  +0.5f, +0.5f, -0.5f,
+  -0.5f, +0.5f, -0.5f
+};
+
+/** Dreiecksflaechen des Wuerfels, je drei Indizes in cubePoints, von aussen
+    gesehen im Uhrzeigersinn */
+static const GLuint cubeTriangles[12 * 3] = {
+  0, 2, 1,
+  0, 3, 2,
+  4, 5, 6,
+  4, 6, 7,
+  4, 3, 0,
+  4, 7, 3,
+  2, 5, 1,
+  2, 6, 5,
+  4, 0, 1,
+  4, 1, 5,
+  2, 3, 7,
+  2, 7, 6
+};
+
+/** Viewport waehrend des Schattendurchlaufs */
+static GLint shadowViewport[4];
+
+/** Vom Schatten betroffenes Bildschirmrechteck: x0, y0, x1, y1 */
+static GLint shadowBounds[4];
+
 /* ----------------------------------------------------------------------------
  * Funktionen
  * ----------------------------------------------------------------------------
  * Static
  * -------------------------------------------------------------------------- */
 
+/**
+ * Berechnet einen Hashwert fuer die Kante mit den Punktindizes p1 < p2.
+ * @param p1 Kleinerer Punktindex.
+ * @param p2 Groesserer Punktindex.
+ * @return Hashwert.
+ */
+static unsigned long hashEdge(GLuint p1, GLuint p2)
+{
+  return ((unsigned long) p1 * 73856093UL) ^ ((unsigned long) p2 * 19349663UL);
+}
+
 /**
  * Berechnet die Nachbarschaftsbeziehungen der Flaechen des Objekts obj.
- * Angelehnt an den Algorithmus von http://www.gamasutra.com/
+ * Jede Kante wird unter ihren beiden Punktindizes in eine Hashtabelle
+ * eingetragen. Trifft eine Flaeche auf eine Kante, die schon eingetragen ist
+ * und noch auf ihren Partner wartet, sind die beiden Flaechen benachbart.
+ * Damit ist der Aufwand linear in der Anzahl der Flaechen.
  * @param obj Objekt, fuer dessen Flaechen die Nachbarschaftsbeziehungen
  *            berechnet werden sollen.
- *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
+ *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt,
+ *                          alle neighIdx sind -1.
  *            Nachbedingung: die Nachbarschaftsbeziehungen der Flaechen von obj
  *                           wurden berechnet.
+ * @return GL_FALSE, wenn kein Speicher fuer die Tabelle frei ist.
  */
-static void setConnectivity(CGObject * obj)
+static GLboolean setConnectivity(CGObject * obj)
 {
-  unsigned int p1i, p2i, p1j, p2j;
-  unsigned int P1i, P2i, P1j, P2j;
-  unsigned int i, j, ki, kj;
+  CGEdge *table;
+  unsigned long size = 1, mask, h;
+  GLuint i, k, p1, p2;
+  GLint edge, other;
+
+  /* Tabelle hoechstens halb voll */
+  while (size < 2UL * 3UL * obj->nPlanes)
+    size <<= 1;
+
+  mask = size - 1;
 
-  /* Fuer alle Flaechen des Objekts */
-  for (i = 0; i < obj->nPlanes - 1; i++)
+  table = malloc (size * sizeof (CGEdge));
+
+  if (table == NULL)
+    return GL_FALSE;
+
+  for (h = 0; h < size; h++)
+    table[h].edge = EDGE_EMPTY;
+
+  /* Fuer jede Kante jeder Flaeche */
+  for (i = 0; i < obj->nPlanes; i++)
     {
-      /* Fuer alle noch folgenden Flaechen */
-      for (j = i + 1; j < obj->nPlanes; j++)
+      for (k = 0; k < 3; k++)
         {
-          /* Fuer jede Kante der Flaeche */
-          for (ki = 0; ki < 3; ki++)
+          p1 = obj->planes[i].pointIdx[k];
+          p2 = obj->planes[i].pointIdx[(k + 1) % 3];
+
+          /* Indizes so ordnen, das p1 immer kleiner p2 ist */
+          if (p1 > p2)
+            {
+              GLuint p = p1;
+              p1 = p2;
+              p2 = p;
+            }
+
+          edge = (GLint) (3 * i + k);
+
+          /* Lineares Sondieren bis zur Kante oder einem freien Platz */
+          for (h = hashEdge (p1, p2) & mask;
+               table[h].edge != EDGE_EMPTY &&
+               (table[h].p1 != p1 || table[h].p2 != p2);
+               h = (h + 1) & mask)
+            ;
+
+          other = table[h].edge;
+
+          /* Die Flaechen sind benachbart */
+          if (other >= 0)
+            {
+              obj->planes[i].neighIdx[k] = other / 3;
+              obj->planes[other / 3].neighIdx[other % 3] = (GLint) i;
+
+              table[h].edge = EDGE_PAIRED;
+            }
+
+          /* Neue Kante oder eine, deren Paar schon vergeben ist: warten */
+          else
             {
-              /* Wenn noch kein Nachbar gesetzt wurde */
-              if (obj->planes[i].neighIdx[ki] == -1)
-                {
-                  /* Fuer jede Kante der nachfolgenden Flaeche */
-                  for (kj = 0; kj < 3; kj++)
-                    {
-                      /* Index des ersten Punktes der Kante ki der Flaeche i
-                         im Array der Eckpunkte der Flaeche i */
-                      p1i = ki;
-                      /* Index des zweiten Punktes der Kante ki der Flaeche i
-                         im Array der Eckpunkte der Flaeche i */
-                      p2i = (ki + 1) % 3;
-                      /* Index des ersten Punktes der Kante kj der Flaeche j
-                         im Array der Eckpunkte der Flaeche j */
-                      p1j = kj;
-                      /* Index des zweiten Punktes der Kante kj der Flaeche j
-                         im Array der Eckpunkte der Flaeche j */
-                      p2j = (kj + 1) % 3;
-
-                      /* Index des ersten Punktes der Kante ki der Flaeche i
-                         im Array der Punkte des Objekts */
-                      p1i = obj->planes[i].pointIdx[p1i];
-                      /* Index des zweiten Punktes der Kante ki der Flaeche i
-                         im Array der Punkte des Objekts */
-                      p2i = obj->planes[i].pointIdx[p2i];
-                      /* Index des ersten Punktes der Kante kj der Flaeche j
-                         im Array der Punkte des Objekts */
-                      p1j = obj->planes[j].pointIdx[p1j];
-                      /* Index des zweiten Punktes der Kante kj der Flaeche j
-                         im Array der Punkte des Objekts */
-                      p2j = obj->planes[j].pointIdx[p2j];
-
-                      /* Indizes so umrechnen, das P1 immer kleiner P2 ist */
-                      P1i = ((p1i + p2i) - abs (p1i - p2i)) / 2;
-                      P2i = ((p1i + p2i) + abs (p1i - p2i)) / 2;
-                      P1j = ((p1j + p2j) - abs (p1j - p2j)) / 2;
-                      P2j = ((p1j + p2j) + abs (p1j - p2j)) / 2;
-
-                      /* Die Flaechen sind benachbart */
-                      if ((P1i == P1j) && (P2i == P2j))
-                        {
-                          obj->planes[i].neighIdx[ki] = j;
-                          obj->planes[j].neighIdx[kj] = i;
-                        }
-                    }
-                }
+              table[h].p1 = p1;
+              table[h].p2 = p2;
+              table[h].edge = edge;
             }
         }
     }
+
+  free (table);
+
+  return GL_TRUE;
 }
 
 /**
- * Zeichnet das Schattenvolumen, welches das Objekts obj fuer eine
- * Punktlichtquelle mit der Position lightPos erzeugt.
- * @param obj Objekt, dessen Schattenvolumen gezeichnet werden soll.
- *            Vorbedingung: die Sichtbarkeit der Flaechen von der Position der
- *                          Lichtquelle aus ist bereits berechnet.
- * @param lightPos Position der Lichtquelle, relativ zum Nullpunkt des Objekts
- *                 obj (also in Objektkoordinaten).
+ * Prueft, ob GL mindestens in der Version major.minor vorliegt.
+ * @param major Hauptversion.
+ * @param minor Unterversion.
+ * @return GL_TRUE, wenn die Version mindestens major.minor ist.
  */
-void drawShadowVolume(CGObject obj, CGVector4f lightPos)
+GLboolean hasGLVersion (int major, int minor)
 {
-  unsigned int i, j;
-  int k;
+  const char * version = (const char *) glGetString (GL_VERSION);
+  int glMajor = 0, glMinor = 0;
 
-  unsigned int p1, p2;
-  CGVector3f v1, v2;
+  if (version)
+    sscanf (version, "%d.%d", &glMajor, &glMinor);
 
-  /* fuer alle Flaechen des Objekts */
-  for (i = 0; i < obj.nPlanes; i++)
+  return glMajor > major || (glMajor == major && glMinor >= minor);
+}
+
+/**
+ * Prueft, ob GL die Erweiterung name anbietet.
+ * @param name Name der Erweiterung.
+ * @return GL_TRUE, wenn die Erweiterung vorhanden ist.
+ */
+GLboolean hasGLExtension (const char * name)
+{
+  const char * extensions = (const char *) glGetString (GL_EXTENSIONS);
+  const char * found;
+  size_t len = strlen (name);
+
+  if (extensions == NULL)
+    return GL_FALSE;
+
+  /* Nur ganze Namen zaehlen, nicht Anfaenge laengerer Namen */
+  for (found = strstr (extensions, name); found != NULL;
+       found = strstr (found + len, name))
+    if ((found == extensions || found[-1] == ' ') &&
+        (found[len] == ' ' || found[len] == '\0'))
+      return GL_TRUE;
+
+  return GL_FALSE;
+}
+
+/**
+ * Prueft, ob GL Vertex Buffer Objects anbietet (ab Version 1.5).
+ * @return GL_TRUE, wenn VBOs benutzt werden koennen.
+ */
+static GLboolean checkVBO(void)
+{
+  if (hasVBO < 0)
+    hasVBO = hasGLVersion (1, 5);
+
+  return (GLboolean) hasVBO;
+}
+
+/**
+ * Prueft, ob GL Depth Clamping anbietet (ab Version 3.2 oder als
+ * Erweiterung). Damit werden die fernen Kappen beim z-fail nicht von der
+ * fernen Clipping-Ebene abgeschnitten.
+ * @return GL_TRUE, wenn GL_DEPTH_CLAMP benutzt werden kann.
+ */
+static GLboolean checkDepthClamp(void)
+{
+  if (hasDepthClamp < 0)
+    hasDepthClamp = hasGLVersion (3, 2) ||
+                    hasGLExtension ("GL_ARB_depth_clamp") ||
+                    hasGLExtension ("GL_NV_depth_clamp");
+
+  return (GLboolean) hasDepthClamp;
+}
+
+/**
+ * Bestimmt, wie Vorder- und Rueckseiten in einem Durchlauf verschieden in
+ * den Stencilpuffer geschrieben werden koennen. Da die Reihenfolge der
+ * Flaechen dann beliebig ist, werden Wrap-Operationen gebraucht.
+ * @return Art der zweiseitigen Stenciloperationen.
+ */
+static StencilMode checkStencilMode(void)
+{
+  if (stencilMode == STENCIL_UNKNOWN)
     {
-      /* wenn die Flaeche dem Licht zugewandt ist */
-      if (obj.planes[i].visible)
-        {
-          /* Fuer alle Kanten der Flaeche */
-          for (j = 0; j < 3; j++)
-            {
-              /* Index der Nachbarflaeche */
-              k = obj.planes[i].neighIdx[j];
-
-              /* Wenn es eine Nachbarflaeche gibt und diese vom Licht abgewandt
-                 ist */
-              if ((k != -1) && (!obj.planes[k].visible))
-                {
-                  /* Diese beiden Flaechen haben eine dazwischenliengende
-                     Kante, die fuer die Silhouette relevant ist. */
-                  /* Index des ersten Punktes dieser Kante in der Liste der
-                     Punkte des Objektes */
-                  p1 = obj.planes[i].pointIdx[j];
-                  /* Index des zweiten Punktes dieser Kante in der Liste der
-                     Punkte des Objektes */
-                  p2 = obj.planes[i].pointIdx[(j + 1) % 3];
-
-                  /* Vektoren von der Lichtquelle aus ueber die beiden Punkte
-                     der Kante hinaus berechnen. Ihre Laenge haengt vom
-                     eingestellten Wert fuer INFINITY ab */
-                  v1[0] = (obj.points[p1][0] - lightPos[0]) * INFINITY;
-                  v1[1] = (obj.points[p1][1] - lightPos[1]) * INFINITY;
-                  v1[2] = (obj.points[p1][2] - lightPos[2]) * INFINITY;
-
-                  v2[0] = (obj.points[p2][0] - lightPos[0]) * INFINITY;
-                  v2[1] = (obj.points[p2][1] - lightPos[1]) * INFINITY;
-                  v2[2] = (obj.points[p2][2] - lightPos[2]) * INFINITY;
-
-                  /* Schattenflaeche zeichnen. Ergibt sich aus den Punkten
-                     der Kante und die zu ihnen addierten Vektoren */
-                  glBegin (GL_TRIANGLE_STRIP);
-                  {
-                    glVertex3f (obj.points[p1][0],
-                                obj.points[p1][1],
-                                obj.points[p1][2]);
-                    glVertex3f (obj.points[p1][0] + v1[0],
-                                obj.points[p1][1] + v1[1],
-                                obj.points[p1][2] + v1[2]);
-                    glVertex3f (obj.points[p2][0],
-                                obj.points[p2][1],
-                                obj.points[p2][2]);
-                    glVertex3f (obj.points[p2][0] + v2[0],
-                                obj.points[p2][1] + v2[1],
-                                obj.points[p2][2] + v2[2]);
-                  }
-                  glEnd ();
-                }
-            }
-        }
+      if (hasGLVersion (2, 0))
+        stencilMode = STENCIL_SEPARATE;
+      else if (hasGLExtension ("GL_EXT_stencil_two_side") &&
+               (hasGLVersion (1, 4) || hasGLExtension ("GL_EXT_stencil_wrap")))
+        stencilMode = STENCIL_TWO_SIDE_EXT;
+      else
+        stencilMode = STENCIL_TWO_PASS;
     }
+
+  return stencilMode;
+}
+
+/**
+ * Schreibt den Punkt p als Eckpunkt nach out.
+ * @param out Ziel, Platz fuer drei Koordinaten.
+ * @param p Punkt.
+ * @return Stelle hinter dem geschriebenen Eckpunkt.
+ */
+static GLfloat * putVertex(GLfloat * out, const CGVector3f p)
+{
+  out[0] = p[0];
+  out[1] = p[1];
+  out[2] = p[2];
+
+  return out + 3;
+}
+
+/**
+ * Schreibt den von der Lichtquelle aus ueber p hinaus verlaengerten Punkt
+ * als Eckpunkt nach out. Die Laenge der Verlaengerung haengt vom
+ * eingestellten Wert fuer INFINITY ab.
+ * @param out Ziel, Platz fuer drei Koordinaten.
+ * @param p Punkt.
+ * @param lightPos Position der Lichtquelle.
+ * @return Stelle hinter dem geschriebenen Eckpunkt.
+ */
+static GLfloat * putExtruded(GLfloat * out, const CGVector3f p,
+                             const CGVector4f lightPos)
+{
+  out[0] = p[0] + (p[0] - lightPos[0]) * INFINITY;
+  out[1] = p[1] + (p[1] - lightPos[1]) * INFINITY;
+  out[2] = p[2] + (p[2] - lightPos[2]) * INFINITY;
+
+  return out + 3;
+}
+
+/**
+ * Sorgt dafuer, dass im Feld von sv Platz fuer n Eckpunkte ist.
+ * @param sv Schattenvolumen.
+ * @param n Anzahl der Eckpunkte.
+ * @return GL_TRUE, wenn genug Platz vorhanden ist.
+ */
+static GLboolean reserveVertices(CGShadowVolume * sv, GLsizei n)
+{
+  GLsizei capacity = sv->capacity < SHADOW_VOLUME_CAPACITY
+                   ? SHADOW_VOLUME_CAPACITY
+                   : sv->capacity;
+  GLfloat *vertices;
+
+  if (n <= sv->capacity)
+    return GL_TRUE;
+
+  while (capacity < n)
+    capacity *= 2;
+
+  vertices = realloc (sv->vertices, capacity * 3 * sizeof (GLfloat));
+
+  if (vertices == NULL)
+    return GL_FALSE;
+
+  sv->vertices = vertices;
+  sv->capacity = capacity;
+
+  return GL_TRUE;
+}
+
+/**
+ * Prueft, ob die Kante j der Flaeche i Teil der Silhouette ist, also die
+ * Flaeche dem Licht zu- und ihr Nachbar an dieser Kante abgewandt ist.
+ * @param obj Objekt mit berechneter Sichtbarkeit.
+ * @param i Flaeche.
+ * @param j Kante der Flaeche.
+ * @return GL_TRUE, wenn die Kante zur Silhouette gehoert.
+ */
+static GLboolean isSilhouette(const CGObject * obj, unsigned int i,
+                              unsigned int j)
+{
+  int k = obj->planes[i].neighIdx[j];
+
+  return obj->planes[i].visible && (k != -1) && !obj->planes[k].visible;
 }
 
 /**
@@ -221,25 +440,323 @@ void calcVisibility(CGObject * obj, CGVector4f pos)
 }
 
 /**
- * Zeichnet die Schatten, die das Objekt obj aufgrund der Position lightPos
- * einer Punktlichtquelle wirft. Schatten werden mithilfe von Shadow-Volumes
- * erzeugt.
- * @param obj Objekt, dessen Schatten gezeichnet werden soll.
- *            Vorbedingung: die Sichtbarkeit der Flaechen von der Position der
- *                          Lichtquelle aus ist bereits berechnet.
+ * Baut das Schattenvolumen sv des Objekts obj fuer die Lichtposition
+ * lightPos neu, falls es fuer eine andere Lichtposition gebaut wurde.
+ * Seiten und Kappen werden als Dreiecke in ein Feld geschrieben und, falls
+ * GL es anbietet, in ein Vertex Buffer Object geladen.
+ * @param obj Objekt, dessen Schattenvolumen gebaut werden soll.
+ * @param sv Schattenvolumen.
  * @param lightPos Position der Lichtquelle, relativ zum Nullpunkt des Objekts
  *                 obj (also in Objektkoordinaten).
+ * @return GL_TRUE, wenn neu gebaut wurde.
+ */
+GLboolean updateShadowVolume(CGObject * obj, CGShadowVolume * sv,
+                             CGVector4f lightPos)
+{
+  unsigned int i, j;
+  GLsizei nSides = 0, nCaps = 0;
+  GLfloat *out;
+
+  /* Licht und Objekt liegen noch genauso zueinander */
+  if (sv->valid &&
+      sv->lightPos[0] == lightPos[0] && sv->lightPos[1] == lightPos[1] &&
+      sv->lightPos[2] == lightPos[2] && sv->lightPos[3] == lightPos[3])
+    return GL_FALSE;
+
+  /* Sichtbarkeit der Flaechen von der Lichtquelle aus berechnen */
+  calcVisibility (obj, lightPos);
+
+  /* Eckpunkte zaehlen: je Silhouettenkante zwei Dreiecke, je beleuchteter
+     Flaeche ein Dreieck in jeder Kappe */
+  for (i = 0; i < obj->nPlanes; i++)
+    {
+      if (obj->planes[i].visible)
+        {
+          nCaps += 6;
+
+          for (j = 0; j < 3; j++)
+            if (isSilhouette (obj, i, j))
+              nSides += 6;
+        }
+    }
+
+  if (!reserveVertices (sv, nSides + nCaps))
+    {
+      sv->valid = GL_FALSE;
+      sv->nSideVertices = 0;
+      sv->nVertices = 0;
+
+      return GL_FALSE;
+    }
+
+  out = sv->vertices;
+
+  /* Seiten: das Viereck aus der Kante und ihrer Verlaengerung, im selben
+     Umlaufsinn wie der fruehere Triangle-Strip */
+  for (i = 0; i < obj->nPlanes; i++)
+    {
+      for (j = 0; j < 3; j++)
+        {
+          if (isSilhouette (obj, i, j))
+            {
+              const GLfloat *p1 = obj->points[obj->planes[i].pointIdx[j]];
+              const GLfloat *p2 =
+                obj->points[obj->planes[i].pointIdx[(j + 1) % 3]];
+
+              out = putVertex (out, p1);
+              out = putExtruded (out, p1, lightPos);
+              out = putVertex (out, p2);
+
+              out = putVertex (out, p2);
+              out = putExtruded (out, p1, lightPos);
+              out = putExtruded (out, p2, lightPos);
+            }
+        }
+    }
+
+  /* Vordere Kappe: die beleuchteten Flaechen selbst, hintere Kappe: ihre
+     Verlaengerung mit umgekehrtem Umlaufsinn */
+  for (i = 0; i < obj->nPlanes; i++)
+    {
+      if (obj->planes[i].visible)
+        {
+          const GLuint *idx = obj->planes[i].pointIdx;
+
+          out = putVertex (out, obj->points[idx[0]]);
+          out = putVertex (out, obj->points[idx[1]]);
+          out = putVertex (out, obj->points[idx[2]]);
+
+          out = putExtruded (out, obj->points[idx[2]], lightPos);
+          out = putExtruded (out, obj->points[idx[1]], lightPos);
+          out = putExtruded (out, obj->points[idx[0]], lightPos);
+        }
+    }
+
+  sv->nSideVertices = nSides;
+  sv->nVertices = nSides + nCaps;
+
+  sv->lightPos[0] = lightPos[0];
+  sv->lightPos[1] = lightPos[1];
+  sv->lightPos[2] = lightPos[2];
+  sv->lightPos[3] = lightPos[3];
+  sv->valid = GL_TRUE;
+
+  /* In den Puffer laden, das Feld wird beim naechsten Bau wiederverwendet */
+  if (checkVBO ())
+    {
+      if (sv->vbo == 0)
+        glGenBuffers (1, &sv->vbo);
+
+      glBindBuffer (GL_ARRAY_BUFFER, sv->vbo);
+      glBufferData (GL_ARRAY_BUFFER, sv->nVertices * 3 * sizeof (GLfloat),
+                    sv->vertices, GL_DYNAMIC_DRAW);
+      glBindBuffer (GL_ARRAY_BUFFER, 0);
+    }
+
+  return GL_TRUE;
+}
+
+/**
+ * Zeichnet das Schattenvolumen sv mit einem einzigen Aufruf.
+ * @param sv Schattenvolumen.
+ *           Vorbedingung: sv ist fuer die aktuelle Lichtposition gebaut.
+ * @param caps GL_TRUE, wenn auch die Kappen gezeichnet werden sollen.
+ */
+void drawShadowVolume(const CGShadowVolume * sv, GLboolean caps)
+{
+  GLsizei n = caps ? sv->nVertices : sv->nSideVertices;
+
+  if (n == 0)
+    return;
+
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+  glEnableClientState (GL_VERTEX_ARRAY);
+
+  if (sv->vbo)
+    {
+      glBindBuffer (GL_ARRAY_BUFFER, sv->vbo);
+      glVertexPointer (3, GL_FLOAT, 0, NULL);
+      glDrawArrays (GL_TRIANGLES, 0, n);
+      glBindBuffer (GL_ARRAY_BUFFER, 0);
+    }
+  else
+    {
+      glVertexPointer (3, GL_FLOAT, 0, sv->vertices);
+      glDrawArrays (GL_TRIANGLES, 0, n);
+    }
+
+  glPopClientAttrib ();
+}
+
+/**
+ * Gibt den fuer das Schattenvolumen sv allokierten Speicher und Puffer frei.
+ * @param sv Schattenvolumen.
+ *           Nachbedingung: sv ist wieder leer.
+ */
+void freeShadowVolume(CGShadowVolume * sv)
+{
+  if (sv->vbo)
+    glDeleteBuffers (1, &sv->vbo);
+
+  free (sv->vertices);
+
+  sv->vertices = NULL;
+  sv->vbo = 0;
+  sv->capacity = 0;
+  sv->nSideVertices = 0;
+  sv->nVertices = 0;
+  sv->valid = GL_FALSE;
+}
+
+/**
+ * Stellt die Stenciloperationen fuer eine Geometrie ein und zeichnet sie,
+ * je nach Faehigkeit von GL in einem oder zwei Durchlaeufen.
+ * @param draw Zeichnet die Geometrie.
+ * @param data Daten fuer draw.
+ * @param zFail GL_TRUE fuer z-fail, die Geometrie muss dann geschlossen sein.
+ */
+static void stencilDraw(CGShadowDraw draw, const void * data, GLboolean zFail)
+{
+  switch (checkStencilMode ())
+    {
+    /* Ein Durchlauf ohne Culling, Vorder- und Rueckseiten zaehlen
+       gegenlaeufig. z-pass zaehlt, wo das Volumen vor der Szene liegt,
+       z-fail, wo es dahinter liegt. */
+    case STENCIL_SEPARATE:
+      if (zFail)
+        {
+          glStencilOpSeparate (GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+          glStencilOpSeparate (GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        }
+      else
+        {
+          glStencilOpSeparate (GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+          glStencilOpSeparate (GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+        }
+
+      draw (data);
+      break;
+
+    /* Wie oben, die Seiten werden ueber glActiveStencilFaceEXT gewaehlt */
+    case STENCIL_TWO_SIDE_EXT:
+      glActiveStencilFaceEXT (GL_BACK);
+      if (zFail)
+        glStencilOp (GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+      else
+        glStencilOp (GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+
+      glActiveStencilFaceEXT (GL_FRONT);
+      if (zFail)
+        glStencilOp (GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+      else
+        glStencilOp (GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+
+      draw (data);
+      break;
+
+    /* Zwei Durchlaeufe, zuerst wird hochgezaehlt, da GL_INCR und GL_DECR
+       bei 0 bzw. dem Hoechstwert stehen bleiben */
+    default:
+      if (zFail)
+        {
+          /* Erster Durchlauf: Rueckseiten der geschlossenen Volumen, die
+             hinter der Szene liegen, zaehlen hoch. */
+          glFrontFace (GL_CW);
+          glStencilOp (GL_KEEP, GL_INCR, GL_KEEP);
+
+          draw (data);
+
+          /* Zweiter Durchlauf: Vorderseiten, die hinter der Szene liegen,
+             zaehlen wieder herunter. Was bleibt, liegt im Volumen, auch
+             wenn das Auge selbst darin steht. */
+          glFrontFace (GL_CCW);
+          glStencilOp (GL_KEEP, GL_DECR, GL_KEEP);
+
+          draw (data);
+        }
+      else
+        {
+          /* Erster Durchlauf: Rendern der kompletten Shadow-Volumes,
+             vom schattenwerfenden Objekt durch den (leeren) Raum
+             bis zum Boden bzw. zur Wand.
+             Der Stencil-Puffer wird an den Stellen hochgezaehlt, wo
+             ein Shadow-Volume vorhanden ist (GL_INCR).
+             Die Face-Orientierung ist dabei auf CCW (CounterClockWise)
+             gestellt, alle FRONTfaces erzeugen also das Shadow-Volume. */
+          glFrontFace (GL_CCW);
+          glStencilOp (GL_KEEP, GL_KEEP, GL_INCR);
+
+          draw (data);
+
+          /* Zweiter Durchlauf: Erneutes Rendern der kompletten
+             Shadow-Volumes.
+             Der Stencil-Puffer wird an den Stellen wieder
+             heruntergezaehlt, wo ein Shadow-Volume vorhanden ist
+             (GL_DECR).
+             Die Face-Orientierung ist dabei auf CW (ClockWise)
+             gestellt, alle BACKfaces erzeugen also das Shadow-Volume.
+             Die "Differenz" zwischen dem Shadow-Volume der Front-
+             und dem der Backfaces ergibt dann den eigentlichen Schatten
+             auf Boden und Waenden. */
+          glFrontFace (GL_CW);
+          glStencilOp (GL_KEEP, GL_KEEP, GL_DECR);
+
+          draw (data);
+
+          glFrontFace (GL_CCW);
+        }
+      break;
+    }
+}
+
+/**
+ * Zeichnet die Seiten des Schattenvolumens data.
+ * @param data Schattenvolumen.
  */
-void castShadow(CGObject obj, CGVector4f lightPos)
+static void drawVolumeSides(const void * data)
+{
+  drawShadowVolume (data, GL_FALSE);
+}
+
+/**
+ * Zeichnet das geschlossene Schattenvolumen data.
+ * @param data Schattenvolumen.
+ */
+static void drawVolumeClosed(const void * data)
+{
+  drawShadowVolume (data, GL_TRUE);
+}
+
+/**
+ * Beginnt den Schattendurchlauf fuer eine Lichtquelle. Bis zu
+ * endShadowPass werden die Schattenvolumen nur in den Stencilpuffer
+ * geschrieben.
+ * @param zFail GL_TRUE, wenn Schattenvolumen mit z-fail gezeichnet werden.
+ * @return GL_TRUE, wenn tatsaechlich z-fail benutzt wird. Ohne Depth
+ *         Clamping wird auf z-pass ausgewichen.
+ */
+GLboolean beginShadowPass(GLboolean zFail)
 {
   /* aktuelle Einstellungen sichern */
   glPushAttrib (GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT |
                 GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-                GL_STENCIL_BUFFER_BIT);
+                GL_STENCIL_BUFFER_BIT | GL_SCISSOR_BIT);
+
+  /* Noch keine Flaeche auf dem Bildschirm betroffen */
+  glGetIntegerv (GL_VIEWPORT, shadowViewport);
+
+  shadowBounds[0] = shadowViewport[0] + shadowViewport[2];
+  shadowBounds[1] = shadowViewport[1] + shadowViewport[3];
+  shadowBounds[2] = shadowViewport[0];
+  shadowBounds[3] = shadowViewport[1];
 
   glCullFace (GL_BACK);
 
-  glEnable (GL_CULL_FACE);
+  /* Bei zweiseitigem Stencil werden beide Seiten gebraucht */
+  if (checkStencilMode () == STENCIL_TWO_PASS)
+    glEnable (GL_CULL_FACE);
+  else
+    glDisable (GL_CULL_FACE);
 
   /* Beleuchtung deaktivieren */
   glDisable (GL_LIGHTING);
@@ -258,45 +775,161 @@ void castShadow(CGObject obj, CGVector4f lightPos)
      Hier: Alles in den Stencilpuffer schreiben. */
   glStencilFunc (GL_ALWAYS, 1, 0xffffffff);
 
-  /* Erster Durchlauf: Rendern der kompletten Shadow-Volumes,
-     vom schattenwerfenden Objekt durch den (leeren) Raum
-     bis zum Boden bzw. zur Wand.
-     Der Stencil-Puffer (der vorher ueberall 0 ist) wird an
-     den Stellen auf 1 gesetzt, wo ein Shadow-Volume vorhanden
-     ist (GL_INCR).
-     Die Face-Orientierung ist dabei auf CCW (CounterClockWise)
-     gestellt, alle FRONTfaces erzeugen also das Shadow-Volume. */
-  glFrontFace (GL_CCW);
-  glStencilOp (GL_KEEP, GL_KEEP, GL_INCR);
-
-  drawShadowVolume (obj, lightPos);
-
-  /* Zweiter Durchlauf: Erneutes Rendern der kompletten
-     Shadow-Volumes.
-     Der Stencil-Puffer (ueberall 0, 1 an Stellen mit Schatten)
-     wird an den Stellen zurueck auf 0 gesetzt, wo ein Schadow-
-     Volume vorhanden ist (GL_DECR).
-     Die Face-Orientierung ist dabei auf CW (ClockWise)
-     gestellt, alle BACKfaces erzeugen also das Shadow-Volume.
-     Die "Differenz" zwischen dem Shadow-Volume der Front-
-     und dem der Backfaces ergibt dann den eigentlichen Schatten
-     auf Boden und Waenden. */
-  glFrontFace (GL_CW);
-  glStencilOp (GL_KEEP, GL_KEEP, GL_DECR);
-
-  drawShadowVolume (obj, lightPos);
-
-  /* Face-Orientierung wieder auf "normal" setzen */
+  if (checkStencilMode () == STENCIL_TWO_SIDE_EXT)
+    {
+      glEnable (GL_STENCIL_TEST_TWO_SIDE_EXT);
+
+      glActiveStencilFaceEXT (GL_BACK);
+      glStencilFunc (GL_ALWAYS, 1, 0xffffffff);
+      glActiveStencilFaceEXT (GL_FRONT);
+    }
+
+  /* Vorderseiten sind gegen den Uhrzeigersinn orientiert */
   glFrontFace (GL_CCW);
+
+  /* Beim z-fail duerfen die fernen Kappen nicht abgeschnitten werden.
+     Sie liegen INFINITY mal so weit hinter dem Objekt wie das Licht davor,
+     also meist hinter der fernen Clipping-Ebene. Ohne Depth Clamping
+     fehlten sie, daher dann z-pass. */
+  if (zFail && !checkDepthClamp ())
+    zFail = GL_FALSE;
+
+  if (zFail)
+    glEnable (GL_DEPTH_CLAMP);
+
+  return zFail;
+}
+
+/**
+ * Erweitert das vom Schatten betroffene Bildschirmrechteck um die
+ * Projektion der Punkte points unter der aktuellen Modelview- und
+ * Projektionsmatrix.
+ * @param points Punkte, je drei Koordinaten.
+ * @param n Anzahl der Punkte.
+ */
+void extendShadowBounds(const GLfloat * points, GLsizei n)
+{
+  CGMatrix16f mv, m;
+  CGVector4f clip[SHADOW_BOUNDS_BATCH];
+  GLsizei i, j, count;
+  GLdouble x, y;
+
+  glGetFloatv (GL_MODELVIEW_MATRIX, mv);
+  glGetFloatv (GL_PROJECTION_MATRIX, m);
+
+  /* m = p * mv */
+  MatrixMatrixMult (&m, mv);
+
+  for (i = 0; i < n; i += count)
+    {
+      count = MIN (n - i, SHADOW_BOUNDS_BATCH);
+
+      TransformPoints (m, points + 3 * i, count, clip);
+
+      for (j = 0; j < count; j++)
+        {
+          /* Punkt hinter dem Auge: Projektion nicht begrenzt */
+          if (clip[j][3] <= SHADOW_MIN_W)
+            {
+              shadowBounds[0] = shadowViewport[0];
+              shadowBounds[1] = shadowViewport[1];
+              shadowBounds[2] = shadowViewport[0] + shadowViewport[2];
+              shadowBounds[3] = shadowViewport[1] + shadowViewport[3];
+              return;
+            }
+
+          /* Fensterkoordinaten */
+          x = shadowViewport[0] +
+              (clip[j][0] / clip[j][3] + 1.0) * 0.5 * shadowViewport[2];
+          y = shadowViewport[1] +
+              (clip[j][1] / clip[j][3] + 1.0) * 0.5 * shadowViewport[3];
+
+          if (x < shadowBounds[0])
+            shadowBounds[0] = (GLint) floor (x);
+          if (y < shadowBounds[1])
+            shadowBounds[1] = (GLint) floor (y);
+          if (x > shadowBounds[2])
+            shadowBounds[2] = (GLint) ceil (x);
+          if (y > shadowBounds[3])
+            shadowBounds[3] = (GLint) ceil (y);
+        }
+    }
+}
+
+/**
+ * Schreibt das Schattenvolumen sv in den Stencilpuffer und erweitert das
+ * betroffene Bildschirmrechteck.
+ * @param sv Schattenvolumen.
+ *           Vorbedingung: sv ist fuer die aktuelle Lichtposition gebaut,
+ *           die Modelviewmatrix enthaelt die Transformation des Objekts.
+ * @param zFail GL_TRUE fuer z-fail mit den Kappen, wie von beginShadowPass
+ *              geliefert.
+ */
+void stencilShadowVolume(const CGShadowVolume * sv, GLboolean zFail)
+{
+  GLsizei n = zFail ? sv->nVertices : sv->nSideVertices;
+
+  if (n == 0)
+    return;
+
+  extendShadowBounds (sv->vertices, n);
+
+  stencilDraw (zFail ? drawVolumeClosed : drawVolumeSides, sv, zFail);
+}
+
+/**
+ * Schreibt eine beliebige, auch offene Geometrie als Schattenvolumen per
+ * z-pass in den Stencilpuffer. Das betroffene Bildschirmrechteck muss der
+ * Aufrufer mit extendShadowBounds erweitern.
+ * @param draw Zeichnet die Geometrie.
+ * @param data Daten fuer draw.
+ */
+void stencilShadowGeometry(CGShadowDraw draw, const void * data)
+{
+  stencilDraw (draw, data, GL_FALSE);
+}
+
+/**
+ * Beendet den Schattendurchlauf einer Lichtquelle. Ein einziges
+ * abdunkelndes Rechteck, beschnitten auf die Projektion aller
+ * Schattenvolumen, wird dort gezeichnet, wo der Stencilpuffer einen Wert
+ * <> 0 hat. Dabei wird der Stencilpuffer wieder auf 0 gesetzt, so dass die
+ * naechste Lichtquelle nicht noch einmal abdunkelt.
+ */
+void endShadowPass(void)
+{
+  GLint x0 = MAX (shadowBounds[0], shadowViewport[0]);
+  GLint y0 = MAX (shadowBounds[1], shadowViewport[1]);
+  GLint x1 = MIN (shadowBounds[2], shadowViewport[0] + shadowViewport[2]);
+  GLint y1 = MIN (shadowBounds[3], shadowViewport[1] + shadowViewport[3]);
+
+  if (checkStencilMode () == STENCIL_TWO_SIDE_EXT)
+    glDisable (GL_STENCIL_TEST_TWO_SIDE_EXT);
+
+  /* Kein Schatten auf dem Bildschirm */
+  if (x0 >= x1 || y0 >= y1)
+    {
+      glPopAttrib ();
+      return;
+    }
+
+  /* Nur im Rechteck der Schattenvolumen */
+  glEnable (GL_SCISSOR_TEST);
+  glScissor (x0, y0, x1 - x0, y1 - y0);
+
+  /* Das Rechteck liegt ueber allem, es zaehlt nur der Stencilpuffer */
+  glDisable (GL_DEPTH_TEST);
+  glDisable (GL_CULL_FACE);
+
   /* Schreiben in den Farbpuffer wieder aktivieren */
   glColorMask (1, 1, 1, 1);
 
-  /* "Schattierendes" Rechteck zeichnen, das die gesamte Szene
-     ueberdeckt. Es wird nur an den Stellen mittels Blending
-     mit den Werten im Farbpuffer verrechnet, an denen der
-     Stencil-Puffer einen Wert <> 0 hat, wo also ein Schatten
-     entstehen soll. */
+  /* "Schattierendes" Rechteck zeichnen. Es wird nur an den Stellen
+     mittels Blending mit den Werten im Farbpuffer verrechnet, an denen
+     der Stencil-Puffer einen Wert <> 0 hat, wo also ein Schatten
+     entstehen soll. Der Stencil-Puffer wird dabei geloescht. */
   glStencilFunc (GL_NOTEQUAL, 0, 0xffffffff);
+  glStencilOp (GL_KEEP, GL_KEEP, GL_ZERO);
 
   /* Schattenfarbe */
   glColor4f (0.0f, 0.0f, 0.0f, 0.4f);
@@ -353,175 +986,6 @@ void castShadow(CGObject obj, CGVector4f lightPos)
   glPopAttrib ();
 }
 
-/**
- * Erzeugt das Objekt obj als ein kreuzartiges Beispielobjekt. Speicher fuer die
- * Punkte und Flaechen des Objekts werden allokiert. Punktkoordianten und
- * Eckpunkte der Flaechen werden gesetzt.
- * @param obj Objekt, das initialisiert werden soll.
- *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
- *            Nachbedingung: obj wurde erzeugt.
- * @return Erfolgsstatus der Erzeugung.
- */
-static GLboolean createObject(CGObject * obj)
-{
-  unsigned int i = 0;
-
-  /* Anzahl Punkte */
-  obj->nPoints = 8;
-
-  obj->points = calloc (obj->nPoints, sizeof (CGVector3f));
-
-  if (obj->points == NULL)
-    {
-      freeObject (obj);
-      return GL_FALSE;
-    }
-
-  obj->points[0][0] = -0.5f;
-  obj->points[0][1] = -0.5f;
-  obj->points[0][2] = +0.5f;
-
-  obj->points[1][0] = +0.5f;
-  obj->points[1][1] = -0.5f;
-  obj->points[1][2] = +0.5f;
-
-  obj->points[2][0] = +0.5f;
-  obj->points[2][1] = +0.5f;
-  obj->points[2][2] = +0.5f;
-
-  obj->points[3][0] = -0.5f;
-  obj->points[3][1] = +0.5f;
-  obj->points[3][2] = +0.5f;
-
-  obj->points[4][0] = -0.5f;
-  obj->points[4][1] = -0.5f;
-  obj->points[4][2] = -0.5f;
-
-  obj->points[5][0] = +0.5f;
-  obj->points[5][1] = -0.5f;
-  obj->points[5][2] = -0.5f;
-
-  obj->points[6][0] = +0.5f;
-  obj->points[6][1] = +0.5f;
-  obj->points[6][2] = -0.5f;
-
-  obj->points[7][0] = -0.5f;
-  obj->points[7][1] = +0.5f;
-  obj->points[7][2] = -0.5f;
-
-  /* Anzahl Dreiecksflaechen */
-  obj->nPlanes = 12;
-
-  obj->planes = calloc (obj->nPlanes, sizeof (CGPlane));
-
-  if (obj->planes == NULL)
-    {
-      freeObject (obj);
-      return GL_FALSE;
-    }
-  
-  obj->planes[0].pointIdx[0] = 0;
-  obj->planes[0].pointIdx[1] = 2;
-  obj->planes[0].pointIdx[2] = 1;
-  obj->planes[0].normal[0] = +0.0f;
-  obj->planes[0].normal[1] = +1.0f;
-  obj->planes[0].normal[2] = +0.0f;
-
-  obj->planes[1].pointIdx[0] = 0;
-  obj->planes[1].pointIdx[1] = 3;
-  obj->planes[1].pointIdx[2] = 2;
-  obj->planes[1].normal[0] = +0.0f;
-  obj->planes[1].normal[1] = +1.0f;
-  obj->planes[1].normal[2] = +0.0f;
-
-  obj->planes[2].pointIdx[0] = 4;
-  obj->planes[2].pointIdx[1] = 5;
-  obj->planes[2].pointIdx[2] = 6;
-  obj->planes[2].normal[0] = +0.0f;
-  obj->planes[2].normal[1] = -1.0f;
-  obj->planes[2].normal[2] = +0.0f;
-
-  obj->planes[3].pointIdx[0] = 4;
-  obj->planes[3].pointIdx[1] = 6;
-  obj->planes[3].pointIdx[2] = 7;
-  obj->planes[3].normal[0] = +0.0f;
-  obj->planes[3].normal[1] = -1.0f;
-  obj->planes[3].normal[2] = +0.0f;
-
-  obj->planes[4].pointIdx[0] = 4;
-  obj->planes[4].pointIdx[1] = 3;
-  obj->planes[4].pointIdx[2] = 0;
-  obj->planes[4].normal[0] = -1.0f;
-  obj->planes[4].normal[1] = +0.0f;
-  obj->planes[4].normal[2] = +0.0f;
-
-  obj->planes[5].pointIdx[0] = 4;
-  obj->planes[5].pointIdx[1] = 7;
-  obj->planes[5].pointIdx[2] = 3;
-  obj->planes[5].normal[0] = -1.0f;
-  obj->planes[5].normal[1] = +0.0f;
-  obj->planes[5].normal[2] = +0.0f;
-
-  obj->planes[6].pointIdx[0] = 2;
-  obj->planes[6].pointIdx[1] = 5;
-  obj->planes[6].pointIdx[2] = 1;
-  obj->planes[6].normal[0] = +1.0f;
-  obj->planes[6].normal[1] = +0.0f;
-  obj->planes[6].normal[2] = +0.0f;
-
-  obj->planes[7].pointIdx[0] = 2;
-  obj->planes[7].pointIdx[1] = 6;
-  obj->planes[7].pointIdx[2] = 5;
-  obj->planes[7].normal[0] = +1.0f;
-  obj->planes[7].normal[1] = +0.0f;
-  obj->planes[7].normal[2] = +0.0f;
-
-  obj->planes[8].pointIdx[0] = 4;
-  obj->planes[8].pointIdx[1] = 0;
-  obj->planes[8].pointIdx[2] = 1;
-  obj->planes[8].normal[0] = +0.0f;
-  obj->planes[8].normal[1] = +0.0f;
-  obj->planes[8].normal[2] = -1.0f;
-
-  obj->planes[9].pointIdx[0] = 4;
-  obj->planes[9].pointIdx[1] = 1;
-  obj->planes[9].pointIdx[2] = 5;
-  obj->planes[9].normal[0] = +0.0f;
-  obj->planes[9].normal[1] = +0.0f;
-  obj->planes[9].normal[2] = -1.0f;
-
-  obj->planes[10].pointIdx[0] = 2;
-  obj->planes[10].pointIdx[1] = 3;
-  obj->planes[10].pointIdx[2] = 7;
-  obj->planes[10].normal[0] = +0.0f;
-  obj->planes[10].normal[1] = +0.0f;
-  obj->planes[10].normal[2] = +1.0f;
-
-  obj->planes[11].pointIdx[0] = 2;
-  obj->planes[11].pointIdx[1] = 7;
-  obj->planes[11].pointIdx[2] = 6;
-  obj->planes[11].normal[0] = +0.0f;
-  obj->planes[11].normal[1] = +0.0f;
-  obj->planes[11].normal[2] = +1.0f;
-
-  /* Alle Flaechen des Objekts initialisieren */
-  for (i = 0; i < obj->nPlanes; i++)
-    {
-      obj->planes[i].visible = GL_TRUE;
-
-      obj->planes[i].neighIdx[0] = -1;
-      obj->planes[i].neighIdx[1] = -1;
-      obj->planes[i].neighIdx[2] = -1;
-
-      obj->planes[i].PlaneEq.a = 0;
-      obj->planes[i].PlaneEq.b = 0;
-      obj->planes[i].PlaneEq.c = 0;
-      obj->planes[i].PlaneEq.d = 0;
-    }
-
-  return GL_TRUE;
-}
-
 /**
  * Berechnet die Ebenengleichungen der Flaechen des Objekts obj.
  * @param obj Objekt, dessen Ebenengleichungen berechnet werden sollen.
@@ -533,6 +997,7 @@ static void calcPlanes(CGObject * obj)
   unsigned int i = 0, j = 0;
   CGVector3f v[3];
   CGPlane *plane;
+  GLfloat len;
 
   /* Fuer alle Objektflaechen */
   for (i = 0; i < obj->nPlanes; i++)
@@ -559,35 +1024,93 @@ static void calcPlanes(CGObject * obj)
       plane->PlaneEq.d = -(v[0][0] * (v[1][1] * v[2][2] - v[2][1] * v[1][2]) +
                            v[1][0] * (v[2][1] * v[0][2] - v[0][1] * v[2][2]) +
                            v[2][0] * (v[0][1] * v[1][2] - v[1][1] * v[0][2]));
+
+      /* Normale aus der Ebenengleichung */
+      len = (GLfloat) sqrt (plane->PlaneEq.a * plane->PlaneEq.a +
+                            plane->PlaneEq.b * plane->PlaneEq.b +
+                            plane->PlaneEq.c * plane->PlaneEq.c);
+
+      if (len > 0.0f)
+        {
+          plane->normal[0] = plane->PlaneEq.a / len;
+          plane->normal[1] = plane->PlaneEq.b / len;
+          plane->normal[2] = plane->PlaneEq.c / len;
+        }
     }
 }
 
 /**
- * Initialisiert das Objekt obj als ein kreuzartiges Beispielobjekt. Speicher
- * fuer die Punkte und Flaechen wird allokiert, Nachbarschaftsbeziehungen und
+ * Initialisiert das Objekt obj aus einem Dreiecksnetz. Speicher fuer die
+ * Punkte und Flaechen wird allokiert, Nachbarschaftsbeziehungen und
  * Ebenengleichungen der Flaechen werden berechnet.
  * @param obj Objekt, das initialisiert werden soll.
  *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
  *            Nachbedingung: obj wurde vollstaendig initialisiert.
+ * @param points Punkte, je drei Koordinaten.
+ * @param nPoints Anzahl der Punkte.
+ * @param triangles Dreiecke, je drei Indizes in points, von aussen gesehen
+ *                  im Uhrzeigersinn.
+ * @param nTriangles Anzahl der Dreiecke.
+ * @return Erfolgsstatus der Initialisierung.
+ */
+GLboolean initObjectFromTriangles(CGObject * obj, const GLfloat * points,
+                                  GLuint nPoints, const GLuint * triangles,
+                                  GLuint nTriangles)
+{
+  unsigned int i = 0;
+
+  obj->nPoints = nPoints;
+  obj->points = malloc (nPoints * sizeof (CGVector3f));
+
+  obj->nPlanes = nTriangles;
+  obj->planes = calloc (nTriangles, sizeof (CGPlane));
+
+  if (obj->points == NULL || obj->planes == NULL)
+    {
+      freeObject (obj);
+      return GL_FALSE;
+    }
+
+  memcpy (obj->points, points, nPoints * sizeof (CGVector3f));
+
+  /* Alle Flaechen des Objekts initialisieren */
+  for (i = 0; i < obj->nPlanes; i++)
+    {
+      obj->planes[i].pointIdx[0] = triangles[3 * i];
+      obj->planes[i].pointIdx[1] = triangles[3 * i + 1];
+      obj->planes[i].pointIdx[2] = triangles[3 * i + 2];
+
+      obj->planes[i].visible = GL_TRUE;
+
+      obj->planes[i].neighIdx[0] = -1;
+      obj->planes[i].neighIdx[1] = -1;
+      obj->planes[i].neighIdx[2] = -1;
+    }
+
+  /* Nachbarschaftsbeziehungen setzen */
+  if (!setConnectivity (obj))
+    {
+      freeObject (obj);
+      return GL_FALSE;
+    }
+
+  /* Ebenengleichungen berechnen */
+  calcPlanes (obj);
+
+  return GL_TRUE;
+}
+
+/**
+ * Initialisiert das Objekt obj als Wuerfel mit der Kantenlaenge 1 um den
+ * Ursprung.
+ * @param obj Objekt, das initialisiert werden soll.
+ *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
+ *            Nachbedingung: obj wurde vollstaendig initialisiert.
  * @return Erfolgsstatus der Initialisierung.
  */
 GLboolean initObject(CGObject * obj)
 {
-  /* Objekt erzeugen und Punkte und Flaechen initialisieren */
-  if (createObject(obj))
-  {
-    /* Nachbarschaftsbeziehungen setzen */
-    setConnectivity(obj);
-    
-    /* Ebenengleichungen berechnen */
-    calcPlanes(obj);
-    
-    return GL_TRUE;
-  }
-  else
-  {
-    return GL_FALSE;
-  }
+  return initObjectFromTriangles (obj, cubePoints, 8, cubeTriangles, 12);
 }
 
 /**
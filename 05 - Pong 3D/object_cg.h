@@ -35,6 +35,8 @@
 
 #define EMPTY_CG_OBJECT { 0, 0, NULL, NULL}
 
+#define EMPTY_CG_SHADOW_VOLUME { {0, 0, 0, 0}, GL_FALSE, 0, 0, 0, NULL, 0}
+
 
 /* ---- Typedeklarationen ---- */
 
@@ -92,13 +94,70 @@ typedef struct
   CGPlane *planes;
 } CGObject;
 
+/**
+ * Zwischengespeichertes Schattenvolumen eines Objekts fuer eine Lichtquelle.
+ * Die Dreiecke liegen in Objektkoordinaten in einem Feld: erst die Seiten
+ * ueber der Silhouette, dann vordere und hintere Kappe.
+ */
+typedef struct
+{
+  /** Lichtposition in Objektkoordinaten, fuer die gebaut wurde. */
+  CGVector4f lightPos;
+
+  /** Wurde schon gebaut? */
+  GLboolean valid;
+
+  /** Anzahl der Eckpunkte der Seiten. */
+  GLsizei nSideVertices;
+
+  /** Anzahl aller Eckpunkte, Seiten und Kappen. */
+  GLsizei nVertices;
+
+  /** Platz im Feld vertices, in Eckpunkten. */
+  GLsizei capacity;
+
+  /** Eckpunkte, je drei Koordinaten. */
+  GLfloat *vertices;
+
+  /** Vertex Buffer Object, 0 wenn aus dem Feld gezeichnet wird. */
+  GLuint vbo;
+} CGShadowVolume;
+
+
+/** Zeichnet eine Geometrie fuer den Stencilpuffer */
+typedef void (* CGShadowDraw) (const void * data);
+
 
 /* ---- Funktionsdeklarationen ---- */
 
 /**
- * Initialisiert das Objekt obj als ein kreuzartiges Beispielobjekt. Speicher
- * fuer die Punkte und Flaechen wird allokiert, Nachbarschaftsbeziehungen und
- * Ebenengleichungen der Flaechen werden berechnet.
+ * Initialisiert das Objekt obj aus einem Dreiecksnetz. Speicher fuer die
+ * Punkte und Flaechen wird allokiert, Nachbarschaftsbeziehungen (ueber eine
+ * Hashtabelle der Kanten, linear in der Anzahl der Dreiecke) und
+ * Ebenengleichungen der Flaechen werden berechnet. Gemeinsame Kanten werden
+ * nur ueber gleiche Punktindizes erkannt, das Netz muss also verschweisst
+ * sein.
+ * @param obj Objekt, das initialisiert werden soll.
+ *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
+ *            Nachbedingung: obj wurde vollstaendig initialisiert.
+ * @param points Punkte, je drei Koordinaten.
+ * @param nPoints Anzahl der Punkte.
+ * @param triangles Dreiecke, je drei Indizes in points, von aussen gesehen
+ *                  im Uhrzeigersinn. Die Ebenennormalen zeigen damit nach
+ *                  innen, darauf beruhen calcVisibility und die
+ *                  Schattenvolumen.
+ * @param nTriangles Anzahl der Dreiecke.
+ * @return Erfolgsstatus der Initialisierung.
+ */
+GLboolean initObjectFromTriangles (CGObject * obj, const GLfloat * points,
+                                   GLuint nPoints, const GLuint * triangles,
+                                   GLuint nTriangles);
+
+/**
+ * Initialisiert das Objekt obj als Wuerfel mit der Kantenlaenge 1 um den
+ * Ursprung. Speicher fuer die Punkte und Flaechen wird allokiert,
+ * Nachbarschaftsbeziehungen und Ebenengleichungen der Flaechen werden
+ * berechnet.
  * @param obj Objekt, das initialisiert werden soll.
  *            Vorbedingung: obj ist ein Zeiger auf ein existierendes Objekt.
  *            Nachbedingung: obj wurde vollstaendig initialisiert.
@@ -115,16 +174,73 @@ extern GLboolean initObject(CGObject * obj);
 void freeObject (CGObject * obj);
 
 /**
- * Zeichnet die Schatten, die das Objekt obj aufgrund der Position lightPos
- * einer Punktlichtquelle wirft. Schatten werden mithilfe von Shadow-Volumes
- * erzeugt.
- * @param obj Objekt, dessen Schatten gezeichnet werden soll.
- *            Vorbedingung: die Sichtbarkeit der Flaechen von der Position der
- *                          Lichtquelle aus ist bereits berechnet.
+ * Gibt den fuer das Schattenvolumen sv allokierten Speicher und Puffer frei.
+ * @param sv Schattenvolumen.
+ *           Nachbedingung: sv ist wieder leer.
+ */
+void freeShadowVolume (CGShadowVolume * sv);
+
+/**
+ * Baut das Schattenvolumen sv des Objekts obj fuer die Lichtposition
+ * lightPos neu, falls es fuer eine andere Lichtposition gebaut wurde. Da
+ * lightPos in Objektkoordinaten angegeben wird, aendert sie sich genau dann,
+ * wenn sich Licht oder Objekt relativ zueinander bewegen.
+ * @param obj Objekt, dessen Schattenvolumen gebaut werden soll.
+ * @param sv Schattenvolumen.
  * @param lightPos Position der Lichtquelle, relativ zum Nullpunkt des Objekts
  *                 obj (also in Objektkoordinaten).
+ * @return GL_TRUE, wenn neu gebaut wurde.
  */
-void castShadow (CGObject obj, CGVector4f lightPos);
+GLboolean updateShadowVolume (CGObject * obj, CGShadowVolume * sv,
+                              CGVector4f lightPos);
+
+/**
+ * Beginnt den Schattendurchlauf einer Lichtquelle. Bis endShadowPass werden
+ * Schattenvolumen nur in den Stencilpuffer geschrieben. Wenn GL es anbietet,
+ * werden Vorder- und Rueckseiten in einem Durchlauf geschrieben
+ * (glStencilOpSeparate oder GL_EXT_stencil_two_side), sonst in zweien.
+ * @param zFail GL_TRUE fuer z-fail mit geschlossenen Volumen (Carmack's
+ *              Reverse), das auch stimmt, wenn das Auge im Volumen steht,
+ *              GL_FALSE fuer z-pass.
+ * @return GL_TRUE, wenn z-fail benutzt wird. Ohne Depth Clamping wuerden die
+ *         fernen Kappen abgeschnitten, dann wird z-pass benutzt und
+ *         GL_FALSE geliefert. Der Wert ist an stencilShadowVolume zu geben.
+ */
+GLboolean beginShadowPass (GLboolean zFail);
+
+/**
+ * Schreibt das Schattenvolumen sv in den Stencilpuffer und erweitert das
+ * vom Schatten betroffene Bildschirmrechteck.
+ * @param sv Schattenvolumen.
+ *           Vorbedingung: sv ist fuer die aktuelle Lichtposition gebaut,
+ *           die Modelviewmatrix enthaelt die Transformation des Objekts.
+ * @param zFail Rueckgabewert von beginShadowPass.
+ */
+void stencilShadowVolume (const CGShadowVolume * sv, GLboolean zFail);
+
+/**
+ * Schreibt eine beliebige, auch offene Geometrie per z-pass als
+ * Schattenvolumen in den Stencilpuffer.
+ * @param draw Zeichnet die Geometrie.
+ * @param data Daten fuer draw.
+ */
+void stencilShadowGeometry (CGShadowDraw draw, const void * data);
+
+/**
+ * Erweitert das vom Schatten betroffene Bildschirmrechteck um die Projektion
+ * der Punkte points unter der aktuellen Modelview- und Projektionsmatrix.
+ * Liegt ein Punkt hinter dem Auge, ist der ganze Viewport betroffen.
+ * @param points Punkte, je drei Koordinaten.
+ * @param n Anzahl der Punkte.
+ */
+void extendShadowBounds (const GLfloat * points, GLsizei n);
+
+/**
+ * Beendet den Schattendurchlauf: Ein einziges Rechteck dunkelt ab, wo der
+ * Stencilpuffer <> 0 ist, beschnitten per Scissor-Test auf das betroffene
+ * Bildschirmrechteck. Der Stencilpuffer wird dabei wieder auf 0 gesetzt.
+ */
+void endShadowPass (void);
 
 /**
  * Berechnet fuer jede Flaeche des Objekts obj, ob diese von der Position pos
@@ -140,14 +256,27 @@ void castShadow (CGObject obj, CGVector4f lightPos);
 void calcVisibility (CGObject * obj, CGVector4f pos);
 
 /**
- * Zeichnet das Schattenvolumen, welches das Objekts obj fuer eine
- * Punktlichtquelle mit der Position lightPos erzeugt.
- * @param obj Objekt, dessen Schattenvolumen gezeichnet werden soll.
- *            Vorbedingung: die Sichtbarkeit der Flaechen von der Position der
- *                          Lichtquelle aus ist bereits berechnet.
- * @param lightPos Position der Lichtquelle, relativ zum Nullpunkt des Objekts
- *                 obj (also in Objektkoordinaten).
+ * Zeichnet das Schattenvolumen sv mit einem einzigen Aufruf.
+ * @param sv Schattenvolumen.
+ *           Vorbedingung: sv ist fuer die aktuelle Lichtposition gebaut.
+ * @param caps GL_TRUE, wenn auch die Kappen gezeichnet werden sollen.
+ */
+void drawShadowVolume (const CGShadowVolume * sv, GLboolean caps);
+
+/**
+ * Prueft, ob GL mindestens in der Version major.minor vorliegt.
+ * @param major Hauptversion.
+ * @param minor Unterversion.
+ * @return GL_TRUE, wenn die Version mindestens major.minor ist.
+ */
+GLboolean hasGLVersion (int major, int minor);
+
+/**
+ * Prueft, ob GL die Erweiterung name anbietet. Nur ganze Namen zaehlen,
+ * nicht Anfaenge laengerer Namen.
+ * @param name Name der Erweiterung.
+ * @return GL_TRUE, wenn die Erweiterung vorhanden ist.
  */
-void drawShadowVolume (CGObject obj, CGVector4f lightPos);
+GLboolean hasGLExtension (const char * name);
 
 #endif
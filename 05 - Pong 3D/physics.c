@@ -0,0 +1,182 @@
+/**
+ * @file
+ *
+ * Kollisionen des Balls mit den quaderfoermigen Objekten.
+ *
+ * Die Seitenflaechen eines Objekts werden wie zuvor in logic.c aus Mitte und
+ * Normale der Flaechen des Einheitswuerfels berechnet, jetzt aber einmal je
+ * Aenderung des Objekts statt in jedem Bild. Das Fegen kostet danach je
+ * Flaeche nur noch einige Skalarprodukte.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <math.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "physics.h"
+#include "types.h"
+#include "vector.h"
+#include "object.h"
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* Mitten der Seitenflaechen des Einheitswuerfels: vorn, links, hinten, rechts */
+static const Vector3d middle[PHYSICS_FACES] =
+  { {  0.0, 0.0, + 0.5 }
+  , {- 0.5, 0.0,   0.0 }
+  , {  0.0, 0.0, - 0.5 }
+  , {+ 0.5, 0.0,   0.0 }
+  };
+
+/* Normalen der Seitenflaechen, die Normale der naechsten Flaeche liegt in der Flaeche */
+static const Vector3d normal[PHYSICS_FACES] =
+  { {  0.0, 0.0, + 1.0 }
+  , {- 1.0, 0.0,   0.0 }
+  , {  0.0, 0.0, - 1.0 }
+  , {+ 1.0, 0.0,   0.0 }
+  };
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Berechnet die Seitenflaechen von b in Weltkoordinaten, wenn sich das
+ * Objekt seit dem letzten Mal bewegt hat.
+ *
+ * @param[in] b Kollisionskoerper.
+ */
+static void updateBody(PhysicsBody * b)
+{
+  const Object * o = b->o;
+
+  int i;
+
+  if (b->valid
+   && b->a   == o->a
+   && b->t.x == o->t.x && b->t.y == o->t.y && b->t.z == o->t.z
+   && b->s.x == o->s.x && b->s.y == o->s.y && b->s.z == o->s.z)
+    return;
+
+  for (i = 0; i < PHYSICS_FACES; ++i)
+  {
+    PhysicsFace * f = &b->faces[i];
+
+    Vector3d m = vectorAdd(vectorRotateY(vectorScale(middle[i], o->s.x, o->s.y, o->s.z), o->a), o->t);
+
+    f->n = vectorRotateY(normal[i], o->a);
+    f->u = vectorRotateY(normal[(i + 1) % PHYSICS_FACES], o->a);
+    f->d = vectorMult(f->n, m);
+    f->c = vectorMult(f->u, m);
+
+    /* Vorn und hinten erstreckt sich die Flaeche entlang x, links und rechts entlang z */
+    f->extent = 0.5 * (i % 2 == 0 ? o->s.x : o->s.z);
+  }
+
+  b->t     = o->t;
+  b->s     = o->s;
+  b->a     = o->a;
+  b->valid = TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Initialisiert den Kollisionskoerper b des Objekts o.
+ *
+ * @param[out] b Kollisionskoerper.
+ * @param[in]  o Objekt.
+ */
+extern void physicsBodyInit(PhysicsBody * b, const Object * o)
+{
+  b->o     = o;
+  b->valid = FALSE;
+}
+
+/**
+ * Fegt eine Kugel mit Radius r von p um die Strecke v gegen die
+ * Seitenflaechen von b.
+ *
+ * @param[in]  b   Kollisionskoerper.
+ * @param[in]  p   Mittelpunkt der Kugel zu Beginn.
+ * @param[in]  v   Strecke, um die sich die Kugel bewegt.
+ * @param[in]  r   Radius der Kugel.
+ * @param[out] hit Fruehester Aufprall.
+ *
+ * @return TRUE  wenn die Kugel eine Flaeche trifft,
+ *         FALSE sonst.
+ */
+extern Boolean physicsSweepSphere(PhysicsBody * b, Vector3d p, Vector3d v, double r, PhysicsHit * hit)
+{
+  Boolean found = FALSE;
+
+  int i;
+
+  updateBody(b);
+
+  for (i = 0; i < PHYSICS_FACES; ++i)
+  {
+    const PhysicsFace * f = &b->faces[i];
+
+    double d0 = vectorMult(f->n, p) - f->d  /* Abstand zu Beginn          */
+         , dv = vectorMult(f->n, v)         /* Aenderung des Abstands     */
+         , t
+         , lateral
+         ;
+
+    /* Nur Flaechen, vor denen der Ball liegt und auf die er sich zubewegt */
+    if (dv >= 0.0 || d0 <= 0.0)
+      continue;
+
+    /* Zeitpunkt, an dem der Abstand auf den Radius faellt */
+    t = d0 > r
+      ? (d0 - r) / - dv
+      : 0.0
+      ;
+
+    if (t > 1.0 || (found && t >= hit->t))
+      continue;
+
+    /* Beruehrt die Kugel dann die Flaeche oder fliegt sie vorbei? */
+    lateral = fabs(vectorMult(f->u, p) + t * vectorMult(f->u, v) - f->c);
+
+    if (lateral > f->extent + r)
+      continue;
+
+    hit->t = t;
+    hit->n = f->n;
+    found  = TRUE;
+  }
+
+  return found;
+}
+
+/**
+ * Spiegelt die Richtung v an der Ebene mit der Normalen n.
+ *
+ * @param[in] v Richtung.
+ * @param[in] n Normale.
+ *
+ * @return gespiegelte Richtung.
+ */
+extern Vector3d physicsReflect(Vector3d v, Vector3d n)
+{
+  double scale = - 2.0 * vectorMult(v, n);
+
+  return vectorAdd(v, vectorScale(n, scale, scale, scale));
+}
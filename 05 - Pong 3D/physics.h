@@ -0,0 +1,110 @@
+#ifndef __PHYSICS_H__
+#define __PHYSICS_H__
+/**
+ * @file
+ *
+ * Kollisionen des Balls mit den quaderfoermigen Objekten.
+ *
+ * Zu jedem Objekt werden die Ebenen seiner vier Seitenflaechen in
+ * Weltkoordinaten vorgehalten und nur neu berechnet, wenn sich Verschiebung,
+ * Skalierung oder Drehwinkel des Objekts geaendert haben. Der Ball wird als
+ * Kugel entlang seiner ganzen Strecke eines Bildes gegen diese Ebenen
+ * gefegt, so dass auch ein schneller Ball nicht durch duenne Objekte
+ * hindurchfliegt und der Zeitpunkt des Aufpralls genau bekannt ist.
+ *
+ * Wie bisher drehen sich alle Objekte nur um die y-Achse und der Ball
+ * bewegt sich in der xz-Ebene, Boden und Decke der Quader zaehlen nicht.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "types.h"
+#include "vector.h"
+#include "object.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Anzahl der Seitenflaechen eines Quaders */
+#define PHYSICS_FACES (4)
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Seitenflaeche in Weltkoordinaten */
+typedef struct {
+  Vector3d n             /* Normale, nach aussen                     */
+         , u             /* Richtung entlang der Flaeche             */
+         ;
+
+  double d               /* Ebene: n * p = d                         */
+       , c               /* Mitte der Flaeche entlang u: u * p = c   */
+       , extent          /* Halbe Breite der Flaeche entlang u       */
+       ;
+} PhysicsFace;
+
+/** Kollisionskoerper eines Objekts */
+typedef struct {
+  const Object * o;      /* Objekt                                   */
+
+  Vector3d t             /* Verschiebung, fuer die faces gelten      */
+         , s             /* Skalierung, fuer die faces gelten        */
+         ;
+
+  double a;              /* Drehwinkel, fuer den faces gilt          */
+
+  Boolean valid;         /* faces berechnet                          */
+
+  PhysicsFace faces[PHYSICS_FACES];
+} PhysicsBody;
+
+/** Aufprall einer Kugel */
+typedef struct {
+  double t;              /* Anteil der Strecke bis zum Aufprall      */
+  Vector3d n;            /* Normale der getroffenen Flaeche          */
+} PhysicsHit;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Initialisiert den Kollisionskoerper b des Objekts o. Die Flaechen werden
+ * erst bei Bedarf berechnet.
+ *
+ * @param[out] b Kollisionskoerper.
+ * @param[in]  o Objekt, muss so lange leben wie b.
+ */
+extern void physicsBodyInit(PhysicsBody * b, const Object * o);
+
+/**
+ * Fegt eine Kugel mit Radius r von p um die Strecke v gegen die
+ * Seitenflaechen von b. Vorher werden die Flaechen neu berechnet, falls
+ * sich das Objekt bewegt hat. Beruehrt die Kugel schon zu Beginn eine
+ * Flaeche, auf die sie sich zubewegt, gilt das als Aufprall bei 0.
+ *
+ * @param[in]  b   Kollisionskoerper.
+ * @param[in]  p   Mittelpunkt der Kugel zu Beginn.
+ * @param[in]  v   Strecke, um die sich die Kugel bewegt.
+ * @param[in]  r   Radius der Kugel.
+ * @param[out] hit Fruehester Aufprall, nur gueltig bei TRUE.
+ *
+ * @return TRUE  wenn die Kugel auf der Strecke eine Flaeche trifft,
+ *         FALSE sonst.
+ */
+extern Boolean physicsSweepSphere(PhysicsBody * b, Vector3d p, Vector3d v, double r, PhysicsHit * hit);
+
+/**
+ * Spiegelt die Richtung v an der Ebene mit der Normalen n.
+ *
+ * @param[in] v Richtung.
+ * @param[in] n Normale, normiert.
+ *
+ * @return gespiegelte Richtung.
+ */
+extern Vector3d physicsReflect(Vector3d v, Vector3d n);
+
+#endif
@@ -0,0 +1,430 @@
+/**
+ * @file
+ *
+ * Das Modul sammelt die Zeichenauftraege eines Bildes und gibt sie sortiert
+ * aus.
+ *
+ * Der Sortierschluessel hat 64 Bit, verteilt auf zwei 32-Bit-Haelften, da
+ * C89 keinen 64-Bit-Typ kennt:
+ *
+ *   hi: Ebene (8) | durchsichtig (1) | Textur (12) | Material (11)
+ *   lo: Tiefe (32)
+ *
+ * Bei durchsichtigen Paketen bleiben Textur und Material im Schluessel 0 und
+ * die Tiefe wird invertiert, sie werden also rein von hinten nach vorn
+ * gezeichnet. Sortiert wird per LSD-Radixsort ueber die acht Bytes des
+ * Schluessels, stabil, so dass gleiche Schluessel in Einfuegereihenfolge
+ * bleiben. Bytes, die bei allen Paketen gleich sind, werden uebersprungen.
+ *
+ * Beim Trennen der z-Ebenen per glDepthRange bekommt die k-te von n Ebenen
+ * eines Bildes den Abschnitt [1 - (k + 1) / n, 1 - k / n]. Da spaetere
+ * Ebenen naeher liegen, verdecken sie die frueheren wie nach einem
+ * Loeschen des z-Buffers.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "renderQueue.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Anfaengliche Anzahl der Pakete */
+#define RENDERQUEUE_CAPACITY (32)
+
+/** Lage der Felder im hoeherwertigen Teil des Schluessels */
+#define KEY_LAYER_SHIFT       (24)
+#define KEY_TRANSLUCENT_SHIFT (23)
+#define KEY_TEXTURE_SHIFT     (11)
+
+#define KEY_LAYER_MASK    (0xFFUL)
+#define KEY_TEXTURE_MASK  (0xFFFUL)
+#define KEY_MATERIAL_MASK (0x7FFUL)
+
+/** Groesster Wert einer 32-Bit-Haelfte */
+#define KEY_MAX (0xFFFFFFFFUL)
+
+/** Anzahl der Bytes des Schluessels */
+#define KEY_BYTES (8)
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Gibt das Byte b (0 = niederwertigstes) des Schluessels von p zurueck.
+ *
+ * @param[in] p Paket.
+ * @param[in] b Byte aus [0, KEY_BYTES).
+ *
+ * @return Byte.
+ */
+static unsigned keyByte(const RenderPacket * p, int b)
+{
+  return (unsigned) (((b < 4 ? p->lo : p->hi) >> (8 * (b % 4))) & 0xFFUL);
+}
+
+/**
+ * Bildet die Tiefe d aus [-far, far] monoton auf [0, KEY_MAX] ab.
+ *
+ * @param[in] d   Tiefe.
+ * @param[in] far Groesster Betrag der Tiefe.
+ *
+ * @return Quantisierte Tiefe.
+ */
+static unsigned long quantizeDepth(double d, double far)
+{
+  d = (d + far) / (2.0 * far);
+
+  if (d <= 0.0)
+    return 0;
+
+  if (d >= 1.0)
+    return KEY_MAX;
+
+  return (unsigned long) (d * KEY_MAX);
+}
+
+/**
+ * Sortiert die Pakete von q stabil nach ihrem Schluessel.
+ *
+ * @param[in] q Warteschlange.
+ */
+static void sortPackets(RenderQueue * q)
+{
+  unsigned long count[256];
+
+  unsigned i
+         , bucket
+         ;
+
+  int b;
+
+  RenderPacket * tmp;
+
+  for (b = 0; b < KEY_BYTES; ++b)
+  {
+    memset(count, 0, sizeof(count));
+
+    for (i = 0; i < q->count; ++i)
+      ++count[keyByte(&q->packets[i], b)];
+
+    /* Alle gleich, nichts zu tun */
+    if (count[keyByte(&q->packets[0], b)] == q->count)
+      continue;
+
+    /* Anfaenge der Faecher */
+    for (bucket = 0, i = 0; bucket < 256; ++bucket)
+    {
+      unsigned long c = count[bucket];
+
+      count[bucket] = i;
+      i += c;
+    }
+
+    for (i = 0; i < q->count; ++i)
+      q->scratch[count[keyByte(&q->packets[i], b)]++] = q->packets[i];
+
+    tmp        = q->packets;
+    q->packets = q->scratch;
+    q->scratch = tmp;
+  }
+}
+
+/**
+ * Prueft, ob der z-Buffer genau genug ist, um layers Ebenen je einen
+ * Abschnitt mit mindestens q->sliceBits Bit zu geben.
+ *
+ * @param[in] q      Warteschlange.
+ * @param[in] layers Anzahl der Ebenen.
+ *
+ * @return TRUE  wenn die Abschnitte genau genug sind,
+ *         FALSE sonst.
+ */
+static Boolean layersFit(RenderQueue * q, unsigned layers)
+{
+  unsigned bits = 0;
+
+  /* Genauigkeit nur einmal erfragen */
+  if (q->depthBits < 0)
+  {
+    GLint depthBits;
+
+    glGetIntegerv(GL_DEPTH_BITS, &depthBits);
+
+    q->depthBits = depthBits;
+  }
+
+  /* Bits fuer die Nummer der Ebene */
+  while ((1UL << bits) < layers)
+    ++bits;
+
+  return bits + q->sliceBits <= (unsigned) q->depthBits;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Initialisiert die leere Warteschlange q.
+ *
+ * @param[out] q           Warteschlange.
+ * @param[in]  far         Groesster Betrag der Tiefe.
+ * @param[in]  setTexture  Setzt eine Textur, NULL wenn die Pakete das selbst
+ *                         tun.
+ * @param[in]  setMaterial Setzt ein Material, NULL wenn die Pakete das selbst
+ *                         tun.
+ */
+extern void renderQueueInit(RenderQueue * q, double far, RenderQueueState setTexture, RenderQueueState setMaterial)
+{
+  q->packets     = NULL;
+  q->scratch     = NULL;
+  q->count       = 0;
+  q->capacity    = 0;
+  q->far         = far;
+  q->layering    = RENDERQUEUE_LAYERS_CLEAR;
+  q->sliceBits   = 0;
+  q->depthBits   = -1;
+  q->slices      = 0;
+  q->setTexture  = setTexture;
+  q->setMaterial = setMaterial;
+
+  memset(q->slice, 0, sizeof(q->slice));
+}
+
+/**
+ * Legt fest, wie die z-Ebenen der Warteschlange q getrennt werden.
+ *
+ * @param[in] q         Warteschlange.
+ * @param[in] layering  Art der Trennung.
+ * @param[in] sliceBits Mindestgenauigkeit eines Abschnitts in Bit.
+ */
+extern void renderQueueSetLayering(RenderQueue * q, RenderQueueLayering layering, unsigned sliceBits)
+{
+  q->layering  = layering;
+  q->sliceBits = sliceBits;
+}
+
+/**
+ * Gibt den Speicher der Warteschlange q frei.
+ *
+ * @param[in] q Warteschlange.
+ */
+extern void renderQueueFree(RenderQueue * q)
+{
+  free(q->packets);
+  free(q->scratch);
+
+  q->packets  = NULL;
+  q->scratch  = NULL;
+  q->count    = 0;
+  q->capacity = 0;
+}
+
+/**
+ * Fuegt ein Paket in die Warteschlange q ein.
+ *
+ * @param[in] q           Warteschlange.
+ * @param[in] layer       z-Ebene.
+ * @param[in] translucent TRUE, wenn das Paket geblendet wird.
+ * @param[in] texture     Textur.
+ * @param[in] material    Material.
+ * @param[in] depth       Abstand zum Auge entlang der Blickrichtung.
+ * @param[in] draw        Zeichenfunktion.
+ * @param[in] data        Daten fuer draw.
+ *
+ * @return TRUE  wenn das Paket eingefuegt wurde
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+extern Boolean renderQueuePush(RenderQueue * q, unsigned layer, Boolean translucent, int texture, int material, double depth, RenderQueueDraw draw, const void * data)
+{
+  RenderPacket * p;
+
+  if (q->count == q->capacity)
+  {
+    unsigned capacity = q->capacity < RENDERQUEUE_CAPACITY
+                      ? RENDERQUEUE_CAPACITY
+                      : 2 * q->capacity
+                      ;
+
+    RenderPacket * packets = realloc(q->packets, capacity * sizeof(RenderPacket))
+               , * scratch
+               ;
+
+    if (packets == NULL)
+      return FALSE;
+
+    q->packets = packets;
+
+    scratch = realloc(q->scratch, capacity * sizeof(RenderPacket));
+
+    if (scratch == NULL)
+    {
+      #ifdef DEBUG
+      fprintf(stderr, "DEBUG :: Render Queue : Could not grow to %u packets.\n", capacity);
+      #endif
+
+      return FALSE;
+    }
+
+    q->scratch  = scratch;
+    q->capacity = capacity;
+  }
+
+  p = &q->packets[q->count++];
+
+  p->layer    = layer;
+  p->texture  = texture;
+  p->material = material;
+  p->draw     = draw;
+  p->data     = data;
+
+  p->hi = (layer & KEY_LAYER_MASK) << KEY_LAYER_SHIFT;
+
+  /* Durchsichtig: nur von hinten nach vorn */
+  if (translucent)
+  {
+    p->hi |= 1UL << KEY_TRANSLUCENT_SHIFT;
+    p->lo  = KEY_MAX - quantizeDepth(depth, q->far);
+  }
+
+  /* Undurchsichtig: nach Zustand, dann von vorn nach hinten */
+  else
+  {
+    p->hi |= ((unsigned long) texture  & KEY_TEXTURE_MASK) << KEY_TEXTURE_SHIFT;
+    p->hi |=  (unsigned long) material & KEY_MATERIAL_MASK;
+    p->lo  = quantizeDepth(depth, q->far);
+  }
+
+  return TRUE;
+}
+
+/**
+ * Sortiert die Pakete der Warteschlange q und zeichnet sie. Zwischen zwei
+ * z-Ebenen wird der z-Buffer geloescht oder der naechste Abschnitt von
+ * glDepthRange gewaehlt, Textur und Material werden nur bei einem Wechsel
+ * gesetzt.
+ *
+ * @param[in] q Warteschlange.
+ */
+extern void renderQueueSubmit(RenderQueue * q)
+{
+  unsigned i
+         , layers = 1
+         , slice  = 0
+         ;
+
+  Boolean useRange;
+
+  RenderPacket * p;
+
+  q->slices = 0;
+
+  if (q->count == 0)
+    return;
+
+  sortPackets(q);
+
+  /* Ebenen dieses Bildes zaehlen, die Pakete liegen nach Ebene sortiert */
+  for (i = 1; i < q->count; ++i)
+    if (q->packets[i].layer != q->packets[i - 1].layer)
+      ++layers;
+
+  useRange = q->layering == RENDERQUEUE_LAYERS_DEPTHRANGE
+          && layers > 1
+          && layersFit(q, layers);
+
+  /* Abschnitte fuer renderQueueDepthRange merken */
+  if (useRange)
+  {
+    q->slices = layers;
+    memset(q->slice, 0, sizeof(q->slice));
+  }
+
+  for (i = 0; i < q->count; ++i)
+  {
+    p = &q->packets[i];
+
+    /*
+     * Bei neuer z-Ebene naechsten Abschnitt waehlen oder z-Buffer loeschen,
+     * die unterste Ebene liegt ganz hinten
+     */
+    if (useRange && (i == 0 || p->layer != q->packets[i - 1].layer))
+    {
+      if (i > 0)
+        ++slice;
+
+      q->slice[p->layer & KEY_LAYER_MASK] = (unsigned char) slice;
+      renderQueueDepthRange(q, p->layer);
+    }
+    else if (i > 0 && p->layer != q->packets[i - 1].layer)
+      glClear(GL_DEPTH_BUFFER_BIT);
+
+    if (q->setTexture != NULL && (i == 0 || p->texture != q->packets[i - 1].texture))
+      q->setTexture(p->texture);
+
+    if (q->setMaterial != NULL && (i == 0 || p->material != q->packets[i - 1].material))
+      q->setMaterial(p->material);
+
+    p->draw(p->data);
+  }
+
+  if (useRange)
+    glDepthRange(0.0, 1.0);
+
+  q->count = 0;
+}
+
+/**
+ * Setzt glDepthRange auf den Abschnitt der z-Ebene layer im letzten Bild.
+ *
+ * @param[in] q     Warteschlange.
+ * @param[in] layer z-Ebene.
+ */
+extern void renderQueueDepthRange(const RenderQueue * q, unsigned layer)
+{
+  renderQueueSliceRange(q, q->slice[layer & KEY_LAYER_MASK]);
+}
+
+/**
+ * Setzt glDepthRange auf den Abschnitt slice des letzten Bildes.
+ *
+ * @param[in] q     Warteschlange.
+ * @param[in] slice Abschnitt.
+ */
+extern void renderQueueSliceRange(const RenderQueue * q, unsigned slice)
+{
+  double width;
+
+  if (q->slices == 0)
+  {
+    glDepthRange(0.0, 1.0);
+    return;
+  }
+
+  width = 1.0 / q->slices;
+
+  glDepthRange(1.0 - (slice + 1) * width, 1.0 - slice * width);
+}
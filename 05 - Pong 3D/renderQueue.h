@@ -0,0 +1,165 @@
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+/**
+ * @file
+ *
+ * Das Modul sammelt die Zeichenauftraege (Pakete) eines Bildes und gibt sie
+ * sortiert aus. Sortiert wird nach z-Ebene, dann undurchsichtig vor
+ * durchsichtig, dann nach Textur, Material und Tiefe. Undurchsichtige Pakete
+ * kommen von vorn nach hinten, durchsichtige von hinten nach vorn und ohne
+ * Ruecksicht auf Textur und Material, damit das Blenden stimmt.
+ * Textur und Material werden nur gesetzt, wenn sie sich aendern.
+ *
+ * Die z-Ebenen werden entweder durch Loeschen des z-Buffers getrennt oder
+ * jede bekommt ihren eigenen Abschnitt von glDepthRange, hoehere Ebenen
+ * weiter vorn. Dann reicht ein Loeschen des z-Buffers pro Bild.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include "types.h"
+
+/** Anzahl der moeglichen z-Ebenen */
+#define RENDERQUEUE_LAYERS (256)
+
+/** Trennung der z-Ebenen */
+typedef enum {
+  RENDERQUEUE_LAYERS_CLEAR       /* z-Buffer zwischen den Ebenen loeschen */
+, RENDERQUEUE_LAYERS_DEPTHRANGE  /* Je Ebene ein Abschnitt des z-Buffers  */
+} RenderQueueLayering;
+
+/** Zeichnet ein Paket, data wie bei renderQueuePush uebergeben */
+typedef void (* RenderQueueDraw)(const void * data);
+
+/** Setzt eine Textur bzw. ein Material */
+typedef void (* RenderQueueState)(int state);
+
+/** Zeichenauftrag */
+typedef struct {
+  unsigned long hi /* Sortierschluessel, hoeherwertiger Teil */
+              , lo /* Sortierschluessel, niederwertiger Teil */
+              ;
+
+  unsigned layer;  /* z-Ebene  */
+
+  int texture      /* Textur   */
+    , material     /* Material */
+    ;
+
+  RenderQueueDraw draw;
+  const void * data;
+} RenderPacket;
+
+/** Warteschlange der Zeichenauftraege eines Bildes */
+typedef struct {
+  RenderPacket * packets  /* Pakete in Einfuegereihenfolge */
+             , * scratch  /* Puffer fuer das Sortieren     */
+             ;
+
+  unsigned count
+         , capacity
+         ;
+
+  double far;             /* Tiefe, ab der nicht mehr unterschieden wird */
+
+  RenderQueueLayering layering;
+
+  unsigned sliceBits;     /* Mindestgenauigkeit eines Abschnitts in Bit  */
+
+  int depthBits;          /* Genauigkeit des z-Buffers, -1 = unbekannt   */
+
+  unsigned slices;        /* Abschnitte im letzten Bild, 0 = keine       */
+
+  unsigned char slice[RENDERQUEUE_LAYERS]; /* Abschnitt je Ebene         */
+
+  RenderQueueState setTexture
+                 , setMaterial
+                 ;
+} RenderQueue;
+
+/**
+ * Initialisiert die leere Warteschlange q.
+ *
+ * @param[out] q           Warteschlange.
+ * @param[in]  far         Groesster Betrag der Tiefe, feiner als far / 2^31
+ *                         wird nicht unterschieden.
+ * @param[in]  setTexture  Setzt eine Textur, NULL wenn die Pakete das selbst
+ *                         tun.
+ * @param[in]  setMaterial Setzt ein Material, NULL wenn die Pakete das selbst
+ *                         tun.
+ */
+extern void renderQueueInit(RenderQueue * q, double far, RenderQueueState setTexture, RenderQueueState setMaterial);
+
+/**
+ * Legt fest, wie die z-Ebenen der Warteschlange q getrennt werden. Bei
+ * RENDERQUEUE_LAYERS_DEPTHRANGE bekommt jede Ebene eines Bildes einen
+ * gleich grossen Abschnitt von glDepthRange. Reicht die Genauigkeit des
+ * z-Buffers nicht fuer alle Ebenen mit je sliceBits Bit, wird fuer dieses
+ * Bild doch geloescht.
+ *
+ * @param[in] q         Warteschlange.
+ * @param[in] layering  Art der Trennung.
+ * @param[in] sliceBits Mindestgenauigkeit eines Abschnitts in Bit.
+ */
+extern void renderQueueSetLayering(RenderQueue * q, RenderQueueLayering layering, unsigned sliceBits);
+
+/**
+ * Gibt den Speicher der Warteschlange q frei.
+ *
+ * @param[in] q Warteschlange.
+ */
+extern void renderQueueFree(RenderQueue * q);
+
+/**
+ * Fuegt ein Paket in die Warteschlange q ein.
+ *
+ * @param[in] q           Warteschlange.
+ * @param[in] layer       z-Ebene, zwischen zwei Ebenen wird der z-Buffer
+ *                        geloescht. Hoechstens 255.
+ * @param[in] translucent TRUE, wenn das Paket geblendet wird.
+ * @param[in] texture     Textur, aus [0, 4096).
+ * @param[in] material    Material, aus [0, 2048).
+ * @param[in] depth       Abstand zum Auge entlang der Blickrichtung.
+ * @param[in] draw        Zeichenfunktion.
+ * @param[in] data        Daten fuer draw, muessen bis zum Zeichnen gueltig
+ *                        bleiben.
+ *
+ * @return TRUE  wenn das Paket eingefuegt wurde
+ *         FALSE wenn kein Speicher mehr frei ist.
+ */
+extern Boolean renderQueuePush(RenderQueue * q, unsigned layer, Boolean translucent, int texture, int material, double depth, RenderQueueDraw draw, const void * data);
+
+/**
+ * Sortiert die Pakete der Warteschlange q und zeichnet sie. Danach ist q
+ * leer. Textur und Material des letzten Pakets bleiben gesetzt,
+ * glDepthRange steht wieder auf [0, 1].
+ *
+ * @param[in] q Warteschlange.
+ */
+extern void renderQueueSubmit(RenderQueue * q);
+
+/**
+ * Setzt glDepthRange auf den Abschnitt, den die z-Ebene layer beim letzten
+ * renderQueueSubmit hatte. Was danach in den z-Buffer dieses Bildes
+ * zeichnet oder gegen ihn testet, etwa Schatten, muss so fuer jedes Objekt
+ * den Abschnitt seiner Ebene waehlen. Wurde nicht in Abschnitten
+ * gezeichnet, ist es [0, 1], Ebenen, die im letzten Bild fehlten, bekommen
+ * den hintersten Abschnitt. Zuruecksetzen mit glDepthRange(0.0, 1.0).
+ *
+ * @param[in] q     Warteschlange.
+ * @param[in] layer z-Ebene.
+ */
+extern void renderQueueDepthRange(const RenderQueue * q, unsigned layer);
+
+/**
+ * Setzt glDepthRange auf den Abschnitt slice aus [0, q->slices) des letzten
+ * renderQueueSubmit, Abschnitt 0 liegt ganz hinten. Wurde nicht in
+ * Abschnitten gezeichnet, ist es [0, 1].
+ *
+ * @param[in] q     Warteschlange.
+ * @param[in] slice Abschnitt.
+ */
+extern void renderQueueSliceRange(const RenderQueue * q, unsigned slice);
+
+#endif
@@ -33,6 +33,11 @@
 #include "object_cg.h"
 #include "drawing.h"
 #include "stringOutput.h"
+#include "material.h"
+#include "texture.h"
+#include "renderQueue.h"
+#include "shadowMap.h"
+#include "mesh.h"
 
 /* ----------------------------------------------------------------------------
  * Typen
@@ -43,6 +48,33 @@
  * -------------------------------------------------------------------------- */
 
 #define INFTY (10)
+
+/** Größte Tiefe in der Warteschlange, wie die ferne Clipping-Ebene */
+#define SCENE_FAR (30.0)
+
+/** Lichtquellen, die Schatten werfen: Lampe und Ball */
+#define SCENE_SHADOW_LIGHTS (2)
+
+/** Mindestgenauigkeit einer z-Ebene im z-Buffer in Bit */
+#define SCENE_LAYER_BITS (16)
+
+/** Kantenlänge der Shadow Maps in Texeln */
+#define SCENE_SHADOWMAP_SIZE (1024)
+
+/** Abtastungen je Achse beim Anwenden der Shadow Maps, 1 für harte Kanten */
+#define SCENE_SHADOWMAP_PCF (2)
+
+/** Abdunkelung durch eine Shadow Map, wie bei den Schattenvolumen */
+#define SCENE_SHADOW_DARKNESS (0.4)
+
+/** Radius einer Kugel um den Ursprung, die das Spielfeld enthält */
+#define SCENE_RADIUS (2.0)
+
+/** Ecken der Box um den Schattenkegel einer Kugel */
+#define KEGEL_HULL_POINTS (8)
+
+/** Modell, aus dem die Schattenvolumen der Quader gebaut werden */
+#define SCENE_CUBE_MESH "models/cube.obj"
  
 /* ----------------------------------------------------------------------------
  * Globale Daten
@@ -62,12 +94,72 @@ static Boolean zInfo = FALSE; /* z-Informationen anzeigen ? */
 /* Objekt zur Schattenberechnung der Würfel */
 static CGObject objCube;
 
+/* Schattenvolumen je Lichtquelle und schattenwerfendem Objekt */
+static CGShadowVolume shadowVolumes[SCENE_SHADOW_LIGHTS][OBJECT_COUNT];
+
+/* Zeichenaufträge eines Bildes */
+static RenderQueue queue;
+
+/* Shadow Maps je Lichtquelle */
+static ShadowMap shadowMaps[SCENE_SHADOW_LIGHTS];
+
+/* Können Shadow Maps benutzt werden? */
+static Boolean shadowMapsReady = FALSE;
+
+/* Box um den Schattenkegel, wie er von drawKegel gezeichnet wird */
+static const GLfloat kegelHull[KEGEL_HULL_POINTS * 3] =
+  { -1.0f, -1.0f, -1.0f
+  ,  1.0f, -1.0f, -1.0f
+  , -1.0f,  1.0f, -1.0f
+  ,  1.0f,  1.0f, -1.0f
+  , -1.0f, -1.0f,  1.0f
+  ,  1.0f, -1.0f,  1.0f
+  , -1.0f,  1.0f,  1.0f
+  ,  1.0f,  1.0f,  1.0f
+  };
+
 /* ----------------------------------------------------------------------------
  * Funktionen
  * ----------------------------------------------------------------------------
  * Static
  * -------------------------------------------------------------------------- */
 
+/**
+ * Bindet die Textur t für die Warteschlange.
+ *
+ * @param[in] t Textur.
+ */
+static void setTexture(int t)
+{
+  bindTexture((TextureName) t);
+}
+
+/**
+ * Setzt das Material m für die Warteschlange.
+ *
+ * @param[in] m Material.
+ */
+static void setMaterial(int m)
+{
+  materialSet((Material) m);
+}
+
+/**
+ * Zeichnet ein Objekt aus der Warteschlange, Material und Textur sind
+ * bereits gesetzt.
+ *
+ * @param[in] data Zeiger auf das Objekt.
+ */
+static void drawObject(const void * data)
+{
+  #ifdef DEBUG
+  if (zInfo)
+    fprintf(stderr, "DEBUG :: Drawing %s\n", ((const Object *) data)->name);
+  #endif
+  
+  objectDrawShape(data);
+}
+
 /**
  * Lichtquellen setzen und ein- bzw. ausschalten.
  */
@@ -120,138 +212,24 @@ static void setLights(void)
 }
 
 /**
- * Schatten einer Kugel unter Benutzung eines Kegels mit dem oberen Radius s zeichnen.
+ * Zeichnet den Kegel, der den Schatten einer Kugel umschliesst.
  *
- * @param[in] s oberer Radius des Kegels.
+ * @param[in] data Oberer Radius des Kegels, double.
  */
-static void castSphereShadow(double s)
+static void drawKegelShadow(const void * data)
 {
-  /* aktuelle Einstellungen sichern */
-  glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT |
-               GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-               GL_STENCIL_BUFFER_BIT);
-
-  glCullFace(GL_BACK);
-
-  glEnable(GL_CULL_FACE);
-
-  /* Beleuchtung deaktivieren */
-  glDisable(GL_LIGHTING);
-
-  /* Schreiben in den Tiefenpuffer deaktivieren */
-  glDepthMask(GL_FALSE);
-  glDepthFunc (GL_LEQUAL); /* !!! */
-
-  /* Stenciltest aktivieren */
-  glEnable(GL_STENCIL_TEST);
-
-  /* Schreiben in den Farbpuffer deaktivieren */
-  glColorMask(0, 0, 0, 0);
-
-  /* Funktion und Referenz wert fuer den Stenciltest setzen.
-     Hier: Alles in den Stencilpuffer schreiben. */
-  glStencilFunc(GL_ALWAYS, 1, 0xffffffff);
-
-  /* Erster Durchlauf: Rendern der kompletten Shadow-Volumes,
-     vom schattenwerfenden Objekt durch den (leeren) Raum
-     bis zum Boden bzw. zur Wand.
-     Der Stencil-Puffer (der vorher ueberall 0 ist) wird an
-     den Stellen auf 1 gesetzt, wo ein Shadow-Volume vorhanden
-     ist (GL_INCR).
-     Die Face-Orientierung ist dabei auf CCW (CounterClockWise)
-     gestellt, alle FRONTfaces erzeugen also das Shadow-Volume. */
-  glFrontFace(GL_CCW);
-  glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
-
-  drawKegel(s, TEXTURE_EMPTY);
-
-  /* Zweiter Durchlauf: Erneutes Rendern der kompletten
-     Shadow-Volumes.
-     Der Stencil-Puffer (ueberall 0, 1 an Stellen mit Schatten)
-     wird an den Stellen zurueck auf 0 gesetzt, wo ein Schadow-
-     Volume vorhanden ist (GL_DECR).
-     Die Face-Orientierung ist dabei auf CW (ClockWise)
-     gestellt, alle BACKfaces erzeugen also das Shadow-Volume.
-     Die "Differenz" zwischen dem Shadow-Volume der Front-
-     und dem der Backfaces ergibt dann den eigentlichen Schatten
-     auf Boden und Waenden. */
-  glFrontFace(GL_CW);
-  glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
-
-  drawKegel(s, TEXTURE_EMPTY);
-
-  /* Face-Orientierung wieder auf "normal" setzen */
-  glFrontFace(GL_CCW);
-  /* Schreiben in den Farbpuffer wieder aktivieren */
-  glColorMask(1, 1, 1, 1);
-
-  /* "Schattierendes" Rechteck zeichnen, das die gesamte Szene
-     ueberdeckt. Es wird nur an den Stellen mittels Blending
-     mit den Werten im Farbpuffer verrechnet, an denen der
-     Stencil-Puffer einen Wert <> 0 hat, wo also ein Schatten
-     entstehen soll. */
-  glStencilFunc(GL_NOTEQUAL, 0, 0xffffffff);
-
-  /* Schattenfarbe */
-  glColor4f(0.0f, 0.0f, 0.0f, 0.4f);
-
-  /* Blending aktivieren und setzen */
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  /* Projektionsmatrix veraendern */
-  glMatrixMode(GL_PROJECTION);
-
-  /* aktuelle Projektionsmatrix sichern */
-  glPushMatrix();
-  {
-    /* neue orthogonale 2D-Projektionsmatrix erzeugen */
-    glLoadIdentity();
-    gluOrtho2D(0.0, 1.0, 0.0, 1.0);
-
-    /* ModelView-Matrix veraendern */
-    glMatrixMode(GL_MODELVIEW);
-
-    /* aktuelle ModelView-Matrix sichern */
-    glPushMatrix();
-    {
-      /* ModelView-Matrix zuruecksetzen */
-      glLoadIdentity();
-
-      glBegin(GL_TRIANGLE_STRIP);
-      {
-        glVertex2f(0.0f, 1.0f);
-        glVertex2f(0.0f, 0.0f);
-        glVertex2f(1.0f, 1.0f);
-        glVertex2f(1.0f, 0.0f);
-      }
-      glEnd();
-
-      /* alte ModelView-Matrix laden */
-    }
-    glPopMatrix();
-
-    /* Projektionsmatrix veraendern */
-    glMatrixMode(GL_PROJECTION);
-
-    /* alte Projektionsmatrix laden */
-  }
-  glPopMatrix();
-
-  /* auf der ModelView-Matrix weiterarbeiten */
-  glMatrixMode(GL_MODELVIEW);
-
-  /* alte Einstellungen laden */
-  glPopAttrib();
+  drawKegel(*(const double *) data, TEXTURE_EMPTY);
 }
 
 /**
- * Schatten einer Kugel zeichnen.
+ * Setzt die Transformation des Schattenkegels einer Kugel.
  *
  * @param[in] light Lichtquelle.
  * @param[in] o     Kugeliges, schattenwerfendes Objekt.
+ *
+ * @return Oberer Radius des Kegels.
  */
-static void castSphereShadows(Vector3d light, Object * o)
+static double transformSphereShadow(Vector3d light, Object * o)
 {
   Vector3d lightToBall /* ... */
          , axis        /* Rotation Axis */
@@ -264,63 +242,44 @@ static void castSphereShadows(Vector3d light, Object * o)
   
   d = vectorLength(lightToBall);
   
-  glPushMatrix();
-    /* affinieren */
-    materialSet(MAT_GLASS);
-    glTranslatef(o->t.x, o->t.y, o->t.z);
-    glRotatef(vectorAngle(lightToBall, vectorMake(0,-1,0)), axis.x, axis.y, axis.z);
-    glScalef(o->s.x + INFTY / d, 2 * INFTY, o->s.z + INFTY / d);
-    glTranslatef(0, -1, 0);
-    
-    /* Schatten zeichnen */
-    if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWS))
-    {
-      castSphereShadow(o->s.x / (o->s.x + INFTY / d));
-    }
-    
-    /* Shadow Volume zeichnen */
-    if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWVOLUMES))
-    {
-      /* aktuelle Einstellungen sichern */
-      glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT);
-
-      glDisable(GL_LIGHTING);
-
-      materialSet(MAT_GLASS);
-      
-      drawKegel(o->s.x / (o->s.x + INFTY / d), TEXTURE_EMPTY);
-      
-      glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
-
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      
-      drawKegel(o->s.x / (o->s.x + INFTY / d), TEXTURE_EMPTY);
+  /* affinieren */
+  glTranslatef(o->t.x, o->t.y, o->t.z);
+  glRotatef(vectorAngle(lightToBall, vectorMake(0,-1,0)), axis.x, axis.y, axis.z);
+  glScalef(o->s.x + INFTY / d, 2 * INFTY, o->s.z + INFTY / d);
+  glTranslatef(0, -1, 0);
+  
+  return o->s.x / (o->s.x + INFTY / d);
+}
 
-      /* alte Einstellungen laden */
-      glPopAttrib();
-    }
-  glPopMatrix();
+/**
+ * Setzt die Transformation eines würfeligen Objekts.
+ *
+ * @param[in] o Würfeliges Objekt.
+ */
+static void transformCube(Object * o)
+{
+  glTranslatef(o->t.x, o->t.y, o->t.z);
+  glRotatef(o->a, 0.0, 1.0, 0.0);
+  glScalef(o->s.x, o->s.y, o->s.z);
 }
 
 /**
- * Zeichnet die Schatten aller schattenwerfenden Objekte.
+ * Aktualisiert das Schattenvolumen eines würfeligen Objekts.
+ *
+ * @param[in] light Lichtquelle.
+ * @param[in] o     Würfeliges, schattenwerfendes Objekt.
+ * @param[in] sv    Schattenvolumen von o für light, wird nur neu gebaut,
+ *                  wenn sich Licht und Objekt zueinander bewegt haben.
  */
-static void castCubeShadows(Vector3d light, Object * o)
+static void updateCubeShadow(Vector3d light, Object * o, CGShadowVolume * sv)
 {
   CGVector4f lp;
 
-  CGMatrix16f minv;
-  CGVector3f v;
-
   /* Zur Berechnung von Schatten wird die Lichtposition relativ zum
      schattenwerfenden Objekt benoetigt. Da hierbei auch die Orientierung des
-     Objektes relevant ist, werden alle Transformationen, die auf das Objekt
-     angewendet werden, invertiert und in umgekehrter Reihenfolge auf die
-     Position der Lichtquelle ausgefuehrt. Hierzu werden die entsprechenden
-     Transformationsmatrizen ausgehen von der Einheitsmatrix miteinander
-     multiplziert. Wird die Lichtposition mit der daraus resultierenden Matrix
-     multiplziert erhaelt man die Lichtposition im lokalen Koordinatensystem des
-     Objektes. */
+     Objektes relevant ist, wird die Lichtposition mit der inversen
+     Transformation des Objektes multipliziert. Die Inverse haelt das Objekt
+     vor, sie wird nur neu berechnet, wenn es sich bewegt hat. */
 
   /* Lichtposition in homogene Koordinaten "umwandeln" */
   lp[0] = light.x;
@@ -328,71 +287,246 @@ static void castCubeShadows(Vector3d light, Object * o)
   lp[2] = light.z;
   lp[3] = 1;
   
-  /* Einheitsmatrix erzeugen */
-  getIdentity(&minv);
-  
-  v[0] = 1.0 / o->s.x;
-  v[1] = 1.0 / o->s.y;
-  v[2] = 1.0 / o->s.z;
-  Scale(&minv, v);
+  /* Inverse Transformation der Lichtposition ergibt deren Position im lokalen
+     Koordinatensystem des Objektes */
+  VectorMatrixMult(objectGetInverse(o), &lp);
 
-  /* invertierte Rotationen des Objekt anwenden */
-  v[0] = 0.0f;
-  v[1] = 1.0f;
-  v[2] = 0.0f;
-  Rotate(&minv, v, -o->a);
+  /* Silhouette und Schattenvolumen nur bei Bewegung neu berechnen */
+  updateShadowVolume(&objCube, sv, lp);
+}
 
-  /* Translation des Objektes negiert anwenden */
-  v[0] = -o->t.x;
-  v[1] = -o->t.y;
-  v[2] = -o->t.z;
-  Translate(&minv, v);
+/**
+ * Zeichnet die Schatten aller Objekte os einer Lichtquelle. Alle
+ * Schattenvolumen landen zuerst im Stencilpuffer, abgedunkelt wird danach
+ * einmal, nur im Bildschirmrechteck, das die Volumen bedecken.
+ *
+ * Lagen die z-Ebenen des Bildes in Abschnitten von glDepthRange, werden die
+ * Volumen in jedem Abschnitt gezeichnet. In fremden Abschnitten liegen sie
+ * ganz vor oder ganz hinter dem z-Buffer. Nur geschlossene Volumen heben
+ * sich dort auf, daher dann z-fail. Ohne Depth Clamping bleibt es bei
+ * z-pass, und Empfänger in anderen Ebenen als ihr Werfer können falsche
+ * Schatten bekommen.
+ *
+ * @param[in] light Lichtquelle.
+ * @param[in] os    Schattenwerfende Objekte.
+ * @param[in] svs   Schattenvolumen der Objekte für light.
+ */
+static void castShadows(Vector3d light, Objects * os, CGShadowVolume * svs)
+{
+  Boolean zFail = logicGetSwitchable(LOGIC_SWITCHABLE_ZFAIL);
 
-  /* Inverse Transformation der Lichtposition ergibt deren Position im lokalen
-     Koordinatensystem des Objektes */
-  VectorMatrixMult(minv, &lp);
+  Object * o;
+
+  double s;
 
-  /* Ende der Lichtpositionsberechnung */
+  int i;
 
-  /* Sichtbarkeit der Flaechen von der Lichtquelle aus berechnen */
-  calcVisibility(&objCube, lp);
+  unsigned slice
+         , slices = queue.slices > 0 ? queue.slices : 1
+         ;
 
-  /* Schatten des Objekts zeichnen */
-  glPushMatrix();
+  for (i = 0; i < os->last; ++i)
+  {
+    o = objectsAt(os, i);
+    
+    if (o->f == FIGURE_CUBE)
+      updateCubeShadow(light, o, &svs[i]);
+  }
+  
+  /* Schatten zeichnen */
+  if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWS))
   {
-    glTranslatef(o->t.x, o->t.y, o->t.z);
-    glRotatef(o->a, 0.0, 1.0, 0.0);
-    glScalef(o->s.x, o->s.y, o->s.z);
+    /* Ohne Depth Clamping weicht beginShadowPass auf z-pass aus */
+    zFail = beginShadowPass(zFail || slices > 1);
     
-    /* Schatten zeichnen */
-    if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWS))
+    for (slice = 0; slice < slices; ++slice)
     {
-      castShadow(objCube, lp);
+      /* Gegen den z-Buffer der Ebenen dieses Abschnitts */
+      renderQueueSliceRange(&queue, slice);
+      
+      for (i = 0; i < os->last; ++i)
+      {
+        o = objectsAt(os, i);
+        
+        glPushMatrix();
+        {
+          switch (o->f)
+          {
+            case FIGURE_CUBE:
+              transformCube(o);
+              stencilShadowVolume(&svs[i], zFail);
+              break;
+            case FIGURE_SPHERE:
+              /* Der Kegel ist offen, also immer z-pass */
+              s = transformSphereShadow(light, o);
+              extendShadowBounds(kegelHull, KEGEL_HULL_POINTS);
+              stencilShadowGeometry(drawKegelShadow, &s);
+              break;
+            default:
+              assert(0);
+              break;
+          }
+        }
+        glPopMatrix();
+      }
     }
+    
+    endShadowPass();
+  }
+  
+  /* ggf. Schattenvolumen zeichnen */
+  if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWVOLUMES))
+  {
+    /* aktuelle Einstellungen sichern */
+    glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT);
 
-    /* ggf. Schattenvolumen zeichnen */
-    if (logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWVOLUMES))
-    {
-      /* aktuelle Einstellungen sichern */
-      glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT);
-
-      glDisable(GL_LIGHTING);
+    glDisable(GL_LIGHTING);
 
-      materialSet(MAT_GLASS);
+    for (i = 0; i < os->last; ++i)
+    {
+      o = objectsAt(os, i);
       
-      drawShadowVolume(objCube, lp);
+      renderQueueDepthRange(&queue, o->z);
+      
+      glPushMatrix();
+      {
+        switch (o->f)
+        {
+          case FIGURE_CUBE:
+            transformCube(o);
+            
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            materialSet(MAT_GLASS);
+            drawShadowVolume(&svs[i], GL_FALSE);
+            
+            glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            drawShadowVolume(&svs[i], GL_FALSE);
+            break;
+          case FIGURE_SPHERE:
+            s = transformSphereShadow(light, o);
+            
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            materialSet(MAT_GLASS);
+            drawKegel(s, TEXTURE_EMPTY);
+            
+            glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            drawKegel(s, TEXTURE_EMPTY);
+            break;
+          default:
+            assert(0);
+            break;
+        }
+      }
+      glPopMatrix();
+    }
 
-      glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
+    /* alte Einstellungen laden */
+    glPopAttrib();
+  }
+}
 
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-      
-      drawShadowVolume(objCube, lp);
+/**
+ * Gibt den Radius der Umgebungskugel des Objekts o zurück.
+ *
+ * @param[in] o Objekt.
+ *
+ * @return Radius.
+ */
+static double boundingRadius(const Object * o)
+{
+  double r = o->s.x;
+  
+  /* Kugeln haben den Radius 1, alles andere passt in [-0.5, 0.5]^3 */
+  if (o->f != FIGURE_SPHERE)
+    return 0.5 * vectorLength(o->s);
+  
+  if (o->s.y > r)
+    r = o->s.y;
+  if (o->s.z > r)
+    r = o->s.z;
+  
+  return r;
+}
+
+/**
+ * Zeichnet die Shadow Map m der Lichtquelle light mit den Objekten os.
+ *
+ * @param[in] m     Shadow Map.
+ * @param[in] light Lichtquelle.
+ * @param[in] os    Schattenwerfende Objekte.
+ */
+static void renderShadowMap(ShadowMap * m, Vector3d light, Objects * os)
+{
+  ShadowMapCaster casters[OBJECT_COUNT];
+  
+  int i;
+  
+  for (i = 0; i < os->last; ++i)
+  {
+    casters[i].c = objectsAt(os, i)->t;
+    casters[i].r = boundingRadius(objectsAt(os, i));
+  }
+  
+  if (!shadowMapBegin(m, light, casters, os->last, vectorLength(light) + SCENE_RADIUS))
+    return;
+  
+  for (i = 0; i < os->last; ++i)
+    objectDrawShape(objectsAt(os, i));
+  
+  shadowMapEnd(m);
+}
 
-      /* alte Einstellungen laden */
-      glPopAttrib();
+/**
+ * Zeichnet alle Objekte des Levels außer der Lichtquelle data noch einmal,
+ * als Empfänger einer Shadow Map.
+ *
+ * @param[in] data Objekt der Lichtquelle.
+ */
+static void drawShadowReceivers(const void * data)
+{
+  Objects * os = logicGetObjects(LOGIC_OBJECTS_LEVEL);
+  
+  Object * o;
+  
+  int i;
+  
+  for (i = 0; i < os->last; ++i)
+  {
+    o = objectsAt(os, i);
+    
+    /* Tiefe wie beim Zeichnen der Szene, sonst greift der z-Test nicht */
+    if (o != data)
+    {
+      renderQueueDepthRange(&queue, o->z);
+      objectDrawShape(o);
     }
   }
-  glPopMatrix();
+}
+
+/**
+ * Initialisiert das Objekt zur Schattenberechnung der Würfel aus
+ * SCENE_CUBE_MESH. Fehlt die Datei oder ist sie fehlerhaft, wird der
+ * eingebaute Würfel verwendet.
+ */
+static void initCubeCaster(void)
+{
+  Mesh m;
+  
+  Boolean loaded = meshLoadObj(&m, SCENE_CUBE_MESH)
+                && initObjectFromTriangles(&objCube, m.points, m.nPoints, m.triangles, m.nTriangles);
+  
+  meshFree(&m);
+  
+  if (!loaded)
+  {
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Scene : Using the built-in cube as shadow caster.\n");
+    #endif
+    
+    initObject(&objCube);
+  }
 }
 
 /* ----------------------------------------------------------------------------
@@ -413,107 +547,82 @@ extern void sceneDraw(Boolean shadow)
   Objects * os = logicGetObjects(LOGIC_OBJECTS_LEVEL);
   Object  * o;
 
-  int i = 0
-    , z = 0;
+  int i = 0;
   
-  setLights();
+  Boolean useShadowMaps = shadow
+                       && shadowMapsReady
+                       && logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWS)
+                       && logicGetSwitchable(LOGIC_SWITCHABLE_SHADOWMAPS)
+                       ;
   
-  i = os->last - 1;
+  setLights();
   
-  /* Back -> Front */
-  while (z < os->zMax && i >= 0)
+  /* Shadow Maps vor der Szene, ohne FBO wird der z-Buffer benutzt */
+  if (useShadowMaps)
   {
-    o = objectsAt(os, i);
-    
-    /* z-BUffer bei neuer z-Ebene löschen */
-    if (z != o->z)
-    {
-      #ifdef DEBUG
-      if (zInfo)
-        fprintf(stderr, "DEBUG :: Clearing Z-Buffer.\n");
-      #endif
-      
-      glClear(GL_DEPTH_BUFFER_BIT);
-      
-      ++z;
-    }
-    
-    objectDraw(o);
+    if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT0))
+      renderShadowMap(&shadowMaps[0],
+                      logicGetObject(LOGIC_OBJECT_LIGHT)->t,
+                      logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYLIGHT));
     
-    --i;
+    if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT1))
+      renderShadowMap(&shadowMaps[1],
+                      logicGetObject(LOGIC_OBJECT_BALL)->t,
+                      logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYBALL));
   }
   
-  /* letzte z-Ebene */
-  while (i >= 0)
+  for (i = 0; i < os->last; ++i)
   {
     o = objectsAt(os, i);
     
-    objectDraw(o);
-    
-    --i;
+    renderQueuePush(&queue, o->z, materialIsTranslucent(o->m), o->tex, o->m, o->size, drawObject, o);
   }
   
+  /* Ebene für Ebene, undurchsichtig von vorn nach hinten, dann
+   * durchscheinend von hinten nach vorn */
+  renderQueueSubmit(&queue);
+  
   #ifdef DEBUG
   if (zInfo)
     fprintf(stderr, "\n");
   #endif
   
-  /* Schatten zeichnen */
-  if (shadow)
+  /* Schatten sind untexturiert */
+  bindTexture(TEXTURE_EMPTY);
+  
+  /* Schatten per Shadow Map */
+  if (useShadowMaps)
   {
     /* "Lampe" */
     if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT0))
-    {
-      Vector3d light = logicGetObject(LOGIC_OBJECT_LIGHT)->t;
-      
-      os = logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYLIGHT);
-      
-      for (i = 0; i < os->last; ++i)
-      {
-        o = objectsAt(os, i);
-        
-        switch (o->f)
-        {
-          case FIGURE_CUBE:
-            castCubeShadows(light, o);
-            break;
-          case FIGURE_SPHERE:
-            castSphereShadows(light, o);
-            break;
-          default:
-            assert(0);
-            break;
-        }
-      }
-    }
+      shadowMapApply(&shadowMaps[0], SCENE_SHADOW_DARKNESS,
+                     drawShadowReceivers, logicGetObject(LOGIC_OBJECT_LIGHT));
     
     /* Ball */
     if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT1))
-    {
-      Vector3d light = logicGetObject(LOGIC_OBJECT_BALL)->t;
-      
-      os = logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYBALL);
-      
-      for (i = 0; i < os->last; ++i)
-      {
-        o = objectsAt(os, i);
-        
-        switch (o->f)
-        {
-          case FIGURE_CUBE:
-            castCubeShadows(light, o);
-            break;
-          case FIGURE_SPHERE:
-            castSphereShadows(light, o);
-            break;
-          default:
-            assert(0);
-            break;
-        }
-      }
-    }
+      shadowMapApply(&shadowMaps[1], SCENE_SHADOW_DARKNESS,
+                     drawShadowReceivers, logicGetObject(LOGIC_OBJECT_BALL));
   }
   
+  /* Schatten per Schattenvolumen */
+  else if (shadow)
+  {
+    /* "Lampe" */
+    if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT0))
+      castShadows(logicGetObject(LOGIC_OBJECT_LIGHT)->t,
+                  logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYLIGHT),
+                  shadowVolumes[0]);
+    
+    /* Ball */
+    if (logicGetSwitchable(LOGIC_SWITCHABLE_LIGHT1))
+      castShadows(logicGetObject(LOGIC_OBJECT_BALL)->t,
+                  logicGetObjects(LOGIC_OBJECTS_SHADOWABLEBYBALL),
+                  shadowVolumes[1]);
+  }
+  
+  /* Die Schatten wählen die Abschnitte der z-Ebenen selbst */
+  glDepthRange(0.0, 1.0);
+  
   /* Infos anzeigen 
   drawString(0.05, 0.10, textColor, "Lifes: %i", logicGetInt(LOGIC_INT_LIFES));
   drawString(0.05, 0.15, textColor, "Points: %i", logicGetInt(LOGIC_INT_POINTS));*/
@@ -524,6 +633,8 @@ extern void sceneDraw(Boolean shadow)
  */
 extern int sceneInit(void)
 {
+  int i;
+  
   /* Hintergrundfarbe */
   glClearColor( 0.0f
               , 0.0f
@@ -552,7 +663,19 @@ extern int sceneInit(void)
   /* Texturierung */
   glEnable(GL_TEXTURE_2D);
   
-  initObject(&objCube);
+  initCubeCaster();
+  
+  renderQueueInit(&queue, SCENE_FAR, setTexture, setMaterial);
+  
+  /* z-Ebenen über glDepthRange trennen, nur ein Löschen des z-Buffers */
+  renderQueueSetLayering(&queue, RENDERQUEUE_LAYERS_DEPTHRANGE, SCENE_LAYER_BITS);
+  
+  /* Ohne Shadow Maps bleibt es bei den Schattenvolumen */
+  shadowMapsReady = TRUE;
+  
+  for (i = 0; i < SCENE_SHADOW_LIGHTS; ++i)
+    shadowMapsReady = shadowMapInit(&shadowMaps[i], SCENE_SHADOWMAP_SIZE, SCENE_SHADOWMAP_PCF)
+                   && shadowMapsReady;
   
   return 1;
 }
@@ -591,5 +714,18 @@ extern void sceneSwitchWireframeMode(void)
  */
 extern void sceneCleanup(void)
 {
+  int i
+    , j
+    ;
+  
   freeObject(&objCube);
+  
+  for (i = 0; i < SCENE_SHADOW_LIGHTS; ++i)
+    for (j = 0; j < OBJECT_COUNT; ++j)
+      freeShadowVolume(&shadowVolumes[i][j]);
+  
+  for (i = 0; i < SCENE_SHADOW_LIGHTS; ++i)
+    shadowMapFree(&shadowMaps[i]);
+  
+  renderQueueFree(&queue);
 }
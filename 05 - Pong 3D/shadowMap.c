@@ -0,0 +1,603 @@
+/**
+ * @file
+ *
+ * Schatten per Shadow Map.
+ *
+ * Der Blickkegel des Lichts zeigt auf den Schwerpunkt der schattenwerfenden
+ * Objekte und ist gerade so weit, dass er alle ihre Umgebungskugeln
+ * umschliesst. Da der Schatten eines Objekts vom Licht aus gesehen immer
+ * hinter dem Objekt liegt, liegt er damit auch im Kegel. Was ausserhalb
+ * liegt, liest ueber den Rand der Textur die Tiefe 1 und bleibt hell.
+ *
+ * Die Texturkoordinaten werden per GL_EYE_LINEAR aus den Weltkoordinaten
+ * erzeugt: Die Ebenen werden unter der Kameramatrix als Einheitsmatrix
+ * angegeben, GL multipliziert sie dabei mit deren Inverser. Die Texturmatrix
+ * bildet dann Welt- auf Texturkoordinaten ab.
+ *
+ * Beim Percentage Closer Filtering wird je Abtastung einmal gezeichnet, jede
+ * dunkelt um 1 - (1 - darkness)^(1 / n) ab. Liegen alle n Abtastungen im
+ * Schatten, ergibt das genau darkness, sonst entsprechend weniger.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#define GL_GLEXT_PROTOTYPES
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "shadowMap.h"
+#include "object_cg.h"
+#include "types.h"
+#include "vector.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+#define PI (3.1415926535897932384626433832795029)
+#define RADTODEG(x) ((x)*(180)/(PI))
+
+/** Groesster halber Oeffnungswinkel des Lichtkegels im Bogenmass */
+#define SHADOWMAP_MAX_ANGLE (80.0 * PI / 180.0)
+
+/** Kleinster Abstand der nahen Clipping-Ebene vom Licht */
+#define SHADOWMAP_MIN_NEAR (0.05)
+
+/** Verschiebung der Tiefe gegen Selbstverschattung, wie bei glPolygonOffset */
+#define SHADOWMAP_OFFSET_FACTOR (1.1f)
+#define SHADOWMAP_OFFSET_UNITS  (4.0f)
+
+/** Texturstufe der Shadow Map, Stufe 0 bleibt den Texturen der Szene */
+#define SHADOWMAP_UNIT (GL_TEXTURE1)
+
+/** Einheitsmatrix, zeilenweise als Ebenen fuer GL_EYE_LINEAR */
+static const GLdouble identity[4][4] =
+  { { 1.0, 0.0, 0.0, 0.0 }
+  , { 0.0, 1.0, 0.0, 0.0 }
+  , { 0.0, 0.0, 1.0, 0.0 }
+  , { 0.0, 0.0, 0.0, 1.0 }
+  };
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* -1 unbekannt, 0 nein, 1 ja */
+static int hasShadow = -1
+         , hasFBO    = -1
+         ;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Prueft, ob GL Framebuffer Objects anbietet (ab Version 3.0 oder als
+ * Erweiterung).
+ *
+ * @return TRUE  wenn in eine Textur gezeichnet werden kann,
+ *         FALSE sonst.
+ */
+static Boolean checkFBO(void)
+{
+  if (hasFBO < 0)
+  {
+    hasFBO = hasGLVersion(3, 0) || hasGLExtension("GL_ARB_framebuffer_object");
+
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Shadow Map : %s.\n", hasFBO ? "Using FBOs" : "Copying from the depth buffer");
+    #endif
+  }
+
+  return hasFBO;
+}
+
+/**
+ * Berechnet res = a * b fuer spaltenweise 4x4-Matrizen. res darf weder a
+ * noch b sein.
+ *
+ * @param[out] res Produkt.
+ * @param[in]  a   Linker Faktor.
+ * @param[in]  b   Rechter Faktor.
+ */
+static void multiply(double res[16], const double a[16], const double b[16])
+{
+  int col
+    , row
+    ;
+
+  for (col = 0; col < 4; ++col)
+    for (row = 0; row < 4; ++row)
+      res[col * 4 + row] = a[row]      * b[col * 4]
+                         + a[4 + row]  * b[col * 4 + 1]
+                         + a[8 + row]  * b[col * 4 + 2]
+                         + a[12 + row] * b[col * 4 + 3];
+}
+
+/**
+ * Gibt den Winkel zwischen den normierten Vektoren u und v im Bogenmass
+ * zurueck.
+ *
+ * @param[in] u Erster Vektor.
+ * @param[in] v Zweiter Vektor.
+ *
+ * @return Winkel aus [0, PI].
+ */
+static double angle(Vector3d u, Vector3d v)
+{
+  double c = vectorMult(u, v);
+
+  /* Rundungsfehler abfangen */
+  if (c > 1.0)
+    c = 1.0;
+  if (c < -1.0)
+    c = -1.0;
+
+  return acos(c);
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Prueft, ob GL Shadow Maps anbietet.
+ *
+ * @return TRUE  wenn Shadow Maps benutzt werden koennen,
+ *         FALSE sonst.
+ */
+extern Boolean shadowMapSupported(void)
+{
+  if (hasShadow < 0)
+    hasShadow = hasGLVersion(1, 4)
+            || (hasGLVersion(1, 3)
+             && hasGLExtension("GL_ARB_depth_texture")
+             && hasGLExtension("GL_ARB_shadow"));
+
+  return hasShadow;
+}
+
+/**
+ * Legt Textur und, wenn moeglich, Framebuffer Object der Shadow Map m an.
+ *
+ * @param[out] m    Shadow Map.
+ * @param[in]  size Kantenlaenge der Textur in Texeln.
+ * @param[in]  pcf  Abtastungen je Achse beim Anwenden.
+ *
+ * @return TRUE  wenn die Shadow Map benutzt werden kann,
+ *         FALSE sonst.
+ */
+extern Boolean shadowMapInit(ShadowMap * m, int size, int pcf)
+{
+  static const GLfloat border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+  GLubyte * ones;
+
+  GLenum filter = pcf > 1 ? GL_LINEAR : GL_NEAREST;
+
+  m->texture = 0;
+  m->fbo     = 0;
+  m->size    = size;
+  m->used    = 0;
+  m->pcf     = pcf < 1 ? 1 : pcf;
+  m->valid   = FALSE;
+
+  if (!shadowMapSupported())
+    return FALSE;
+
+  /* Alles auf die Tiefe 1, damit nicht beschriebene Texel hell bleiben */
+  ones = malloc((size_t) size * size);
+
+  if (ones == NULL)
+    return FALSE;
+
+  memset(ones, 0xFF, (size_t) size * size);
+
+  glGenTextures(1, &m->texture);
+
+  glActiveTexture(SHADOWMAP_UNIT);
+  glBindTexture(GL_TEXTURE_2D, m->texture);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, ones);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  free(ones);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+  /* Ausserhalb des Lichtkegels die Tiefe 1 */
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+
+  /* Ergebnis des Vergleichs im Alphakanal: 1 beleuchtet, 0 im Schatten */
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_ALPHA);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+
+  if (checkFBO())
+  {
+    GLenum status;
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m->framebuffer);
+
+    glGenFramebuffers(1, &m->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m->fbo);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m->texture, 0);
+
+    /* Nur Tiefe, keine Farbe */
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m->framebuffer);
+
+    /* Dann doch kopieren */
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+      #ifdef DEBUG
+      fprintf(stderr, "DEBUG :: Shadow Map : Incomplete FBO (0x%x), copying instead.\n", status);
+      #endif
+
+      glDeleteFramebuffers(1, &m->fbo);
+
+      m->fbo = 0;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+ * Gibt Textur und Framebuffer Object der Shadow Map m frei.
+ *
+ * @param[in] m Shadow Map.
+ */
+extern void shadowMapFree(ShadowMap * m)
+{
+  if (m->fbo != 0)
+    glDeleteFramebuffers(1, &m->fbo);
+
+  if (m->texture != 0)
+    glDeleteTextures(1, &m->texture);
+
+  m->fbo     = 0;
+  m->texture = 0;
+  m->valid   = FALSE;
+}
+
+/**
+ * Beginnt das Zeichnen der Shadow Map m.
+ *
+ * @param[in] m       Shadow Map.
+ * @param[in] light   Position der Lichtquelle.
+ * @param[in] casters Umgebungskugeln der schattenwerfenden Objekte.
+ * @param[in] n       Anzahl der Umgebungskugeln.
+ * @param[in] far     Groesster Abstand eines Empfaengers vom Licht.
+ *
+ * @return TRUE  wenn gezeichnet werden soll,
+ *         FALSE wenn kein Objekt einen Schatten werfen kann.
+ */
+extern Boolean shadowMapBegin(ShadowMap * m, Vector3d light, const ShadowMapCaster * casters, int n, double far)
+{
+  Vector3d center = vectorMakeNull()
+         , up
+         , toCaster
+         ;
+
+  double near  = far
+       , half  = 0.0
+       , dist
+       , projection[16]
+       , view[16]
+       , lightMatrix[16]
+       , bias[16]
+       , scale
+       ;
+
+  int i
+    , count = 0
+    ;
+
+  m->valid = FALSE;
+
+  if (m->texture == 0)
+    return FALSE;
+
+  /* Schwerpunkt der Objekte, die das Licht nicht einschliessen */
+  for (i = 0; i < n; ++i)
+    if (vectorLength(vectorSub(casters[i].c, light)) > casters[i].r)
+    {
+      center = vectorAdd(center, casters[i].c);
+      ++count;
+    }
+
+  if (count == 0)
+    return FALSE;
+
+  center = vectorScale(center, 1.0 / count, 1.0 / count, 1.0 / count);
+
+  m->light = light;
+  m->dir   = vectorNorm(vectorSub(center, light));
+
+  /* Kegel um alle Umgebungskugeln, nahe Ebene vor der naechsten */
+  for (i = 0; i < n; ++i)
+  {
+    toCaster = vectorSub(casters[i].c, light);
+    dist     = vectorLength(toCaster);
+
+    if (dist <= casters[i].r)
+      continue;
+
+    toCaster = vectorScale(toCaster, 1.0 / dist, 1.0 / dist, 1.0 / dist);
+
+    if (angle(m->dir, toCaster) + asin(casters[i].r / dist) > half)
+      half = angle(m->dir, toCaster) + asin(casters[i].r / dist);
+
+    if (dist - casters[i].r < near)
+      near = dist - casters[i].r;
+  }
+
+  if (half > SHADOWMAP_MAX_ANGLE)
+    half = SHADOWMAP_MAX_ANGLE;
+
+  if (near < SHADOWMAP_MIN_NEAR)
+    near = SHADOWMAP_MIN_NEAR;
+
+  if (far <= near)
+    far = 2.0 * near;
+
+  /* Senkrechter Blick braucht einen anderen Up-Vektor */
+  up = fabs(m->dir.y) > 0.99
+     ? vectorMake(0.0, 0.0, 1.0)
+     : vectorMake(0.0, 1.0, 0.0)
+     ;
+
+  glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT
+             | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_SCISSOR_BIT);
+
+  /* Ins Framebuffer Object oder in die Ecke des aktuellen Viewports */
+  if (m->fbo != 0)
+  {
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m->fbo);
+
+    m->viewport[0] = 0;
+    m->viewport[1] = 0;
+    m->used        = m->size;
+  }
+  else
+  {
+    glGetIntegerv(GL_VIEWPORT, m->viewport);
+
+    m->used = m->size;
+
+    if (m->viewport[2] < m->used)
+      m->used = m->viewport[2];
+    if (m->viewport[3] < m->used)
+      m->used = m->viewport[3];
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(m->viewport[0], m->viewport[1], m->used, m->used);
+  }
+
+  m->viewport[2] = m->used;
+  m->viewport[3] = m->used;
+
+  glViewport(m->viewport[0], m->viewport[1], m->used, m->used);
+
+  glDepthMask(GL_TRUE);
+  glClear(GL_DEPTH_BUFFER_BIT);
+
+  /* Nur Tiefe */
+  glColorMask(0, 0, 0, 0);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glDisable(GL_BLEND);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LEQUAL);
+
+  /* Rueckseiten und etwas nach hinten, gegen Selbstverschattung */
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_FRONT);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(SHADOWMAP_OFFSET_FACTOR, SHADOWMAP_OFFSET_UNITS);
+
+  glMatrixMode(GL_PROJECTION);
+  glPushMatrix();
+  glLoadIdentity();
+  gluPerspective(RADTODEG(2.0 * half), 1.0, near, far);
+  glGetDoublev(GL_PROJECTION_MATRIX, projection);
+
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  gluLookAt( light.x,  light.y,  light.z
+           , center.x, center.y, center.z
+           , up.x,     up.y,     up.z
+           );
+  glGetDoublev(GL_MODELVIEW_MATRIX, view);
+
+  /* [-1, 1] auf den beschriebenen Teil [0, used / size] der Textur */
+  scale = 0.5 * m->used / m->size;
+
+  memset(bias, 0, sizeof(bias));
+
+  bias[0]  = scale;
+  bias[5]  = scale;
+  bias[10] = 0.5;
+  bias[12] = scale;
+  bias[13] = scale;
+  bias[14] = 0.5;
+  bias[15] = 1.0;
+
+  multiply(lightMatrix, projection, view);
+  multiply(m->matrix, bias, lightMatrix);
+
+  return TRUE;
+}
+
+/**
+ * Beendet das Zeichnen der Shadow Map m.
+ *
+ * @param[in] m Shadow Map.
+ */
+extern void shadowMapEnd(ShadowMap * m)
+{
+  if (m->fbo != 0)
+    glBindFramebuffer(GL_FRAMEBUFFER, m->framebuffer);
+
+  /* Aus dem z-Buffer kopieren und ihn fuer die Szene wieder loeschen */
+  else
+  {
+    glActiveTexture(SHADOWMAP_UNIT);
+    glBindTexture(GL_TEXTURE_2D, m->texture);
+
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m->viewport[0], m->viewport[1], m->used, m->used);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+
+  glMatrixMode(GL_PROJECTION);
+  glPopMatrix();
+
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix();
+
+  glPopAttrib();
+
+  m->valid = TRUE;
+}
+
+/**
+ * Dunkelt die von draw gezeichneten Empfaenger dort ab, wo sie von m aus
+ * gesehen im Schatten liegen.
+ *
+ * @param[in] m        Shadow Map.
+ * @param[in] darkness Abdunkelung im vollen Schatten.
+ * @param[in] draw     Zeichnet die Empfaenger.
+ * @param[in] data     Daten fuer draw.
+ */
+extern void shadowMapApply(const ShadowMap * m, double darkness, ShadowMapDraw draw, const void * data)
+{
+  GLdouble plane[4];
+
+  int taps = m->pcf * m->pcf
+    , i
+    , j
+    ;
+
+  if (!m->valid)
+    return;
+
+  glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT
+             | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT);
+
+  /* Nur abdunkeln, wo die Szene schon steht */
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glDepthMask(GL_FALSE);
+  glDepthFunc(GL_LEQUAL);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glColor4d(0.0, 0.0, 0.0, 1.0 - pow(1.0 - darkness, 1.0 / taps));
+
+  /* Nichts hinter dem Licht, dort spiegelt sich die Projektion */
+  plane[0] = m->dir.x;
+  plane[1] = m->dir.y;
+  plane[2] = m->dir.z;
+  plane[3] = - vectorMult(m->dir, m->light);
+
+  glClipPlane(GL_CLIP_PLANE0, plane);
+  glEnable(GL_CLIP_PLANE0);
+
+  glActiveTexture(SHADOWMAP_UNIT);
+  glBindTexture(GL_TEXTURE_2D, m->texture);
+  glEnable(GL_TEXTURE_2D);
+
+  /* Weltkoordinaten als Texturkoordinaten */
+  glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+  glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+  glTexGeni(GL_R, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+  glTexGeni(GL_Q, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+
+  glTexGendv(GL_S, GL_EYE_PLANE, identity[0]);
+  glTexGendv(GL_T, GL_EYE_PLANE, identity[1]);
+  glTexGendv(GL_R, GL_EYE_PLANE, identity[2]);
+  glTexGendv(GL_Q, GL_EYE_PLANE, identity[3]);
+
+  glEnable(GL_TEXTURE_GEN_S);
+  glEnable(GL_TEXTURE_GEN_T);
+  glEnable(GL_TEXTURE_GEN_R);
+  glEnable(GL_TEXTURE_GEN_Q);
+
+  /* Farbe schwarz, Alpha = Schattenfarbe * (1 - Vergleich) */
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PRIMARY_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PRIMARY_COLOR);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+  glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_TEXTURE);
+  glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+
+  /* Eine Abtastung je Durchlauf, um Texel verschoben. Gezeichnet wird mit
+     Stufe 0 aktiv, da draw dort Texturen binden darf. */
+  for (i = 0; i < m->pcf; ++i)
+    for (j = 0; j < m->pcf; ++j)
+    {
+      glActiveTexture(SHADOWMAP_UNIT);
+      glMatrixMode(GL_TEXTURE);
+      glLoadIdentity();
+      glTranslated((i - 0.5 * (m->pcf - 1)) / m->size, (j - 0.5 * (m->pcf - 1)) / m->size, 0.0);
+      glMultMatrixd(m->matrix);
+
+      glMatrixMode(GL_MODELVIEW);
+      glActiveTexture(GL_TEXTURE0);
+
+      draw(data);
+    }
+
+  glActiveTexture(SHADOWMAP_UNIT);
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+
+  glActiveTexture(GL_TEXTURE0);
+
+  glPopAttrib();
+}
@@ -0,0 +1,131 @@
+#ifndef __SHADOWMAP_H__
+#define __SHADOWMAP_H__
+/**
+ * @file
+ *
+ * Schatten per Shadow Map. Aus Sicht einer Lichtquelle werden die
+ * schattenwerfenden Objekte in eine Tiefentextur gezeichnet, ueber ein
+ * Framebuffer Object oder, wenn es keins gibt, in den z-Buffer des Fensters
+ * mit anschliessendem glCopyTexSubImage2D. Beim Anwenden werden die
+ * Empfaenger noch einmal gezeichnet, die Textur wird projektiv aufgelegt und
+ * per Tiefenvergleich (GL_ARB_shadow) dort abgedunkelt, wo etwas zwischen
+ * Licht und Empfaenger liegt.
+ *
+ * Die Kosten haengen von der Aufloesung der Textur ab, nicht davon, wie
+ * viele Schatten sich auf dem Bildschirm ueberlagern.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+#include <GL/gl.h>
+
+#include "types.h"
+#include "vector.h"
+
+/** Zeichnet Geometrie fuer die Shadow Map */
+typedef void (* ShadowMapDraw)(const void * data);
+
+/** Umgebungskugel eines schattenwerfenden Objekts */
+typedef struct {
+  Vector3d c;              /* Mittelpunkt */
+  double r;                /* Radius      */
+} ShadowMapCaster;
+
+/** Shadow Map einer Lichtquelle */
+typedef struct {
+  GLuint texture           /* Tiefentextur                               */
+       , fbo               /* Framebuffer Object, 0 beim Kopieren        */
+       ;
+
+  int size                 /* Kantenlaenge der Textur                    */
+    , used                 /* Davon im letzten Bild beschrieben          */
+    , pcf                  /* Abtastungen je Achse beim Anwenden         */
+    ;
+
+  GLint viewport[4]        /* Bereich, in den gezeichnet wird            */
+      , framebuffer        /* Vorher gebundenes Framebuffer Object       */
+      ;
+
+  Vector3d light           /* Position der Lichtquelle                   */
+         , dir             /* Blickrichtung der Lichtquelle              */
+         ;
+
+  double matrix[16];       /* Welt- auf Texturkoordinaten, spaltenweise  */
+
+  Boolean valid;           /* Im letzten Bild gezeichnet                 */
+} ShadowMap;
+
+/**
+ * Prueft, ob GL Shadow Maps anbietet (Tiefentexturen und Tiefenvergleich,
+ * ab Version 1.4 oder als Erweiterungen).
+ *
+ * @return TRUE  wenn Shadow Maps benutzt werden koennen,
+ *         FALSE sonst.
+ */
+extern Boolean shadowMapSupported(void);
+
+/**
+ * Legt Textur und, wenn moeglich, Framebuffer Object der Shadow Map m an.
+ *
+ * @param[out] m    Shadow Map.
+ * @param[in]  size Kantenlaenge der Textur in Texeln.
+ * @param[in]  pcf  Abtastungen je Achse beim Anwenden (Percentage Closer
+ *                  Filtering), 1 fuer harte Kanten.
+ *
+ * @return TRUE  wenn die Shadow Map benutzt werden kann,
+ *         FALSE wenn GL keine Shadow Maps anbietet.
+ */
+extern Boolean shadowMapInit(ShadowMap * m, int size, int pcf);
+
+/**
+ * Gibt Textur und Framebuffer Object der Shadow Map m frei.
+ *
+ * @param[in] m Shadow Map.
+ */
+extern void shadowMapFree(ShadowMap * m);
+
+/**
+ * Beginnt das Zeichnen der Shadow Map m. Der Blickkegel des Lichts wird so
+ * gelegt, dass er alle Umgebungskugeln casters umschliesst. Danach sind
+ * Projektions- und Modelviewmatrix die des Lichts, bis shadowMapEnd die
+ * alten wiederherstellt.
+ *
+ * Ohne Framebuffer Object wird in den aktuellen Viewport gezeichnet, das
+ * muss also vor der eigentlichen Szene geschehen.
+ *
+ * @param[in] m       Shadow Map.
+ * @param[in] light   Position der Lichtquelle.
+ * @param[in] casters Umgebungskugeln der schattenwerfenden Objekte.
+ * @param[in] n       Anzahl der Umgebungskugeln.
+ * @param[in] far     Groesster Abstand eines Empfaengers vom Licht.
+ *
+ * @return TRUE  wenn gezeichnet werden soll, dann muss shadowMapEnd folgen,
+ *         FALSE wenn kein Objekt einen Schatten werfen kann.
+ */
+extern Boolean shadowMapBegin(ShadowMap * m, Vector3d light, const ShadowMapCaster * casters, int n, double far);
+
+/**
+ * Beendet das Zeichnen der Shadow Map m und stellt Viewport und Matrizen
+ * wieder her.
+ *
+ * @param[in] m Shadow Map.
+ */
+extern void shadowMapEnd(ShadowMap * m);
+
+/**
+ * Dunkelt die von draw gezeichneten Empfaenger dort ab, wo sie von m aus
+ * gesehen im Schatten liegen. Die Empfaenger werden einmal je Abtastung
+ * gezeichnet, mit derselben Geometrie wie vorher, damit der Tiefentest
+ * GL_LEQUAL sie trifft.
+ *
+ * @param[in] m        Shadow Map, im aktuellen Bild gezeichnet.
+ * @param[in] darkness Abdunkelung im vollen Schatten, aus [0, 1].
+ * @param[in] draw     Zeichnet die Empfaenger.
+ * @param[in] data     Daten fuer draw.
+ *
+ * Vorbedingung: die Modelviewmatrix enthaelt nur die Kamera.
+ */
+extern void shadowMapApply(const ShadowMap * m, double darkness, ShadowMapDraw draw, const void * data);
+
+#endif
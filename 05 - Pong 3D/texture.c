@@ -24,6 +24,9 @@
  * -------------------------------------------------------------------------- */
 #include "texture.h"
 #include "cgimage.h"
+#include "textureLoader.h"
+#include "textureCache.h"
+#include "mipmap.h"
 #include "types.h"
 #include "vector.h"
 
@@ -44,6 +47,9 @@ typedef struct {
 /** Anzahl der Texturen. */
 #define TEXTURE_COUNT (TEXTURE_EMPTY)
 
+/** Mipmaps sRGB-korrekt (im linearen Farbraum) mitteln */
+#define TEXTURE_MIPMAP_SRGB (FALSE)
+
 /* ----------------------------------------------------------------------------
  * Macros
  * -------------------------------------------------------------------------- */
@@ -56,6 +62,8 @@ static Boolean texturing = TRUE;
 
 static Texture textures[TEXTURE_COUNT]; /* Texturen */
 
+static GLuint boundTexture = 0; /* Zuletzt mit bindTexture gebundene Textur */
+
 /* ----------------------------------------------------------------------------
  * Funktionen
  * ----------------------------------------------------------------------------
@@ -118,16 +126,23 @@ unsigned calculateGLBitmapMode(CGImage * self)
 
 /**
  * Bindet die Textur texture, so dass sie fuer alle nachfolgende gezeichneten
- * Primitiven verwendet wird.
+ * Primitiven verwendet wird. Ist sie schon gebunden, passiert nichts.
  *
  * @param texture Bezeichner der Textur, die gebunden werden soll.
  */
 extern void bindTexture(TextureName t)
 {
-  texturing
-    ? glBindTexture(GL_TEXTURE_2D, textures[t].id)
-    : glBindTexture(GL_TEXTURE_2D, textures[TEXTURE_EMPTY].id)
-    ;
+  GLuint id = texturing
+            ? textures[t].id
+            : textures[TEXTURE_EMPTY].id
+            ;
+  
+  if (id != boundTexture)
+  {
+    glBindTexture(GL_TEXTURE_2D, id);
+    
+    boundTexture = id;
+  }
 }
 
 /**
@@ -138,45 +153,72 @@ extern void bindTexture(TextureName t)
  */
 extern int loadTextures(void)
 {
-  int i;
-  
-  CGImage * image = NULL;
+  int i
+    , count   = 0
+    , success = 1
+    ;
+
+  char * filenames[TEXTURE_COUNT]; /* Nicht im Cache gefundene Texturen */
+
+  int missing[TEXTURE_COUNT];      /* Zugehoerige Texturindizes        */
+
+  TextureLoaderResult result;
 
   if (initTextureArray())
   {
-    /* Alle Texturen nacheinander laden. */
-    for (i = 0; i < TEXTURE_EMPTY; ++i)
+    /* Zuerst im Cache nachsehen, ... */
+    for (i = 0; i < TEXTURE_COUNT; ++i)
     {
+      glBindTexture(GL_TEXTURE_2D, textures[i].id);
+
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+      if (!textureCacheLoad(textures[i].filename))
+      {
+        filenames[count] = textures[i].filename;
+        missing[count++] = i;
+      }
+    }
+
+    /* ... den Rest parallel dekodieren ... */
+    if (count > 0 && !textureLoaderStart(filenames, count))
+      return 0;
+
+    /* ... in der Reihenfolge der Fertigstellung hochladen und cachen. */
+    while (count > 0 && textureLoaderNext(&result))
+    {
+      i = missing[result.index];
+
       #ifdef DEBUG
-      fprintf(stderr, "DEBUG :: Loading %s.\n", textures[i].filename);
+      fprintf(stderr, "DEBUG :: Loaded %s.\n", textures[i].filename);
       #endif
-      
-      image = CGImage_load(textures[i].filename);
 
-      if (image != NULL)
+      if (result.image != NULL)
       {
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        
-        gluBuild2DMipmaps( GL_TEXTURE_2D
-                         , image->bpp
-                         , image->width
-                         , image->height
-                         , calculateGLBitmapMode(image)
-                         , GL_UNSIGNED_BYTE
-                         , image->data);
-        
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        
-        CGImage_free(image);
+
+        /* Nur vollstaendig gebaute Stufen cachen */
+        if (mipmapBuild2D(result.image, calculateGLBitmapMode(result.image), TEXTURE_MIPMAP_SRGB))
+          textureCacheStore(textures[i].filename, result.image->bpp, calculateGLBitmapMode(result.image));
+        else
+          success = 0;
+
+        CGImage_free(result.image);
       }
       else
-        return 0;
+        success = 0;
     }
-    
-    return 1;
+
+    if (count > 0)
+      textureLoaderFinish();
+
+    /* Beim Laden wurde an bindTexture vorbei gebunden */
+    boundTexture = 0;
+
+    return success;
   }
   else
     return 0;
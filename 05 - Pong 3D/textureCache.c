@@ -0,0 +1,692 @@
+/**
+ * @file
+ *
+ * Das Modul stellt einen Cache auf der Festplatte fuer fertig dekodierte
+ * Texturen samt aller Mipmap-Stufen zur Verfuegung.
+ *
+ * Aufbau einer Cache-Datei (native Byte-Reihenfolge, damit sie direkt
+ * gemappt werden kann):
+ *
+ *   TextureCacheHeader
+ *   TextureCacheLevel[levels]
+ *   Pfad der Quelldatei (pathLength Bytes, nullterminiert)
+ *   Texeldaten aller Stufen, jeweils an TEXTURE_CACHE_ALIGN ausgerichtet
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* mmap, stat & Co. */
+#define _POSIX_C_SOURCE 200112L
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <GL/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "textureCache.h"
+#include "types.h"
+
+/* ----------------------------------------------------------------------------
+ * Typen
+ * -------------------------------------------------------------------------- */
+
+/** Kopf einer Cache-Datei */
+typedef struct {
+  char magic[4];           /* TEXTURE_CACHE_MAGIC                    */
+  unsigned int version     /* TEXTURE_CACHE_VERSION                  */
+             , srcSize     /* Groesse der Quelldatei                 */
+             , srcMtime    /* Aenderungszeit der Quelldatei          */
+             , srcHash     /* FNV-1a Hash ueber den Inhalt der Quelle */
+             , pathLength  /* Laenge des Pfades inkl. Nullbyte        */
+             , components  /* Komponenten der Textur                 */
+             , format      /* Pixelformat der Textur                 */
+             , levels      /* Anzahl der Mipmap-Stufen               */
+             ;
+} TextureCacheHeader;
+
+/** Beschreibung einer Mipmap-Stufe */
+typedef struct {
+  unsigned int width   /* Breite                      */
+             , height  /* Hoehe                       */
+             , offset  /* Beginn der Texel in der Datei */
+             , size    /* Anzahl der Bytes             */
+             ;
+} TextureCacheLevel;
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Verzeichnis des Caches */
+#define TEXTURE_CACHE_DIR "texcache"
+
+/** Kennung und Version des Dateiformats */
+#define TEXTURE_CACHE_MAGIC   "CGTC"
+#define TEXTURE_CACHE_VERSION (2)
+
+/** Maximale Anzahl der Mipmap-Stufen */
+#define TEXTURE_CACHE_LEVELS (16)
+
+/** Ausrichtung der Texeldaten in der Datei */
+#define TEXTURE_CACHE_ALIGN (16)
+
+/** Maximale Kantenlaenge von Stufe 0, damit die Groesse nicht ueberlaeuft */
+#define TEXTURE_CACHE_MAX_SIZE (16384)
+
+/** Parameter des FNV-1a Hashes */
+#define FNV_OFFSET (2166136261U)
+#define FNV_PRIME  (16777619U)
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * -------------------------------------------------------------------------- */
+
+/** Rundet x auf ein Vielfaches von TEXTURE_CACHE_ALIGN auf */
+#define ALIGN(x) (((x) + TEXTURE_CACHE_ALIGN - 1) & ~(TEXTURE_CACHE_ALIGN - 1))
+
+/** Kantenlaenge der naechsten Mipmap-Stufe */
+#define HALVE(x) ((x) > 1 ? (x) / 2 : 1)
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Fuehrt den FNV-1a Hash hash ueber size Bytes von data fort.
+ *
+ * @param[in] hash bisheriger Hash.
+ * @param[in] data Daten.
+ * @param[in] size Anzahl der Bytes.
+ *
+ * @return neuer Hash.
+ */
+static unsigned int hashBytes(unsigned int hash, const unsigned char * data, size_t size)
+{
+  while (size-- > 0)
+    hash = (hash ^ *data++) * FNV_PRIME;
+
+  return hash;
+}
+
+/**
+ * Berechnet den FNV-1a Hash ueber den Inhalt der Datei filename.
+ *
+ * @param[in]  filename Datei.
+ * @param[out] hash     Hash des Inhalts.
+ *
+ * @return TRUE  wenn die Datei gelesen werden konnte
+ *         FALSE sonst.
+ */
+static Boolean hashFile(char * filename, unsigned int * hash)
+{
+  unsigned char buffer[4096];
+
+  size_t n;
+
+  FILE * file = fopen(filename, "rb");
+
+  if (file == NULL)
+    return FALSE;
+
+  *hash = FNV_OFFSET;
+
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    *hash = hashBytes(*hash, buffer, n);
+
+  fclose(file);
+
+  return TRUE;
+}
+
+/**
+ * Bestimmt die Anzahl der Komponenten des Pixelformats format.
+ *
+ * @param[in] format Pixelformat (GL_RGB, GL_RGBA, ...).
+ *
+ * @return Anzahl der Komponenten oder 0 fuer unbekannte Formate.
+ */
+static unsigned int formatComponents(unsigned int format)
+{
+  switch (format)
+  {
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Erzeugt den Namen der Cache-Datei zur Quelldatei filename.
+ * Der Speicher muss vom Aufrufer freigegeben werden.
+ *
+ * @param[in] filename Quelldatei.
+ *
+ * @return Name der Cache-Datei oder NULL.
+ */
+static char * cacheFilename(char * filename)
+{
+  char * name = malloc(strlen(TEXTURE_CACHE_DIR) + 1 + 8 + 4 + 1);
+
+  if (name != NULL)
+    sprintf( name
+           , "%s/%08x.tex"
+           , TEXTURE_CACHE_DIR
+           , hashBytes(FNV_OFFSET, (unsigned char *) filename, strlen(filename))
+           );
+
+  return name;
+}
+
+/**
+ * Prueft, ob der Kopf header samt Stufentabelle zur Quelldatei filename mit
+ * den Eigenschaften src passt und vollstaendig in size Bytes liegt. Jede
+ * Stufe muss genau ihre Texel umfassen und halb so gross wie die vorige
+ * sein, denn beim Laden werden width * height * components Bytes gelesen.
+ *
+ * @param[in] header   Kopf der Cache-Datei.
+ * @param[in] size     Groesse der Cache-Datei.
+ * @param[in] filename Quelldatei.
+ * @param[in] src      Eigenschaften der Quelldatei.
+ *
+ * @return TRUE  wenn der Eintrag gueltig ist
+ *         FALSE sonst.
+ */
+static Boolean cacheValid(TextureCacheHeader * header, size_t size, char * filename, struct stat * src)
+{
+  TextureCacheLevel * level = (TextureCacheLevel *) (header + 1);
+
+  char * path;
+
+  unsigned int i
+             , hash
+             ;
+
+  /* Kopf, Stufentabelle und Pfad muessen in der Datei liegen */
+  if (size < sizeof(TextureCacheHeader)
+   || memcmp(header->magic, TEXTURE_CACHE_MAGIC, 4) != 0
+   || header->version != TEXTURE_CACHE_VERSION
+   || header->levels == 0
+   || header->levels > TEXTURE_CACHE_LEVELS
+   || size < sizeof(TextureCacheHeader) + header->levels * sizeof(TextureCacheLevel) + header->pathLength)
+    return FALSE;
+
+  /* Gleicher Pfad, gleiche Groesse */
+  path = (char *) (level + header->levels);
+
+  if (header->pathLength != strlen(filename) + 1
+   || strcmp(path, filename) != 0
+   || header->srcSize != (unsigned int) src->st_size)
+    return FALSE;
+
+  /* Pixelformat und Komponenten muessen zusammenpassen */
+  if (header->components == 0 || header->components != formatComponents(header->format))
+    return FALSE;
+
+  /* Stufe 0 darf nicht leer und nicht zu gross sein */
+  if (level[0].width  == 0 || level[0].width  > TEXTURE_CACHE_MAX_SIZE
+   || level[0].height == 0 || level[0].height > TEXTURE_CACHE_MAX_SIZE)
+    return FALSE;
+
+  for (i = 0; i < header->levels; ++i)
+  {
+    /* Jede weitere Stufe halbiert die vorige */
+    if (i > 0
+     && (level[i].width  != HALVE(level[i - 1].width)
+      || level[i].height != HALVE(level[i - 1].height)))
+      return FALSE;
+
+    /* Genau die Texel der Stufe, vollstaendig in der Datei */
+    if (level[i].size != level[i].width * level[i].height * header->components
+     || level[i].offset > size
+     || level[i].size > size - level[i].offset)
+      return FALSE;
+  }
+
+  /* Gleiche Aenderungszeit -> billig gueltig, sonst ueber den Inhalt pruefen */
+  if (header->srcMtime == (unsigned int) src->st_mtime)
+    return TRUE;
+
+  return hashFile(filename, &hash) && hash == header->srcHash;
+}
+
+/**
+ * Traegt die Aenderungszeit mtime der Quelldatei in den Kopf der Cache-Datei
+ * name ein, nachdem der Eintrag ueber den Inhalt bestaetigt wurde. So muss
+ * eine nur beruehrte Quelldatei nicht bei jedem Start neu gehasht werden.
+ *
+ * @param[in] name  Cache-Datei.
+ * @param[in] mtime Aenderungszeit der Quelldatei.
+ */
+static void cacheTouch(char * name, unsigned int mtime)
+{
+  int fd = open(name, O_WRONLY);
+
+  if (fd < 0)
+    return;
+
+  if (lseek(fd, offsetof(TextureCacheHeader, srcMtime), SEEK_SET) >= 0
+   && write(fd, &mtime, sizeof(mtime)) == sizeof(mtime))
+  {
+    #ifdef DEBUG
+    fprintf(stderr, "DEBUG :: Texture cache refreshed %s.\n", name);
+    #endif
+  }
+
+  close(fd);
+}
+
+/**
+ * Mappt die Cache-Datei zur Quelldatei filename, sofern sie einen gueltigen
+ * Eintrag enthaelt. Die Abbildung muss vom Aufrufer mit munmap freigegeben
+ * werden.
+ *
+ * @param[in]  filename Quelldatei.
+ * @param[out] size     Groesse der Abbildung.
+ *
+ * @return Kopf des Eintrags oder NULL.
+ */
+static TextureCacheHeader * cacheMap(char * filename, size_t * size)
+{
+  struct stat src
+            , dst
+            ;
+
+  char * name = cacheFilename(filename);
+
+  void * map = MAP_FAILED;
+
+  int fd;
+
+  if (name == NULL)
+    return NULL;
+
+  fd = open(name, O_RDONLY);
+
+  if (fd < 0)
+  {
+    free(name);
+    return NULL;
+  }
+
+  if (stat(filename, &src) == 0 && fstat(fd, &dst) == 0 && dst.st_size > 0)
+  {
+    map   = mmap(NULL, dst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    *size = dst.st_size;
+
+    if (map != MAP_FAILED && !cacheValid(map, dst.st_size, filename, &src))
+    {
+      munmap(map, dst.st_size);
+      map = MAP_FAILED;
+    }
+
+    /* Ueber den Hash bestaetigt -> neue Aenderungszeit merken */
+    if (map != MAP_FAILED && ((TextureCacheHeader *) map)->srcMtime != (unsigned int) src.st_mtime)
+      cacheTouch(name, (unsigned int) src.st_mtime);
+  }
+
+  close(fd);
+
+  free(name);
+
+  return map != MAP_FAILED
+       ? map
+       : NULL
+       ;
+}
+
+/**
+ * Schreibt die Stufen level als Eintrag zur Quelldatei filename in den
+ * Cache. Die Texel aller Stufen liegen dicht gepackt hintereinander in data.
+ *
+ * @param[in] filename   Quelldatei der Textur.
+ * @param[in] components Anzahl der Komponenten der Textur.
+ * @param[in] format     Pixelformat der Textur (GL_RGB, GL_RGBA, ...).
+ * @param[in] level      Ausmasse der Stufen, Lage und Groesse werden hier
+ *                       ergaenzt.
+ * @param[in] levels     Anzahl der Stufen.
+ * @param[in] data       Texel aller Stufen.
+ *
+ * @return TRUE  wenn der Eintrag geschrieben wurde
+ *         FALSE sonst.
+ */
+static Boolean cacheWrite(char * filename, GLint components, GLenum format, TextureCacheLevel * level, unsigned int levels, const unsigned char * data)
+{
+  TextureCacheHeader header;
+
+  struct stat src;
+
+  unsigned int i
+             , offset
+             , pos
+             ;
+
+  unsigned char zero[TEXTURE_CACHE_ALIGN];
+
+  char * name
+     , * tmp
+     ;
+
+  Boolean success = FALSE;
+
+  FILE * file;
+
+  if (levels == 0 || stat(filename, &src) != 0)
+    return FALSE;
+
+  /* Kopf befuellen */
+  memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+  header.version    = TEXTURE_CACHE_VERSION;
+  header.srcSize    = (unsigned int) src.st_size;
+  header.srcMtime   = (unsigned int) src.st_mtime;
+  header.pathLength = strlen(filename) + 1;
+  header.components = components;
+  header.format     = format;
+  header.levels     = levels;
+
+  if (!hashFile(filename, &header.srcHash))
+    return FALSE;
+
+  /* Lage der Texel in der Datei */
+  offset = ALIGN(sizeof(TextureCacheHeader) + header.levels * sizeof(TextureCacheLevel) + header.pathLength);
+
+  for (i = 0; i < header.levels; ++i)
+  {
+    level[i].size   = level[i].width * level[i].height * components;
+    level[i].offset = offset;
+    offset = ALIGN(offset + level[i].size);
+  }
+
+  memset(zero, 0, TEXTURE_CACHE_ALIGN);
+
+  mkdir(TEXTURE_CACHE_DIR, 0755);
+
+  name = cacheFilename(filename);
+  tmp  = malloc(strlen(TEXTURE_CACHE_DIR) + 1 + 8 + 4 + 1 + 20 + 4 + 1);
+
+  if (name != NULL && tmp != NULL)
+  {
+    /* Erst in eine temporaere Datei schreiben, dann umbenennen. Die PID
+     * trennt Prozesse, die denselben Eintrag gleichzeitig schreiben. */
+    sprintf(tmp, "%s.%ld.tmp", name, (long) getpid());
+
+    file = fopen(tmp, "wb");
+
+    if (file != NULL)
+    {
+      success = fwrite(&header, sizeof(header), 1, file) == 1
+             && fwrite(level, sizeof(TextureCacheLevel), header.levels, file) == header.levels
+             && fwrite(filename, 1, header.pathLength, file) == header.pathLength
+             ;
+
+      pos = sizeof(header) + header.levels * sizeof(TextureCacheLevel) + header.pathLength;
+
+      for (i = 0; success && i < header.levels; ++i)
+      {
+        /* Bis zum Beginn der Stufe mit Nullen auffuellen */
+        success = fwrite(zero, 1, level[i].offset - pos, file) == level[i].offset - pos
+               && fwrite(data, 1, level[i].size, file) == level[i].size
+               ;
+
+        data += level[i].size;
+        pos   = level[i].offset + level[i].size;
+      }
+
+      fclose(file);
+
+      if (success)
+        success = rename(tmp, name) == 0;
+      else
+        remove(tmp);
+    }
+  }
+
+  free(name);
+  free(tmp);
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Texture cache %s %s.\n", success ? "stored" : "failed to store", filename);
+  #endif
+
+  return success;
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Laedt die Textur zur Quelldatei filename aus dem Cache und laedt alle
+ * Mipmap-Stufen in die gerade gebundene Textur hoch.
+ *
+ * @param[in] filename Quelldatei der Textur.
+ *
+ * @return TRUE  wenn die Textur aus dem Cache geladen wurde
+ *         FALSE wenn kein gueltiger Eintrag existiert.
+ */
+extern Boolean textureCacheLoad(char * filename)
+{
+  size_t size;
+
+  TextureCacheHeader * header = cacheMap(filename, &size);
+
+  if (header != NULL)
+  {
+    TextureCacheLevel * level = (TextureCacheLevel *) (header + 1);
+
+    unsigned int i;
+
+    /* Stufen liegen dicht gepackt in der Datei */
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (i = 0; i < header->levels; ++i)
+      glTexImage2D( GL_TEXTURE_2D
+                  , i
+                  , header->components
+                  , level[i].width
+                  , level[i].height
+                  , 0
+                  , header->format
+                  , GL_UNSIGNED_BYTE
+                  , (unsigned char *) header + level[i].offset);
+
+    glPopClientAttrib();
+
+    munmap(header, size);
+  }
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Texture cache %s for %s.\n", header != NULL ? "hit" : "miss", filename);
+  #endif
+
+  return header != NULL;
+}
+
+/**
+ * Laedt die Kachel zur Quelldatei filename aus dem Cache in die gerade
+ * gebundene Textur. Ihr Platz wird erst ueber place angefordert, wenn ein
+ * gueltiger Eintrag gefunden wurde.
+ *
+ * @param[in] filename Quelldatei der Kachel.
+ * @param[in] place    Bestimmt den Platz der Kachel.
+ * @param[in] user     Wird an place durchgereicht.
+ *
+ * @return TRUE  wenn die Kachel aus dem Cache geladen wurde
+ *         FALSE wenn kein passender Eintrag existiert.
+ */
+extern Boolean textureCacheLoadTile(char * filename, TextureCachePlace place, void * user)
+{
+  Boolean hit = FALSE;
+
+  size_t size;
+
+  GLint x
+      , y
+      ;
+
+  TextureCacheHeader * header = cacheMap(filename, &size);
+
+  if (header != NULL)
+  {
+    TextureCacheLevel * level = (TextureCacheLevel *) (header + 1);
+
+    unsigned int i;
+
+    if (place(user, level[0].width, level[0].height, header->levels, &x, &y))
+    {
+      glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+      for (i = 0; i < header->levels; ++i)
+        glTexSubImage2D( GL_TEXTURE_2D
+                       , i
+                       , x >> i
+                       , y >> i
+                       , level[i].width
+                       , level[i].height
+                       , header->format
+                       , GL_UNSIGNED_BYTE
+                       , (unsigned char *) header + level[i].offset);
+
+      glPopClientAttrib();
+
+      hit = TRUE;
+    }
+
+    munmap(header, size);
+  }
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Texture cache %s for tile %s.\n", hit ? "hit" : "miss", filename);
+  #endif
+
+  return hit;
+}
+
+/**
+ * Liest alle Mipmap-Stufen der gerade gebundenen Textur zurueck und legt sie
+ * als Eintrag zur Quelldatei filename im Cache ab.
+ *
+ * @param[in] filename   Quelldatei der Textur.
+ * @param[in] components Anzahl der Komponenten der Textur.
+ * @param[in] format     Pixelformat der Textur (GL_RGB, GL_RGBA, ...).
+ *
+ * @return TRUE  wenn der Eintrag geschrieben wurde
+ *         FALSE sonst.
+ */
+extern Boolean textureCacheStore(char * filename, GLint components, GLenum format)
+{
+  TextureCacheLevel level[TEXTURE_CACHE_LEVELS];
+
+  unsigned int levels = 0
+             , size   = 0
+             , i
+             ;
+
+  unsigned char * data
+              , * p
+              ;
+
+  Boolean success;
+
+  GLint width
+      , height
+      ;
+
+  /* Stufen abzaehlen, bis GL keine weitere mehr kennt */
+  do
+  {
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, levels, GL_TEXTURE_WIDTH,  &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, levels, GL_TEXTURE_HEIGHT, &height);
+
+    if (width > 0 && height > 0)
+    {
+      level[levels].width  = width;
+      level[levels].height = height;
+      size += width * height * components;
+      ++levels;
+    }
+  }
+  while (width > 0 && height > 0 && (width > 1 || height > 1) && levels < TEXTURE_CACHE_LEVELS);
+
+  if (levels == 0 || (data = malloc(size)) == NULL)
+    return FALSE;
+
+  /* Die Textur gehoert ganz zum Eintrag, also alle Stufen zuruecklesen */
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  for (i = 0, p = data; i < levels; ++i)
+  {
+    glGetTexImage(GL_TEXTURE_2D, i, format, GL_UNSIGNED_BYTE, p);
+    p += level[i].width * level[i].height * components;
+  }
+
+  glPopClientAttrib();
+
+  success = cacheWrite(filename, components, format, level, levels, data);
+
+  free(data);
+
+  return success;
+}
+
+/**
+ * Legt die Stufen 0 bis levels - 1 einer Kachel als Eintrag zur Quelldatei
+ * filename im Cache ab. Stufe i ist width >> i x height >> i Texel gross,
+ * alle Stufen liegen dicht gepackt hintereinander in data, so wie sie eben
+ * hochgeladen wurden. Es wird nichts aus GL zurueckgelesen.
+ *
+ * @param[in] filename   Quelldatei der Kachel.
+ * @param[in] components Anzahl der Komponenten der Textur.
+ * @param[in] format     Pixelformat der Textur (GL_RGB, GL_RGBA, ...).
+ * @param[in] width      Breite der Kachel auf Stufe 0.
+ * @param[in] height     Hoehe der Kachel auf Stufe 0.
+ * @param[in] levels     Anzahl der Stufen.
+ * @param[in] data       Texel aller Stufen.
+ *
+ * @return TRUE  wenn der Eintrag geschrieben wurde
+ *         FALSE sonst.
+ */
+extern Boolean textureCacheStoreTile(char * filename, GLint components, GLenum format, GLsizei width, GLsizei height, GLint levels, const unsigned char * data)
+{
+  TextureCacheLevel level[TEXTURE_CACHE_LEVELS];
+
+  int i;
+
+  if (levels < 1 || levels > TEXTURE_CACHE_LEVELS || data == NULL)
+    return FALSE;
+
+  for (i = 0; i < levels; ++i)
+  {
+    level[i].width  = width  >> i;
+    level[i].height = height >> i;
+  }
+
+  return cacheWrite(filename, components, format, level, levels, data);
+}
@@ -0,0 +1,92 @@
+#ifndef __TEXTURECACHE_H__
+#define __TEXTURECACHE_H__
+/**
+ * @file
+ *
+ * Das Modul stellt einen Cache auf der Festplatte fuer fertig dekodierte
+ * Texturen samt aller Mipmap-Stufen zur Verfuegung.
+ * Ein Eintrag gehoert zu einer Quelldatei und ist gueltig, solange Pfad,
+ * Groesse und Aenderungszeit (oder ersatzweise der Inhalt) der Quelldatei
+ * uebereinstimmen.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+#include <GL/gl.h>
+
+#include "types.h"
+
+/**
+ * Bestimmt den Platz einer Kachel, die mit levels Stufen und den Ausmassen
+ * width x height (Stufe 0) aus dem Cache geladen werden soll.
+ *
+ * @param[in]  user   Daten des Aufrufers.
+ * @param[in]  width  Breite der Kachel auf Stufe 0.
+ * @param[in]  height Hoehe der Kachel auf Stufe 0.
+ * @param[in]  levels Anzahl der Stufen des Eintrags.
+ * @param[out] x      Linke Kante der Kachel auf Stufe 0.
+ * @param[out] y      Obere Kante der Kachel auf Stufe 0.
+ *
+ * @return TRUE  wenn die Kachel geladen werden soll
+ *         FALSE wenn der Eintrag nicht passt.
+ */
+typedef Boolean (* TextureCachePlace)(void * user, GLsizei width, GLsizei height, GLint levels, GLint * x, GLint * y);
+
+/**
+ * Laedt die Textur zur Quelldatei filename aus dem Cache und laedt alle
+ * Mipmap-Stufen in die gerade gebundene Textur hoch.
+ *
+ * @param[in] filename Quelldatei der Textur.
+ *
+ * @return TRUE  wenn die Textur aus dem Cache geladen wurde
+ *         FALSE wenn kein gueltiger Eintrag existiert.
+ */
+extern Boolean textureCacheLoad(char * filename);
+
+/**
+ * Laedt die Kachel zur Quelldatei filename aus dem Cache in die gerade
+ * gebundene Textur, deren Stufen bereits angelegt sein muessen. Ihr Platz
+ * wird ueber place angefordert, sobald ein gueltiger Eintrag gefunden wurde.
+ *
+ * @param[in] filename Quelldatei der Kachel.
+ * @param[in] place    Bestimmt den Platz der Kachel.
+ * @param[in] user     Wird an place durchgereicht.
+ *
+ * @return TRUE  wenn die Kachel aus dem Cache geladen wurde
+ *         FALSE wenn kein passender Eintrag existiert.
+ */
+extern Boolean textureCacheLoadTile(char * filename, TextureCachePlace place, void * user);
+
+/**
+ * Liest alle Mipmap-Stufen der gerade gebundenen Textur zurueck und legt sie
+ * als Eintrag zur Quelldatei filename im Cache ab.
+ *
+ * @param[in] filename   Quelldatei der Textur.
+ * @param[in] components Anzahl der Komponenten der Textur.
+ * @param[in] format     Pixelformat der Textur (GL_RGB, GL_RGBA, ...).
+ *
+ * @return TRUE  wenn der Eintrag geschrieben wurde
+ *         FALSE sonst.
+ */
+extern Boolean textureCacheStore(char * filename, GLint components, GLenum format);
+
+/**
+ * Legt die Stufen 0 bis levels - 1 einer Kachel als Eintrag zur Quelldatei
+ * filename im Cache ab. Stufe i ist width >> i x height >> i Texel gross,
+ * alle Stufen liegen dicht gepackt hintereinander in data, so wie sie eben
+ * hochgeladen wurden. Es wird nichts aus GL zurueckgelesen.
+ *
+ * @param[in] filename   Quelldatei der Kachel.
+ * @param[in] components Anzahl der Komponenten der Textur.
+ * @param[in] format     Pixelformat der Textur (GL_RGB, GL_RGBA, ...).
+ * @param[in] width      Breite der Kachel auf Stufe 0.
+ * @param[in] height     Hoehe der Kachel auf Stufe 0.
+ * @param[in] levels     Anzahl der Stufen.
+ * @param[in] data       Texel aller Stufen.
+ *
+ * @return TRUE  wenn der Eintrag geschrieben wurde
+ *         FALSE sonst.
+ */
+extern Boolean textureCacheStoreTile(char * filename, GLint components, GLenum format, GLsizei width, GLsizei height, GLint levels, const unsigned char * data);
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * @file
+ *
+ * Das Modul dekodiert Bilddateien parallel auf mehreren Threads.
+ * Die fertigen Bilder werden ueber eine Warteschlange an den GL-Thread
+ * uebergeben, der sie dann hochladen kann.
+ *
+ * @author Christopher Blöcker
+ * @author Julius Beckmann
+ */
+
+/* ----------------------------------------------------------------------------
+ * System Header einbinden
+ * -------------------------------------------------------------------------- */
+#include <pthread.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Eigene Header einbinden
+ * -------------------------------------------------------------------------- */
+#include "textureLoader.h"
+#include "cgimage.h"
+
+/* ----------------------------------------------------------------------------
+ * Konstanten
+ * -------------------------------------------------------------------------- */
+
+/** Maximale Anzahl der Threads, die gleichzeitig dekodieren. */
+#define TEXTURE_LOADER_THREADS (4)
+
+/* ----------------------------------------------------------------------------
+ * Globale Daten
+ * -------------------------------------------------------------------------- */
+
+/* Zu ladende Dateien */
+static char ** loaderFiles = NULL;
+
+static int loaderCount         = 0    /* Anzahl der Dateien                  */
+         , loaderNextJob       = 0    /* Naechste noch nicht vergebene Datei */
+         , loaderDone          = 0    /* Anzahl fertiger Bilder in der Queue */
+         , loaderDelivered     = 0    /* Anzahl abgeholter Bilder            */
+         , loaderThreads       = 0    /* Anzahl laufender Threads            */
+         ;
+
+/* Fertige Bilder in der Reihenfolge ihrer Fertigstellung */
+static TextureLoaderResult * loaderQueue = NULL;
+
+static pthread_t loaderThread[TEXTURE_LOADER_THREADS];
+
+static pthread_mutex_t loaderMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  loaderReady = PTHREAD_COND_INITIALIZER;
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Static
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Arbeitsschleife eines Threads.
+ * Holt sich so lange Dateien ab, bis alle vergeben sind, dekodiert sie und
+ * haengt die Ergebnisse an die Queue an.
+ *
+ * @param[in] arg unbenutzt.
+ *
+ * @return NULL.
+ */
+static void * loaderWork(void * arg)
+{
+  int i;
+
+  CGImage * image;
+
+  for (;;)
+  {
+    /* Naechste Datei abholen */
+    pthread_mutex_lock(&loaderMutex);
+    i = loaderNextJob < loaderCount
+      ? loaderNextJob++
+      : -1
+      ;
+    pthread_mutex_unlock(&loaderMutex);
+
+    if (i < 0)
+      return NULL;
+
+    /* Dekodieren ohne Lock */
+    image = CGImage_load(loaderFiles[i]);
+
+    /* Ergebnis einreihen und den GL-Thread wecken */
+    pthread_mutex_lock(&loaderMutex);
+    loaderQueue[loaderDone].index = i;
+    loaderQueue[loaderDone].image = image;
+    ++loaderDone;
+    pthread_cond_signal(&loaderReady);
+    pthread_mutex_unlock(&loaderMutex);
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Funktionen
+ * ----------------------------------------------------------------------------
+ * Exportiert
+ * -------------------------------------------------------------------------- */
+
+/**
+ * Startet das Dekodieren der count Dateien filenames.
+ * Es kann immer nur ein Ladevorgang gleichzeitig laufen.
+ *
+ * @param[in] filenames Namen der zu ladenden Dateien.
+ * @param[in] count     Anzahl der Dateien.
+ *
+ * @return 1 wenn das Laden gestartet wurde
+ *         0 sonst.
+ */
+extern int textureLoaderStart(char ** filenames, int count)
+{
+  assert(loaderQueue == NULL);
+
+  loaderQueue = malloc(count * sizeof(TextureLoaderResult));
+
+  if (loaderQueue == NULL)
+    return 0;
+
+  loaderFiles     = filenames;
+  loaderCount     = count;
+  loaderNextJob   = 0;
+  loaderDone      = 0;
+  loaderDelivered = 0;
+  loaderThreads   = 0;
+
+  /* Threads starten, schlaegt das fehl, wird in textureLoaderNext geladen */
+  while (loaderThreads < TEXTURE_LOADER_THREADS && loaderThreads < count
+      && pthread_create(&loaderThread[loaderThreads], NULL, loaderWork, NULL) == 0)
+    ++loaderThreads;
+
+  #ifdef DEBUG
+  fprintf(stderr, "DEBUG :: Decoding %i images on %i threads.\n", count, loaderThreads);
+  #endif
+
+  return 1;
+}
+
+/**
+ * Wartet auf das naechste fertig dekodierte Bild und gibt es in result
+ * zurueck. Die Reihenfolge entspricht der Fertigstellung, nicht der Reihenfolge
+ * der Dateinamen. Das Bild gehoert danach dem Aufrufer.
+ *
+ * @param[out] result Fertiges Bild.
+ *
+ * @return 1 wenn ein Bild geliefert wurde
+ *         0 wenn alle Bilder abgeholt wurden.
+ */
+extern int textureLoaderNext(TextureLoaderResult * result)
+{
+  if (loaderDelivered >= loaderCount)
+    return 0;
+
+  /* Ohne Threads im aufrufenden Thread dekodieren */
+  if (loaderThreads == 0)
+  {
+    result->index = loaderNextJob++;
+    result->image = CGImage_load(loaderFiles[result->index]);
+  }
+  else
+  {
+    pthread_mutex_lock(&loaderMutex);
+
+    while (loaderDelivered == loaderDone)
+      pthread_cond_wait(&loaderReady, &loaderMutex);
+
+    *result = loaderQueue[loaderDelivered];
+
+    pthread_mutex_unlock(&loaderMutex);
+  }
+
+  ++loaderDelivered;
+
+  return 1;
+}
+
+/**
+ * Beendet den Ladevorgang, wartet auf alle Threads und gibt nicht abgeholte
+ * Bilder frei.
+ */
+extern void textureLoaderFinish(void)
+{
+  int i;
+
+  /* Keine neuen Dateien mehr vergeben */
+  pthread_mutex_lock(&loaderMutex);
+  loaderNextJob = loaderCount;
+  pthread_mutex_unlock(&loaderMutex);
+
+  for (i = 0; i < loaderThreads; ++i)
+    pthread_join(loaderThread[i], NULL);
+
+  /* Liegengebliebene Bilder freigeben */
+  for (i = loaderDelivered; i < loaderDone; ++i)
+    if (loaderQueue[i].image != NULL)
+      CGImage_free(loaderQueue[i].image);
+
+  free(loaderQueue);
+
+  loaderQueue   = NULL;
+  loaderFiles   = NULL;
+  loaderCount   = 0;
+  loaderThreads = 0;
+}